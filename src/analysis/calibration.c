@@ -0,0 +1,711 @@
+#include "calibration.h"
+#include "sampling.h"
+
+/*
+Measurement files
+
+Comma-separated values, with a header naming the columns. Columns named after a command-line option of the desalination module are the
+operating conditions of each point (the command-line values are used for the conditions not in the file), columns named after an unknown
+of the plant system or a KPI are measurements, and any other column (e.g. a timestamp) is ignored. Empty fields are missing values. Lines
+starting with # are comments. Measured mass_flux is the unknown, in kg/m²s, and permeate_flux the KPI, in kg/m²h.
+*/
+
+PetscErrorCode MeasurementSplit(char line[], char *fields[], PetscInt *num_fields)
+{
+    PetscFunctionBeginUser;
+
+    char *field = line, *end;
+
+    *num_fields = 0;
+
+    while (field)
+    {
+        end = strchr(field, ',');
+
+        if (end)
+            *end = '\0';
+
+        // Trimming blanks and line endings
+        while (*field == ' ' || *field == '\t')
+            field++;
+        for (char *c = field + strlen(field); c > field && (c[-1] == ' ' || c[-1] == '\t' || c[-1] == '\r' || c[-1] == '\n'); c--)
+            c[-1] = '\0';
+
+        PetscCheck(*num_fields < MAX_COLUMNS, PETSC_COMM_SELF, PETSC_ERR_ARG_SIZ, "More than %d columns in a measurement file", MAX_COLUMNS);
+
+        fields[(*num_fields)++] = field;
+        field = end ? end + 1 : NULL;
+    }
+
+    return 0;
+}
+
+PetscErrorCode MeasurementSetRead(MeasurementSet *measurements, const char file[], DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    FILE *fptr;
+    char line[16384], *fields[MAX_COLUMNS], *end;
+    PetscReal *parameter;
+    PetscInt num_fields, capacity = 1024, line_number = 0, i, k;
+    PetscBool match;
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "r", &fptr));
+
+    // Header, after the leading comments
+    do
+    {
+        PetscCheck(fgets(line, sizeof(line), fptr), PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "No header in measurement file %s", file);
+        line_number++;
+    } while (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0');
+
+    PetscCall(MeasurementSplit(line, fields, &num_fields));
+
+    measurements->num_columns = num_fields;
+    measurements->num_outputs = 0;
+
+    for (i = 0; i < num_fields; i++)
+    {
+        PetscStrncpy(measurements->name[i], fields[i], sizeof(measurements->name[i]));
+        measurements->type[i] = COLUMN_IGNORED;
+        measurements->index[i] = -1;
+
+        for (k = 0; k < NUM_VAR && measurements->type[i] == COLUMN_IGNORED; k++)
+        {
+            PetscStrcmp(fields[i], dessal_state_names[k], &match);
+            if (match)
+            {
+                measurements->type[i] = COLUMN_STATE;
+                measurements->index[i] = k;
+            }
+        }
+
+        for (k = 0; k < NUM_KPI && measurements->type[i] == COLUMN_IGNORED; k++)
+        {
+            PetscStrcmp(fields[i], kpi_names[k], &match);
+            if (match)
+            {
+                measurements->type[i] = COLUMN_KPI;
+                measurements->index[i] = k;
+            }
+        }
+
+        if (measurements->type[i] == COLUMN_IGNORED)
+        {
+            DessalDataFindParameter(dessal_data, fields[i], &parameter);
+            if (parameter)
+                measurements->type[i] = COLUMN_INPUT;
+        }
+
+        if (measurements->type[i] == COLUMN_STATE || measurements->type[i] == COLUMN_KPI)
+            measurements->num_outputs++;
+    }
+
+    PetscCheck(measurements->num_outputs > 0, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "No measured quantity in the header of %s", file);
+
+    measurements->num_rows = 0;
+    PetscMalloc1(capacity * measurements->num_columns, &measurements->data);
+
+    while (fgets(line, sizeof(line), fptr))
+    {
+        line_number++;
+
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        PetscCall(MeasurementSplit(line, fields, &num_fields));
+
+        PetscCheck(num_fields == measurements->num_columns, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED,
+                   "Line %d of %s has %d fields instead of %d", (int)line_number, file, (int)num_fields, (int)measurements->num_columns);
+
+        if (measurements->num_rows == capacity)
+        {
+            capacity *= 2;
+            PetscRealloc(capacity * measurements->num_columns * sizeof(PetscReal), &measurements->data);
+        }
+
+        for (i = 0; i < num_fields; i++)
+        {
+            PetscReal *value = &measurements->data[measurements->num_rows * measurements->num_columns + i];
+
+            if (fields[i][0] == '\0' || measurements->type[i] == COLUMN_IGNORED)
+            {
+                *value = NAN;
+                continue;
+            }
+
+            *value = (PetscReal)strtod(fields[i], &end);
+
+            PetscCheck(*end == '\0', PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Invalid number '%s' in line %d of %s", fields[i],
+                       (int)line_number, file);
+        }
+
+        measurements->num_rows++;
+    }
+
+    PetscFClose(PETSC_COMM_SELF, fptr);
+
+    return 0;
+}
+
+PetscErrorCode MeasurementSetApply(MeasurementSet *measurements, PetscInt row, EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *parameter, value;
+    PetscInt i;
+
+    for (i = 0; i < measurements->num_columns; i++)
+    {
+        value = measurements->data[row * measurements->num_columns + i];
+
+        if (measurements->type[i] != COLUMN_INPUT || PetscIsNanReal(value))
+            continue;
+
+        DessalDataGetParameter(&entry_data->dessal_data, measurements->name[i], &parameter);
+        *parameter = value;
+    }
+
+    return 0;
+}
+
+PetscErrorCode MeasurementSetPredict(MeasurementSet *measurements, const PetscReal state[], DessalData *dessal_data, PetscReal output[])
+{
+    PetscFunctionBeginUser;
+
+    PlantKPIs kpis;
+    PetscReal kpi_array[NUM_KPI];
+    PetscInt i, j = 0;
+
+    ComputeKPIs(state, dessal_data, &kpis);
+    KPIsToArray(&kpis, kpi_array);
+
+    for (i = 0; i < measurements->num_columns; i++)
+        if (measurements->type[i] == COLUMN_STATE)
+            output[j++] = state[measurements->index[i]];
+        else if (measurements->type[i] == COLUMN_KPI)
+            output[j++] = kpi_array[measurements->index[i]];
+
+    return 0;
+}
+
+PetscErrorCode MeasurementSetDestroy(MeasurementSet *measurements)
+{
+    PetscFunctionBeginUser;
+
+    PetscFree(measurements->data);
+
+    return 0;
+}
+
+/*
+Dense linear algebra for the normal equations, which are as small as the number of fitted parameters
+*/
+
+PetscBool DenseSolve(PetscInt n, const PetscReal matrix[], const PetscReal rhs[], PetscReal solution[])
+{
+    PetscReal a[MAX_FITTED * MAX_FITTED], b[MAX_FITTED], pivot, factor, swap;
+    PetscInt i, j, k, p;
+
+    for (i = 0; i < n * n; i++)
+        a[i] = matrix[i];
+    for (i = 0; i < n; i++)
+        b[i] = rhs[i];
+
+    // Gaussian elimination with partial pivoting
+    for (k = 0; k < n; k++)
+    {
+        for (p = k, i = k + 1; i < n; i++)
+            if (PetscAbsReal(a[i * n + k]) > PetscAbsReal(a[p * n + k]))
+                p = i;
+
+        pivot = a[p * n + k];
+
+        if (!(PetscAbsReal(pivot) > 0.0))
+            return PETSC_FALSE;
+
+        if (p != k)
+        {
+            for (j = 0; j < n; j++)
+            {
+                swap = a[k * n + j];
+                a[k * n + j] = a[p * n + j];
+                a[p * n + j] = swap;
+            }
+
+            swap = b[k];
+            b[k] = b[p];
+            b[p] = swap;
+        }
+
+        for (i = k + 1; i < n; i++)
+        {
+            factor = a[i * n + k] / pivot;
+
+            for (j = k; j < n; j++)
+                a[i * n + j] -= factor * a[k * n + j];
+
+            b[i] -= factor * b[k];
+        }
+    }
+
+    for (i = n - 1; i >= 0; i--)
+    {
+        solution[i] = b[i];
+
+        for (j = i + 1; j < n; j++)
+            solution[i] -= a[i * n + j] * solution[j];
+
+        solution[i] /= a[i * n + i];
+    }
+
+    return PETSC_TRUE;
+}
+
+/*
+Weighted least-squares objective and its Gauss-Newton approximation
+
+For every measured point, the plant is solved with the current parameters and the weighted residuals r = (prediction - measurement) / sigma
+are accumulated into the cost r'r, the gradient J'r and the normal matrix J'J, J being the derivatives of the residuals with respect to the
+parameters relative to their nominal values. J is obtained from the sensitivities of the solution (PlantSensitivity, one linear solve per
+parameter and no new nonlinear solve), propagated to the predictions by a directional finite difference. The points are split in
+contiguous blocks among the MPI ranks and the sums are reduced on all of them.
+*/
+
+// Data structure containing the setup of a calibration
+typedef struct
+{
+    MeasurementSet measurements;
+    PetscInt num_params, first_row, last_row;
+    char *names[MAX_FITTED];
+    PetscReal nominal[MAX_FITTED], sigma[MAX_COLUMNS];
+    PetscBool *active;
+} CalibrationCtx;
+
+// Data structure containing the least-squares objective at given parameters
+typedef struct
+{
+    PetscReal cost, normal[MAX_FITTED * MAX_FITTED], gradient[MAX_FITTED], sum_squares[MAX_COLUMNS], count[MAX_COLUMNS];
+    PetscInt failed;
+} CalibrationObjective;
+
+PetscErrorCode CalibrationEvaluate(CalibrationCtx *calib, SolverCtx *solver_ctx, EntryData *entry_data, const PetscReal theta[],
+                                   PetscReal states[], PetscBool drop_failed, CalibrationObjective *objective)
+{
+    PetscFunctionBeginUser;
+
+    MeasurementSet *measurements = &calib->measurements;
+    SNESConvergedReason reason;
+    EntryData case_data, shifted_data;
+    PetscReal state[NUM_VAR], shifted[NUM_VAR], sensitivity[MAX_FITTED * NUM_VAR];
+    PetscReal output[MAX_COLUMNS], shifted_output[MAX_COLUMNS], measured[MAX_COLUMNS], residual[MAX_COLUMNS], jacobian[MAX_COLUMNS * MAX_FITTED];
+    PetscReal *parameter, *warm, step;
+    PetscInt n = calib->num_params, num_outputs = measurements->num_outputs, row, local, i, j, k;
+
+    PetscMemzero(objective, sizeof(CalibrationObjective));
+
+    for (row = calib->first_row; row < calib->last_row; row++)
+    {
+        local = row - calib->first_row;
+
+        if (!calib->active[local])
+            continue;
+
+        case_data = *entry_data;
+        MeasurementSetApply(measurements, row, &case_data);
+
+        for (i = 0; i < n; i++)
+        {
+            DessalDataGetParameter(&case_data.dessal_data, calib->names[i], &parameter);
+            *parameter = theta[i] * calib->nominal[i];
+        }
+
+        warm = &states[local * NUM_VAR];
+
+        PlantSolveCase(solver_ctx, &case_data, warm, state, &reason);
+
+        if (reason <= 0)
+        {
+            if (drop_failed)
+                calib->active[local] = PETSC_FALSE;
+            else
+                objective->failed++;
+
+            continue;
+        }
+
+        for (k = 0; k < NUM_VAR; k++)
+            warm[k] = state[k];
+
+        // Weighted residuals, missing measurements being skipped
+        MeasurementSetPredict(measurements, state, &case_data.dessal_data, output);
+
+        for (i = 0, j = 0; i < measurements->num_columns; i++)
+            if (measurements->type[i] == COLUMN_STATE || measurements->type[i] == COLUMN_KPI)
+                measured[j++] = measurements->data[row * measurements->num_columns + i];
+
+        for (j = 0; j < num_outputs; j++)
+        {
+            if (PetscIsNanReal(measured[j]))
+            {
+                residual[j] = 0.0;
+                continue;
+            }
+
+            residual[j] = (output[j] - measured[j]) / calib->sigma[j];
+            objective->cost += residual[j] * residual[j];
+            objective->sum_squares[j] += (output[j] - measured[j]) * (output[j] - measured[j]);
+            objective->count[j] += 1.0;
+        }
+
+        // Derivatives of the residuals with respect to the relative parameters
+        PetscCall(PlantSensitivity(solver_ctx, state, (const char *const *)calib->names, n, sensitivity));
+
+        for (i = 0; i < n; i++)
+        {
+            shifted_data = case_data;
+            DessalDataGetParameter(&shifted_data.dessal_data, calib->names[i], &parameter);
+
+            step = PETSC_SQRT_MACHINE_EPSILON * PetscMax(PetscAbsReal(*parameter), PETSC_SMALL);
+            *parameter += step;
+
+            for (k = 0; k < NUM_VAR; k++)
+                shifted[k] = state[k] + step * sensitivity[i * NUM_VAR + k];
+
+            MeasurementSetPredict(measurements, shifted, &shifted_data.dessal_data, shifted_output);
+
+            for (j = 0; j < num_outputs; j++)
+                jacobian[j * n + i] = PetscIsNanReal(measured[j]) ? 0.0
+                                                                   : (shifted_output[j] - output[j]) / step * calib->nominal[i] / calib->sigma[j];
+        }
+
+        for (i = 0; i < n; i++)
+            for (j = 0; j < num_outputs; j++)
+            {
+                objective->gradient[i] += jacobian[j * n + i] * residual[j];
+
+                for (k = 0; k < n; k++)
+                    objective->normal[i * n + k] += jacobian[j * n + i] * jacobian[j * n + k];
+            }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &objective->cost, 1, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, objective->normal, n * n, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, objective->gradient, n, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, objective->sum_squares, num_outputs, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, objective->count, num_outputs, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &objective->failed, 1, MPIU_INT, MPIU_SUM, PETSC_COMM_WORLD);
+
+    return 0;
+}
+
+/*
+Calibration by the Levenberg-Marquardt method
+
+The parameters are fitted relative to their nominal values, theta = p / p_nominal, starting from theta = 1. Each iteration solves the
+damped normal equations (J'J + lambda diag(J'J)) delta = -J'r; the step is accepted if all points converge and the cost decreases, in which
+case the damping is reduced, and rejected otherwise, in which case the damping is increased. Only the accepted steps count as iterations
+(and against -calib_max_it); the rejected trials end the fit when the damping exceeds 1e10. Points that fail to converge with the nominal
+parameters are dropped from the fit. At convergence, the covariance of the parameters is estimated as s^2 (J'J)^-1, s^2 being the cost
+divided by the degrees of freedom, and the confidence intervals follow from the normal approximation.
+
+Reference: K. Madsen, H.B. Nielsen, O. Tingleff, Methods for non-linear least squares problems, 2nd ed., Technical University of Denmark
+           (2004)
+*/
+
+PetscErrorCode RunCalibration(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    const char *default_names[] = {"film_thickness", "membrane_tortuosity"};
+    CalibrationCtx calib;
+    MeasurementSet *measurements = &calib.measurements;
+    PetscReal sigma[MAX_COLUMNS], confidence = 0.95, *parameter;
+    PetscInt num_sigma = MAX_COLUMNS, max_it = 50, i, j, k;
+    PetscBool given, given_sigma;
+    char measurement_file[PETSC_MAX_PATH_LEN], file[256] = "./results/calibration.csv";
+
+    PetscOptionsGetString(NULL, NULL, "-calib_file", measurement_file, sizeof(measurement_file), &given);
+    PetscCheck(given, PETSC_COMM_WORLD, PETSC_ERR_ARG_NULL, "The calibration needs a measurement file (-calib_file)");
+
+    calib.num_params = MAX_FITTED;
+    PetscOptionsGetStringArray(NULL, NULL, "-calib_parameters", calib.names, &calib.num_params, &given);
+
+    if (!given)
+    {
+        calib.num_params = sizeof(default_names) / sizeof(default_names[0]);
+
+        for (i = 0; i < calib.num_params; i++)
+            PetscStrallocpy(default_names[i], &calib.names[i]);
+    }
+
+    PetscOptionsGetRealArray(NULL, NULL, "-calib_sigma", sigma, &num_sigma, &given_sigma);
+    PetscOptionsGetInt(NULL, NULL, "-calib_max_it", &max_it, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-calib_confidence", &confidence, NULL);
+
+    PetscCheck(confidence > 0.0 && confidence < 1.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Confidence level must be within (0, 1)");
+
+    PetscCall(MeasurementSetRead(measurements, measurement_file, &entry_data->dessal_data));
+
+    PetscCheck(!given_sigma || num_sigma == measurements->num_outputs, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -calib_sigma needs one value per measured column (%d)", (int)measurements->num_outputs);
+
+    for (i = 0; i < calib.num_params; i++)
+    {
+        PetscBool match;
+
+        PetscCall(DessalDataGetParameter(&entry_data->dessal_data, calib.names[i], &parameter));
+        calib.nominal[i] = *parameter;
+
+        PetscCheck(calib.nominal[i] != 0.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Nominal value of %s must not be zero", calib.names[i]);
+
+        for (j = 0; j < measurements->num_columns; j++)
+        {
+            PetscStrcmp(calib.names[i], measurements->name[j], &match);
+            PetscCheck(!match || measurements->type[j] != COLUMN_INPUT, PETSC_COMM_WORLD, PETSC_ERR_ARG_INCOMP,
+                       "Parameter %s cannot be both fitted and given in the measurement file", calib.names[i]);
+        }
+    }
+
+    // Weights of the measured quantities, defaulting to their mean absolute values (relative residuals)
+    for (i = 0, k = 0; i < measurements->num_columns; i++)
+    {
+        PetscReal sum = 0.0, count = 0.0, value;
+
+        if (measurements->type[i] != COLUMN_STATE && measurements->type[i] != COLUMN_KPI)
+            continue;
+
+        for (j = 0; j < measurements->num_rows; j++)
+        {
+            value = measurements->data[j * measurements->num_columns + i];
+
+            if (!PetscIsNanReal(value))
+            {
+                sum += PetscAbsReal(value);
+                count += 1.0;
+            }
+        }
+
+        calib.sigma[k] = given_sigma ? sigma[k] : (count > 0.0 && sum > 0.0 ? sum / count : 1.0);
+        k++;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Distributing the measured points, warm-started from the nominal solution                                                                      //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMPIInt size, rank;
+    SolverCtx solver_ctx;
+    SNESConvergedReason reason;
+    PetscReal nominal_state[NUM_VAR], *states, *trial_states, *swap;
+    PetscInt num_local;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    calib.first_row = (PetscInt)(((PetscInt64)measurements->num_rows * rank) / size);
+    calib.last_row = (PetscInt)(((PetscInt64)measurements->num_rows * (rank + 1)) / size);
+    num_local = calib.last_row - calib.first_row;
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    PlantSolveCase(&solver_ctx, entry_data, NULL, nominal_state, &reason);
+
+    PetscMalloc1(PetscMax(num_local, 1) * NUM_VAR, &states);
+    PetscMalloc1(PetscMax(num_local, 1) * NUM_VAR, &trial_states);
+    PetscMalloc1(PetscMax(num_local, 1), &calib.active);
+
+    for (i = 0; i < num_local; i++)
+    {
+        calib.active[i] = PETSC_TRUE;
+
+        for (k = 0; k < NUM_VAR; k++)
+            states[i * NUM_VAR + k] = nominal_state[k];
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Levenberg-Marquardt iterations                                                                                                                //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    CalibrationObjective objective, trial;
+    PetscReal theta[MAX_FITTED], trial_theta[MAX_FITTED], initial_theta[MAX_FITTED], damped[MAX_FITTED * MAX_FITTED], step[MAX_FITTED];
+    PetscReal lambda = 1.0e-3, num_residuals = 0.0, max_step, initial_cost;
+    PetscInt n = calib.num_params, it, active_points = 0;
+    PetscBool converged = PETSC_FALSE, feasible;
+
+    for (i = 0; i < n; i++)
+        theta[i] = initial_theta[i] = 1.0;
+
+    PetscCall(CalibrationEvaluate(&calib, &solver_ctx, entry_data, theta, states, PETSC_TRUE, &objective));
+
+    initial_cost = objective.cost;
+
+    for (i = 0; i < num_local; i++)
+        active_points += calib.active[i];
+    MPI_Allreduce(MPI_IN_PLACE, &active_points, 1, MPIU_INT, MPIU_SUM, PETSC_COMM_WORLD);
+
+    for (j = 0; j < measurements->num_outputs; j++)
+        num_residuals += objective.count[j];
+
+    PetscCheck(num_residuals > n, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "Not enough converged measurements (%g) to fit %d parameters",
+               (double)num_residuals, (int)n);
+
+    PetscPrintf(PETSC_COMM_WORLD, "Calibration: %d of %d measured points used, initial cost %g\n", (int)active_points,
+                (int)measurements->num_rows, (double)objective.cost);
+
+    // The iterations are the accepted steps, the rejected trials only increasing the damping (which bounds their number)
+    for (it = 0; it < max_it;)
+    {
+        for (i = 0; i < n * n; i++)
+            damped[i] = objective.normal[i];
+        for (i = 0; i < n; i++)
+            damped[i * n + i] += lambda * PetscMax(objective.normal[i * n + i], PETSC_SMALL);
+        for (i = 0; i < n; i++)
+            trial_theta[i] = -objective.gradient[i];
+
+        feasible = DenseSolve(n, damped, trial_theta, step);
+
+        // Parameters must keep the sign of their nominal values
+        for (i = 0, max_step = 0.0; feasible && i < n; i++)
+        {
+            trial_theta[i] = theta[i] + step[i];
+            max_step = PetscMax(max_step, PetscAbsReal(step[i]));
+            feasible = trial_theta[i] > 0.0 ? PETSC_TRUE : PETSC_FALSE;
+        }
+
+        if (feasible)
+        {
+            PetscArraycpy(trial_states, states, num_local * NUM_VAR);
+            PetscCall(CalibrationEvaluate(&calib, &solver_ctx, entry_data, trial_theta, trial_states, PETSC_FALSE, &trial));
+            feasible = trial.failed == 0 && trial.cost < objective.cost ? PETSC_TRUE : PETSC_FALSE;
+        }
+
+        if (!feasible)
+        {
+            // A rejected step too small to change the parameters means the minimum is reached within round-off
+            if (max_step > 0.0 && max_step < 1.0e-8)
+            {
+                converged = PETSC_TRUE;
+                break;
+            }
+
+            lambda *= 4.0;
+
+            if (lambda > 1.0e10)
+                break;
+
+            continue;
+        }
+
+        converged = max_step < 1.0e-8 || objective.cost - trial.cost < 1.0e-12 * objective.cost ? PETSC_TRUE : PETSC_FALSE;
+
+        for (i = 0; i < n; i++)
+            theta[i] = trial_theta[i];
+
+        objective = trial;
+        swap = states;
+        states = trial_states;
+        trial_states = swap;
+        lambda = PetscMax(lambda / 3.0, 1.0e-12);
+        it++;
+
+        PetscPrintf(PETSC_COMM_WORLD, "  iteration %d: cost %g, largest relative step %g\n", (int)it, (double)objective.cost, (double)max_step);
+
+        if (converged)
+            break;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Covariance of the fitted parameters and export                                                                                                //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscReal covariance[MAX_FITTED * MAX_FITTED], unit[MAX_FITTED], column[MAX_FITTED], variance, deviation, z;
+    PetscBool identifiable = PETSC_TRUE;
+
+    variance = objective.cost / (num_residuals - n);
+    z = InverseNormalCDF(0.5 * (1.0 + confidence));
+
+    for (j = 0; j < n && identifiable; j++)
+    {
+        for (i = 0; i < n; i++)
+            unit[i] = i == j ? 1.0 : 0.0;
+
+        identifiable = DenseSolve(n, objective.normal, unit, column);
+
+        for (i = 0; i < n; i++)
+            covariance[i * n + j] = variance * column[i];
+    }
+
+    if (rank == 0)
+    {
+        FILE *fptr;
+
+        PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Calibration:,,\n\n");
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Measurement file =, %s,\n", measurement_file);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Measured points used =, %d, of %d\n", (int)active_points, (int)measurements->num_rows);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Residuals =, %.0f,\n", (double)num_residuals);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Iterations =, %d, %s\n", (int)PetscMin(it, max_it), converged ? "converged" : "not converged");
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Initial and final weighted costs =, %.10e, %.10e\n", (double)initial_cost, (double)objective.cost);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Confidence level =, %g,\n\n", (double)confidence);
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Parameter,initial,fitted,standard error,CI lower,CI upper\n");
+
+        for (i = 0; i < n; i++)
+        {
+            deviation = identifiable ? PetscSqrtReal(PetscMax(covariance[i * n + i], 0.0)) * PetscAbsReal(calib.nominal[i]) : NAN;
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.10e,%.10e,%.10e,%.10e,%.10e\n", calib.names[i],
+                         (double)(initial_theta[i] * calib.nominal[i]), (double)(theta[i] * calib.nominal[i]), (double)deviation,
+                         (double)(theta[i] * calib.nominal[i] - z * deviation), (double)(theta[i] * calib.nominal[i] + z * deviation));
+        }
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\nCorrelation matrix");
+        for (j = 0; j < n; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", calib.names[j]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+        for (i = 0; i < n; i++)
+        {
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s", calib.names[i]);
+
+            for (j = 0; j < n; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6f",
+                             identifiable ? (double)(covariance[i * n + j] / PetscSqrtReal(covariance[i * n + i] * covariance[j * n + j])) : NAN);
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\nMeasured quantity,sigma,RMS residual\n");
+
+        for (i = 0, k = 0; i < measurements->num_columns; i++)
+        {
+            if (measurements->type[i] != COLUMN_STATE && measurements->type[i] != COLUMN_KPI)
+                continue;
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.10e,%.10e\n", measurements->name[i], (double)calib.sigma[k],
+                         (double)PetscSqrtReal(objective.sum_squares[k] / PetscMax(objective.count[k], 1.0)));
+            k++;
+        }
+
+        PetscFClose(PETSC_COMM_SELF, fptr);
+    }
+
+    if (!identifiable)
+        PetscPrintf(PETSC_COMM_WORLD, "Warning: the fitted parameters are not identifiable from the measurements (singular normal matrix)\n");
+
+    PetscPrintf(PETSC_COMM_WORLD, "Calibration %s after %d iterations, results in %s\n", converged ? "converged" : "stopped",
+                (int)it, file);
+
+    MeasurementSetDestroy(measurements);
+    PetscFree(states);
+    PetscFree(trial_states);
+    PetscFree(calib.active);
+    SolverCtxDestroy(&solver_ctx);
+
+    for (i = 0; i < n; i++)
+        PetscFree(calib.names[i]);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef CALIBRATION
+
+#define CALIBRATION
+
+#include "../plant/plant.h"
+
+// Maximum number of fitted parameters
+#define MAX_FITTED 16
+
+// Maximum number of columns of a measurement file
+#define MAX_COLUMNS 64
+
+// Roles of the columns of a measurement file
+typedef enum
+{
+    COLUMN_IGNORED, // Unknown name, e.g. a timestamp
+    COLUMN_INPUT,   // Operating condition or parameter of the desalination module, named after its command-line option
+    COLUMN_STATE,   // Measured unknown of the plant system, named as in dessal_state_names
+    COLUMN_KPI      // Measured key performance indicator, named as in kpi_names
+} ColumnType;
+
+// Data structure containing a set of measured operating points of the plant
+typedef struct
+{
+    PetscInt num_columns, num_rows, num_outputs;
+    char name[MAX_COLUMNS][64];
+    ColumnType type[MAX_COLUMNS];
+    PetscInt index[MAX_COLUMNS];
+    PetscReal *data;
+} MeasurementSet;
+
+// Function to read a set of measurements from a CSV file whose header names the columns
+PetscErrorCode MeasurementSetRead(MeasurementSet *measurements, const char file[], DessalData *dessal_data);
+
+// Function to set the operating conditions of a measured point into the entry data
+PetscErrorCode MeasurementSetApply(MeasurementSet *measurements, PetscInt row, EntryData *entry_data);
+
+// Function to compute the model predictions of the measured quantities from the solution of the plant system
+PetscErrorCode MeasurementSetPredict(MeasurementSet *measurements, const PetscReal state[], DessalData *dessal_data, PetscReal output[]);
+
+// Measurement set destructor
+PetscErrorCode MeasurementSetDestroy(MeasurementSet *measurements);
+
+// Function to run the calibration of parameters of the desalination module against measured operating points
+PetscErrorCode RunCalibration(EntryData *entry_data);
+
+#endif
@@ -0,0 +1,123 @@
+#include "continuation.h"
+
+/*
+Response curves by continuation
+
+The plant is solved at the start value of the parameter (-continuation_start, the nominal value by default), from the default initial guess
+with the usual fallbacks, and the branch of solutions through that point is traced by pseudo-arclength continuation up to the end value
+(-continuation_end, a tenth of the nominal value by default). Every point of the curve is written to the results file, with its unknowns and
+KPIs and a flag marking the turning points, at which the branch folds back in the parameter. The curve stops at the end value, after
+-continuation_max_steps steps, or where the step falls below its minimum.
+*/
+
+PetscErrorCode RunContinuation(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    EntryData start_data = *entry_data;
+    SolverCtx solver_ctx;
+    ArclengthSolver arclength;
+    SNESConvergedReason reason;
+    PlantKPIs kpis;
+    PetscReal state[NUM_VAR], kpi_array[NUM_KPI], *parameter, start, end, value;
+    PetscInt max_steps = 1000, j;
+    PetscBool reached = PETSC_FALSE, turning = PETSC_FALSE, converged;
+    PetscLogDouble start_time, end_time;
+    char name[64] = "vacuum_pressure", file[256] = "./results/continuation.csv";
+    FILE *fptr;
+
+    PetscOptionsGetString(NULL, NULL, "-continuation_parameter", name, sizeof(name), NULL);
+    PetscOptionsGetInt(NULL, NULL, "-continuation_max_steps", &max_steps, NULL);
+
+    PetscCall(DessalDataGetParameter(&start_data.dessal_data, name, &parameter));
+
+    start = *parameter;
+    end = 0.1 * start;
+
+    PetscOptionsGetReal(NULL, NULL, "-continuation_start", &start, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-continuation_end", &end, NULL);
+
+    PetscCheck(start != end, PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "The start and end values of %s must differ", name);
+
+    *parameter = start;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Solution at the start of the curve                                                                                                            //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscTime(&start_time);
+
+    SolverCtxBuild(&solver_ctx, &start_data);
+
+    PlantSolveCase(&solver_ctx, &start_data, NULL, state, &reason);
+
+    PetscCheck(reason > 0, PETSC_COMM_SELF, PETSC_ERR_NOT_CONVERGED, "The plant did not converge at the start of the curve, %s = %g (reason %d)",
+               name, (double)start, (int)reason);
+
+    PetscCall(ArclengthSolverBuild(&arclength, &solver_ctx, name));
+
+    ArclengthSolverStart(&arclength, state, start, end - start, &converged);
+
+    PetscCheck(converged, PETSC_COMM_SELF, PETSC_ERR_NOT_CONVERGED,
+               "The continuation could not start from %s = %g (corrector failed or singular tangent)", name, (double)start);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Tracing the curve                                                                                                                             //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "point,%s,turning_point", name);
+    for (j = 0; j < NUM_VAR; j++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", dessal_state_names[j]);
+    for (j = 0; j < NUM_KPI; j++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", kpi_names[j]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+    while (PETSC_TRUE)
+    {
+        ArclengthSolverGetPoint(&arclength, state, &value);
+
+        ComputeKPIs(state, &arclength.entry_data.dessal_data, &kpis);
+        KPIsToArray(&kpis, kpi_array);
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "%d,%.10e,%d", (int)arclength.num_steps, (double)value, (int)turning);
+        for (j = 0; j < NUM_VAR; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)state[j]);
+        for (j = 0; j < NUM_KPI; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)kpi_array[j]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+        if (turning)
+            PetscPrintf(PETSC_COMM_SELF, "Turning point near %s = %g (point %d)\n", name, (double)value, (int)arclength.num_steps);
+
+        if (reached || arclength.num_steps >= max_steps)
+            break;
+
+        // Only the accepted points are written, a failed step leaving the last one as the end of the curve
+        ArclengthSolverStep(&arclength, end, &reached, &turning, &converged);
+
+        if (!converged)
+            break;
+    }
+
+    PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscTime(&end_time);
+
+    if (reached)
+        PetscPrintf(PETSC_COMM_SELF, "Curve traced from %s = %g to %g", name, (double)start, (double)end);
+    else if (!converged)
+        PetscPrintf(PETSC_COMM_SELF, "Curve stopped at %s = %g, the continuation step fell below its minimum", name, (double)value);
+    else
+        PetscPrintf(PETSC_COMM_SELF, "Curve stopped at %s = %g after %d steps", name, (double)value, (int)max_steps);
+
+    PetscPrintf(PETSC_COMM_SELF, ": %d points, %d turning points, %lld corrector iterations, %lld evaluations of the balance, %g s\n",
+                (int)arclength.num_steps + 1, (int)arclength.num_turning_points, (long long)arclength.num_iterations,
+                (long long)arclength.num_evaluations, (double)(end_time - start_time));
+    PetscPrintf(PETSC_COMM_SELF, "Results written to %s\n", file);
+
+    SolverCtxDestroy(&solver_ctx);
+
+    return 0;
+}
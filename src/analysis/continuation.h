@@ -0,0 +1,11 @@
+#ifndef CONTINUATION
+
+#define CONTINUATION
+
+#include "../plant/plant.h"
+
+// Function to run the continuation of the plant along one of its parameters, tracing the response curve of the solution from a start value
+// to an end value of the parameter
+PetscErrorCode RunContinuation(EntryData *entry_data);
+
+#endif
@@ -0,0 +1,287 @@
+#include "convergence.h"
+
+PetscErrorCode TraceReadFile(const char file[], PetscInt index, TraceSolve **solves, PetscInt *num_solves, PetscInt *capacity,
+                             PetscInt64 dominant[], PetscInt64 dominant_failed[])
+{
+    PetscFunctionBeginUser;
+
+    TraceRecordKind kind;
+    TraceBegin begin;
+    TraceIteration iteration;
+    TraceEnd end;
+    TraceSolve *solve;
+    FILE *fptr;
+    PetscReal largest;
+    PetscInt k, largest_class;
+    PetscBool found, open = PETSC_FALSE;
+    int header[2];
+
+    fptr = fopen(file, "rb");
+    PetscCheck(fptr, PETSC_COMM_SELF, PETSC_ERR_FILE_OPEN, "Unable to open trace file %s", file);
+
+    PetscCheck(fread(header, sizeof(int), 2, fptr) == 2 && header[0] == TRACE_MAGIC, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED,
+               "%s is not a trace file", file);
+    PetscCheck(header[1] == TRACE_VERSION, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Trace file %s has version %d, expected %d", file,
+               header[1], TRACE_VERSION);
+
+    for (;;)
+    {
+        PetscCall(TraceRead(fptr, &kind, &begin, &iteration, &end, &found));
+
+        if (!found)
+            break;
+
+        if (kind == TRACE_BEGIN)
+        {
+            if (*num_solves == *capacity)
+            {
+                *capacity = PetscMax(2 * *capacity, 256);
+                PetscRealloc(*capacity * sizeof(TraceSolve), solves);
+            }
+
+            solve = &(*solves)[*num_solves];
+            solve->file = index;
+            solve->reason = 0;
+            solve->iterations = 0;
+            solve->function_evaluations = 0;
+            solve->dominant = -1;
+            solve->norm = 0.0;
+            solve->time = 0.0;
+            solve->max_condition = 0.0;
+            solve->min_step = 1.0;
+
+            for (k = 0; k < NUM_TRACE_INLETS; k++)
+                solve->inlet[k] = begin.inlet[k];
+
+            open = PETSC_TRUE;
+
+            continue;
+        }
+
+        PetscCheck(open, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Trace record outside a solve in %s", file);
+
+        solve = &(*solves)[*num_solves];
+
+        if (kind == TRACE_ITERATION)
+        {
+            // Class of the largest scaled residual of the iterate
+            for (k = 0, largest_class = NUM_VAR, largest = iteration.extra_residual; k < NUM_VAR; k++)
+                if (PetscAbsReal(iteration.residual[k]) >= largest)
+                {
+                    largest = PetscAbsReal(iteration.residual[k]);
+                    largest_class = k;
+                }
+
+            dominant[largest_class]++;
+            solve->dominant = largest_class;
+            solve->max_condition = PetscMax(solve->max_condition, iteration.condition);
+
+            if (iteration.iteration > 0)
+                solve->min_step = PetscMin(solve->min_step, iteration.step);
+
+            continue;
+        }
+
+        solve->reason = end.reason;
+        solve->iterations = end.iterations;
+        solve->function_evaluations = end.function_evaluations;
+        solve->norm = end.norm;
+        solve->time = end.time;
+
+        if (solve->reason <= 0 && solve->dominant >= 0)
+            dominant_failed[solve->dominant]++;
+
+        (*num_solves)++;
+        open = PETSC_FALSE;
+    }
+
+    fclose(fptr);
+
+    // A solve left open was interrupted and is dropped
+    return 0;
+}
+
+/*
+Summary of convergence traces
+
+The trace file given by -trace_file is read along with the files of the other MPI ranks of the run that wrote it (the file name followed
+by the rank, read while they exist). The solves are summarized by a histogram of their numbers of iterations, their converged reasons, the
+share of damped steps and the condition numbers of their Jacobians, and by how often each unknown holds the largest scaled residual of an
+iterate, over all the iterates and over the last iterates of the solves that did not converge, which points at the equations that hold
+the solver back. The -trace_summary_worst solves that failed or took the most iterations are listed with their inlet conditions, and every
+solve is written to ./results/trace_summary.csv.
+*/
+
+PetscErrorCode RunTraceSummary(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    TraceSolve *solves = NULL, *solve;
+    PetscInt64 dominant[NUM_TRACE_CLASSES] = {0}, dominant_failed[NUM_TRACE_CLASSES] = {0}, histogram[NUM_TRACE_BINS] = {0};
+    PetscInt64 total_dominant = 0, total_failed = 0, total_iterations = 0, reasons[2 * TRACE_MAX_REASON + 1] = {0};
+    PetscInt num_solves = 0, capacity = 0, num_files = 0, num_failed = 0, num_damped = 0, worst = 5, bin, upper, width, *order, i, k;
+    PetscReal *key, *conditions, max_condition = 0.0;
+    PetscBool exists = PETSC_TRUE;
+    char file[PETSC_MAX_PATH_LEN] = "./results/trace.bin", name[PETSC_MAX_PATH_LEN], output[256] = "./results/trace_summary.csv";
+    const char *class_name;
+    FILE *fptr;
+
+    PetscOptionsGetString(NULL, NULL, "-trace_file", file, sizeof(file), NULL);
+    PetscOptionsGetInt(NULL, NULL, "-trace_summary_worst", &worst, NULL);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Reading the traces of every rank                                                                                                              //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(TraceReadFile(file, 0, &solves, &num_solves, &capacity, dominant, dominant_failed));
+
+    for (num_files = 1; exists; num_files++)
+    {
+        PetscSNPrintf(name, sizeof(name), "%s.%d", file, (int)num_files);
+        PetscTestFile(name, 'r', &exists);
+
+        if (exists)
+            PetscCall(TraceReadFile(name, num_files, &solves, &num_solves, &capacity, dominant, dominant_failed));
+    }
+
+    num_files--;
+
+    PetscCheck(num_solves > 0, PETSC_COMM_WORLD, PETSC_ERR_FILE_UNEXPECTED, "No complete solve in the trace file %s", file);
+
+    for (k = 0; k < NUM_TRACE_CLASSES; k++)
+    {
+        total_dominant += dominant[k];
+        total_failed += dominant_failed[k];
+    }
+
+    PetscMalloc1(num_solves, &order);
+    PetscMalloc1(num_solves, &key);
+    PetscMalloc1(num_solves, &conditions);
+
+    for (i = 0; i < num_solves; i++)
+    {
+        solve = &solves[i];
+
+        for (bin = 1, upper = 1; solve->iterations > upper && bin < NUM_TRACE_BINS - 1; bin++)
+            upper *= 2;
+
+        histogram[solve->iterations > 0 ? bin : 0]++;
+
+        num_failed += solve->reason <= 0;
+        reasons[TRACE_MAX_REASON + PetscMax(PetscMin(solve->reason, TRACE_MAX_REASON), -TRACE_MAX_REASON)]++;
+        num_damped += solve->min_step < 1.0;
+        total_iterations += solve->iterations;
+        max_condition = PetscMax(max_condition, solve->max_condition);
+        conditions[i] = solve->max_condition;
+
+        // Failed solves first, then by decreasing number of iterations
+        order[i] = i;
+        key[i] = -(PetscReal)solve->iterations - (solve->reason <= 0 ? 1.0e9 : 0.0);
+    }
+
+    PetscSortRealWithPermutation(num_solves, key, order);
+    PetscSortReal(num_solves, conditions);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Printing the summary                                                                                                                          //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscPrintf(PETSC_COMM_WORLD, "Convergence traces: %d solves in %d file(s), %d not converged, %.2f iterations per solve\n",
+                (int)num_solves, (int)num_files, (int)num_failed, (double)total_iterations / num_solves);
+    PetscPrintf(PETSC_COMM_WORLD, "  %d solves with damped steps, condition numbers of the Jacobians: median %.3e, maximum %.3e\n",
+                (int)num_damped, (double)conditions[num_solves / 2], (double)max_condition);
+
+    PetscPrintf(PETSC_COMM_WORLD, "  converged reasons (count):");
+    for (k = 0; k < 2 * TRACE_MAX_REASON + 1; k++)
+        if (reasons[k])
+            PetscPrintf(PETSC_COMM_WORLD, " %d (%lld)", (int)(k - TRACE_MAX_REASON), (long long)reasons[k]);
+    PetscPrintf(PETSC_COMM_WORLD, "\n");
+
+    PetscPrintf(PETSC_COMM_WORLD, "\nIterations per solve:\n");
+    for (bin = 0, upper = 1; bin < NUM_TRACE_BINS; bin++)
+    {
+        if (bin == 0)
+            PetscSNPrintf(name, sizeof(name), "0");
+        else if (bin == 1 || bin == 2)
+            PetscSNPrintf(name, sizeof(name), "%d", (int)bin);
+        else if (bin < NUM_TRACE_BINS - 1)
+            PetscSNPrintf(name, sizeof(name), "%d-%d", (int)(upper / 2 + 1), (int)upper);
+        else
+            PetscSNPrintf(name, sizeof(name), "%d+", (int)(upper / 2 + 1));
+
+        width = (PetscInt)(50.0 * histogram[bin] / num_solves + 0.5);
+
+        PetscPrintf(PETSC_COMM_WORLD, "  %-9s %8lld ", name, (long long)histogram[bin]);
+        for (k = 0; k < width; k++)
+            PetscPrintf(PETSC_COMM_WORLD, "#");
+        PetscPrintf(PETSC_COMM_WORLD, "\n");
+
+        upper = bin == 0 ? 1 : 2 * upper;
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "\nLargest scaled residual of the iterates:\n");
+    PetscPrintf(PETSC_COMM_WORLD, "  %-26s %14s %14s\n", "unknown", "all iterates", "failed, last");
+    for (k = 0; k < NUM_TRACE_CLASSES; k++)
+    {
+        if (!dominant[k] && !dominant_failed[k])
+            continue;
+
+        class_name = k < NUM_VAR ? dessal_state_names[k] : "targets and closures";
+
+        PetscPrintf(PETSC_COMM_WORLD, "  %-26s %13.1f%% %13.1f%%\n", class_name, 100.0 * dominant[k] / PetscMax(total_dominant, 1),
+                    100.0 * dominant_failed[k] / PetscMax(total_failed, 1));
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "\nWorst solves:\n");
+    PetscPrintf(PETSC_COMM_WORLD, "  %6s %4s %6s %10s %10s %12s %10s", "solve", "file", "reason", "iterations", "evaluations", "final norm",
+                "min step");
+    for (k = 0; k < NUM_TRACE_INLETS; k++)
+        PetscPrintf(PETSC_COMM_WORLD, " %22s", trace_inlet_names[k]);
+    PetscPrintf(PETSC_COMM_WORLD, "\n");
+
+    for (i = 0; i < PetscMin(worst, num_solves); i++)
+    {
+        solve = &solves[order[i]];
+
+        PetscPrintf(PETSC_COMM_WORLD, "  %6d %4d %6d %10d %10d %12.3e %10.3e", (int)order[i], (int)solve->file, (int)solve->reason,
+                    (int)solve->iterations, (int)solve->function_evaluations, (double)solve->norm, (double)solve->min_step);
+        for (k = 0; k < NUM_TRACE_INLETS; k++)
+            PetscPrintf(PETSC_COMM_WORLD, " %22.6e", (double)solve->inlet[k]);
+        PetscPrintf(PETSC_COMM_WORLD, "\n");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Writing the solves                                                                                                                            //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_WORLD, output, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_WORLD, fptr, "solve,file,reason,iterations,function_evaluations,norm,time,max_condition,min_step,dominant");
+    for (k = 0; k < NUM_TRACE_INLETS; k++)
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, ",%s", trace_inlet_names[k]);
+    PetscFPrintf(PETSC_COMM_WORLD, fptr, "\n");
+
+    for (i = 0; i < num_solves; i++)
+    {
+        solve = &solves[i];
+        class_name = solve->dominant < 0 ? "" : solve->dominant < NUM_VAR ? dessal_state_names[solve->dominant] : "targets_and_closures";
+
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "%d,%d,%d,%d,%d,%.6e,%.6e,%.6e,%.6e,%s", (int)i, (int)solve->file, (int)solve->reason,
+                     (int)solve->iterations, (int)solve->function_evaluations, (double)solve->norm, (double)solve->time,
+                     (double)solve->max_condition, (double)solve->min_step, class_name);
+        for (k = 0; k < NUM_TRACE_INLETS; k++)
+            PetscFPrintf(PETSC_COMM_WORLD, fptr, ",%.6e", (double)solve->inlet[k]);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "\n");
+    }
+
+    PetscCall(PetscFClose(PETSC_COMM_WORLD, fptr));
+
+    PetscPrintf(PETSC_COMM_WORLD, "\nResults written to %s\n", output);
+
+    PetscFree(solves);
+    PetscFree(order);
+    PetscFree(key);
+    PetscFree(conditions);
+
+    return 0;
+}
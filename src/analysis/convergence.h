@@ -0,0 +1,34 @@
+#ifndef CONVERGENCE
+
+#define CONVERGENCE
+
+#include "../plant/plant.h"
+
+// Number of classes of residuals that can dominate an iterate: the unknowns of the plant system, and the target equations of an inverse
+// problem together with the closures of the recycle loop
+#define NUM_TRACE_CLASSES (NUM_VAR + 1)
+
+// Number of bins of the histogram of the iterations per solve (0, 1, 2, 3-4, 5-8, ..., the last one open)
+#define NUM_TRACE_BINS 12
+
+// Bound of the converged reasons tallied one by one, beyond which they are tallied with the bound
+#define TRACE_MAX_REASON 16
+
+// Data structure containing the summary of a solve read from a trace file
+typedef struct
+{
+    PetscInt file, reason, iterations, function_evaluations;
+    PetscInt dominant; // Class of the largest scaled residual at the last iterate
+    PetscReal norm, time, max_condition, min_step;
+    PetscReal inlet[NUM_TRACE_INLETS];
+} TraceSolve;
+
+// Function to read the solves of a trace file, accumulating how often each class of residuals dominates the iterates (all of them, and the
+// last ones of the solves that did not converge)
+PetscErrorCode TraceReadFile(const char file[], PetscInt index, TraceSolve **solves, PetscInt *num_solves, PetscInt *capacity,
+                             PetscInt64 dominant[], PetscInt64 dominant_failed[]);
+
+// Function to run the summary of the convergence traces written with -trace by one or several MPI ranks
+PetscErrorCode RunTraceSummary(EntryData *entry_data);
+
+#endif
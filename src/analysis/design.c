@@ -0,0 +1,569 @@
+#include "design.h"
+
+PetscErrorCode DesignObjectivesBuild(DesignObjectives *objectives, const char prefix[], const char *const default_names[],
+                                     const char *const default_senses[], PetscInt num_defaults, DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    char *names[MAX_OBJECTIVES], *senses[MAX_OBJECTIVES], option[256];
+    PetscReal *parameter;
+    PetscInt num_senses = MAX_OBJECTIVES, i;
+    PetscBool given, given_senses, match, minimized;
+
+    objectives->num_objectives = MAX_OBJECTIVES;
+
+    PetscSNPrintf(option, sizeof(option), "-%s_objectives", prefix);
+    PetscOptionsGetStringArray(NULL, NULL, option, names, &objectives->num_objectives, &given);
+    PetscSNPrintf(option, sizeof(option), "-%s_senses", prefix);
+    PetscOptionsGetStringArray(NULL, NULL, option, senses, &num_senses, &given_senses);
+
+    if (!given)
+    {
+        objectives->num_objectives = num_defaults;
+
+        for (i = 0; i < num_defaults; i++)
+            PetscStrallocpy(default_names[i], &names[i]);
+    }
+
+    PetscCheck(objectives->num_objectives > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "A design exploration needs at least one objective");
+    PetscCheck(!given_senses || num_senses == objectives->num_objectives, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -%s_senses needs one value (max or min) per objective", prefix);
+
+    for (i = 0; i < objectives->num_objectives; i++)
+    {
+        // Outputs of the plant, or parameters of the desalination module (e.g. the membrane area, as a cost)
+        PlantOutputFind(names[i], &objectives->output[i]);
+        DessalDataFindParameter(dessal_data, names[i], &parameter);
+        PetscCheck(objectives->output[i] >= 0 || parameter, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown output or parameter: %s", names[i]);
+
+        objectives->parameter[i] = objectives->output[i] < 0 ? PETSC_TRUE : PETSC_FALSE;
+        PetscStrncpy(objectives->name[i], names[i], sizeof(objectives->name[i]));
+
+        // Maximized unless -<prefix>_senses says otherwise, the default objectives coming with their own senses
+        minimized = PETSC_FALSE;
+
+        if (given_senses)
+        {
+            PetscStrcmp(senses[i], "min", &minimized);
+            PetscStrcmp(senses[i], "max", &match);
+            PetscCheck(minimized || match, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown sense %s, expected max or min", senses[i]);
+
+            PetscFree(senses[i]);
+        }
+        else if (!given)
+            PetscStrcmp(default_senses[i], "min", &minimized);
+
+        objectives->sense[i] = minimized ? -1.0 : 1.0;
+
+        PetscFree(names[i]);
+    }
+
+    return 0;
+}
+
+PetscErrorCode DesignObjectivesEvaluate(DesignObjectives *objectives, EntryData *entry_data, const PetscReal state[], PetscReal values[])
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *parameter;
+    PetscInt k;
+
+    for (k = 0; k < objectives->num_objectives; k++)
+    {
+        if (objectives->parameter[k])
+        {
+            DessalDataFindParameter(&entry_data->dessal_data, objectives->name[k], &parameter);
+            values[k] = *parameter;
+        }
+        else
+            PlantOutput(state, &entry_data->dessal_data, objectives->output[k], &values[k]);
+    }
+
+    return 0;
+}
+
+PetscErrorCode DesignScreen(EntryData *entry_data, DesignObjectives *objectives, PetscReal state[], PetscReal values[])
+{
+    PetscFunctionBeginUser;
+
+    DessalContext dessal_ctx;
+
+    DessalContextBuild(&dessal_ctx, &entry_data->dessal_data);
+    DessalContextScreening(&dessal_ctx, state);
+
+    DesignObjectivesEvaluate(objectives, entry_data, state, values);
+
+    return 0;
+}
+
+PetscErrorCode DesignSensitivity(EntryData *entry_data, DesignObjectives *objectives, const PetscReal state[], PetscReal scale[],
+                                 PetscReal gradient[])
+{
+    PetscFunctionBeginUser;
+
+    SolverCtx scale_ctx;
+    PetscReal perturbed[NUM_VAR], values[MAX_OBJECTIVES], perturbed_values[MAX_OBJECTIVES];
+    PetscInt k, v;
+
+    // Reference scales of the unknowns of the plant system for these entry data
+    scale_ctx.entry_data = *entry_data;
+    SolverCtxSetScaling(&scale_ctx, PETSC_TRUE);
+
+    for (v = 0; v < NUM_VAR; v++)
+    {
+        scale[v] = scale_ctx.scale[v];
+        perturbed[v] = state[v];
+    }
+
+    DesignObjectivesEvaluate(objectives, entry_data, state, values);
+
+    for (v = 0; v < NUM_VAR; v++)
+    {
+        perturbed[v] = state[v] + PETSC_SQRT_MACHINE_EPSILON * scale[v];
+
+        DesignObjectivesEvaluate(objectives, entry_data, perturbed, perturbed_values);
+
+        for (k = 0; k < objectives->num_objectives; k++)
+            gradient[k * NUM_VAR + v] = PetscAbsReal(perturbed_values[k] - values[k]) / PETSC_SQRT_MACHINE_EPSILON;
+
+        perturbed[v] = state[v];
+    }
+
+    return 0;
+}
+
+PetscErrorCode DesignDominates(DesignObjectives *objectives, const PetscReal first[], const PetscReal second[], PetscBool *dominates)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt k, better = 0, worse = 0;
+
+    for (k = 0; k < objectives->num_objectives; k++)
+    {
+        if (objectives->sense[k] * first[k] > objectives->sense[k] * second[k])
+            better++;
+        else if (objectives->sense[k] * first[k] < objectives->sense[k] * second[k])
+            worse++;
+    }
+
+    *dominates = better > 0 && worse == 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    return 0;
+}
+
+PetscErrorCode DesignParetoFront(DesignObjectives *objectives, const PetscReal values[], const PetscBool active[], PetscInt64 num_candidates,
+                                 PetscBool front[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt num_objectives = objectives->num_objectives;
+    PetscInt64 i, j;
+    PetscBool dominated;
+
+    for (i = 0; i < num_candidates; i++)
+    {
+        front[i] = active[i];
+
+        for (j = 0; front[i] && j < num_candidates; j++)
+        {
+            if (j == i || !active[j])
+                continue;
+
+            DesignDominates(objectives, &values[j * num_objectives], &values[i * num_objectives], &dominated);
+
+            if (dominated)
+                front[i] = PETSC_FALSE;
+        }
+    }
+
+    return 0;
+}
+
+/*
+Multi-fidelity design exploration
+
+The candidates are the cases of a grid over parameters of the desalination module (options -design_parameters, -design_min, -design_max and
+-design_points, as for a sweep, by default the feed inlet temperature and the membrane thickness), and the objectives are outputs of the
+plant or parameters of the module, maximized or minimized as set by -design_senses (by default the distillate rate and the GOR, both
+maximized, which trade off against each other). Every candidate is first rejected by PlantScreen if infeasible, and otherwise evaluated with
+the one-pass screening model of DessalContextScreening, at a tiny fraction of the cost of a solve.
+
+The error of the screening model is calibrated against the full solver on -design_calibration_points candidates spread over the grid: the
+error bound of each unknown is its largest error found, relative to its reference scale (see SolverCtxSetScaling), times the safety factor
+-design_safety. The bounds of the unknowns are propagated to the objectives of each candidate to first order, through the sensitivities of
+the objectives to the unknowns, so that an objective that is ill-conditioned for a candidate (e.g. the GOR when the coolant leaves the
+module close to the feed inlet temperature) gets a wide interval there only. A candidate is discarded when its optimistic objectives are
+dominated by the pessimistic objectives of another candidate, which it cannot beat whatever the errors of the screening. Only the remaining
+candidates are solved, warm-started from their screened states, and the Pareto front is taken among them. With -design_check, the discarded
+candidates are solved too, and the members of the true front that the screening discarded are counted.
+*/
+
+PetscErrorCode RunDesign(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    SweepGrid grid;
+    DesignObjectives objectives;
+    SolverCtx solver_ctx;
+    LockstepSolver lockstep;
+    PlantScreenReason screen;
+    PetscBool check = PETSC_FALSE, *feasible, *converged, *front, *check_front;
+    PetscReal safety = 2.0, error[MAX_OBJECTIVES], width[MAX_OBJECTIVES], bound[NUM_VAR], error_scaled;
+    PetscReal *values, *screened, *full, *optimistic, *pessimistic;
+    PetscReal *screened_states, *states, *scales, *gradients, *warm_states, *solve_states, half_width;
+    PetscInt num_covered = 0, v;
+    PetscInt num_calibration = 16, lanes = 0, num_objectives, num_feasible = 0, num_solved, num_front = 0, num_missed = 0, k, n;
+    PetscInt64 num_candidates, *list, *calibration, *solve_index, i, j;
+    SNESConvergedReason *reasons, *solve_reasons;
+    DesignStatus *status;
+    EntryData *cases, *solve_cases;
+    PetscLogDouble start, end, screening_time, solving_time;
+    char file[256] = "./results/design.csv";
+    FILE *fptr;
+
+    PetscOptionsGetInt(NULL, NULL, "-design_calibration_points", &num_calibration, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-design_safety", &safety, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-design_check", &check, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-lockstep_lanes", &lanes, NULL);
+
+    PetscCheck(num_calibration > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of calibration points must be positive");
+    PetscCheck(safety >= 1.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "The safety factor of the error bounds must be at least one");
+    PetscCheck(!entry_data->recycle_data.enabled, PETSC_COMM_WORLD, PETSC_ERR_SUP,
+               "The screening model covers the desalination module alone, without the recycle loop");
+
+    PetscCall(SweepGridBuild(&grid, "design", design_default_parameters, 2, 11, &entry_data->dessal_data));
+    PetscCall(DesignObjectivesBuild(&objectives, "design", design_default_objectives, design_default_senses, 2, &entry_data->dessal_data));
+
+    num_candidates = grid.num_cases;
+    num_objectives = objectives.num_objectives;
+
+    PetscMalloc1(num_candidates, &cases);
+    PetscMalloc1(num_candidates * grid.num_params, &values);
+    PetscMalloc1(num_candidates * num_objectives, &screened);
+    PetscMalloc1(num_candidates * num_objectives, &full);
+    PetscMalloc1(num_candidates * num_objectives, &optimistic);
+    PetscMalloc1(num_candidates * num_objectives, &pessimistic);
+    PetscMalloc1(num_candidates * NUM_VAR, &screened_states);
+    PetscMalloc1(num_candidates * NUM_VAR, &states);
+    PetscMalloc1(num_candidates * NUM_VAR, &scales);
+    PetscMalloc1(num_candidates * num_objectives * NUM_VAR, &gradients);
+    PetscMalloc1(num_candidates, &reasons);
+    PetscMalloc1(num_candidates, &status);
+    PetscMalloc1(num_candidates, &feasible);
+    PetscMalloc1(num_candidates, &converged);
+    PetscMalloc1(num_candidates, &front);
+    PetscMalloc1(num_candidates, &check_front);
+    PetscMalloc1(num_candidates, &list);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Screening every candidate                                                                                                                     //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscTime(&start);
+
+    for (i = 0; i < num_candidates; i++)
+    {
+        SweepGridCase(&grid, i, &values[i * grid.num_params]);
+
+        cases[i] = *entry_data;
+        SweepGridApply(&grid, &values[i * grid.num_params], &cases[i]);
+
+        PlantScreen(&cases[i], &screen);
+
+        feasible[i] = screen == SCREEN_FEASIBLE ? PETSC_TRUE : PETSC_FALSE;
+        converged[i] = PETSC_FALSE;
+        reasons[i] = SNES_CONVERGED_ITERATING;
+        status[i] = feasible[i] ? DESIGN_DISCARDED : DESIGN_INFEASIBLE;
+
+        if (feasible[i])
+        {
+            DesignScreen(&cases[i], &objectives, &screened_states[i * NUM_VAR], &screened[i * num_objectives]);
+            DesignSensitivity(&cases[i], &objectives, &screened_states[i * NUM_VAR], &scales[i * NUM_VAR],
+                              &gradients[i * num_objectives * NUM_VAR]);
+            list[num_feasible++] = i;
+        }
+    }
+
+    PetscTime(&end);
+    screening_time = end - start;
+
+    PetscCheck(num_feasible > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Every candidate of the design exploration is infeasible");
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    if (lanes > 0)
+        PetscCall(LockstepSolverBuild(&lockstep, &solver_ctx, lanes));
+
+    PetscMalloc1(num_feasible, &solve_cases);
+    PetscMalloc1(num_feasible * NUM_VAR, &warm_states);
+    PetscMalloc1(num_feasible * NUM_VAR, &solve_states);
+    PetscMalloc1(num_feasible, &solve_reasons);
+    PetscMalloc1(num_feasible, &calibration);
+    PetscMalloc1(num_feasible, &solve_index);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Calibrating the error bounds of the screening model                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscTime(&start);
+
+    num_calibration = PetscMin(num_calibration, num_feasible);
+
+    for (n = 0; n < num_calibration; n++)
+        calibration[n] = list[num_calibration > 1 ? (n * (num_feasible - 1)) / (num_calibration - 1) : 0];
+
+    for (n = 0; n < num_calibration; n++)
+    {
+        i = calibration[n];
+
+        PlantSolveCase(&solver_ctx, &cases[i], &screened_states[i * NUM_VAR], &states[i * NUM_VAR], &reasons[i]);
+
+        status[i] = DESIGN_SOLVED;
+    }
+
+    for (v = 0; v < NUM_VAR; v++)
+        bound[v] = 0.0;
+
+    for (n = 0; n < num_calibration; n++)
+    {
+        i = calibration[n];
+
+        if (reasons[i] <= 0)
+            continue;
+
+        converged[i] = PETSC_TRUE;
+
+        for (v = 0; v < NUM_VAR; v++)
+        {
+            error_scaled = PetscAbsReal(screened_states[i * NUM_VAR + v] - states[i * NUM_VAR + v]) / scales[i * NUM_VAR + v];
+            bound[v] = PetscMax(bound[v], error_scaled);
+        }
+    }
+
+    for (v = 0; v < NUM_VAR; v++)
+        bound[v] *= safety;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Discarding the candidates that cannot reach the front                                                                                         //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    for (k = 0; k < num_objectives; k++)
+    {
+        error[k] = 0.0;
+        width[k] = 0.0;
+    }
+
+    for (i = 0; i < num_candidates; i++)
+        for (k = 0; feasible[i] && k < num_objectives; k++)
+        {
+            n = i * num_objectives + k;
+
+            for (v = 0, half_width = 0.0; v < NUM_VAR; v++)
+                half_width += gradients[n * NUM_VAR + v] * bound[v];
+
+            optimistic[n] = screened[n] + objectives.sense[k] * half_width;
+            pessimistic[n] = screened[n] - objectives.sense[k] * half_width;
+            width[k] += half_width / PetscMax(PetscAbsReal(screened[n]), PETSC_SMALL) / num_feasible;
+        }
+
+    // Errors of the screened objectives at the calibration points, which should lie within their intervals
+    for (n = 0; n < num_calibration; n++)
+    {
+        PetscBool covered = PETSC_TRUE;
+
+        i = calibration[n];
+
+        if (converged[i])
+            DesignObjectivesEvaluate(&objectives, &cases[i], &states[i * NUM_VAR], &full[i * num_objectives]);
+
+        for (k = 0; converged[i] && k < num_objectives; k++)
+        {
+            j = i * num_objectives + k;
+
+            error[k] = PetscMax(error[k], PetscAbsReal(screened[j] - full[j]) / PetscMax(PetscAbsReal(full[j]), PETSC_SMALL));
+
+            if (objectives.sense[k] * (full[j] - pessimistic[j]) < 0.0 || objectives.sense[k] * (full[j] - optimistic[j]) > 0.0)
+                covered = PETSC_FALSE;
+        }
+
+        num_covered += converged[i] && covered;
+    }
+
+    // A candidate dominated by the pessimistic objectives of some candidate is dominated by those of a member of their front
+    PetscCall(DesignParetoFront(&objectives, pessimistic, feasible, num_candidates, front));
+
+    for (n = 0, num_solved = 0; n < num_feasible; n++)
+    {
+        PetscBool dominated = PETSC_FALSE;
+
+        i = list[n];
+
+        if (status[i] == DESIGN_SOLVED)
+            continue;
+
+        for (j = 0; !dominated && j < num_candidates; j++)
+        {
+            if (j == i || !front[j])
+                continue;
+
+            DesignDominates(&objectives, &pessimistic[j * num_objectives], &optimistic[i * num_objectives], &dominated);
+        }
+
+        if (dominated)
+            continue;
+
+        solve_cases[num_solved] = cases[i];
+        PetscArraycpy(&warm_states[num_solved * NUM_VAR], &screened_states[i * NUM_VAR], NUM_VAR);
+        solve_index[num_solved++] = i;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Solving the remaining candidates                                                                                                              //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PlantSolveCases(&solver_ctx, lanes > 0 ? &lockstep : NULL, solve_cases, num_solved, warm_states, NULL, solve_states,
+                              solve_reasons));
+
+    for (n = 0; n < num_solved; n++)
+    {
+        i = solve_index[n];
+
+        PetscArraycpy(&states[i * NUM_VAR], &solve_states[n * NUM_VAR], NUM_VAR);
+        reasons[i] = solve_reasons[n];
+        status[i] = DESIGN_SOLVED;
+        converged[i] = reasons[i] > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+        if (converged[i])
+            DesignObjectivesEvaluate(&objectives, &cases[i], &states[i * NUM_VAR], &full[i * num_objectives]);
+    }
+
+    PetscTime(&end);
+    solving_time = end - start;
+
+    PetscCall(DesignParetoFront(&objectives, full, converged, num_candidates, front));
+
+    for (i = 0, num_solved = 0; i < num_candidates; i++)
+    {
+        num_solved += status[i] == DESIGN_SOLVED;
+        num_front += front[i];
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Checking the front against the solution of every candidate                                                                                    //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (check)
+    {
+        for (n = 0, j = 0; n < num_feasible; n++)
+        {
+            i = list[n];
+
+            if (status[i] != DESIGN_DISCARDED)
+                continue;
+
+            solve_cases[j] = cases[i];
+            PetscArraycpy(&warm_states[j * NUM_VAR], &screened_states[i * NUM_VAR], NUM_VAR);
+            solve_index[j++] = i;
+        }
+
+        PetscCall(PlantSolveCases(&solver_ctx, lanes > 0 ? &lockstep : NULL, solve_cases, j, warm_states, NULL, solve_states,
+                                  solve_reasons));
+
+        // The discarded candidates are flagged as converged for the check only, their results being left out of the report
+        for (n = 0; n < j; n++)
+        {
+            i = solve_index[n];
+            converged[i] = solve_reasons[n] > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+            if (converged[i])
+                DesignObjectivesEvaluate(&objectives, &cases[i], &solve_states[n * NUM_VAR], &full[i * num_objectives]);
+        }
+
+        PetscCall(DesignParetoFront(&objectives, full, converged, num_candidates, check_front));
+
+        for (i = 0; i < num_candidates; i++)
+            num_missed += check_front[i] && status[i] == DESIGN_DISCARDED;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Writing the results                                                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "case");
+    for (k = 0; k < grid.num_params; k++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", grid.name[k]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, ",status,reason");
+    for (k = 0; k < num_objectives; k++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",screened_%s", objectives.name[k]);
+    for (k = 0; k < num_objectives; k++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", objectives.name[k]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, ",pareto\n");
+
+    for (i = 0; i < num_candidates; i++)
+    {
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "%lld", (long long)i);
+        for (k = 0; k < grid.num_params; k++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)values[i * grid.num_params + k]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s,%d", design_status_names[status[i]], (int)reasons[i]);
+        for (k = 0; k < num_objectives; k++)
+            if (feasible[i])
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)screened[i * num_objectives + k]);
+            else
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+        for (k = 0; k < num_objectives; k++)
+            if (status[i] == DESIGN_SOLVED && reasons[i] > 0)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)full[i * num_objectives + k]);
+            else
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%d\n", (int)front[i]);
+    }
+
+    PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscPrintf(PETSC_COMM_SELF, "Design exploration: %lld candidates, %d infeasible, %d solved (%.1f%%), %d on the Pareto front\n",
+                (long long)num_candidates, (int)(num_candidates - num_feasible), (int)num_solved,
+                100.0 * num_solved / (double)num_candidates, (int)num_front);
+    PetscPrintf(PETSC_COMM_SELF, "  %-20s %18s %18s\n", "objective", "screening error", "mean bound");
+    for (k = 0; k < num_objectives; k++)
+        PetscPrintf(PETSC_COMM_SELF, "  %-20s %18.3e %18.3e\n", objectives.name[k], (double)error[k], (double)width[k]);
+    PetscPrintf(PETSC_COMM_SELF, "  %d of %d calibration points within the bounds\n", (int)num_covered, (int)num_calibration);
+    PetscPrintf(PETSC_COMM_SELF, "Screening time %.4f s, solving time %.4f s\n", (double)screening_time, (double)solving_time);
+
+    if (check)
+        PetscPrintf(PETSC_COMM_SELF, "Check: %d members of the Pareto front discarded by the screening\n", (int)num_missed);
+
+    PetscPrintf(PETSC_COMM_SELF, "Results written to %s\n", file);
+
+    if (lanes > 0)
+        LockstepSolverDestroy(&lockstep);
+
+    SolverCtxDestroy(&solver_ctx);
+
+    PetscFree(cases);
+    PetscFree(values);
+    PetscFree(screened);
+    PetscFree(full);
+    PetscFree(optimistic);
+    PetscFree(pessimistic);
+    PetscFree(screened_states);
+    PetscFree(states);
+    PetscFree(scales);
+    PetscFree(gradients);
+    PetscFree(reasons);
+    PetscFree(status);
+    PetscFree(feasible);
+    PetscFree(converged);
+    PetscFree(front);
+    PetscFree(check_front);
+    PetscFree(list);
+    PetscFree(solve_cases);
+    PetscFree(warm_states);
+    PetscFree(solve_states);
+    PetscFree(solve_reasons);
+    PetscFree(calibration);
+    PetscFree(solve_index);
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef DESIGN
+
+#define DESIGN
+
+#include "sweep.h"
+
+// Maximum number of objectives of a design exploration
+#define MAX_OBJECTIVES 4
+
+// Data structure containing the objectives of a design exploration, outputs of the plant or parameters of the desalination module
+typedef struct
+{
+    PetscInt num_objectives;
+    PetscInt output[MAX_OBJECTIVES]; // Index of an unknown, or NUM_VAR plus the index of a KPI (-1 for a parameter)
+    PetscBool parameter[MAX_OBJECTIVES];
+    PetscReal sense[MAX_OBJECTIVES]; // +1 if maximized, -1 if minimized
+    char name[MAX_OBJECTIVES][64];
+} DesignObjectives;
+
+// Statuses of the candidates of a design exploration
+typedef enum
+{
+    DESIGN_INFEASIBLE, // Rejected by PlantScreen
+    DESIGN_DISCARDED,  // Dominated whatever the errors of the screening model
+    DESIGN_SOLVED      // Solved with the full model
+} DesignStatus;
+
+static const char *const design_status_names[] = {"infeasible", "discarded", "solved"};
+
+// Parameters of the grid of a multi-fidelity design exploration unless given on the command line, along which the default objectives trade
+// off (a hotter feed raises the distillate rate and a thicker membrane the GOR, each at the expense of the other objective)
+static const char *const design_default_parameters[] = {"entry_temperature_feed", "membrane_thickness"};
+
+// Objectives of a multi-fidelity design exploration unless given on the command line, and their senses
+static const char *const design_default_objectives[] = {"distillate_rate", "GOR"};
+static const char *const design_default_senses[] = {"max", "max"};
+
+// Function to fetch the objectives of a design exploration and their senses from the command line (options -<prefix>_objectives and
+// -<prefix>_senses), defaulting to given objectives
+PetscErrorCode DesignObjectivesBuild(DesignObjectives *objectives, const char prefix[], const char *const default_names[],
+                                     const char *const default_senses[], PetscInt num_defaults, DessalData *dessal_data);
+
+// Function to evaluate the objectives of a candidate from its entry data and the solution of the plant system
+PetscErrorCode DesignObjectivesEvaluate(DesignObjectives *objectives, EntryData *entry_data, const PetscReal state[], PetscReal values[]);
+
+// Function to estimate the objectives of a candidate with the one-pass screening model, also returning its approximate state
+PetscErrorCode DesignScreen(EntryData *entry_data, DesignObjectives *objectives, PetscReal state[], PetscReal values[]);
+
+// Function to compute the reference scales of the unknowns of a candidate and the absolute sensitivities of its objectives to its unknowns,
+// per reference scale (objective by objective, NUM_VAR values each)
+PetscErrorCode DesignSensitivity(EntryData *entry_data, DesignObjectives *objectives, const PetscReal state[], PetscReal scale[],
+                                 PetscReal gradient[]);
+
+// Function to tell whether the objectives of a candidate dominate those of another one (no worse in every objective, better in one)
+PetscErrorCode DesignDominates(DesignObjectives *objectives, const PetscReal first[], const PetscReal second[], PetscBool *dominates);
+
+// Function to flag the active candidates whose objectives are not dominated by those of another active candidate
+PetscErrorCode DesignParetoFront(DesignObjectives *objectives, const PetscReal values[], const PetscBool active[], PetscInt64 num_candidates,
+                                 PetscBool front[]);
+
+// Function to run a multi-fidelity design exploration, screening a grid of candidates and solving only those that could be on the front
+PetscErrorCode RunDesign(EntryData *entry_data);
+
+#endif
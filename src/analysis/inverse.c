@@ -0,0 +1,235 @@
+#include "inverse.h"
+
+PetscErrorCode InverseProblemBuild(InverseProblem *inverse, DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    char *inputs[MAX_INVERSE], *outputs[MAX_INVERSE];
+    PetscReal *parameter, min[MAX_INVERSE], max[MAX_INVERSE];
+    PetscInt num_inputs = MAX_INVERSE, num_outputs = MAX_INVERSE, num_targets = MAX_INVERSE, num_min = MAX_INVERSE, num_max = MAX_INVERSE;
+    PetscInt i;
+    PetscBool given, given_targets, given_min, given_max;
+
+    PetscOptionsGetStringArray(NULL, NULL, "-inverse_inputs", inputs, &num_inputs, &given);
+
+    if (!given)
+    {
+        num_inputs = 1;
+        PetscStrallocpy("feed_mass_flow_rate", &inputs[0]);
+    }
+
+    PetscOptionsGetStringArray(NULL, NULL, "-inverse_outputs", outputs, &num_outputs, &given);
+
+    if (!given)
+    {
+        num_outputs = 1;
+        PetscStrallocpy("distillate_rate", &outputs[0]);
+    }
+
+    PetscOptionsGetRealArray(NULL, NULL, "-inverse_targets", inverse->target, &num_targets, &given_targets);
+    PetscOptionsGetRealArray(NULL, NULL, "-inverse_min", min, &num_min, &given_min);
+    PetscOptionsGetRealArray(NULL, NULL, "-inverse_max", max, &num_max, &given_max);
+
+    PetscCheck(num_inputs == num_outputs, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "An inverse problem needs as many freed inputs (%d) as target outputs (%d)", (int)num_inputs, (int)num_outputs);
+    PetscCheck(given_targets && num_targets == num_outputs, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -inverse_targets needs one value per target output (%d)", (int)num_outputs);
+    PetscCheck(!given_min || num_min == num_inputs, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "Option -inverse_min needs %d values", (int)num_inputs);
+    PetscCheck(!given_max || num_max == num_inputs, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "Option -inverse_max needs %d values", (int)num_inputs);
+
+    inverse->num_free = num_inputs;
+
+    for (i = 0; i < num_inputs; i++)
+    {
+        PetscCall(DessalDataGetParameter(dessal_data, inputs[i], &parameter));
+        PetscStrncpy(inverse->input[i], inputs[i], sizeof(inverse->input[i]));
+
+        PlantOutputFind(outputs[i], &inverse->output[i]);
+        PetscCheck(inverse->output[i] >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown output of the plant: %s", outputs[i]);
+
+        // Default bounds: 0.5 and 1.5 times the nominal value
+        inverse->min[i] = given_min ? min[i] : PetscMin(0.5 * (*parameter), 1.5 * (*parameter));
+        inverse->max[i] = given_max ? max[i] : PetscMax(0.5 * (*parameter), 1.5 * (*parameter));
+        inverse->orientation[i] = 1.0;
+
+        PetscCheck(inverse->min[i] <= *parameter && *parameter <= inverse->max[i], PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+                   "The nominal value of %s (the initial guess) must lie within its bounds", inputs[i]);
+
+        PetscFree(inputs[i]);
+        PetscFree(outputs[i]);
+    }
+
+    return 0;
+}
+
+/*
+Inverse solve of the plant
+
+The forward problem is solved first at the nominal inputs, which provides the initial guess of the augmented system and the directions in
+which the target outputs vary with their paired inputs (from the sensitivities of the solution, without new solves). The directions orient
+the target equations for the bounded solver, which pairs each bound with the equation of the same index. The augmented system is then
+solved once from the forward solution.
+*/
+
+PetscErrorCode RunInverse(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    InverseProblem inverse;
+    SolverCtx solver_ctx;
+    SNESConvergedReason forward_reason, reason;
+    const char *inputs[MAX_INVERSE];
+    PetscReal state[NUM_VAR], shifted[NUM_VAR], sensitivity[MAX_INVERSE * NUM_VAR], nominal[MAX_INVERSE], solution[MAX_INVERSE];
+    PetscReal achieved[MAX_INVERSE], output, shifted_output, step, *parameter;
+    PetscInt forward_iterations = 0, iterations, evaluations, forward_evaluations = 0, i, k;
+    PetscBool check = PETSC_FALSE;
+    char file[256] = "./results/inverse.csv", report_file[256] = "./results/report.csv";
+
+    PetscCall(InverseProblemBuild(&inverse, &entry_data->dessal_data));
+
+    PetscOptionsGetBool(NULL, NULL, "-inverse_check", &check, NULL);
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    for (i = 0; i < inverse.num_free; i++)
+    {
+        inputs[i] = inverse.input[i];
+        DessalDataGetParameter(&entry_data->dessal_data, inverse.input[i], &parameter);
+        nominal[i] = *parameter;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Forward solve at the nominal inputs                                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    DessalDataGetState(&entry_data->dessal_data, state);
+
+    PlantSolve(&solver_ctx, state, &forward_reason);
+    SNESGetIterationNumber(solver_ctx.snes, &forward_iterations);
+    SNESGetNumberFunctionEvals(solver_ctx.snes, &forward_evaluations);
+
+    if (forward_reason > 0)
+    {
+        PetscCall(PlantSensitivity(&solver_ctx, state, inputs, inverse.num_free, sensitivity));
+
+        for (i = 0; i < inverse.num_free; i++)
+        {
+            EntryData shifted_data = solver_ctx.entry_data;
+
+            DessalDataGetParameter(&shifted_data.dessal_data, inverse.input[i], &parameter);
+
+            step = PETSC_SQRT_MACHINE_EPSILON * PetscMax(PetscAbsReal(*parameter), PETSC_SMALL);
+            *parameter += step;
+
+            for (k = 0; k < NUM_VAR; k++)
+                shifted[k] = state[k] + step * sensitivity[i * NUM_VAR + k];
+
+            PlantOutput(state, &solver_ctx.entry_data.dessal_data, inverse.output[i], &output);
+            PlantOutput(shifted, &shifted_data.dessal_data, inverse.output[i], &shifted_output);
+
+            inverse.orientation[i] = shifted_output < output ? -1.0 : 1.0;
+        }
+    }
+    else
+    {
+        PetscPrintf(PETSC_COMM_WORLD, "Warning: the forward solve at the nominal inputs did not converge (reason %d), the inverse solve starts "
+                                      "from the default initial guess\n", (int)forward_reason);
+
+        DessalDataGetState(&entry_data->dessal_data, state);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Augmented solve                                                                                                                               //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(SolverCtxSetInverse(&solver_ctx, &inverse));
+
+    PlantSolve(&solver_ctx, state, &reason);
+    SNESGetIterationNumber(solver_ctx.snes, &iterations);
+    SNESGetNumberFunctionEvals(solver_ctx.snes, &evaluations);
+
+    for (i = 0; i < inverse.num_free; i++)
+    {
+        solution[i] = *solver_ctx.free_input[i];
+        PlantOutput(state, &solver_ctx.entry_data.dessal_data, inverse.output[i], &achieved[i]);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Export                                                                                                                                        //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    FILE *fptr;
+    const char *output_name;
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "Inverse problem:,,\n\n");
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "Solver converged reason =, %d,\n", (int)reason);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "Newton iterations (forward and augmented solves) =, %d, %d\n", (int)forward_iterations,
+                 (int)iterations);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "Balance evaluations (forward and augmented solves) =, %d, %d\n\n", (int)forward_evaluations,
+                 (int)evaluations);
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "Freed input,nominal,lower bound,upper bound,solution,at bound\n");
+
+    for (i = 0; i < inverse.num_free; i++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.10e,%.10e,%.10e,%.10e,%s\n", inverse.input[i], (double)nominal[i], (double)inverse.min[i],
+                     (double)inverse.max[i], (double)solution[i],
+                     solution[i] <= inverse.min[i] ? "lower" : (solution[i] >= inverse.max[i] ? "upper" : "no"));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "\nTarget output,target,achieved,relative error\n");
+
+    for (i = 0; i < inverse.num_free; i++)
+    {
+        output_name = inverse.output[i] < NUM_VAR ? dessal_state_names[inverse.output[i]] : kpi_names[inverse.output[i] - NUM_VAR];
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.10e,%.10e,%.10e\n", output_name, (double)inverse.target[i], (double)achieved[i],
+                     (double)((achieved[i] - inverse.target[i]) / solver_ctx.output_scale[i]));
+    }
+
+    PetscFClose(PETSC_COMM_SELF, fptr);
+
+    ExportToFile(state, &solver_ctx.entry_data, report_file);
+
+    PetscPrintf(PETSC_COMM_WORLD, "Inverse solve: reason %d after %d Newton iterations (%d for the forward solve), results in %s and %s\n",
+                (int)reason, (int)iterations, (int)forward_iterations, file, report_file);
+
+    for (i = 0; i < inverse.num_free; i++)
+        PetscPrintf(PETSC_COMM_WORLD, "  %s = %g for %s = %g (target %g)\n", inverse.input[i], (double)solution[i],
+                    inverse.output[i] < NUM_VAR ? dessal_state_names[inverse.output[i]] : kpi_names[inverse.output[i] - NUM_VAR],
+                    (double)achieved[i], (double)inverse.target[i]);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Forward check at the inputs found                                                                                                             //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (check)
+    {
+        SolverCtx check_ctx;
+        EntryData check_data = solver_ctx.entry_data;
+        SNESConvergedReason check_reason;
+        PetscReal check_state[NUM_VAR];
+
+        SolverCtxBuild(&check_ctx, &check_data);
+
+        DessalDataResetState(&check_data.dessal_data);
+        DessalDataGetState(&check_data.dessal_data, check_state);
+
+        PlantSolve(&check_ctx, check_state, &check_reason);
+
+        PetscPrintf(PETSC_COMM_WORLD, "Inverse check (forward solve at the inputs found, reason %d):\n", (int)check_reason);
+
+        for (i = 0; i < inverse.num_free; i++)
+        {
+            PlantOutput(check_state, &check_data.dessal_data, inverse.output[i], &output);
+            PetscPrintf(PETSC_COMM_WORLD, "  output %d: forward %g, inverse %g, relative difference %g\n", (int)i, (double)output,
+                        (double)achieved[i], (double)(PetscAbsReal(output - achieved[i]) / PetscMax(PetscAbsReal(output), PETSC_SMALL)));
+        }
+
+        SolverCtxDestroy(&check_ctx);
+    }
+
+    SolverCtxDestroy(&solver_ctx);
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef INVERSE
+
+#define INVERSE
+
+#include "../plant/plant.h"
+
+// Function to fetch an inverse problem from the command line (options -inverse_inputs, -inverse_outputs, -inverse_targets, -inverse_min,
+// -inverse_max)
+PetscErrorCode InverseProblemBuild(InverseProblem *inverse, DessalData *dessal_data);
+
+// Function to run the inverse solve of the plant, finding the inputs that meet production targets
+PetscErrorCode RunInverse(EntryData *entry_data);
+
+#endif
@@ -0,0 +1,706 @@
+#include "map.h"
+#include "sampling.h"
+
+// Maximum number of mapped parameters, each refinement of a cell adding up to 3^dim points
+#define MAX_MAP_DIM 6
+
+/*
+Storage of the points of an operating map
+
+The points lie on the lattice of the coarse grid refined max_level times by bisection, so every point is identified by integer coordinates
+and the points shared by neighbouring cells are solved only once. The points are kept in an array and located through an open-addressing
+hash table of their coordinates.
+*/
+
+PetscInt64 MapSlot(OperatingMap *map, const PetscInt64 coord[])
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    PetscInt i;
+
+    for (i = 0; i < map->dim; i++)
+    {
+        hash ^= (unsigned long long)coord[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return (PetscInt64)(hash & (unsigned long long)(map->table_size - 1));
+}
+
+PetscInt64 MapFind(OperatingMap *map, const PetscInt64 coord[])
+{
+    PetscInt64 slot = MapSlot(map, coord), index;
+    PetscInt i;
+
+    while ((index = map->table[slot]) >= 0)
+    {
+        for (i = 0; i < map->dim; i++)
+            if (map->points[index].coord[i] != coord[i])
+                break;
+
+        if (i == map->dim)
+            return index;
+
+        slot = (slot + 1) & (map->table_size - 1);
+    }
+
+    return -1;
+}
+
+PetscErrorCode MapAddPoint(OperatingMap *map, const PetscInt64 coord[], PetscInt level, PetscInt64 *index, PetscBool *added)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt64 slot, k;
+    PetscInt i;
+
+    *index = MapFind(map, coord);
+    *added = *index < 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    if (!*added)
+        return 0;
+
+    if (map->num_points == map->capacity)
+    {
+        map->capacity *= 2;
+        PetscRealloc(map->capacity * sizeof(MapPoint), &map->points);
+    }
+
+    // Keeping the load factor of the hash table below one half
+    if (2 * (map->num_points + 1) > map->table_size)
+    {
+        PetscFree(map->table);
+        map->table_size *= 2;
+        PetscMalloc1(map->table_size, &map->table);
+
+        for (k = 0; k < map->table_size; k++)
+            map->table[k] = -1;
+
+        for (k = 0; k < map->num_points; k++)
+        {
+            slot = MapSlot(map, map->points[k].coord);
+            while (map->table[slot] >= 0)
+                slot = (slot + 1) & (map->table_size - 1);
+            map->table[slot] = k;
+        }
+    }
+
+    *index = map->num_points++;
+
+    for (i = 0; i < map->dim; i++)
+        map->points[*index].coord[i] = coord[i];
+    map->points[*index].reason = 0;
+    map->points[*index].level = level;
+
+    slot = MapSlot(map, coord);
+    while (map->table[slot] >= 0)
+        slot = (slot + 1) & (map->table_size - 1);
+    map->table[slot] = *index;
+
+    return 0;
+}
+
+PetscErrorCode MapValues(OperatingMap *map, const PetscReal coord[], PetscReal values[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i;
+
+    for (i = 0; i < map->dim; i++)
+        values[i] = map->grid.min[i] + (map->grid.max[i] - map->grid.min[i]) * coord[i] / (PetscReal)map->extent[i];
+
+    return 0;
+}
+
+PetscErrorCode MapInterpolate(OperatingMap *map, MapCell *cell, const PetscReal coord[], PetscReal state[], PetscReal kpi[],
+                              PetscBool *valid)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt64 corner[MAX_SWEEP], index;
+    PetscReal t[MAX_SWEEP], weight;
+    PetscInt mask, i, k;
+
+    *valid = PETSC_TRUE;
+
+    for (i = 0; i < map->dim; i++)
+        t[i] = (coord[i] - (PetscReal)cell->lo[i]) / (PetscReal)(cell->hi[i] - cell->lo[i]);
+
+    for (k = 0; k < NUM_VAR; k++)
+        state[k] = 0.0;
+    for (k = 0; k < NUM_KPI; k++)
+        kpi[k] = 0.0;
+
+    for (mask = 0; mask < (1 << map->dim); mask++)
+    {
+        weight = 1.0;
+
+        for (i = 0; i < map->dim; i++)
+        {
+            corner[i] = (mask >> i) & 1 ? cell->hi[i] : cell->lo[i];
+            weight *= (mask >> i) & 1 ? t[i] : 1.0 - t[i];
+        }
+
+        index = MapFind(map, corner);
+
+        if (index < 0 || map->points[index].reason <= 0)
+        {
+            *valid = PETSC_FALSE;
+            return 0;
+        }
+
+        for (k = 0; k < NUM_VAR; k++)
+            state[k] += weight * map->points[index].state[k];
+        for (k = 0; k < NUM_KPI; k++)
+            kpi[k] += weight * map->points[index].kpi[k];
+    }
+
+    return 0;
+}
+
+/*
+Solution of the points added to the map
+
+Each new point is warm-started from the multilinear interpolation of the solutions at the corners of the cell it was added from, which is
+a much better initial guess than any single neighbour away from the corners. The points are split in contiguous chunks among the MPI ranks
+and the results are gathered on all of them, so that every rank holds the whole map.
+*/
+
+// Data structure containing a point of the map waiting to be solved, with its initial guess
+typedef struct
+{
+    PetscInt64 point;
+    PetscReal guess[NUM_VAR];
+    PetscBool warm;
+} MapPending;
+
+PetscErrorCode MapAddPending(OperatingMap *map, MapCell *cell, const PetscInt64 coord[], PetscInt level, MapPending pending[],
+                             PetscInt64 *num_pending)
+{
+    PetscFunctionBeginUser;
+
+    MapPending *entry = &pending[*num_pending];
+    PetscReal real_coord[MAX_SWEEP], kpi[NUM_KPI];
+    PetscBool added;
+    PetscInt i;
+
+    MapAddPoint(map, coord, level, &entry->point, &added);
+
+    if (!added)
+        return 0;
+
+    for (i = 0; i < map->dim; i++)
+        real_coord[i] = (PetscReal)coord[i];
+
+    MapInterpolate(map, cell, real_coord, entry->guess, kpi, &entry->warm);
+
+    (*num_pending)++;
+
+    return 0;
+}
+
+PetscErrorCode MapSolvePending(OperatingMap *map, SolverCtx *solver_ctx, EntryData *entry_data, MapPending pending[], PetscInt64 num_pending)
+{
+    PetscFunctionBeginUser;
+
+    PetscMPIInt size, rank;
+    SNESConvergedReason reason;
+    EntryData case_data;
+    PlantKPIs kpis;
+    MapPoint *point;
+    PetscReal coord[MAX_SWEEP], values[MAX_SWEEP], state[NUM_VAR], *record, *batch, *gathered;
+    PetscInt64 chunk, k;
+    PetscInt record_size = 1 + NUM_VAR + NUM_KPI, i, j;
+
+    if (!num_pending)
+        return 0;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    chunk = (num_pending + size - 1) / size;
+
+    PetscMalloc1(chunk * record_size, &batch);
+    PetscMalloc1(size * chunk * record_size, &gathered);
+
+    for (k = 0; k < chunk; k++)
+    {
+        record = &batch[k * record_size];
+        record[0] = 0.0;
+
+        if (rank * chunk + k >= num_pending)
+            continue;
+
+        MapPending *entry = &pending[rank * chunk + k];
+
+        point = &map->points[entry->point];
+
+        for (i = 0; i < map->dim; i++)
+            coord[i] = (PetscReal)point->coord[i];
+
+        MapValues(map, coord, values);
+
+        case_data = *entry_data;
+        SweepGridApply(&map->grid, values, &case_data);
+
+        PlantSolveCase(solver_ctx, &case_data, entry->warm ? entry->guess : NULL, state, &reason);
+
+        record[0] = (PetscReal)reason;
+
+        for (j = 0; j < NUM_VAR; j++)
+            record[1 + j] = state[j];
+
+        if (reason > 0)
+        {
+            ComputeKPIs(state, &case_data.dessal_data, &kpis);
+            KPIsToArray(&kpis, &record[1 + NUM_VAR]);
+        }
+    }
+
+    MPI_Allgather(batch, chunk * record_size, MPIU_REAL, gathered, chunk * record_size, MPIU_REAL, PETSC_COMM_WORLD);
+
+    for (k = 0; k < num_pending; k++)
+    {
+        record = &gathered[k * record_size];
+        point = &map->points[pending[k].point];
+
+        point->reason = (PetscInt)record[0];
+
+        for (j = 0; j < NUM_VAR; j++)
+            point->state[j] = record[1 + j];
+
+        if (point->reason <= 0)
+            continue;
+
+        for (j = 0; j < NUM_KPI; j++)
+        {
+            point->kpi[j] = record[1 + NUM_VAR + j];
+            map->kpi_min[j] = PetscMin(map->kpi_min[j], point->kpi[j]);
+            map->kpi_max[j] = PetscMax(map->kpi_max[j], point->kpi[j]);
+        }
+    }
+
+    PetscFree(batch);
+    PetscFree(gathered);
+
+    return 0;
+}
+
+/*
+Refinement criterion
+
+The KPIs solved at the center of a cell are compared with their multilinear interpolation from the corners, the difference being divided
+by the range of each KPI over the map. Cells whose corners and center all failed to converge lie outside the feasible region and are not
+refined, while cells where only some of them failed lie on its boundary and are always refined.
+*/
+
+PetscReal MapCellError(OperatingMap *map, MapCell *cell, PetscInt64 center)
+{
+    MapPoint *point = &map->points[center];
+    PetscInt64 corner[MAX_SWEEP], index;
+    PetscReal coord[MAX_SWEEP], state[NUM_VAR], kpi[NUM_KPI], error = 0.0;
+    PetscBool valid;
+    PetscInt mask, converged = 0, i, k;
+
+    for (i = 0; i < map->dim; i++)
+        coord[i] = (PetscReal)point->coord[i];
+
+    MapInterpolate(map, cell, coord, state, kpi, &valid);
+
+    if (!valid || point->reason <= 0)
+    {
+        converged += point->reason > 0;
+
+        for (mask = 0; mask < (1 << map->dim); mask++)
+        {
+            for (i = 0; i < map->dim; i++)
+                corner[i] = (mask >> i) & 1 ? cell->hi[i] : cell->lo[i];
+
+            index = MapFind(map, corner);
+            converged += index >= 0 && map->points[index].reason > 0;
+        }
+
+        return converged ? PETSC_INFINITY : 0.0;
+    }
+
+    for (k = 0; k < NUM_KPI; k++)
+        error = PetscMax(error, PetscAbsReal(point->kpi[k] - kpi[k]) / PetscMax(map->kpi_max[k] - map->kpi_min[k], PETSC_SMALL));
+
+    return error;
+}
+
+PetscErrorCode MapCellPush(MapCell **cells, PetscInt64 *count, PetscInt64 *capacity, MapCell *cell)
+{
+    PetscFunctionBeginUser;
+
+    if (*count == *capacity)
+    {
+        *capacity = PetscMax(2 * *capacity, 64);
+        PetscRealloc(*capacity * sizeof(MapCell), cells);
+    }
+
+    (*cells)[(*count)++] = *cell;
+
+    return 0;
+}
+
+/*
+Adaptive generation of operating maps
+
+The map starts from the coarse grid given by the -map_* options. At every round, the centers of the active cells are solved and the cells
+whose interpolation error exceeds -map_tolerance are split by bisection along all parameters into 2^dim children, after solving the 3^dim
+lattice points of the split cell not yet in the map. The children become the active cells of the next round, the remaining cells being
+leaves of the map. The refinement stops at -map_max_level bisections or when -map_max_points would be exceeded. Optionally, the map is
+validated against direct solutions at -map_validate quasi-random points.
+*/
+
+PetscErrorCode RunMap(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    OperatingMap map;
+    PetscReal tolerance = 1.0e-2;
+    PetscInt64 index, k;
+    PetscInt max_points = 20000, validate = 0, pow3 = 1, i, j;
+    char file[256] = "./results/map.csv";
+
+    map.max_level = 4;
+
+    PetscOptionsGetReal(NULL, NULL, "-map_tolerance", &tolerance, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-map_max_level", &map.max_level, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-map_max_points", &max_points, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-map_validate", &validate, NULL);
+
+    PetscCall(SweepGridBuild(&map.grid, "map", sweep_default_parameters, 2, 5, &entry_data->dessal_data));
+
+    map.dim = map.grid.num_params;
+
+    PetscCheck(map.dim <= MAX_MAP_DIM, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "At most %d parameters can be mapped", MAX_MAP_DIM);
+    PetscCheck(map.max_level >= 0 && map.max_level < 20, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Maximum level must be within [0, 20)");
+
+    for (i = 0; i < map.dim; i++)
+    {
+        PetscCheck(map.grid.points[i] >= 2, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "The coarse grid needs two points of %s at least",
+                   map.grid.name[i]);
+
+        map.extent[i] = (PetscInt64)(map.grid.points[i] - 1) << map.max_level;
+        pow3 *= 3;
+    }
+
+    map.capacity = 1024;
+    map.num_points = 0;
+    map.table_size = 2048;
+    PetscMalloc1(map.capacity, &map.points);
+    PetscMalloc1(map.table_size, &map.table);
+
+    for (k = 0; k < map.table_size; k++)
+        map.table[k] = -1;
+
+    for (j = 0; j < NUM_KPI; j++)
+    {
+        map.kpi_min[j] = PETSC_MAX_REAL;
+        map.kpi_max[j] = PETSC_MIN_REAL;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Coarse grid, warm-started from the nominal solution                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    SolverCtx solver_ctx;
+    SNESConvergedReason reason;
+    MapCell cell, *active = NULL, *next = NULL, *leaves = NULL;
+    MapPending *pending;
+    PetscInt64 coord[MAX_SWEEP], num_pending = 0, num_active = 0, num_next = 0, num_leaves = 0;
+    PetscInt64 active_capacity = 0, next_capacity = 0, leaves_capacity = 0, num_cells = 1, rest;
+    PetscReal nominal_state[NUM_VAR];
+    PetscBool added, warm;
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    PlantSolveCase(&solver_ctx, entry_data, NULL, nominal_state, &reason);
+    warm = reason > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    for (i = 0; i < map.dim; i++)
+        num_cells *= map.grid.points[i] - 1;
+
+    PetscMalloc1(map.grid.num_cases, &pending);
+
+    for (k = 0; k < map.grid.num_cases; k++)
+    {
+        for (rest = k, i = map.dim - 1; i >= 0; i--)
+        {
+            coord[i] = (rest % map.grid.points[i]) << map.max_level;
+            rest /= map.grid.points[i];
+        }
+
+        MapAddPoint(&map, coord, 0, &pending[num_pending].point, &added);
+
+        for (j = 0; j < NUM_VAR; j++)
+            pending[num_pending].guess[j] = nominal_state[j];
+        pending[num_pending++].warm = warm;
+    }
+
+    MapSolvePending(&map, &solver_ctx, entry_data, pending, num_pending);
+    PetscFree(pending);
+
+    for (k = 0; k < num_cells; k++)
+    {
+        for (rest = k, i = map.dim - 1; i >= 0; i--)
+        {
+            cell.lo[i] = (rest % (map.grid.points[i] - 1)) << map.max_level;
+            cell.hi[i] = cell.lo[i] + ((PetscInt64)1 << map.max_level);
+            rest /= map.grid.points[i] - 1;
+        }
+
+        cell.level = 0;
+
+        if (map.max_level > 0)
+            MapCellPush(&active, &num_active, &active_capacity, &cell);
+        else
+            MapCellPush(&leaves, &num_leaves, &leaves_capacity, &cell);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Refinement loop                                                                                                                               //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscInt64 *centers, half, digits;
+    PetscInt finest_level = 0, mask;
+    PetscBool budget_hit = PETSC_FALSE;
+
+    while (num_active)
+    {
+        // Solving the centers of the active cells
+        PetscMalloc1(num_active, &pending);
+        PetscMalloc1(num_active, &centers);
+        num_pending = 0;
+
+        for (k = 0; k < num_active; k++)
+        {
+            for (i = 0; i < map.dim; i++)
+                coord[i] = (active[k].lo[i] + active[k].hi[i]) / 2;
+
+            MapAddPending(&map, &active[k], coord, active[k].level + 1, pending, &num_pending);
+            centers[k] = MapFind(&map, coord);
+        }
+
+        MapSolvePending(&map, &solver_ctx, entry_data, pending, num_pending);
+        PetscFree(pending);
+
+        // Splitting the cells above the tolerance, solving the new lattice points of the split cells
+        PetscMalloc1(num_active * pow3, &pending);
+        num_pending = 0;
+        num_next = 0;
+
+        for (k = 0; k < num_active; k++)
+        {
+            if (MapCellError(&map, &active[k], centers[k]) <= tolerance)
+            {
+                MapCellPush(&leaves, &num_leaves, &leaves_capacity, &active[k]);
+                continue;
+            }
+
+            if (map.num_points + pow3 > max_points)
+            {
+                budget_hit = PETSC_TRUE;
+                MapCellPush(&leaves, &num_leaves, &leaves_capacity, &active[k]);
+                continue;
+            }
+
+            half = (active[k].hi[0] - active[k].lo[0]) / 2;
+            finest_level = PetscMax(finest_level, active[k].level + 1);
+
+            for (digits = 0; digits < pow3; digits++)
+            {
+                for (rest = digits, i = 0; i < map.dim; i++, rest /= 3)
+                    coord[i] = active[k].lo[i] + (rest % 3) * half;
+
+                MapAddPending(&map, &active[k], coord, active[k].level + 1, pending, &num_pending);
+            }
+
+            for (mask = 0; mask < (1 << map.dim); mask++)
+            {
+                for (i = 0; i < map.dim; i++)
+                {
+                    cell.lo[i] = active[k].lo[i] + ((mask >> i) & 1) * half;
+                    cell.hi[i] = cell.lo[i] + half;
+                }
+
+                cell.level = active[k].level + 1;
+
+                if (cell.level < map.max_level)
+                    MapCellPush(&next, &num_next, &next_capacity, &cell);
+                else
+                    MapCellPush(&leaves, &num_leaves, &leaves_capacity, &cell);
+            }
+        }
+
+        MapSolvePending(&map, &solver_ctx, entry_data, pending, num_pending);
+        PetscFree(pending);
+        PetscFree(centers);
+
+        // The children become the active cells
+        {
+            MapCell *swap = active;
+            PetscInt64 swap_capacity = active_capacity;
+
+            active = next;
+            active_capacity = next_capacity;
+            num_active = num_next;
+            next = swap;
+            next_capacity = swap_capacity;
+        }
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Validation against direct solutions                                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMPIInt size, rank;
+    PetscReal max_error = 0.0, sum_error = 0.0, count = 0.0;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    if (validate > 0)
+    {
+        HaltonSequence halton;
+        EntryData case_data;
+        PlantKPIs kpis;
+        PetscReal unit[MAX_SWEEP], real_coord[MAX_SWEEP], values[MAX_SWEEP], guess[NUM_VAR], kpi[NUM_KPI], exact[NUM_KPI], state[NUM_VAR];
+        PetscReal error;
+        PetscBool valid;
+        PetscInt64 leaf;
+
+        HaltonBuild(&halton, map.dim, PETSC_TRUE, 7);
+
+        for (k = rank; k < validate; k += size)
+        {
+            HaltonPoint(&halton, k + 1, unit);
+
+            for (i = 0; i < map.dim; i++)
+                real_coord[i] = unit[i] * (PetscReal)map.extent[i];
+
+            for (leaf = 0; leaf < num_leaves; leaf++)
+            {
+                for (i = 0; i < map.dim; i++)
+                    if (real_coord[i] < (PetscReal)leaves[leaf].lo[i] || real_coord[i] > (PetscReal)leaves[leaf].hi[i])
+                        break;
+
+                if (i == map.dim)
+                    break;
+            }
+
+            if (leaf == num_leaves)
+                continue;
+
+            MapInterpolate(&map, &leaves[leaf], real_coord, guess, kpi, &valid);
+
+            if (!valid)
+                continue;
+
+            MapValues(&map, real_coord, values);
+
+            case_data = *entry_data;
+            SweepGridApply(&map.grid, values, &case_data);
+
+            PlantSolveCase(&solver_ctx, &case_data, guess, state, &reason);
+
+            if (reason <= 0)
+                continue;
+
+            ComputeKPIs(state, &case_data.dessal_data, &kpis);
+            KPIsToArray(&kpis, exact);
+
+            for (j = 0; j < NUM_KPI; j++)
+            {
+                error = PetscAbsReal(exact[j] - kpi[j]) / PetscMax(map.kpi_max[j] - map.kpi_min[j], PETSC_SMALL);
+                max_error = PetscMax(max_error, error);
+                sum_error += error / NUM_KPI;
+            }
+
+            count += 1.0;
+        }
+
+        MPI_Allreduce(MPI_IN_PLACE, &max_error, 1, MPIU_REAL, MPIU_MAX, PETSC_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &sum_error, 1, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPIU_REAL, MPIU_SUM, PETSC_COMM_WORLD);
+
+        HaltonDestroy(&halton);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Exporting the map                                                                                                                             //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscReal dense_points = 1.0;
+
+    for (i = 0; i < map.dim; i++)
+        dense_points *= (PetscReal)(((map.grid.points[i] - 1) << finest_level) + 1);
+
+    if (rank == 0)
+    {
+        FILE *fptr;
+        PetscReal real_coord[MAX_SWEEP], values[MAX_SWEEP];
+
+        PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "point,level");
+        for (j = 0; j < map.dim; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", map.grid.name[j]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",reason");
+        for (j = 0; j < NUM_VAR; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", dessal_state_names[j]);
+        for (j = 0; j < NUM_KPI; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", kpi_names[j]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+        for (index = 0; index < map.num_points; index++)
+        {
+            MapPoint *point = &map.points[index];
+
+            for (i = 0; i < map.dim; i++)
+                real_coord[i] = (PetscReal)point->coord[i];
+
+            MapValues(&map, real_coord, values);
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%lld,%d", (long long)index, (int)point->level);
+            for (j = 0; j < map.dim; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)values[j]);
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%d", (int)point->reason);
+
+            // Unknowns and KPIs are left empty for points that did not converge
+            for (j = 0; j < NUM_VAR; j++)
+                if (point->reason > 0)
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)point->state[j]);
+                else
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+            for (j = 0; j < NUM_KPI; j++)
+                if (point->reason > 0)
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)point->kpi[j]);
+                else
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        PetscFClose(PETSC_COMM_SELF, fptr);
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "Adaptive map: %lld points solved in %lld leaf cells, finest level %d (the uniform grid at this level has %.0f "
+                "points), results in %s\n", (long long)map.num_points, (long long)num_leaves, (int)finest_level, (double)dense_points, file);
+
+    if (budget_hit)
+        PetscPrintf(PETSC_COMM_WORLD, "Warning: refinement stopped by -map_max_points before reaching the tolerance everywhere\n");
+
+    if (validate > 0)
+        PetscPrintf(PETSC_COMM_WORLD, "Validation at %.0f points: maximum and mean interpolation errors of the KPIs, relative to their ranges, "
+                    "%g and %g\n", (double)count, (double)max_error, (double)(sum_error / PetscMax(count, 1.0)));
+
+    PetscFree(map.points);
+    PetscFree(map.table);
+    PetscFree(active);
+    PetscFree(next);
+    PetscFree(leaves);
+    SolverCtxDestroy(&solver_ctx);
+
+    return 0;
+}
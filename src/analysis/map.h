@@ -0,0 +1,44 @@
+#ifndef MAP
+
+#define MAP
+
+#include "sweep.h"
+
+// Data structure containing a point of an operating map, located by its integer coordinates on the finest lattice
+typedef struct
+{
+    PetscInt64 coord[MAX_SWEEP];
+    PetscReal state[NUM_VAR], kpi[NUM_KPI];
+    PetscInt reason, level;
+} MapPoint;
+
+// Data structure containing a cell (hyperrectangle) of an operating map, given by its lowest and highest corners on the finest lattice
+typedef struct
+{
+    PetscInt64 lo[MAX_SWEEP], hi[MAX_SWEEP];
+    PetscInt level;
+} MapCell;
+
+// Data structure containing an adaptively refined operating map
+typedef struct
+{
+    SweepGrid grid;
+    PetscInt dim, max_level;
+    PetscInt64 extent[MAX_SWEEP];
+    MapPoint *points;
+    PetscInt64 num_points, capacity;
+    PetscInt64 *table, table_size;
+    PetscReal kpi_min[NUM_KPI], kpi_max[NUM_KPI];
+} OperatingMap;
+
+// Function to find the point of a map at given lattice coordinates, returning -1 if the point was not added yet
+PetscInt64 MapFind(OperatingMap *map, const PetscInt64 coord[]);
+
+// Function to interpolate the unknowns and KPIs multilinearly within a cell whose corners were all solved
+PetscErrorCode MapInterpolate(OperatingMap *map, MapCell *cell, const PetscReal coord[], PetscReal state[], PetscReal kpi[],
+                              PetscBool *valid);
+
+// Function to run the adaptive generation of an operating map of the plant
+PetscErrorCode RunMap(EntryData *entry_data);
+
+#endif
@@ -0,0 +1,561 @@
+#include "pareto.h"
+
+/*
+Non-dominated sorting and crowding distance
+
+The converged members are peeled into successive fronts, each made of the members not dominated by any member left after the previous
+fronts (see DesignDominates). Within a front, the crowding distance of a member is the sum over the objectives of the gap between its two
+neighbours along that objective, relative to the range of the objective over the front, the extreme members getting an infinite distance
+so that the ends of the front are always kept.
+
+Reference: K. Deb, A. Pratap, S. Agarwal, T. Meyarivan, A fast and elitist multiobjective genetic algorithm: NSGA-II.
+           IEEE Trans. Evol. Comput. 6 (2002) 182-197. https://doi.org/10.1109/4235.996017
+*/
+
+PetscErrorCode ParetoSort(ParetoArchive *archive, const PetscInt members[], PetscInt num_members, PetscInt front[], PetscReal crowding[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt num_objectives = archive->objectives.num_objectives, remaining = 0, rank, num_front, i, j, k, m, *list, *perm;
+    PetscReal *key, range;
+    PetscBool dominated;
+
+    PetscMalloc1(num_members, &list);
+    PetscMalloc1(num_members, &perm);
+    PetscMalloc1(num_members, &key);
+
+    // Fronts not assigned yet are marked with -1, the front being built with -2
+    for (i = 0; i < num_members; i++)
+    {
+        front[i] = archive->points[members[i]].reason > 0 ? -1 : num_members;
+        crowding[i] = 0.0;
+        remaining += front[i] < 0;
+    }
+
+    for (rank = 0; remaining > 0; rank++)
+    {
+        for (i = 0, num_front = 0; i < num_members; i++)
+        {
+            if (front[i] != -1)
+                continue;
+
+            for (j = 0, dominated = PETSC_FALSE; !dominated && j < num_members; j++)
+                if (j != i && front[j] < 0)
+                    DesignDominates(&archive->objectives, archive->points[members[j]].values, archive->points[members[i]].values, &dominated);
+
+            if (!dominated)
+            {
+                front[i] = -2;
+                list[num_front++] = i;
+            }
+        }
+
+        for (m = 0; m < num_front; m++)
+            front[list[m]] = rank;
+
+        remaining -= num_front;
+
+        for (k = 0; k < num_objectives; k++)
+        {
+            for (m = 0; m < num_front; m++)
+            {
+                key[m] = archive->points[members[list[m]]].values[k];
+                perm[m] = m;
+            }
+
+            PetscSortRealWithPermutation(num_front, key, perm);
+
+            range = key[perm[num_front - 1]] - key[perm[0]];
+
+            crowding[list[perm[0]]] = PETSC_INFINITY;
+            crowding[list[perm[num_front - 1]]] = PETSC_INFINITY;
+
+            for (m = 1; range > 0.0 && m < num_front - 1; m++)
+                crowding[list[perm[m]]] += (key[perm[m + 1]] - key[perm[m - 1]]) / range;
+        }
+    }
+
+    PetscFree(list);
+    PetscFree(perm);
+    PetscFree(key);
+
+    return 0;
+}
+
+/*
+Evaluation of the points of the archive
+
+The points are split in contiguous chunks among the MPI ranks and the results are gathered on all of them, as for the points of an
+operating map, so that every rank holds the whole archive and draws the same offspring from the same random stream. Each point is
+screened by PlantScreen and, when feasible, solved warm-started from the solution of its first parent (or from the nominal solution for
+the initial population), which is close to it in the design space.
+*/
+
+PetscErrorCode ParetoCase(ParetoArchive *archive, ParetoPoint *point, EntryData *entry_data, EntryData *case_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal values[MAX_SWEEP];
+    PetscInt i;
+
+    for (i = 0; i < archive->bounds.num_params; i++)
+        values[i] = archive->bounds.min[i] + point->unit[i] * (archive->bounds.max[i] - archive->bounds.min[i]);
+
+    *case_data = *entry_data;
+    PetscCall(SweepGridApply(&archive->bounds, values, case_data));
+
+    return 0;
+}
+
+PetscErrorCode ParetoEvaluate(ParetoArchive *archive, SolverCtx *solver_ctx, EntryData *entry_data, const PetscReal nominal_state[],
+                              PetscInt first, PetscInt count)
+{
+    PetscFunctionBeginUser;
+
+    PetscMPIInt size, rank;
+    SNESConvergedReason reason;
+    EntryData case_data;
+    ParetoPoint *point;
+    const PetscReal *warm_state;
+    PetscReal state[NUM_VAR], *record, *batch, *gathered;
+    PetscInt record_size = 1 + NUM_VAR, chunk, k, j;
+
+    if (!count)
+        return 0;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    chunk = (count + size - 1) / size;
+
+    PetscMalloc1(chunk * record_size, &batch);
+    PetscMalloc1(size * chunk * record_size, &gathered);
+
+    for (k = 0; k < chunk; k++)
+    {
+        record = &batch[k * record_size];
+        record[0] = 0.0;
+
+        if (rank * chunk + k >= count)
+            continue;
+
+        point = &archive->points[first + rank * chunk + k];
+
+        PetscCall(ParetoCase(archive, point, entry_data, &case_data));
+
+        warm_state = point->parent >= 0 && archive->points[point->parent].reason > 0 ? archive->points[point->parent].state : nominal_state;
+
+        PlantSolveCase(solver_ctx, &case_data, warm_state, state, &reason);
+
+        record[0] = (PetscReal)reason;
+
+        for (j = 0; j < NUM_VAR; j++)
+            record[1 + j] = state[j];
+    }
+
+    MPI_Allgather(batch, chunk * record_size, MPIU_REAL, gathered, chunk * record_size, MPIU_REAL, PETSC_COMM_WORLD);
+
+    for (k = 0; k < count; k++)
+    {
+        record = &gathered[k * record_size];
+        point = &archive->points[first + k];
+
+        point->reason = (PetscInt)record[0];
+
+        for (j = 0; j < NUM_VAR; j++)
+            point->state[j] = record[1 + j];
+
+        if (point->reason <= 0)
+            continue;
+
+        PetscCall(ParetoCase(archive, point, entry_data, &case_data));
+        DesignObjectivesEvaluate(&archive->objectives, &case_data, point->state, point->values);
+    }
+
+    PetscFree(batch);
+    PetscFree(gathered);
+
+    return 0;
+}
+
+/*
+Variation operators
+
+Offspring are bred in the design parameters normalized within their bounds, by simulated binary crossover (each parameter crossed with
+probability 1/2, with distribution index -pareto_crossover_eta) and polynomial mutation (each parameter mutated with probability
+1/num_params, with distribution index -pareto_mutation_eta), both in their bounded forms that never leave the unit hypercube.
+
+Reference: K. Deb, R.B. Agrawal, Simulated binary crossover for continuous search space. Complex Syst. 9 (1995) 115-148.
+*/
+
+PetscReal ParetoSpread(PetscReal distance, PetscReal eta, PetscReal u)
+{
+    PetscReal beta = 1.0 + 2.0 * distance, alpha = 2.0 - PetscPowReal(beta, -(eta + 1.0));
+
+    if (u <= 1.0 / alpha)
+        return PetscPowReal(u * alpha, 1.0 / (eta + 1.0));
+
+    return PetscPowReal(1.0 / (2.0 - u * alpha), 1.0 / (eta + 1.0));
+}
+
+PetscErrorCode ParetoCrossover(PetscRandom random, PetscInt dim, PetscReal eta, const PetscReal first[], const PetscReal second[],
+                               PetscReal child_first[], PetscReal child_second[])
+{
+    PetscFunctionBeginUser;
+
+    PetscReal low, high, u, lower_child, upper_child;
+    PetscInt i;
+
+    for (i = 0; i < dim; i++)
+    {
+        child_first[i] = first[i];
+        child_second[i] = second[i];
+
+        PetscRandomGetValueReal(random, &u);
+
+        if (u > 0.5 || PetscAbsReal(first[i] - second[i]) < PETSC_SMALL)
+            continue;
+
+        low = PetscMin(first[i], second[i]);
+        high = PetscMax(first[i], second[i]);
+
+        PetscRandomGetValueReal(random, &u);
+        lower_child = 0.5 * (low + high - ParetoSpread(low / (high - low), eta, u) * (high - low));
+        upper_child = 0.5 * (low + high + ParetoSpread((1.0 - high) / (high - low), eta, u) * (high - low));
+
+        lower_child = PetscMin(PetscMax(lower_child, 0.0), 1.0);
+        upper_child = PetscMin(PetscMax(upper_child, 0.0), 1.0);
+
+        // Each child inherits the side of either parent at random
+        PetscRandomGetValueReal(random, &u);
+        child_first[i] = u < 0.5 ? lower_child : upper_child;
+        child_second[i] = u < 0.5 ? upper_child : lower_child;
+    }
+
+    return 0;
+}
+
+PetscErrorCode ParetoMutate(PetscRandom random, PetscInt dim, PetscReal eta, PetscReal unit[])
+{
+    PetscFunctionBeginUser;
+
+    PetscReal u, value, shift;
+    PetscInt i;
+
+    for (i = 0; i < dim; i++)
+    {
+        PetscRandomGetValueReal(random, &u);
+
+        if (u >= 1.0 / dim)
+            continue;
+
+        PetscRandomGetValueReal(random, &u);
+
+        if (u < 0.5)
+        {
+            value = 2.0 * u + (1.0 - 2.0 * u) * PetscPowReal(1.0 - unit[i], eta + 1.0);
+            shift = PetscPowReal(value, 1.0 / (eta + 1.0)) - 1.0;
+        }
+        else
+        {
+            value = 2.0 * (1.0 - u) + 2.0 * (u - 0.5) * PetscPowReal(unit[i], eta + 1.0);
+            shift = 1.0 - PetscPowReal(value, 1.0 / (eta + 1.0));
+        }
+
+        unit[i] = PetscMin(PetscMax(unit[i] + shift, 0.0), 1.0);
+    }
+
+    return 0;
+}
+
+PetscInt ParetoTournament(PetscRandom random, PetscInt num_members, const PetscInt front[], const PetscReal crowding[])
+{
+    PetscReal u;
+    PetscInt first, second;
+
+    PetscRandomGetValueReal(random, &u);
+    first = PetscMin((PetscInt)(u * num_members), num_members - 1);
+    PetscRandomGetValueReal(random, &u);
+    second = PetscMin((PetscInt)(u * num_members), num_members - 1);
+
+    if (front[second] < front[first] || (front[second] == front[first] && crowding[second] > crowding[first]))
+        return second;
+
+    return first;
+}
+
+PetscErrorCode ParetoArchivePush(ParetoArchive *archive, ParetoPoint *point)
+{
+    PetscFunctionBeginUser;
+
+    if (archive->num_points == archive->capacity)
+    {
+        archive->capacity = PetscMax(2 * archive->capacity, 64);
+        PetscRealloc(archive->capacity * sizeof(ParetoPoint), &archive->points);
+    }
+
+    archive->points[archive->num_points++] = *point;
+
+    return 0;
+}
+
+/*
+Pareto front search (NSGA-II)
+
+The design parameters and their bounds are given by -pareto_parameters, -pareto_min and -pareto_max (as for a sweep, by default the
+membrane area, the feed flow rate and the air gap thickness within 20% of their nominal values), and the objectives by -pareto_objectives
+and -pareto_senses (as for a design exploration, by default the distillate rate maximized, and the specific energy consumption and the
+membrane area, as a cost, minimized). The initial population of -pareto_population members is drawn from a scrambled Halton sequence.
+At every generation, as many offspring are bred from parents chosen by binary tournaments on their front and crowding distance, and the
+population and offspring together are sorted to keep the best members, front by front, the last front kept being cut by decreasing
+crowding distance. Infeasible or unconverged members rank behind every converged one. Every evaluated point is kept in the archive, whose
+own non-dominated points form the returned front.
+*/
+
+PetscErrorCode RunPareto(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    ParetoArchive archive;
+    ParetoPoint point;
+    SolverCtx solver_ctx;
+    SNESConvergedReason reason;
+    HaltonSequence halton;
+    PetscRandom random;
+    PetscLogDouble start, end;
+    PetscMPIInt rank;
+    PetscReal crossover_eta = 15.0, mutation_eta = 20.0, u, nominal_state[NUM_VAR], *crowding, *cut, *values;
+    PetscInt population = 32, generations = 20, seed = 1, dim, num_objectives, num_converged = 0, num_front = 0, num_next, generation;
+    PetscInt *members, *front, *next, *perm, num_cut, level, i, j, k;
+    PetscBool nominal, *converged, *archive_front;
+    char file[256] = "./results/pareto.csv";
+    FILE *fptr;
+
+    PetscOptionsGetInt(NULL, NULL, "-pareto_population", &population, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-pareto_generations", &generations, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-pareto_seed", &seed, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-pareto_crossover_eta", &crossover_eta, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-pareto_mutation_eta", &mutation_eta, NULL);
+
+    PetscCheck(population >= 4 && population % 2 == 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+               "The population must be even and have four members at least");
+    PetscCheck(generations >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "The number of generations must not be negative");
+
+    PetscCall(SweepGridBuild(&archive.bounds, "pareto", pareto_default_parameters, 3, 2, &entry_data->dessal_data));
+    PetscCall(DesignObjectivesBuild(&archive.objectives, "pareto", pareto_default_objectives, pareto_default_senses, 3,
+                                    &entry_data->dessal_data));
+
+    dim = archive.bounds.num_params;
+    num_objectives = archive.objectives.num_objectives;
+
+    for (i = 0; i < dim; i++)
+        PetscCheck(archive.bounds.max[i] > archive.bounds.min[i], PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+                   "The upper bound of %s must exceed its lower bound", archive.bounds.name[i]);
+
+    archive.points = NULL;
+    archive.num_points = 0;
+    archive.capacity = 0;
+
+    PetscMalloc1(2 * population, &members);
+    PetscMalloc1(2 * population, &front);
+    PetscMalloc1(2 * population, &crowding);
+    PetscMalloc1(2 * population, &next);
+    PetscMalloc1(2 * population, &perm);
+    PetscMalloc1(2 * population, &cut);
+
+    // Every rank draws the same random stream, so that all of them breed the same offspring
+    PetscRandomCreate(PETSC_COMM_SELF, &random);
+    PetscRandomSetSeed(random, (unsigned long)seed);
+    PetscRandomSeed(random);
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    PetscTime(&start);
+
+    PlantSolveCase(&solver_ctx, entry_data, NULL, nominal_state, &reason);
+    nominal = reason > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Initial population                                                                                                                            //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    HaltonBuild(&halton, dim, PETSC_TRUE, (unsigned long)seed);
+
+    for (i = 0; i < population; i++)
+    {
+        HaltonPoint(&halton, i + 1, point.unit);
+        point.generation = 0;
+        point.parent = -1;
+        point.reason = 0;
+
+        ParetoArchivePush(&archive, &point);
+        members[i] = i;
+    }
+
+    HaltonDestroy(&halton);
+
+    PetscCall(ParetoEvaluate(&archive, &solver_ctx, entry_data, nominal ? nominal_state : NULL, 0, population));
+    PetscCall(ParetoSort(&archive, members, population, front, crowding));
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Generations                                                                                                                                   //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    for (generation = 1; generation <= generations; generation++)
+    {
+        PetscInt first = archive.num_points, parent_first, parent_second;
+        ParetoPoint sibling;
+
+        for (i = 0; i < population; i += 2)
+        {
+            parent_first = members[ParetoTournament(random, population, front, crowding)];
+            parent_second = members[ParetoTournament(random, population, front, crowding)];
+
+            PetscRandomGetValueReal(random, &u);
+
+            if (u < 0.9)
+                ParetoCrossover(random, dim, crossover_eta, archive.points[parent_first].unit, archive.points[parent_second].unit,
+                                point.unit, sibling.unit);
+            else
+                for (j = 0; j < dim; j++)
+                {
+                    point.unit[j] = archive.points[parent_first].unit[j];
+                    sibling.unit[j] = archive.points[parent_second].unit[j];
+                }
+
+            ParetoMutate(random, dim, mutation_eta, point.unit);
+            ParetoMutate(random, dim, mutation_eta, sibling.unit);
+
+            point.generation = sibling.generation = generation;
+            point.reason = sibling.reason = 0;
+            point.parent = parent_first;
+            sibling.parent = parent_second;
+
+            ParetoArchivePush(&archive, &point);
+            ParetoArchivePush(&archive, &sibling);
+        }
+
+        PetscCall(ParetoEvaluate(&archive, &solver_ctx, entry_data, nominal ? nominal_state : NULL, first, population));
+
+        // Population and offspring sorted together, the best half surviving
+        for (i = 0; i < population; i++)
+            members[population + i] = first + i;
+
+        PetscCall(ParetoSort(&archive, members, 2 * population, front, crowding));
+
+        for (level = 0, num_next = 0; num_next < population; level++)
+        {
+            for (i = 0, num_cut = 0; i < 2 * population; i++)
+                if (front[i] == level)
+                {
+                    perm[num_cut] = i;
+                    cut[num_cut++] = -crowding[i];
+                }
+
+            if (num_next + num_cut > population)
+                PetscSortRealWithPermutation(num_cut, cut, perm);
+
+            for (k = 0; k < num_cut && num_next < population; k++)
+                next[num_next++] = perm[k];
+        }
+
+        for (i = 0; i < population; i++)
+        {
+            cut[i] = crowding[next[i]];
+            perm[i] = front[next[i]];
+            next[i] = members[next[i]];
+        }
+
+        for (i = 0; i < population; i++)
+        {
+            members[i] = next[i];
+            front[i] = perm[i];
+            crowding[i] = cut[i];
+        }
+    }
+
+    PetscTime(&end);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Writing the archive                                                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMalloc1(archive.num_points * num_objectives, &values);
+    PetscMalloc1(archive.num_points, &converged);
+    PetscMalloc1(archive.num_points, &archive_front);
+
+    for (i = 0; i < archive.num_points; i++)
+    {
+        converged[i] = archive.points[i].reason > 0 ? PETSC_TRUE : PETSC_FALSE;
+        num_converged += converged[i];
+
+        for (k = 0; k < num_objectives; k++)
+            values[i * num_objectives + k] = archive.points[i].values[k];
+    }
+
+    PetscCall(DesignParetoFront(&archive.objectives, values, converged, archive.num_points, archive_front));
+
+    for (i = 0; i < archive.num_points; i++)
+        num_front += archive_front[i];
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    if (rank == 0)
+    {
+        EntryData case_data;
+        PetscReal *parameter;
+
+        PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "point,generation,parent");
+        for (k = 0; k < dim; k++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", archive.bounds.name[k]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",reason");
+        for (k = 0; k < num_objectives; k++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",objective_%s", archive.objectives.name[k]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",pareto\n");
+
+        for (i = 0; i < archive.num_points; i++)
+        {
+            ParetoCase(&archive, &archive.points[i], entry_data, &case_data);
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%d,%d,%d", (int)i, (int)archive.points[i].generation, (int)archive.points[i].parent);
+            for (k = 0; k < dim; k++)
+            {
+                DessalDataGetParameter(&case_data.dessal_data, archive.bounds.name[k], &parameter);
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)*parameter);
+            }
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%d", (int)archive.points[i].reason);
+
+            // Objectives are left empty for points that did not converge
+            for (k = 0; k < num_objectives; k++)
+                if (converged[i])
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)values[i * num_objectives + k]);
+                else
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%d\n", (int)archive_front[i]);
+        }
+
+        PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "Pareto front search: %d generations of %d members, %d points evaluated (%d converged), %d on the front in "
+                "%.4f s\n", (int)generations, (int)population, (int)archive.num_points, (int)num_converged, (int)num_front, end - start);
+    PetscPrintf(PETSC_COMM_WORLD, "Results written to %s\n", file);
+
+    PetscRandomDestroy(&random);
+    SolverCtxDestroy(&solver_ctx);
+
+    PetscFree(archive.points);
+    PetscFree(members);
+    PetscFree(front);
+    PetscFree(crowding);
+    PetscFree(next);
+    PetscFree(perm);
+    PetscFree(cut);
+    PetscFree(values);
+    PetscFree(converged);
+    PetscFree(archive_front);
+
+    return 0;
+}
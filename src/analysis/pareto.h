@@ -0,0 +1,41 @@
+#ifndef PARETO
+
+#define PARETO
+
+#include "design.h"
+#include "sampling.h"
+
+// Design parameters and objectives of a Pareto front search unless given on the command line, and the senses of the objectives
+static const char *const pareto_default_parameters[] = {"membrane_area", "feed_mass_flow_rate", "air_gap_thickness"};
+static const char *const pareto_default_objectives[] = {"distillate_rate", "SEC", "membrane_area"};
+static const char *const pareto_default_senses[] = {"max", "min", "min"};
+
+// Data structure containing a point evaluated by a Pareto front search
+typedef struct
+{
+    PetscReal unit[MAX_SWEEP]; // Design parameters, normalized within their bounds
+    PetscReal state[NUM_VAR], values[MAX_OBJECTIVES];
+    PetscInt generation, parent, reason; // Parent whose solution warm-starts the solve (-1 for the nominal solution)
+} ParetoPoint;
+
+// Data structure containing the archive of all the points evaluated by a Pareto front search
+typedef struct
+{
+    SweepGrid bounds; // Design parameters and their bounds (the numbers of points are not used)
+    DesignObjectives objectives;
+    ParetoPoint *points;
+    PetscInt num_points, capacity;
+} ParetoArchive;
+
+// Function to sort members of the archive into non-dominated fronts, returning the front of each member (0 for the first one, the number
+// of members for the unconverged ones) and its crowding distance within its front
+PetscErrorCode ParetoSort(ParetoArchive *archive, const PetscInt members[], PetscInt num_members, PetscInt front[], PetscReal crowding[]);
+
+// Function to solve points of the archive split among the MPI ranks, each warm-started from the solution of its parent
+PetscErrorCode ParetoEvaluate(ParetoArchive *archive, SolverCtx *solver_ctx, EntryData *entry_data, const PetscReal nominal_state[],
+                              PetscInt first, PetscInt count);
+
+// Function to run the search of the Pareto front of the design parameters of the desalination module with an evolutionary algorithm
+PetscErrorCode RunPareto(EntryData *entry_data);
+
+#endif
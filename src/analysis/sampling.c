@@ -0,0 +1,197 @@
+#include "sampling.h"
+
+/*
+Halton low-discrepancy sequence with random digit permutations (scrambling), which breaks the correlations between the dimensions built
+on large prime bases
+
+Reference: J.H. Halton, On the efficiency of certain quasi-random sequences of points in evaluating multi-dimensional integrals.
+           Numer. Math. 2 (1960) 84-90. https://doi.org/10.1007/BF01386213
+*/
+
+PetscErrorCode HaltonBuild(HaltonSequence *halton, PetscInt dim, PetscBool scramble, unsigned long seed)
+{
+    PetscFunctionBeginUser;
+
+    PetscRandom random;
+    PetscInt i, j, k, candidate, swap;
+    PetscReal value;
+    PetscBool prime;
+
+    halton->dim = dim;
+
+    PetscMalloc1(dim, &halton->base);
+
+    // First dim prime numbers
+    for (i = 0, candidate = 2; i < dim; candidate++)
+    {
+        prime = PETSC_TRUE;
+
+        for (j = 2; j * j <= candidate && prime; j++)
+            if (candidate % j == 0)
+                prime = PETSC_FALSE;
+
+        if (prime)
+            halton->base[i++] = candidate;
+    }
+
+    halton->max_base = dim > 0 ? halton->base[dim - 1] : 1;
+
+    PetscMalloc1(dim * halton->max_base, &halton->permutation);
+
+    PetscRandomCreate(PETSC_COMM_SELF, &random);
+    PetscRandomSetSeed(random, seed);
+    PetscRandomSeed(random);
+
+    // Random permutations of the digits that keep the digit zero fixed (Fisher-Yates shuffle of the others)
+    for (i = 0; i < dim; i++)
+    {
+        PetscInt *permutation = &halton->permutation[i * halton->max_base];
+
+        for (k = 0; k < halton->base[i]; k++)
+            permutation[k] = k;
+
+        if (!scramble)
+            continue;
+
+        for (k = halton->base[i] - 1; k > 1; k--)
+        {
+            PetscRandomGetValueReal(random, &value);
+            j = 1 + (PetscInt)(value * k);
+            j = PetscMin(j, k);
+
+            swap = permutation[k];
+            permutation[k] = permutation[j];
+            permutation[j] = swap;
+        }
+    }
+
+    PetscRandomDestroy(&random);
+
+    return 0;
+}
+
+PetscErrorCode HaltonPoint(HaltonSequence *halton, PetscInt64 index, PetscReal point[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i, base, *permutation;
+    PetscInt64 remainder;
+    PetscReal factor;
+
+    for (i = 0; i < halton->dim; i++)
+    {
+        base = halton->base[i];
+        permutation = &halton->permutation[i * halton->max_base];
+        factor = 1.0 / base;
+        remainder = index;
+        point[i] = 0.0;
+
+        // Scrambled radical inverse of the index
+        while (remainder > 0)
+        {
+            point[i] += permutation[remainder % base] * factor;
+            remainder /= base;
+            factor /= base;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode HaltonDestroy(HaltonSequence *halton)
+{
+    PetscFunctionBeginUser;
+
+    PetscFree(halton->base);
+    PetscFree(halton->permutation);
+
+    return 0;
+}
+
+/*
+Rational approximation of the inverse of the standard normal cumulative distribution function, refined by one step of Halley's method
+
+Reference: P.J. Acklam, An algorithm for computing the inverse normal cumulative distribution function (2003).
+*/
+
+PetscReal InverseNormalCDF(PetscReal probability)
+{
+    PetscReal a[6] = {-3.969683028665376e+01,
+                      2.209460984245205e+02,
+                      -2.759285104469687e+02,
+                      1.383577518672690e+02,
+                      -3.066479806614716e+01,
+                      2.506628277459239e+00};
+    PetscReal b[5] = {-5.447609879822406e+01,
+                      1.615858368580409e+02,
+                      -1.556989798598866e+02,
+                      6.680131188771972e+01,
+                      -1.328068155288572e+01};
+    PetscReal c[6] = {-7.784894002430293e-03,
+                      -3.223964580411365e-01,
+                      -2.400758277161838e+00,
+                      -2.549732539343734e+00,
+                      4.374664141464968e+00,
+                      2.938163982698783e+00};
+    PetscReal d[4] = {7.784695709041462e-03,
+                      3.224671290700398e-01,
+                      2.445134137142996e+00,
+                      3.754408661907416e+00};
+    PetscReal p_low = 0.02425, q, r, x, error;
+
+    if (probability <= 0.0)
+        return PETSC_NINFINITY;
+
+    if (probability >= 1.0)
+        return PETSC_INFINITY;
+
+    if (probability < p_low)
+    {
+        q = PetscSqrtReal(-2.0 * PetscLogReal(probability));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]);
+        x /= ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    else if (probability <= 1.0 - p_low)
+    {
+        q = probability - 0.5;
+        r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q;
+        x /= (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+    }
+    else
+    {
+        q = PetscSqrtReal(-2.0 * PetscLogReal(1.0 - probability));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]);
+        x /= ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+
+    error = 0.5 * erfc(-x / PetscSqrtReal(2.0)) - probability;
+    r = error * PetscSqrtReal(2.0 * PETSC_PI) * PetscExpReal(0.5 * x * x);
+    x -= r / (1.0 + 0.5 * x * r);
+
+    return x;
+}
+
+PetscReal NormalCDF(PetscReal x)
+{
+    return 0.5 * erfc(-x / PetscSqrtReal(2.0));
+}
+
+/*
+Quantile of the Student t distribution by the Cornish-Fisher expansion around the normal quantile, accurate to a few parts in a thousand
+down to three degrees of freedom
+
+Reference: M. Abramowitz, I.A. Stegun, Handbook of mathematical functions (1964), formula 26.7.5.
+*/
+
+PetscReal StudentQuantile(PetscReal probability, PetscInt dof)
+{
+    PetscReal x = InverseNormalCDF(probability), x2 = x * x, nu = (PetscReal)dof, g[4];
+
+    g[0] = (x2 + 1.0) * x / 4.0;
+    g[1] = ((5.0 * x2 + 16.0) * x2 + 3.0) * x / 96.0;
+    g[2] = (((3.0 * x2 + 19.0) * x2 + 17.0) * x2 - 15.0) * x / 384.0;
+    g[3] = ((((79.0 * x2 + 776.0) * x2 + 1482.0) * x2 - 1920.0) * x2 - 945.0) * x / 92160.0;
+
+    return x + g[0] / nu + g[1] / (nu * nu) + g[2] / (nu * nu * nu) + g[3] / (nu * nu * nu * nu);
+}
@@ -0,0 +1,32 @@
+#ifndef SAMPLING
+
+#define SAMPLING
+
+#include <petscsys.h>
+
+// Data structure containing a (optionally scrambled) Halton low-discrepancy sequence
+typedef struct
+{
+    PetscInt dim, max_base;
+    PetscInt *base, *permutation;
+} HaltonSequence;
+
+// Halton sequence constructor
+PetscErrorCode HaltonBuild(HaltonSequence *halton, PetscInt dim, PetscBool scramble, unsigned long seed);
+
+// Function to compute the point of a given index (starting from 1) of the Halton sequence, within the unit hypercube
+PetscErrorCode HaltonPoint(HaltonSequence *halton, PetscInt64 index, PetscReal point[]);
+
+// Halton sequence destructor
+PetscErrorCode HaltonDestroy(HaltonSequence *halton);
+
+// Function to calculate the inverse of the standard normal cumulative distribution function
+PetscReal InverseNormalCDF(PetscReal probability);
+
+// Function to calculate the standard normal cumulative distribution function
+PetscReal NormalCDF(PetscReal x);
+
+// Function to calculate a quantile of the Student t distribution with a given number of degrees of freedom
+PetscReal StudentQuantile(PetscReal probability, PetscInt dof);
+
+#endif
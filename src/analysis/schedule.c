@@ -0,0 +1,391 @@
+#include "schedule.h"
+#include "../properties/properties.h"
+
+/*
+Forecast of a day
+
+The inlet temperatures of the feed (after the solar heater) and of the coolant (seawater), and the heat available for the plant, are given
+as piecewise-linear profiles over common breakpoints in hours (-schedule_times), each one constant before its first breakpoint and after its
+last one. A profile that is not given holds the nominal inlet temperature, or unlimited heat.
+*/
+
+PetscErrorCode ScheduleForecastBuild(ScheduleForecast *forecast, EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    const char *options[3] = {"-schedule_feed_temperature", "-schedule_cool_temperature", "-schedule_heat"};
+    PetscReal *profiles[3] = {forecast->feed_temperature, forecast->cool_temperature, forecast->heat};
+    PetscReal defaults[3] = {entry_data->dessal_data.entry_temperature_feed, entry_data->dessal_data.entry_temperature_cool, PETSC_INFINITY};
+    PetscInt num_times = MAX_FORECAST, num_values, i, k;
+    PetscBool given_times, given;
+
+    PetscOptionsGetRealArray(NULL, NULL, "-schedule_times", forecast->time, &num_times, &given_times);
+
+    if (!given_times)
+    {
+        num_times = 1;
+        forecast->time[0] = 0.0;
+    }
+
+    forecast->num_points = num_times;
+
+    for (i = 1; i < num_times; i++)
+        PetscCheck(forecast->time[i] >= forecast->time[i - 1], PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+                   "The times of the forecast must be nondecreasing");
+
+    for (k = 0; k < 3; k++)
+    {
+        num_values = MAX_FORECAST;
+
+        PetscOptionsGetRealArray(NULL, NULL, options[k], profiles[k], &num_values, &given);
+
+        PetscCheck(!given || (given_times && num_values == num_times), PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+                   "Option %s needs one value per breakpoint of -schedule_times", options[k]);
+
+        for (i = 0; !given && i < num_times; i++)
+            profiles[k][i] = defaults[k];
+    }
+
+    return 0;
+}
+
+PetscErrorCode ScheduleForecastValue(const ScheduleForecast *forecast, const PetscReal profile[], PetscReal time, PetscReal *value)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal weight;
+    PetscInt i = 0;
+
+    // Piecewise-linear interpolation, constant before the first breakpoint and after the last one
+    while (i + 1 < forecast->num_points && forecast->time[i + 1] < time)
+        i++;
+
+    if (i + 1 == forecast->num_points || time <= forecast->time[0])
+        *value = profile[time <= forecast->time[0] ? 0 : i];
+    else
+    {
+        weight = (time - forecast->time[i]) / (forecast->time[i + 1] - forecast->time[i]);
+        *value = (1.0 - weight) * profile[i] + weight * profile[i + 1];
+    }
+
+    return 0;
+}
+
+/*
+Heat input of a setpoint
+
+The heater brings the feed up to its inlet temperature. The feed is drawn from the coolant preheated by the module, up to the coolant flow
+rate, and the rest from the sea at the coolant inlet temperature, so the heat input is the sensible heat of the feed flow rate between the
+temperature of this mix and the feed inlet temperature. Unlike the heat input of the KPIs, which charges the coolant flow rate, it does not
+vanish when the coolant is throttled, and it is computed directly rather than from the specific consumption, undefined without distillate.
+*/
+
+PetscErrorCode ScheduleHeatInput(const PetscReal state[], DessalData *dessal_data, PetscReal *heat_input)
+{
+    PetscFunctionBeginUser;
+
+    SaltWaterProperties prop;
+    PetscReal feed = dessal_data->feed_mass_flow_rate, preheated = PetscMin(dessal_data->cool_mass_flow_rate, feed), heater_temperature;
+
+    heater_temperature = (preheated * state[1] + (feed - preheated) * dessal_data->entry_temperature_cool) / feed;
+
+    SaltWaterPropBuild(&prop, 0.5 * (dessal_data->entry_temperature_feed + heater_temperature), dessal_data->entry_salinity_feed);
+
+    *heat_input = feed * prop.specific_heat * (dessal_data->entry_temperature_feed - heater_temperature);
+
+    return 0;
+}
+
+/*
+Scheduling of the setpoints over a day
+
+The day is split into steps of -schedule_step_time hours, the plant being at steady state within each step at the forecast conditions of
+its midpoint. At every step, the setpoints take their values on a grid (-schedule_parameters, -schedule_min, -schedule_max,
+-schedule_points, as for a sweep), or the plant is off. A setpoint is admissible at a step when its case converges to a positive distillate
+rate with a heat input below the heat available then.
+
+The steady states are solved once per distinct operating conditions: the forecast temperatures are rounded to -schedule_resolution, and the
+steps whose conditions round to the same values share the evaluations of the setpoints (a cache keyed by the rounded conditions), which
+spares most of the solves over the nights and the plateaus of the forecast. The setpoints of a condition are solved in the order of the
+grid, consecutive cases being neighbours, each one warm-started from the solution of the same setpoint at the previous condition.
+
+The schedule maximizing the distillate of the day within the daily heat budget (-schedule_heat_budget, in kWh) is then found by dynamic
+programming, backwards over the steps, on the heat left in the budget discretized in -schedule_budget_bins bins. The heat of a setpoint is
+rounded up to whole bins, so that the schedule never exceeds the budget, at the cost of at most one bin per step; without a budget, every
+step takes its best admissible setpoint.
+*/
+
+PetscErrorCode RunSchedule(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    SweepGrid grid;
+    ScheduleForecast forecast;
+    ScheduleConditions *conditions;
+    SolverCtx solver_ctx;
+    LockstepSolver lockstep;
+    PlantKPIs kpis;
+    SNESConvergedReason *reasons;
+    EntryData *cases;
+    PetscReal step_time = 1.0, resolution = 0.1, budget = PETSC_INFINITY, bin_energy = 0.0, time, feed_temperature, cool_temperature;
+    PetscReal best, candidate, total_distillate = 0.0, total_heat = 0.0;
+    PetscReal *values, *available, *distillate, *heat_input, *states, *warm_states, *value;
+    PetscBool *warm, *admissible;
+    PetscInt num_steps = 24, num_bins = 480, lanes = 0, num_setpoints, num_conditions = 0, num_solved = 0, c, d, s, b, k;
+    PetscInt *step_condition, *cost, *choice;
+    PetscLogDouble start, end, solving_time;
+    char file[256] = "./results/schedule.csv";
+    FILE *fptr;
+
+    PetscOptionsGetInt(NULL, NULL, "-schedule_steps", &num_steps, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-schedule_step_time", &step_time, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-schedule_resolution", &resolution, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-schedule_heat_budget", &budget, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-schedule_budget_bins", &num_bins, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-lockstep_lanes", &lanes, NULL);
+
+    PetscCheck(num_steps > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of steps of the schedule must be positive");
+    PetscCheck(step_time > 0.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Duration of the steps of the schedule must be positive");
+    PetscCheck(resolution > 0.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Resolution of the forecast temperatures must be positive");
+    PetscCheck(budget > 0.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "The heat budget of the day must be positive");
+    PetscCheck(num_bins > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of bins of the heat budget must be positive");
+    PetscCheck(!entry_data->recycle_data.enabled, PETSC_COMM_WORLD, PETSC_ERR_SUP, "The schedule does not support the recycle loop");
+
+    PetscCall(SweepGridBuild(&grid, "schedule", schedule_default_setpoints, 3, 5, &entry_data->dessal_data));
+    PetscCall(ScheduleForecastBuild(&forecast, entry_data));
+
+    num_setpoints = (PetscInt)grid.num_cases;
+
+    // Without a budget, a single state of the dynamic programming with every heat costing nothing
+    if (budget < PETSC_INFINITY)
+        bin_energy = budget / num_bins;
+    else
+        num_bins = 0;
+
+    PetscMalloc1(num_setpoints * grid.num_params, &values);
+    PetscMalloc1(num_steps, &conditions);
+    PetscMalloc1(num_steps, &step_condition);
+    PetscMalloc1(num_steps, &available);
+
+    for (d = 0; d < num_setpoints; d++)
+        SweepGridCase(&grid, d, &values[d * grid.num_params]);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Forecast conditions of the steps, sharing the conditions that round to the same values                                                        //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    for (s = 0; s < num_steps; s++)
+    {
+        time = (s + 0.5) * step_time;
+
+        ScheduleForecastValue(&forecast, forecast.feed_temperature, time, &feed_temperature);
+        ScheduleForecastValue(&forecast, forecast.cool_temperature, time, &cool_temperature);
+        ScheduleForecastValue(&forecast, forecast.heat, time, &available[s]);
+
+        feed_temperature = resolution * PetscFloorReal(feed_temperature / resolution + 0.5);
+        cool_temperature = resolution * PetscFloorReal(cool_temperature / resolution + 0.5);
+
+        for (c = 0; c < num_conditions; c++)
+            if (conditions[c].feed_temperature == feed_temperature && conditions[c].cool_temperature == cool_temperature)
+                break;
+
+        if (c == num_conditions)
+        {
+            conditions[c].feed_temperature = feed_temperature;
+            conditions[c].cool_temperature = cool_temperature;
+            num_conditions++;
+        }
+
+        step_condition[s] = c;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Evaluating the setpoints at each distinct condition                                                                                           //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMalloc1(num_conditions * num_setpoints, &distillate);
+    PetscMalloc1(num_conditions * num_setpoints, &heat_input);
+    PetscMalloc1(num_conditions * num_setpoints, &admissible);
+    PetscMalloc1(num_setpoints, &cases);
+    PetscMalloc1(num_setpoints, &reasons);
+    PetscMalloc1(num_setpoints, &warm);
+    PetscMalloc1(num_setpoints * NUM_VAR, &states);
+    PetscMalloc1(num_setpoints * NUM_VAR, &warm_states);
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    if (lanes > 0)
+        PetscCall(LockstepSolverBuild(&lockstep, &solver_ctx, lanes));
+
+    PetscTime(&start);
+
+    for (c = 0; c < num_conditions; c++)
+    {
+        for (d = 0; d < num_setpoints; d++)
+        {
+            cases[d] = *entry_data;
+            SweepGridApply(&grid, &values[d * grid.num_params], &cases[d]);
+
+            cases[d].dessal_data.entry_temperature_feed = conditions[c].feed_temperature;
+            cases[d].dessal_data.entry_temperature_cool = conditions[c].cool_temperature;
+        }
+
+        PetscCall(PlantSolveCases(&solver_ctx, lanes > 0 ? &lockstep : NULL, cases, num_setpoints, c > 0 ? warm_states : NULL, warm, states,
+                                  reasons));
+
+        num_solved += num_setpoints;
+
+        for (d = 0; d < num_setpoints; d++)
+        {
+            PetscInt n = c * num_setpoints + d;
+
+            distillate[n] = 0.0;
+            heat_input[n] = 0.0;
+            admissible[n] = PETSC_FALSE;
+
+            if (reasons[d] > 0)
+            {
+                ComputeKPIs(&states[d * NUM_VAR], &cases[d].dessal_data, &kpis);
+                ScheduleHeatInput(&states[d * NUM_VAR], &cases[d].dessal_data, &heat_input[n]);
+
+                distillate[n] = kpis.distillate_rate;
+                admissible[n] = kpis.distillate_rate > 0.0 && heat_input[n] > 0.0 && !PetscIsInfOrNanReal(heat_input[n])
+                                    ? PETSC_TRUE
+                                    : PETSC_FALSE;
+            }
+
+            // Warm state of the setpoint at the next condition
+            warm[d] = reasons[d] > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+            if (warm[d])
+                PetscArraycpy(&warm_states[d * NUM_VAR], &states[d * NUM_VAR], NUM_VAR);
+        }
+    }
+
+    PetscTime(&end);
+    solving_time = end - start;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Dynamic programming over the steps and the heat left in the budget                                                                            //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscTime(&start);
+
+    PetscMalloc1(num_conditions * num_setpoints, &cost);
+    PetscMalloc1((num_steps + 1) * (num_bins + 1), &value);
+    PetscMalloc1(num_steps * (num_bins + 1), &choice);
+
+    // Heat of an admissible setpoint over a step, in whole bins of the budget rounded up
+    for (d = 0; d < num_conditions * num_setpoints; d++)
+        cost[d] = num_bins > 0 && admissible[d] ? (PetscInt)PetscCeilReal(heat_input[d] * step_time / 1000.0 / bin_energy - PETSC_SMALL) : 0;
+
+    for (b = 0; b <= num_bins; b++)
+        value[num_steps * (num_bins + 1) + b] = 0.0;
+
+    for (s = num_steps - 1; s >= 0; s--)
+    {
+        c = step_condition[s];
+
+        for (b = 0; b <= num_bins; b++)
+        {
+            // The plant off, then each admissible setpoint fitting in the heat left
+            best = value[(s + 1) * (num_bins + 1) + b];
+            choice[s * (num_bins + 1) + b] = -1;
+
+            for (d = 0; d < num_setpoints; d++)
+            {
+                PetscInt n = c * num_setpoints + d;
+
+                if (!admissible[n] || heat_input[n] > available[s] || cost[n] > b)
+                    continue;
+
+                candidate = distillate[n] * step_time + value[(s + 1) * (num_bins + 1) + b - cost[n]];
+
+                if (candidate > best)
+                {
+                    best = candidate;
+                    choice[s * (num_bins + 1) + b] = d;
+                }
+            }
+
+            value[s * (num_bins + 1) + b] = best;
+        }
+    }
+
+    PetscTime(&end);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Schedule from the full budget                                                                                                                 //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "step,start_time,end_time,entry_temperature_feed,entry_temperature_cool,available_heat,status");
+    for (k = 0; k < grid.num_params; k++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", grid.name[k]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, ",distillate,heat_input,heat_used,cumulative_heat\n");
+
+    for (s = 0, b = num_bins; s < num_steps; s++)
+    {
+        c = step_condition[s];
+        d = choice[s * (num_bins + 1) + b];
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "%d,%.6e,%.6e,%.6e,%.6e,%.6e,%s", (int)s, (double)(s * step_time), (double)((s + 1) * step_time),
+                     (double)conditions[c].feed_temperature, (double)conditions[c].cool_temperature, (double)available[s], d >= 0 ? "on" : "off");
+
+        if (d < 0)
+        {
+            for (k = 0; k < grid.num_params; k++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6e,%.6e,%.6e,%.6e\n", 0.0, 0.0, 0.0, (double)total_heat);
+
+            continue;
+        }
+
+        PetscInt n = c * num_setpoints + d;
+
+        total_distillate += distillate[n] * step_time;
+        total_heat += heat_input[n] * step_time / 1000.0;
+        b -= cost[n];
+
+        for (k = 0; k < grid.num_params; k++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6e", (double)values[d * grid.num_params + k]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6e,%.6e,%.6e,%.6e\n", (double)(distillate[n] * step_time), (double)heat_input[n],
+                     (double)(heat_input[n] * step_time / 1000.0), (double)total_heat);
+    }
+
+    PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscPrintf(PETSC_COMM_WORLD, "Schedule over %d steps of %g h: %g kg of distillate, %g kWh of heat", (int)num_steps, (double)step_time,
+                (double)total_distillate, (double)total_heat);
+    if (num_bins > 0)
+        PetscPrintf(PETSC_COMM_WORLD, " (budget %g kWh)\n", (double)budget);
+    else
+        PetscPrintf(PETSC_COMM_WORLD, " (no budget)\n");
+    PetscPrintf(PETSC_COMM_WORLD, "  %d cases solved (%d setpoints at %d distinct conditions, %d steps served from the cache) in %.3f s, "
+                "dynamic programming in %.3f s\n", (int)num_solved, (int)num_setpoints, (int)num_conditions, (int)(num_steps - num_conditions),
+                (double)solving_time, (double)(end - start));
+    PetscPrintf(PETSC_COMM_WORLD, "Results written to %s\n", file);
+
+    PetscFree(values);
+    PetscFree(conditions);
+    PetscFree(step_condition);
+    PetscFree(available);
+    PetscFree(distillate);
+    PetscFree(heat_input);
+    PetscFree(admissible);
+    PetscFree(cases);
+    PetscFree(reasons);
+    PetscFree(warm);
+    PetscFree(states);
+    PetscFree(warm_states);
+    PetscFree(cost);
+    PetscFree(value);
+    PetscFree(choice);
+    SolverCtxDestroy(&solver_ctx);
+
+    if (lanes > 0)
+        LockstepSolverDestroy(&lockstep);
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef SCHEDULE
+
+#define SCHEDULE
+
+#include "sweep.h"
+
+// Maximum number of breakpoints of the forecast profiles of a day
+#define MAX_FORECAST 64
+
+// Setpoints of the plant chosen step by step unless given on the command line
+static const char *const schedule_default_setpoints[] = {"feed_mass_flow_rate", "cool_mass_flow_rate", "vacuum_pressure"};
+
+// Data structure containing the forecast of a day: piecewise-linear profiles in time of the inlet temperatures and of the heat available
+typedef struct
+{
+    PetscInt num_points;
+    PetscReal time[MAX_FORECAST]; // Breakpoints, in hours
+    PetscReal feed_temperature[MAX_FORECAST], cool_temperature[MAX_FORECAST], heat[MAX_FORECAST];
+} ScheduleForecast;
+
+// Data structure containing the operating conditions of a step of the schedule, those of several steps being shared when they round to
+// the same values
+typedef struct
+{
+    PetscReal feed_temperature, cool_temperature;
+} ScheduleConditions;
+
+// Function to fetch the forecast of a day from the command line, each profile defaulting to a constant (the nominal inlet temperatures,
+// and unlimited heat)
+PetscErrorCode ScheduleForecastBuild(ScheduleForecast *forecast, EntryData *entry_data);
+
+// Function to interpolate a profile of the forecast at a given time (in hours)
+PetscErrorCode ScheduleForecastValue(const ScheduleForecast *forecast, const PetscReal profile[], PetscReal time, PetscReal *value);
+
+// Function to compute the heat input of the plant (W) from the solution of the plant system, i.e. the duty of the heater on the feed stream
+PetscErrorCode ScheduleHeatInput(const PetscReal state[], DessalData *dessal_data, PetscReal *heat_input);
+
+// Function to run the scheduling of the setpoints of the plant over a day, maximizing the distillate under a heat budget
+PetscErrorCode RunSchedule(EntryData *entry_data);
+
+#endif
@@ -0,0 +1,504 @@
+#include "sobol.h"
+#include "sampling.h"
+
+/*
+Streaming estimators of the Sobol indices
+
+Each base sample gives the outputs at two independent points A and B of the inputs and at the points A_B^i, equal to A but for the input
+i taken from B. The first-order indices follow from the covariances of f(B) with f(A_B^i) and f(A) (Saltelli), and the total ones from the
+mean squared difference between f(A) and f(A_B^i) (Jansen), both over the variance pooled from f(A) and f(B). Only the means and the
+co-moments these estimators need are kept, updated with weights so that bootstrap replicates are accumulated in the same pass.
+
+Reference: A. Saltelli et al., Variance based sensitivity analysis of model output. Design and estimator for the total sensitivity index.
+           Comput. Phys. Commun. 181 (2010) 259-270. https://doi.org/10.1016/j.cpc.2009.09.018
+*/
+
+PetscErrorCode SobolAccumulatorBuild(SobolAccumulator *accumulator, PetscInt num_inputs, PetscInt num_outputs)
+{
+    PetscFunctionBeginUser;
+
+    accumulator->num_inputs = num_inputs;
+    accumulator->num_outputs = num_outputs;
+    accumulator->weight = 0.0;
+
+    PetscCalloc1((num_inputs + 2) * num_outputs, &accumulator->mean);
+    PetscCalloc1((3 * num_inputs + 3) * num_outputs, &accumulator->comoment);
+    PetscMalloc1((num_inputs + 2) * num_outputs, &accumulator->delta);
+
+    return 0;
+}
+
+PetscErrorCode SobolAccumulatorUpdate(SobolAccumulator *accumulator, const PetscReal values[], PetscReal weight)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i, k, a, b, ab, num_inputs = accumulator->num_inputs, num_outputs = accumulator->num_outputs;
+    PetscReal *mean = accumulator->mean, *delta = accumulator->delta, *comoment;
+
+    if (weight <= 0.0)
+        return 0;
+
+    accumulator->weight += weight;
+
+    for (i = 0; i < (num_inputs + 2) * num_outputs; i++)
+    {
+        delta[i] = values[i] - mean[i];
+        mean[i] += weight * delta[i] / accumulator->weight;
+    }
+
+    // Weighted co-moments, combining the deviation from the old mean with the deviation from the updated one
+    for (k = 0; k < num_outputs; k++)
+    {
+        comoment = &accumulator->comoment[k * (3 * num_inputs + 3)];
+        a = k;
+        b = num_outputs + k;
+
+        comoment[0] += weight * delta[a] * (values[a] - mean[a]);
+        comoment[1] += weight * delta[b] * (values[b] - mean[b]);
+        comoment[2] += weight * delta[a] * (values[b] - mean[b]);
+
+        for (i = 0; i < num_inputs; i++)
+        {
+            ab = (2 + i) * num_outputs + k;
+
+            comoment[3 + 3 * i] += weight * delta[b] * (values[ab] - mean[ab]);
+            comoment[4 + 3 * i] += weight * delta[a] * (values[ab] - mean[ab]);
+            comoment[5 + 3 * i] += weight * delta[ab] * (values[ab] - mean[ab]);
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode SobolAccumulatorIndices(SobolAccumulator *accumulator, PetscReal first[], PetscReal total[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i, k, a, ab, num_inputs = accumulator->num_inputs, num_outputs = accumulator->num_outputs;
+    PetscReal *comoment, variance, difference, weight = accumulator->weight;
+
+    for (k = 0; k < num_outputs; k++)
+    {
+        comoment = &accumulator->comoment[k * (3 * num_inputs + 3)];
+        a = k;
+
+        variance = weight > 0.0 ? 0.5 * (comoment[0] + comoment[1]) / weight : 0.0;
+
+        for (i = 0; i < num_inputs; i++)
+        {
+            ab = (2 + i) * num_outputs + k;
+
+            if (!(variance > 0.0))
+            {
+                first[k * num_inputs + i] = 0.0;
+                total[k * num_inputs + i] = 0.0;
+                continue;
+            }
+
+            difference = accumulator->mean[a] - accumulator->mean[ab];
+
+            first[k * num_inputs + i] = (comoment[3 + 3 * i] - comoment[2]) / weight / variance;
+            total[k * num_inputs + i] = 0.5 * ((comoment[0] + comoment[5 + 3 * i] - 2.0 * comoment[4 + 3 * i]) / weight
+                                               + difference * difference) / variance;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode SobolAccumulatorDestroy(SobolAccumulator *accumulator)
+{
+    PetscFunctionBeginUser;
+
+    PetscFree(accumulator->mean);
+    PetscFree(accumulator->comoment);
+    PetscFree(accumulator->delta);
+
+    return 0;
+}
+
+/*
+Poisson bootstrap
+
+Resampling the base samples with replacement needs them all in memory. Instead, each base sample enters every bootstrap replicate with an
+independent Poisson weight of unit mean, which approximates the multinomial counts of the classic bootstrap for many samples and lets the
+replicates be accumulated in streaming. The weights are drawn by Knuth's multiplication method.
+
+Reference: N. Chamandy et al., Estimating uncertainty for massive data streams. Google Technical Report (2012).
+*/
+
+PetscErrorCode SobolPoissonWeight(PetscRandom random, PetscReal *weight)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal u, product = 1.0, limit = PetscExpReal(-1.0);
+    PetscInt count = -1;
+
+    do
+    {
+        PetscRandomGetValueReal(random, &u);
+        product *= u;
+        count++;
+    } while (product > limit);
+
+    *weight = (PetscReal)count;
+
+    return 0;
+}
+
+PetscErrorCode SobolBootstrapIntervals(SobolAccumulator replicates[], PetscInt num_replicates, PetscReal confidence, PetscReal estimates[],
+                                       PetscReal lower[], PetscReal upper[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt r, j, num_indices, low, high;
+    PetscReal *column;
+
+    if (num_replicates < 1)
+        return 0;
+
+    num_indices = replicates[0].num_inputs * replicates[0].num_outputs;
+
+    for (r = 0; r < num_replicates; r++)
+        SobolAccumulatorIndices(&replicates[r], &estimates[2 * r * num_indices], &estimates[(2 * r + 1) * num_indices]);
+
+    low = (PetscInt)PetscFloorReal(0.5 * (1.0 - confidence) * (num_replicates - 1) + 0.5);
+    high = (PetscInt)PetscFloorReal(0.5 * (1.0 + confidence) * (num_replicates - 1) + 0.5);
+
+    PetscMalloc1(num_replicates, &column);
+
+    for (j = 0; j < 2 * num_indices; j++)
+    {
+        for (r = 0; r < num_replicates; r++)
+            column[r] = estimates[2 * r * num_indices + j];
+
+        PetscSortReal(num_replicates, column);
+
+        lower[j] = column[low];
+        upper[j] = column[high];
+    }
+
+    PetscFree(column);
+
+    return 0;
+}
+
+/*
+Variance-based global sensitivity analysis
+
+The base samples are drawn from a scrambled Halton sequence of twice the number of inputs, whose halves give the points A and B. Each MPI
+rank solves the num_inputs + 2 cases of the base samples of its chunk of the batch, A and B with a warm start from the nominal solution and
+the points A_B^i, which differ from A in a single input, from the solution at A. A base sample counts only when all its cases converge.
+The first rank feeds the estimate and its bootstrap replicates in sample order, so neither the solves nor the samples are stored and the
+results do not depend on the number of ranks. The run stops early once the widest confidence interval of the indices drops below the target.
+*/
+
+PetscErrorCode RunSobol(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    const char *default_names[] = {"membrane_thickness", "membrane_porosity", "pore_diameter", "membrane_tortuosity",
+                                   "polymer_conductivity", "film_thickness", "air_gap_thickness", "gap_spacer_porosity", "spacer_conductivity",
+                                   "feed_channel_height", "cold_channel_height", "spacer_porosity"};
+    const char *default_outputs[] = {"permeate_flux", "GOR", "SEC"};
+    char *names[MAX_UNCERTAIN], *outputs[MAX_SOBOL_OUTPUTS];
+    InputDistribution distribution[MAX_UNCERTAIN];
+    PetscInt num_inputs = MAX_UNCERTAIN, num_outputs = MAX_SOBOL_OUTPUTS, output[MAX_SOBOL_OUTPUTS];
+    PetscInt max_samples = 2048, min_samples = 256, batch_size = 4, num_replicates = 200, seed = 1;
+    PetscInt num_cases, num_indices, record_size, i, j, k, r, c;
+    PetscReal ci_target = 0.0, confidence = 0.95;
+    PetscBool given, scramble = PETSC_TRUE;
+    char file[256] = "./results/sobol.csv";
+
+    PetscOptionsGetStringArray(NULL, NULL, "-sobol_parameters", names, &num_inputs, &given);
+
+    if (!given)
+    {
+        num_inputs = sizeof(default_names) / sizeof(default_names[0]);
+
+        for (i = 0; i < num_inputs; i++)
+            PetscStrallocpy(default_names[i], &names[i]);
+    }
+
+    PetscOptionsGetStringArray(NULL, NULL, "-sobol_outputs", outputs, &num_outputs, &given);
+
+    if (!given)
+    {
+        num_outputs = sizeof(default_outputs) / sizeof(default_outputs[0]);
+
+        for (k = 0; k < num_outputs; k++)
+            PetscStrallocpy(default_outputs[k], &outputs[k]);
+    }
+
+    PetscOptionsGetInt(NULL, NULL, "-sobol_samples", &max_samples, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-sobol_min_samples", &min_samples, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-sobol_batch_size", &batch_size, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-sobol_bootstrap", &num_replicates, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-sobol_seed", &seed, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-sobol_scramble", &scramble, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-sobol_ci_target", &ci_target, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-sobol_confidence", &confidence, NULL);
+
+    PetscCheck(num_inputs > 0 && num_outputs > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "A sensitivity analysis needs inputs and outputs");
+    PetscCheck(batch_size > 0 && max_samples > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Sample and batch sizes must be positive");
+    PetscCheck(num_replicates >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of bootstrap replicates must be nonnegative");
+    PetscCheck(confidence > 0.0 && confidence < 1.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Confidence level must be within (0, 1)");
+
+    for (i = 0; i < num_inputs; i++)
+        PetscCall(InputDistributionBuild(&distribution[i], names[i], "sobol", &entry_data->dessal_data));
+
+    for (k = 0; k < num_outputs; k++)
+    {
+        PlantOutputFind(outputs[k], &output[k]);
+        PetscCheck(output[k] >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown output: %s", outputs[k]);
+    }
+
+    num_cases = num_inputs + 2;
+    num_indices = num_inputs * num_outputs;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Nominal solution, used as warm start for the points A and B                                                                                   //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    SolverCtx solver_ctx;
+    SNESConvergedReason reason;
+    PetscReal nominal_state[NUM_VAR], state_a[NUM_VAR], state[NUM_VAR];
+    PetscBool warm_start;
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    PlantSolveCase(&solver_ctx, entry_data, NULL, nominal_state, &reason);
+    warm_start = reason > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Sampling loop                                                                                                                                 //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMPIInt size, rank;
+    HaltonSequence halton;
+    SobolAccumulator accumulator, *replicates = NULL;
+    PetscRandom random = NULL;
+    EntryData sample_data;
+    PetscReal *point, *record, *batch, *gathered = NULL, *parameter, *first, *total, *lower, *upper, *estimates = NULL;
+    PetscReal weight, worst_width = PETSC_MAX_REAL;
+    PetscInt64 index, processed = 0, failed = 0;
+    PetscInt stop = 0;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    // Record of a base sample: validity flag and outputs of its cases (A, B, AB_1, ..., AB_d)
+    record_size = 1 + num_cases * num_outputs;
+
+    PetscMalloc1(2 * num_inputs, &point);
+    PetscMalloc1(batch_size * record_size, &batch);
+
+    if (rank == 0)
+        PetscMalloc1(size * batch_size * record_size, &gathered);
+
+    PetscMalloc1(num_indices, &first);
+    PetscMalloc1(num_indices, &total);
+    PetscCalloc1(2 * num_indices, &lower);
+    PetscCalloc1(2 * num_indices, &upper);
+
+    HaltonBuild(&halton, 2 * num_inputs, scramble, (unsigned long)seed);
+    SobolAccumulatorBuild(&accumulator, num_inputs, num_outputs);
+
+    // Bootstrap replicates, only fed by the first rank
+    if (rank == 0 && num_replicates > 0)
+    {
+        PetscMalloc1(num_replicates, &replicates);
+        PetscMalloc1(2 * num_replicates * num_indices, &estimates);
+
+        for (r = 0; r < num_replicates; r++)
+            SobolAccumulatorBuild(&replicates[r], num_inputs, num_outputs);
+
+        PetscRandomCreate(PETSC_COMM_SELF, &random);
+        PetscRandomSetSeed(random, (unsigned long)seed);
+        PetscRandomSeed(random);
+    }
+
+    while (!stop)
+    {
+        for (i = 0; i < batch_size; i++)
+        {
+            record = &batch[i * record_size];
+            index = processed + (PetscInt64)rank * batch_size + i;
+            record[0] = 0.0;
+
+            if (index >= max_samples)
+                continue;
+
+            HaltonPoint(&halton, index + 1, point);
+
+            for (c = 0; c < num_cases; c++)
+            {
+                sample_data = *entry_data;
+
+                // Inputs from A, but from B for the point B and for the input of the point A_B^i
+                for (j = 0; j < num_inputs; j++)
+                {
+                    DessalDataGetParameter(&sample_data.dessal_data, distribution[j].name, &parameter);
+                    *parameter = InputDistributionSample(&distribution[j], c == 1 || c == 2 + j ? point[num_inputs + j] : point[j]);
+                }
+
+                if (c < 2)
+                    PlantSolveCase(&solver_ctx, &sample_data, warm_start ? nominal_state : NULL, c == 0 ? state_a : state, &reason);
+                else
+                    PlantSolveCase(&solver_ctx, &sample_data, state_a, state, &reason);
+
+                if (reason <= 0)
+                    break;
+
+                for (k = 0; k < num_outputs; k++)
+                    PlantOutput(c == 0 ? state_a : state, &sample_data.dessal_data, output[k], &record[1 + c * num_outputs + k]);
+            }
+
+            record[0] = c == num_cases ? 1.0 : 0.0;
+        }
+
+        MPI_Gather(batch, batch_size * record_size, MPIU_REAL, gathered, batch_size * record_size, MPIU_REAL, 0, PETSC_COMM_WORLD);
+
+        if (rank == 0)
+        {
+            // Feeding the estimate and the bootstrap replicates in sample order
+            for (r = 0; r < size; r++)
+                for (i = 0; i < batch_size; i++)
+                {
+                    record = &gathered[(r * batch_size + i) * record_size];
+                    index = processed + (PetscInt64)r * batch_size + i;
+
+                    if (index >= max_samples)
+                        continue;
+
+                    if (record[0] == 0.0)
+                    {
+                        failed++;
+                        continue;
+                    }
+
+                    SobolAccumulatorUpdate(&accumulator, &record[1], 1.0);
+
+                    for (j = 0; j < num_replicates; j++)
+                    {
+                        SobolPoissonWeight(random, &weight);
+                        SobolAccumulatorUpdate(&replicates[j], &record[1], weight);
+                    }
+                }
+
+            if (processed + size * batch_size >= max_samples)
+                stop = 1;
+            else if (ci_target > 0.0 && num_replicates > 1 && accumulator.weight >= PetscMax(min_samples, 2))
+            {
+                SobolBootstrapIntervals(replicates, num_replicates, confidence, estimates, lower, upper);
+
+                worst_width = 0.0;
+
+                for (j = 0; j < 2 * num_indices; j++)
+                    worst_width = PetscMax(worst_width, upper[j] - lower[j]);
+
+                if (worst_width <= ci_target)
+                    stop = 1;
+            }
+        }
+
+        processed += (PetscInt64)size * batch_size;
+
+        MPI_Bcast(&stop, 1, MPIU_INT, 0, PETSC_COMM_WORLD);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Exporting the indices                                                                                                                         //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (rank == 0)
+    {
+        FILE *fptr;
+        PetscReal mean, variance, sum;
+
+        SobolAccumulatorIndices(&accumulator, first, total);
+
+        if (num_replicates > 1)
+        {
+            SobolBootstrapIntervals(replicates, num_replicates, confidence, estimates, lower, upper);
+
+            worst_width = 0.0;
+
+            for (j = 0; j < 2 * num_indices; j++)
+                worst_width = PetscMax(worst_width, upper[j] - lower[j]);
+        }
+
+        PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Sobol sensitivity analysis:,,\n\n");
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Base samples drawn =, %lld,\n", (long long)PetscMin(processed, (PetscInt64)max_samples));
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Base samples converged =, %lld,\n", (long long)accumulator.weight);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Base samples failed =, %lld,\n", (long long)failed);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Cases per base sample =, %d,\n", (int)num_cases);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Bootstrap replicates =, %d,\n", (int)num_replicates);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Confidence level =, %g,\n", (double)confidence);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Widest confidence interval of the indices =, %g,\n\n",
+                     (double)(num_replicates > 1 ? worst_width : 0.0));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Output,mean,variance,sum of first-order indices\n");
+
+        for (k = 0; k < num_outputs; k++)
+        {
+            mean = 0.5 * (accumulator.mean[k] + accumulator.mean[num_outputs + k]);
+            variance = accumulator.weight > 1.0 ? 0.5 * (accumulator.comoment[k * (3 * num_inputs + 3)]
+                                                         + accumulator.comoment[k * (3 * num_inputs + 3) + 1]) / (accumulator.weight - 1.0)
+                                                : 0.0;
+
+            for (i = 0, sum = 0.0; i < num_inputs; i++)
+                sum += first[k * num_inputs + i];
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.10e,%.10e,%.6f\n", outputs[k], (double)mean, (double)variance, (double)sum);
+        }
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\nOutput,parameter,distribution,first-order,lower,upper,total,lower,upper\n");
+
+        for (k = 0; k < num_outputs; k++)
+            for (i = 0; i < num_inputs; i++)
+            {
+                j = k * num_inputs + i;
+
+                PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%s,%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n", outputs[k], distribution[i].name,
+                             distribution_names[distribution[i].type], (double)first[j], (double)lower[j], (double)upper[j],
+                             (double)total[j], (double)lower[num_indices + j], (double)upper[num_indices + j]);
+            }
+
+        PetscFClose(PETSC_COMM_SELF, fptr);
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "Sobol sensitivity analysis: %lld base samples converged (%d cases each), %lld failed, "
+                "results in %s\n", (long long)accumulator.weight, (int)num_cases, (long long)failed, file);
+
+    if (replicates)
+    {
+        for (r = 0; r < num_replicates; r++)
+            SobolAccumulatorDestroy(&replicates[r]);
+
+        PetscFree(replicates);
+        PetscFree(estimates);
+        PetscRandomDestroy(&random);
+    }
+
+    HaltonDestroy(&halton);
+    SobolAccumulatorDestroy(&accumulator);
+    PetscFree(point);
+    PetscFree(batch);
+    PetscFree(gathered);
+    PetscFree(first);
+    PetscFree(total);
+    PetscFree(lower);
+    PetscFree(upper);
+    SolverCtxDestroy(&solver_ctx);
+
+    for (i = 0; i < num_inputs; i++)
+        PetscFree(names[i]);
+
+    for (k = 0; k < num_outputs; k++)
+        PetscFree(outputs[k]);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef SOBOL
+
+#define SOBOL
+
+#include "uncertainty.h"
+
+// Maximum number of outputs whose sensitivity indices are estimated
+#define MAX_SOBOL_OUTPUTS 8
+
+// Data structure containing the streaming (weighted) means and co-moments needed by the estimators of the first-order and total Sobol
+// indices, for the outputs of the cases of a base sample: A, B and A with the column of each input taken from B
+typedef struct
+{
+    PetscInt num_inputs, num_outputs;
+    PetscReal weight;
+    PetscReal *mean;     // Per case (A, B, AB_1, ..., AB_d) and output
+    PetscReal *comoment; // Per output: AA, BB, AB, then per input B AB_i, A AB_i and AB_i AB_i
+    PetscReal *delta;
+} SobolAccumulator;
+
+// Sobol accumulator constructor
+PetscErrorCode SobolAccumulatorBuild(SobolAccumulator *accumulator, PetscInt num_inputs, PetscInt num_outputs);
+
+// Function to add the outputs of the cases of one base sample (case by case, num_outputs values each) to the Sobol accumulator, with a
+// weight (the number of times the base sample is drawn, for a bootstrap replicate)
+PetscErrorCode SobolAccumulatorUpdate(SobolAccumulator *accumulator, const PetscReal values[], PetscReal weight);
+
+// Function to calculate the first-order and total Sobol indices of every input for every output (num_inputs values per output)
+PetscErrorCode SobolAccumulatorIndices(SobolAccumulator *accumulator, PetscReal first[], PetscReal total[]);
+
+// Sobol accumulator destructor
+PetscErrorCode SobolAccumulatorDestroy(SobolAccumulator *accumulator);
+
+// Function to draw the weight of a base sample in a Poisson bootstrap replicate, i.e. a Poisson random variable of unit mean
+PetscErrorCode SobolPoissonWeight(PetscRandom random, PetscReal *weight);
+
+// Function to compute the percentile confidence intervals of the first-order and total indices (first ones, then total ones) from the
+// bootstrap replicates, using a work array for the estimates of all replicates
+PetscErrorCode SobolBootstrapIntervals(SobolAccumulator replicates[], PetscInt num_replicates, PetscReal confidence, PetscReal estimates[],
+                                       PetscReal lower[], PetscReal upper[]);
+
+// Function to run the variance-based global sensitivity analysis of outputs of the plant to parameters of the desalination module
+PetscErrorCode RunSobol(EntryData *entry_data);
+
+#endif
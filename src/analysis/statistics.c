@@ -0,0 +1,219 @@
+#include "statistics.h"
+
+/*
+Streaming mean and co-moments of a random vector, so that memory does not grow with the number of samples
+
+Reference: B.P. Welford, Note on a method for calculating corrected sums of squares and products. Technometrics 4 (1962) 419-420.
+           https://doi.org/10.1080/00401706.1962.10490022
+*/
+
+PetscErrorCode CovarianceBuild(CovarianceAccumulator *accumulator, PetscInt dim)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i;
+
+    accumulator->dim = dim;
+    accumulator->count = 0;
+
+    PetscCalloc1(dim, &accumulator->mean);
+    PetscCalloc1(dim * dim, &accumulator->comoment);
+    PetscMalloc1(dim, &accumulator->min);
+    PetscMalloc1(dim, &accumulator->max);
+    PetscMalloc1(dim, &accumulator->delta);
+
+    for (i = 0; i < dim; i++)
+    {
+        accumulator->min[i] = PETSC_MAX_REAL;
+        accumulator->max[i] = PETSC_MIN_REAL;
+    }
+
+    return 0;
+}
+
+PetscErrorCode CovarianceUpdate(CovarianceAccumulator *accumulator, const PetscReal sample[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i, j, dim = accumulator->dim;
+    PetscReal *mean = accumulator->mean, *comoment = accumulator->comoment, *delta = accumulator->delta;
+
+    accumulator->count++;
+
+    for (i = 0; i < dim; i++)
+    {
+        delta[i] = sample[i] - mean[i];
+        mean[i] += delta[i] / accumulator->count;
+
+        accumulator->min[i] = PetscMin(accumulator->min[i], sample[i]);
+        accumulator->max[i] = PetscMax(accumulator->max[i], sample[i]);
+    }
+
+    // The co-moments combine the deviation from the old mean with the deviation from the updated one
+    for (i = 0; i < dim; i++)
+        for (j = 0; j < dim; j++)
+            comoment[i * dim + j] += delta[i] * (sample[j] - mean[j]);
+
+    return 0;
+}
+
+PetscReal CovarianceVariance(CovarianceAccumulator *accumulator, PetscInt i)
+{
+    if (accumulator->count < 2)
+        return 0.0;
+
+    return accumulator->comoment[i * accumulator->dim + i] / (accumulator->count - 1);
+}
+
+PetscReal CovarianceCorrelation(CovarianceAccumulator *accumulator, PetscInt i, PetscInt j)
+{
+    PetscInt dim = accumulator->dim;
+    PetscReal denominator;
+
+    denominator = PetscSqrtReal(accumulator->comoment[i * dim + i] * accumulator->comoment[j * dim + j]);
+
+    if (!(denominator > 0.0))
+        return 0.0;
+
+    return accumulator->comoment[i * dim + j] / denominator;
+}
+
+PetscErrorCode CovarianceDestroy(CovarianceAccumulator *accumulator)
+{
+    PetscFunctionBeginUser;
+
+    PetscFree(accumulator->mean);
+    PetscFree(accumulator->comoment);
+    PetscFree(accumulator->min);
+    PetscFree(accumulator->max);
+    PetscFree(accumulator->delta);
+
+    return 0;
+}
+
+/*
+Streaming quantile estimation with five markers adjusted by piecewise-parabolic interpolation
+
+Reference: R. Jain, I. Chlamtac, The P2 algorithm for dynamic calculation of quantiles and histograms without storing observations.
+           Commun. ACM 28 (1985) 1076-1085. https://doi.org/10.1145/4372.4378
+*/
+
+PetscErrorCode QuantileBuild(QuantileEstimator *estimator, PetscReal probability)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal p = probability;
+    PetscInt i;
+
+    estimator->probability = p;
+    estimator->count = 0;
+
+    for (i = 0; i < 5; i++)
+    {
+        estimator->height[i] = 0.0;
+        estimator->position[i] = i + 1.0;
+    }
+
+    estimator->desired[0] = 1.0;
+    estimator->desired[1] = 1.0 + 2.0 * p;
+    estimator->desired[2] = 1.0 + 4.0 * p;
+    estimator->desired[3] = 3.0 + 2.0 * p;
+    estimator->desired[4] = 5.0;
+
+    estimator->increment[0] = 0.0;
+    estimator->increment[1] = 0.5 * p;
+    estimator->increment[2] = p;
+    estimator->increment[3] = 0.5 * (1.0 + p);
+    estimator->increment[4] = 1.0;
+
+    return 0;
+}
+
+PetscErrorCode QuantileUpdate(QuantileEstimator *estimator, PetscReal sample)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *q = estimator->height, *n = estimator->position;
+    PetscReal d, parabolic;
+    PetscInt i, k;
+
+    // The first five samples initialize the markers
+    if (estimator->count < 5)
+    {
+        q[estimator->count++] = sample;
+
+        if (estimator->count == 5)
+            PetscSortReal(5, q);
+
+        return 0;
+    }
+
+    estimator->count++;
+
+    // Cell containing the sample, stretching the extreme markers if needed
+    if (sample < q[0])
+    {
+        q[0] = sample;
+        k = 0;
+    }
+    else if (sample >= q[4])
+    {
+        q[4] = sample;
+        k = 3;
+    }
+    else
+        for (k = 0; k < 3 && sample >= q[k + 1]; k++)
+            ;
+
+    for (i = k + 1; i < 5; i++)
+        n[i] += 1.0;
+
+    for (i = 0; i < 5; i++)
+        estimator->desired[i] += estimator->increment[i];
+
+    // Adjusting the heights of the three middle markers
+    for (i = 1; i < 4; i++)
+    {
+        d = estimator->desired[i] - n[i];
+
+        if ((d >= 1.0 && n[i + 1] - n[i] > 1.0) || (d <= -1.0 && n[i - 1] - n[i] < -1.0))
+        {
+            d = d > 0.0 ? 1.0 : -1.0;
+
+            parabolic = (n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]);
+            parabolic += (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]);
+            parabolic = q[i] + d * parabolic / (n[i + 1] - n[i - 1]);
+
+            if (q[i - 1] < parabolic && parabolic < q[i + 1])
+                q[i] = parabolic;
+            else
+                q[i] += d * (q[i + (PetscInt)d] - q[i]) / (n[i + (PetscInt)d] - n[i]);
+
+            n[i] += d;
+        }
+    }
+
+    return 0;
+}
+
+PetscReal QuantileValue(QuantileEstimator *estimator)
+{
+    PetscReal sorted[5];
+    PetscInt count = (PetscInt)estimator->count, i;
+
+    if (count >= 5)
+        return estimator->height[2];
+
+    if (count == 0)
+        return 0.0;
+
+    // Too few samples for the markers, using the order statistics instead
+    for (i = 0; i < count; i++)
+        sorted[i] = estimator->height[i];
+
+    PetscSortReal(count, sorted);
+
+    i = (PetscInt)PetscFloorReal(estimator->probability * (count - 1) + 0.5);
+
+    return sorted[i];
+}
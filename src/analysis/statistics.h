@@ -0,0 +1,46 @@
+#ifndef STATISTICS
+
+#define STATISTICS
+
+#include <petscsys.h>
+
+// Data structure containing the streaming (one-pass) mean, co-moments and extrema of a random vector
+typedef struct
+{
+    PetscInt dim;
+    PetscInt64 count;
+    PetscReal *mean, *comoment, *min, *max, *delta;
+} CovarianceAccumulator;
+
+// Data structure containing the streaming (P-square) estimate of a quantile of a random variable
+typedef struct
+{
+    PetscReal probability, height[5], position[5], desired[5], increment[5];
+    PetscInt64 count;
+} QuantileEstimator;
+
+// Covariance accumulator constructor
+PetscErrorCode CovarianceBuild(CovarianceAccumulator *accumulator, PetscInt dim);
+
+// Function to add one realization of the random vector to the covariance accumulator
+PetscErrorCode CovarianceUpdate(CovarianceAccumulator *accumulator, const PetscReal sample[]);
+
+// Function to calculate the (unbiased) variance of a component of the random vector
+PetscReal CovarianceVariance(CovarianceAccumulator *accumulator, PetscInt i);
+
+// Function to calculate the Pearson correlation coefficient between two components of the random vector
+PetscReal CovarianceCorrelation(CovarianceAccumulator *accumulator, PetscInt i, PetscInt j);
+
+// Covariance accumulator destructor
+PetscErrorCode CovarianceDestroy(CovarianceAccumulator *accumulator);
+
+// Quantile estimator constructor
+PetscErrorCode QuantileBuild(QuantileEstimator *estimator, PetscReal probability);
+
+// Function to add one realization of the random variable to the quantile estimator
+PetscErrorCode QuantileUpdate(QuantileEstimator *estimator, PetscReal sample);
+
+// Function to get the current estimate of the quantile
+PetscReal QuantileValue(QuantileEstimator *estimator);
+
+#endif
@@ -0,0 +1,497 @@
+#include "sweep.h"
+#include <unistd.h>
+#include <fcntl.h>
+
+/*
+Cartesian grid of cases
+
+The cases are enumerated in a reflected mixed-radix (boustrophedon) order: each index of the grid runs forward or backward depending on the
+parity of the indices of the slower parameters, so that two consecutive cases differ by one step of a single parameter and the solution of a
+case is a good warm start for the next one.
+*/
+
+PetscErrorCode SweepGridBuild(SweepGrid *grid, const char prefix[], const char *const default_names[], PetscInt num_default_names,
+                              PetscInt default_points, DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    char *names[MAX_SWEEP], option[256];
+    PetscReal *parameter, min[MAX_SWEEP], max[MAX_SWEEP];
+    PetscInt num_min = MAX_SWEEP, num_max = MAX_SWEEP, num_points = MAX_SWEEP, points[MAX_SWEEP], i;
+    PetscBool given, given_min, given_max, given_points;
+
+    grid->num_params = MAX_SWEEP;
+
+    PetscSNPrintf(option, sizeof(option), "-%s_parameters", prefix);
+    PetscOptionsGetStringArray(NULL, NULL, option, names, &grid->num_params, &given);
+
+    if (!given)
+    {
+        grid->num_params = num_default_names;
+
+        for (i = 0; i < grid->num_params; i++)
+            PetscStrallocpy(default_names[i], &names[i]);
+    }
+
+    PetscSNPrintf(option, sizeof(option), "-%s_min", prefix);
+    PetscOptionsGetRealArray(NULL, NULL, option, min, &num_min, &given_min);
+    PetscSNPrintf(option, sizeof(option), "-%s_max", prefix);
+    PetscOptionsGetRealArray(NULL, NULL, option, max, &num_max, &given_max);
+    PetscSNPrintf(option, sizeof(option), "-%s_points", prefix);
+    PetscOptionsGetIntArray(NULL, NULL, option, points, &num_points, &given_points);
+
+    PetscCheck(!given_min || num_min == grid->num_params, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -%s_min needs one value per swept parameter", prefix);
+    PetscCheck(!given_max || num_max == grid->num_params, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -%s_max needs one value per swept parameter", prefix);
+    PetscCheck(!given_points || num_points == grid->num_params, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+               "Option -%s_points needs one value per swept parameter", prefix);
+
+    grid->num_cases = 1;
+
+    for (i = 0; i < grid->num_params; i++)
+    {
+        PetscCall(DessalDataGetParameter(dessal_data, names[i], &parameter));
+
+        PetscStrncpy(grid->name[i], names[i], sizeof(grid->name[i]));
+
+        // Defaults to bounds within 20% of the nominal value
+        grid->min[i] = given_min ? min[i] : *parameter - 0.2 * PetscAbsReal(*parameter);
+        grid->max[i] = given_max ? max[i] : *parameter + 0.2 * PetscAbsReal(*parameter);
+        grid->points[i] = given_points ? points[i] : default_points;
+
+        PetscCheck(grid->points[i] > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of points of %s must be positive", names[i]);
+
+        grid->num_cases *= grid->points[i];
+
+        PetscFree(names[i]);
+    }
+
+    return 0;
+}
+
+PetscErrorCode SweepGridCase(SweepGrid *grid, PetscInt64 index, PetscReal values[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt64 digit[MAX_SWEEP], parity = 0;
+    PetscInt i;
+
+    // Mixed-radix digits, the last parameter varying the fastest
+    for (i = grid->num_params - 1; i >= 0; i--)
+    {
+        digit[i] = index % grid->points[i];
+        index /= grid->points[i];
+    }
+
+    for (i = 0; i < grid->num_params; i++)
+    {
+        if (parity % 2)
+            digit[i] = grid->points[i] - 1 - digit[i];
+
+        parity += digit[i];
+
+        if (grid->points[i] > 1)
+            values[i] = grid->min[i] + (grid->max[i] - grid->min[i]) * (PetscReal)digit[i] / (PetscReal)(grid->points[i] - 1);
+        else
+            values[i] = grid->min[i];
+    }
+
+    return 0;
+}
+
+PetscErrorCode SweepGridApply(SweepGrid *grid, const PetscReal values[], EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *parameter;
+    PetscInt i;
+
+    for (i = 0; i < grid->num_params; i++)
+    {
+        PetscCall(DessalDataGetParameter(&entry_data->dessal_data, grid->name[i], &parameter));
+        *parameter = values[i];
+    }
+
+    return 0;
+}
+
+/*
+Checkpoints of a sweep
+
+A checkpoint records the signature of the sweep, the number of cases done, the size of the results file once those cases were written and
+the warm-start state for the next case. It is written to a temporary file, synced to disk and renamed over the previous checkpoint, so that
+an interruption at any time leaves either the previous or the new checkpoint, never a partial one. The results file is synced before, so it
+always holds at least the rows the checkpoint accounts for; on resume it is truncated to the recorded size, dropping any row written after
+the checkpoint, and the sweep continues from the next case. The directory is synced after the rename, which is only durable once its entry
+is. The signature holds the grid and the layout of the batches (batch size and number of ranks), which sets the cases done at each
+checkpoint and the warm starts of the following ones, so a checkpoint is only resumed by the same sweep on the same layout.
+*/
+
+PetscErrorCode SweepSignature(SweepGrid *grid, PetscInt batch_size, PetscMPIInt size, char signature[], size_t length)
+{
+    PetscFunctionBeginUser;
+
+    size_t used;
+    PetscInt i;
+
+    signature[0] = '\0';
+
+    for (i = 0; i < grid->num_params; i++)
+    {
+        PetscStrlen(signature, &used);
+        PetscSNPrintf(signature + used, length - used, "%s%s:%.17g:%.17g:%d", i ? ";" : "", grid->name[i], (double)grid->min[i],
+                      (double)grid->max[i], (int)grid->points[i]);
+    }
+
+    PetscStrlen(signature, &used);
+    PetscSNPrintf(signature + used, length - used, ";batch_size:%d;ranks:%d", (int)batch_size, (int)size);
+
+    return 0;
+}
+
+PetscErrorCode SweepCheckpointWrite(const char checkpoint[], const char signature[], PetscInt64 done, long long offset,
+                                    const PetscReal warm_state[], PetscBool warm_start)
+{
+    PetscFunctionBeginUser;
+
+    char temporary[PETSC_MAX_PATH_LEN], directory[PETSC_MAX_PATH_LEN], *separator;
+    FILE *fptr;
+    PetscInt i;
+    int descriptor;
+
+    PetscSNPrintf(temporary, sizeof(temporary), "%s.tmp", checkpoint);
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, temporary, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "signature %s\n", signature);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "cases_done %lld\n", (long long)done);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "results_size %lld\n", offset);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "warm_start %d\n", (int)warm_start);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "warm_state");
+    for (i = 0; i < NUM_VAR; i++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, " %.17e", (double)warm_state[i]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+    fflush(fptr);
+    fsync(fileno(fptr));
+    PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscCheck(rename(temporary, checkpoint) == 0, PETSC_COMM_SELF, PETSC_ERR_FILE_WRITE, "Unable to replace checkpoint %s", checkpoint);
+
+    // Syncing the directory holding the checkpoint, so that the rename survives a crash
+    PetscStrncpy(directory, checkpoint, sizeof(directory));
+    separator = strrchr(directory, '/');
+
+    if (separator)
+        separator[separator == directory ? 1 : 0] = '\0';
+    else
+        PetscStrncpy(directory, ".", sizeof(directory));
+
+    descriptor = open(directory, O_RDONLY);
+    PetscCheck(descriptor >= 0, PETSC_COMM_SELF, PETSC_ERR_FILE_OPEN, "Unable to open directory %s to sync checkpoint", directory);
+    fsync(descriptor);
+    close(descriptor);
+
+    return 0;
+}
+
+PetscErrorCode SweepCheckpointRead(const char checkpoint[], const char signature[], PetscInt64 *done, long long *offset,
+                                   PetscReal warm_state[], PetscBool *warm_start, PetscBool *found)
+{
+    PetscFunctionBeginUser;
+
+    char line[4096], *stored = line + 10;
+    FILE *fptr;
+    long long cases_done;
+    double value;
+    int flag, count = 0;
+    size_t length;
+    PetscBool match = PETSC_FALSE;
+    PetscInt i;
+
+    fptr = fopen(checkpoint, "r");
+    *found = fptr ? PETSC_TRUE : PETSC_FALSE;
+
+    if (!fptr)
+        return 0;
+
+    if (fgets(line, sizeof(line), fptr))
+    {
+        PetscStrncmp(line, "signature ", 10, &match);
+        PetscStrlen(line, &length);
+        if (length && line[length - 1] == '\n')
+            line[length - 1] = '\0';
+        count += match ? 1 : 0;
+    }
+
+    count += fscanf(fptr, " cases_done %lld", &cases_done);
+    count += fscanf(fptr, " results_size %lld", offset);
+    count += fscanf(fptr, " warm_start %d", &flag);
+    count += fscanf(fptr, " warm_state");
+
+    for (i = 0; i < NUM_VAR; i++)
+    {
+        count += fscanf(fptr, " %lf", &value);
+        warm_state[i] = (PetscReal)value;
+    }
+
+    fclose(fptr);
+
+    PetscCheck(count == 4 + NUM_VAR, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Corrupted checkpoint %s", checkpoint);
+
+    PetscStrcmp(stored, signature, &match);
+    PetscCheck(match, PETSC_COMM_SELF, PETSC_ERR_ARG_INCOMP, "Checkpoint %s was written for another sweep or batch layout (%s)", checkpoint,
+               stored);
+
+    *done = (PetscInt64)cases_done;
+    *warm_start = flag ? PETSC_TRUE : PETSC_FALSE;
+
+    return 0;
+}
+
+/*
+Parameter sweep
+
+The cases are solved in batches, each MPI rank solving a contiguous chunk of the batch. The first case of every chunk is warm-started from
+the last converged case of the previous batch and the following ones from the previous case of the chunk. The results are gathered on the
+first rank, which appends them in case order to the results file and, every -sweep_checkpoint_interval seconds and at the end of the run,
+writes a checkpoint. With -resume, the run restarts from the last checkpoint, without solving again nor duplicating any case. With
+-lockstep_lanes, the chunk is solved by the lockstep solver, advancing that many cases together.
+*/
+
+PetscErrorCode RunSweep(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    SweepGrid grid;
+    PetscInt batch_size = 16, record_size, i, j, r;
+    PetscReal checkpoint_interval = 300.0;
+    PetscBool resume = PETSC_FALSE, found = PETSC_FALSE;
+    char file[256] = "./results/sweep.csv", checkpoint[256] = "./results/sweep.checkpoint", signature[4096];
+
+    PetscOptionsGetInt(NULL, NULL, "-sweep_batch_size", &batch_size, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-sweep_checkpoint_interval", &checkpoint_interval, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-resume", &resume, NULL);
+
+    PetscCheck(batch_size > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Batch size must be positive");
+
+    PetscCall(SweepGridBuild(&grid, "sweep", sweep_default_parameters, 2, 11, &entry_data->dessal_data));
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Starting or resuming the sweep                                                                                                                //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMPIInt size, rank;
+    PetscReal warm_state[NUM_VAR];
+    PetscInt64 done = 0;
+    PetscInt warm_start = 0;
+    long long offset = 0;
+    FILE *fptr = NULL;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    SweepSignature(&grid, batch_size, size, signature, sizeof(signature));
+
+    DessalDataGetState(&entry_data->dessal_data, warm_state);
+
+    if (rank == 0)
+    {
+        PetscBool flag = PETSC_FALSE;
+
+        if (resume)
+            PetscCall(SweepCheckpointRead(checkpoint, signature, &done, &offset, warm_state, &flag, &found));
+
+        if (found)
+        {
+            PetscCheck(truncate(file, (off_t)offset) == 0, PETSC_COMM_SELF, PETSC_ERR_FILE_WRITE, "Unable to truncate %s to the checkpoint", file);
+            PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "a", &fptr));
+            PetscPrintf(PETSC_COMM_SELF, "Resuming sweep from %s: %lld of %lld cases done\n", checkpoint, (long long)done,
+                        (long long)grid.num_cases);
+        }
+        else
+        {
+            if (resume)
+                PetscPrintf(PETSC_COMM_SELF, "No checkpoint found in %s, starting the sweep from scratch\n", checkpoint);
+
+            PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "case");
+            for (j = 0; j < grid.num_params; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", grid.name[j]);
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",reason");
+            for (j = 0; j < NUM_VAR; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", dessal_state_names[j]);
+            for (j = 0; j < NUM_KPI; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", kpi_names[j]);
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        warm_start = flag ? 1 : 0;
+    }
+
+    MPI_Bcast(&done, 1, MPIU_INT64, 0, PETSC_COMM_WORLD);
+    MPI_Bcast(&warm_start, 1, MPIU_INT, 0, PETSC_COMM_WORLD);
+    MPI_Bcast(warm_state, NUM_VAR, MPIU_REAL, 0, PETSC_COMM_WORLD);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Sweep loop                                                                                                                                    //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    SolverCtx solver_ctx;
+    LockstepSolver lockstep;
+    SNESConvergedReason *reasons;
+    EntryData *cases;
+    PlantKPIs kpis;
+    PetscReal *guesses, *states, *record, *batch, *gathered = NULL;
+    PetscBool *warm;
+    PetscInt64 index, failed = 0;
+    PetscInt lanes = 0, num_cases;
+    PetscLogDouble last_checkpoint;
+
+    PetscOptionsGetInt(NULL, NULL, "-lockstep_lanes", &lanes, NULL);
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    if (lanes > 0)
+        PetscCall(LockstepSolverBuild(&lockstep, &solver_ctx, lanes));
+
+    // Record of a case: converged reason, swept parameters, unknowns and KPIs
+    record_size = 1 + grid.num_params + NUM_VAR + NUM_KPI;
+
+    PetscMalloc1(batch_size * record_size, &batch);
+
+    if (rank == 0)
+        PetscMalloc1(size * batch_size * record_size, &gathered);
+
+    PetscMalloc1(batch_size, &cases);
+    PetscMalloc1(batch_size * NUM_VAR, &guesses);
+    PetscMalloc1(batch_size * NUM_VAR, &states);
+    PetscMalloc1(batch_size, &warm);
+    PetscMalloc1(batch_size, &reasons);
+
+    PetscTime(&last_checkpoint);
+
+    while (done < grid.num_cases)
+    {
+        // Cases of the chunk of this rank, the first one being warm-started from the last converged case of the previous batch
+        for (i = 0, num_cases = 0; i < batch_size; i++)
+        {
+            record = &batch[i * record_size];
+            index = done + (PetscInt64)rank * batch_size + i;
+            record[0] = 0.0;
+
+            if (index >= grid.num_cases)
+                continue;
+
+            cases[i] = *entry_data;
+
+            SweepGridCase(&grid, index, &record[1]);
+            SweepGridApply(&grid, &record[1], &cases[i]);
+
+            num_cases++;
+        }
+
+        for (i = 0; i < num_cases; i++)
+            warm[i] = i == 0 && warm_start ? PETSC_TRUE : PETSC_FALSE;
+
+        for (j = 0; j < NUM_VAR; j++)
+            guesses[j] = warm_state[j];
+
+        PetscCall(PlantSolveCases(&solver_ctx, lanes > 0 ? &lockstep : NULL, cases, num_cases, guesses, warm, states, reasons));
+
+        for (i = 0; i < num_cases; i++)
+        {
+            record = &batch[i * record_size];
+            record[0] = (PetscReal)reasons[i];
+
+            for (j = 0; j < NUM_VAR; j++)
+                record[1 + grid.num_params + j] = states[i * NUM_VAR + j];
+
+            if (reasons[i] <= 0)
+                continue;
+
+            ComputeKPIs(&states[i * NUM_VAR], &cases[i].dessal_data, &kpis);
+            KPIsToArray(&kpis, &record[1 + grid.num_params + NUM_VAR]);
+        }
+
+        MPI_Gather(batch, batch_size * record_size, MPIU_REAL, gathered, batch_size * record_size, MPIU_REAL, 0, PETSC_COMM_WORLD);
+
+        if (rank == 0)
+        {
+            PetscLogDouble now;
+
+            for (r = 0; r < size; r++)
+                for (i = 0; i < batch_size; i++)
+                {
+                    record = &gathered[(r * batch_size + i) * record_size];
+                    index = done + (PetscInt64)r * batch_size + i;
+
+                    if (index >= grid.num_cases)
+                        continue;
+
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, "%lld", (long long)index);
+                    for (j = 0; j < grid.num_params; j++)
+                        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)record[1 + j]);
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",%d", (int)record[0]);
+
+                    // Unknowns and KPIs are left empty for cases that did not converge
+                    for (j = 0; j < NUM_VAR + NUM_KPI; j++)
+                        if (record[0] > 0.0)
+                            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)record[1 + grid.num_params + j]);
+                        else
+                            PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+                    if (record[0] > 0.0)
+                    {
+                        for (j = 0; j < NUM_VAR; j++)
+                            warm_state[j] = record[1 + grid.num_params + j];
+                        warm_start = 1;
+                    }
+                    else
+                        failed++;
+                }
+
+            done = PetscMin(done + (PetscInt64)size * batch_size, grid.num_cases);
+
+            PetscTime(&now);
+
+            if (now - last_checkpoint >= checkpoint_interval || done == grid.num_cases)
+            {
+                fflush(fptr);
+                fsync(fileno(fptr));
+                offset = (long long)ftello(fptr);
+
+                PetscCall(SweepCheckpointWrite(checkpoint, signature, done, offset, warm_state, warm_start ? PETSC_TRUE : PETSC_FALSE));
+
+                last_checkpoint = now;
+            }
+        }
+
+        MPI_Bcast(&done, 1, MPIU_INT64, 0, PETSC_COMM_WORLD);
+        MPI_Bcast(&warm_start, 1, MPIU_INT, 0, PETSC_COMM_WORLD);
+        MPI_Bcast(warm_state, NUM_VAR, MPIU_REAL, 0, PETSC_COMM_WORLD);
+    }
+
+    if (rank == 0)
+        PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscPrintf(PETSC_COMM_WORLD, "Parameter sweep: %lld cases, %lld failed in this run, results in %s\n", (long long)grid.num_cases,
+                (long long)failed, file);
+
+    PetscFree(batch);
+    PetscFree(gathered);
+    PetscFree(cases);
+    PetscFree(guesses);
+    PetscFree(states);
+    PetscFree(warm);
+    PetscFree(reasons);
+    SolverCtxDestroy(&solver_ctx);
+
+    if (lanes > 0)
+        LockstepSolverDestroy(&lockstep);
+
+    return 0;
+}
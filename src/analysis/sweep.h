@@ -0,0 +1,36 @@
+#ifndef SWEEP
+
+#define SWEEP
+
+#include "../plant/plant.h"
+
+// Maximum number of swept parameters
+#define MAX_SWEEP 16
+
+// Data structure containing a Cartesian grid of cases over parameters of the desalination module
+typedef struct
+{
+    char name[MAX_SWEEP][64];
+    PetscReal min[MAX_SWEEP], max[MAX_SWEEP];
+    PetscInt num_params, points[MAX_SWEEP];
+    PetscInt64 num_cases;
+} SweepGrid;
+
+// Parameters of a grid of cases unless given on the command line
+static const char *const sweep_default_parameters[] = {"entry_temperature_feed", "feed_mass_flow_rate"};
+
+// Function to fetch a grid of cases from the command line (options -<prefix>_parameters, -<prefix>_min, -<prefix>_max, -<prefix>_points),
+// defaulting to given parameters
+PetscErrorCode SweepGridBuild(SweepGrid *grid, const char prefix[], const char *const default_names[], PetscInt num_default_names,
+                              PetscInt default_points, DessalData *dessal_data);
+
+// Function to compute the values of the parameters of a case of the grid, consecutive cases being neighbours in the grid
+PetscErrorCode SweepGridCase(SweepGrid *grid, PetscInt64 index, PetscReal values[]);
+
+// Function to set the values of the parameters of a case into the entry data
+PetscErrorCode SweepGridApply(SweepGrid *grid, const PetscReal values[], EntryData *entry_data);
+
+// Function to run a parameter sweep, with periodic checkpoints from which an interrupted run can be resumed
+PetscErrorCode RunSweep(EntryData *entry_data);
+
+#endif
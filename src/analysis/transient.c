@@ -0,0 +1,528 @@
+#include "transient.h"
+#include "../properties/properties.h"
+
+/*
+Lumped-capacitance model of the desalination module
+
+The steady balance maps the unknowns x to their update B(x), and the steady state solves x = B(x). In the transient model, the unknowns
+that carry heat capacity relax towards their update, tau dx/dt = B(x) - x, while the others (interfaces without capacitance, fluxes)
+remain algebraic, B(x) - x = 0, so that the model is a differential-algebraic system whose steady state is the one of the plant.
+
+- Channels: with the mean temperature of a channel taken as the average of its inlet and outlet, the energy balance of the fluid held in
+  it, M cp dT_mean/dt = m cp (T_in - T_out) - q A, becomes (M / 2m) dT_out/dt = B(x) - T_out for a constant inlet temperature. The same
+  time constant applies to the salinity of the feed at the outlet.
+- Wall: its heat capacity is lumped at the coolant side, relaxing through the thermal resistance of the coolant boundary layer.
+- Distillate film: its heat capacity relaxes through its own thermal resistance.
+
+The resistances of the wall and of the film are evaluated at the initial steady state, while the time constants of the channels follow
+the current flow rates, which may be the driven input.
+*/
+
+PetscErrorCode TransientModelBuild(TransientModel *model, EntryData *entry_data, PetscReal state[], SNESConvergedReason *reason)
+{
+    PetscFunctionBeginUser;
+
+    EntryData initial_data = *entry_data;
+    DessalData *dessal_data;
+    SaltWaterProperties feed_prop, cool_prop, film_prop;
+    PetscReal *parameter, nominal, step, step_time = 600.0, ramp_time = 600.0, start_value, resistance;
+    PetscReal wall_density = 950.0, wall_specific_heat = 1900.0;
+    PetscInt scenario = SCENARIO_STEP, num_times = MAX_PROFILE, num_values = MAX_PROFILE, i;
+    PetscBool given_times, given_values;
+    char event_output[64] = "out_temperature_cool";
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Scenario                                                                                                                                      //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscStrncpy(model->input_name, "entry_temperature_feed", sizeof(model->input_name));
+
+    PetscOptionsGetEList(NULL, NULL, "-transient_scenario", scenario_names, 4, &scenario, NULL);
+    PetscOptionsGetString(NULL, NULL, "-transient_input", model->input_name, sizeof(model->input_name), NULL);
+
+    PetscCall(DessalDataGetParameter(&initial_data.dessal_data, model->input_name, &parameter));
+    nominal = *parameter;
+
+    // Default step of 10% of the nominal value, and start value of the ramps at half of it
+    step = 0.1 * nominal;
+    start_value = 0.5 * nominal;
+
+    PetscOptionsGetReal(NULL, NULL, "-transient_step", &step, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-transient_step_time", &step_time, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-transient_ramp_time", &ramp_time, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-transient_start_value", &start_value, NULL);
+
+    model->scenario = (TransientScenario)scenario;
+
+    switch (scenario)
+    {
+    case SCENARIO_STARTUP:
+    case SCENARIO_SHUTDOWN:
+        model->num_points = 2;
+        model->profile_time[0] = 0.0;
+        model->profile_time[1] = ramp_time;
+        model->profile_value[0] = scenario == SCENARIO_STARTUP ? start_value : nominal;
+        model->profile_value[1] = scenario == SCENARIO_STARTUP ? nominal : start_value;
+        break;
+    case SCENARIO_PROFILE:
+        PetscOptionsGetRealArray(NULL, NULL, "-transient_profile_times", model->profile_time, &num_times, &given_times);
+        PetscOptionsGetRealArray(NULL, NULL, "-transient_profile_values", model->profile_value, &num_values, &given_values);
+
+        PetscCheck(given_times && given_values && num_times == num_values, PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ,
+                   "The profile scenario needs as many -transient_profile_values as -transient_profile_times");
+
+        model->num_points = num_times;
+        break;
+    default:
+        // Two breakpoints at the same time make a discontinuity, the later one applying from then on
+        model->num_points = 3;
+        model->profile_time[0] = 0.0;
+        model->profile_time[1] = step_time;
+        model->profile_time[2] = step_time;
+        model->profile_value[0] = nominal;
+        model->profile_value[1] = nominal;
+        model->profile_value[2] = nominal + step;
+    }
+
+    for (i = 1; i < model->num_points; i++)
+        PetscCheck(model->profile_time[i] >= model->profile_time[i - 1], PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+                   "The times of the input profile must be nondecreasing");
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Event                                                                                                                                         //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    model->event_stop = PETSC_FALSE;
+    model->num_events = 0;
+
+    PetscOptionsGetString(NULL, NULL, "-transient_event_output", event_output, sizeof(event_output), NULL);
+    PetscOptionsGetReal(NULL, NULL, "-transient_event_limit", &model->event_limit, &model->event_enabled);
+    PetscOptionsGetBool(NULL, NULL, "-transient_event_stop", &model->event_stop, NULL);
+
+    PlantOutputFind(event_output, &model->event_output);
+    PetscCheck(model->event_output >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown output of the plant: %s", event_output);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Initial steady state                                                                                                                          //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    *parameter = model->profile_value[0];
+
+    DessalDataResetState(&initial_data.dessal_data);
+    DessalDataGetState(&initial_data.dessal_data, state);
+
+    SolverCtxBuild(&model->solver_ctx, &initial_data);
+
+    PetscCheck(model->solver_ctx.num_loop == 0, PETSC_COMM_WORLD, PETSC_ERR_SUP, "The transient model does not support the recycle loop");
+
+    PlantSolve(&model->solver_ctx, state, reason);
+
+    dessal_data = &model->solver_ctx.entry_data.dessal_data;
+    DessalDataGetParameter(dessal_data, model->input_name, &model->input);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Capacitances and time constants                                                                                                               //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    // Defaults for a polyethylene wall
+    PetscOptionsGetReal(NULL, NULL, "-wall_density", &wall_density, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-wall_specific_heat", &wall_specific_heat, NULL);
+
+    SaltWaterPropBuild(&feed_prop, 0.5 * (dessal_data->entry_temperature_feed + state[0]),
+                       0.5 * (dessal_data->entry_salinity_feed + state[7]));
+    SaltWaterPropBuild(&cool_prop, 0.5 * (dessal_data->entry_temperature_cool + state[1]), dessal_data->entry_salinity_cool);
+    SaltWaterPropBuild(&film_prop, state[4], 0.0);
+
+    model->feed_holdup = feed_prop.density * dessal_data->membrane_area * dessal_data->feed_channel_height * dessal_data->spacer_porosity;
+    model->cool_holdup = cool_prop.density * dessal_data->membrane_area * dessal_data->cool_channel_height * dessal_data->spacer_porosity;
+    model->wall_capacity = wall_density * wall_specific_heat * dessal_data->wall_thickness;
+
+    for (i = 0; i < NUM_VAR; i++)
+        model->time_constant[i] = 0.0;
+
+    // Wall, through the coolant boundary layer
+    resistance = (state[6] - 0.5 * (dessal_data->entry_temperature_cool + state[1])) / state[9];
+
+    if (resistance > 0.0)
+        model->time_constant[6] = model->wall_capacity * resistance;
+
+    // Distillate film, held in the spacer of the gap
+    resistance = (state[4] - state[5]) / state[9];
+
+    if (resistance > 0.0)
+        model->time_constant[4] = film_prop.density * film_prop.specific_heat * dessal_data->film_thickness *
+                                  dessal_data->gap_spacer_porosity * resistance;
+
+    model->fptr = NULL;
+    model->num_evaluations = 0;
+
+    TransientModelSetTime(model, 0.0);
+
+    return 0;
+}
+
+PetscErrorCode TransientModelSetTime(TransientModel *model, PetscReal time)
+{
+    PetscFunctionBeginUser;
+
+    DessalData *dessal_data = &model->solver_ctx.entry_data.dessal_data;
+    PetscReal value, weight;
+    PetscInt i = 0;
+
+    // Piecewise-linear interpolation of the profile, constant before its first breakpoint and after its last one; at a discontinuity, the
+    // later value applies only after its time, so that steps ending there see the earlier value
+    while (i + 1 < model->num_points && model->profile_time[i + 1] < time)
+        i++;
+
+    if (i + 1 == model->num_points || time <= model->profile_time[0])
+        value = model->profile_value[time <= model->profile_time[0] ? 0 : i];
+    else
+    {
+        weight = (time - model->profile_time[i]) / (model->profile_time[i + 1] - model->profile_time[i]);
+        value = (1.0 - weight) * model->profile_value[i] + weight * model->profile_value[i + 1];
+    }
+
+    if (value != *model->input)
+    {
+        *model->input = value;
+
+        DessalContextBuild(&model->solver_ctx.dessal_ctx, dessal_data);
+    }
+
+    model->time_constant[0] = model->feed_holdup / (2.0 * dessal_data->feed_mass_flow_rate);
+    model->time_constant[1] = model->cool_holdup / (2.0 * dessal_data->cool_mass_flow_rate);
+    model->time_constant[7] = model->time_constant[0];
+
+    return 0;
+}
+
+PetscErrorCode TransientModelDestroy(TransientModel *model)
+{
+    PetscFunctionBeginUser;
+
+    SolverCtxDestroy(&model->solver_ctx);
+
+    return 0;
+}
+
+PetscErrorCode TransientState(TransientModel *model, PetscReal time, Vec x, PetscReal state[])
+{
+    SolverCtx *solver_ctx = &model->solver_ctx;
+    const PetscScalar *x_array;
+    PetscReal update[NUM_VAR];
+    PetscInt i, k;
+
+    TransientModelSetTime(model, time);
+
+    DMDAVecGetArrayRead(solver_ctx->da, x, &x_array);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * solver_ctx->scale[k];
+    }
+
+    DMDAVecRestoreArrayRead(solver_ctx->da, x, &x_array);
+
+    if (solver_ctx->formulation == FORMULATION_FULL)
+        return 0;
+
+    // Reconstructing the explicit unknowns in one pass of the balance
+    DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+
+    state[5] = update[5];
+    state[8] = update[8];
+    state[9] = update[9];
+    state[10] = update[10];
+    state[11] = update[11];
+
+    return 0;
+}
+
+PetscErrorCode TransientResidual(TS ts, PetscReal time, Vec x, Vec x_dot, Vec f, void *ctx)
+{
+    TransientModel *model = (TransientModel *)ctx;
+    SolverCtx *solver_ctx = &model->solver_ctx;
+    DM da = solver_ctx->da;
+    const PetscScalar *x_array, *x_dot_array;
+    PetscScalar *f_array;
+    PetscReal *scale = solver_ctx->scale;
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR];
+    PetscInt i, k;
+
+    TransientModelSetTime(model, time);
+
+    DMDAVecGetArrayRead(da, x, &x_array);
+    DMDAVecGetArrayRead(da, x_dot, &x_dot_array);
+    DMDAVecGetArray(da, f, &f_array);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * scale[k];
+    }
+
+    DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+    model->num_evaluations++;
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        f_array[i] = model->time_constant[k] * x_dot_array[i] + (state[k] - update[k]) / scale[k];
+    }
+
+    DMDAVecRestoreArrayRead(da, x, &x_array);
+    DMDAVecRestoreArrayRead(da, x_dot, &x_dot_array);
+    DMDAVecRestoreArray(da, f, &f_array);
+
+    return 0;
+}
+
+PetscErrorCode TransientPreStep(TS ts)
+{
+    TransientModel *model;
+    PetscReal time, step;
+    PetscInt i;
+
+    TSGetApplicationContext(ts, &model);
+    TSGetTime(ts, &time);
+    TSGetTimeStep(ts, &step);
+
+    // Steps end at the next breakpoint of the profile, so that no change of the input is stepped over
+    for (i = 0; i < model->num_points; i++)
+    {
+        if (model->profile_time[i] > time + PETSC_SQRT_MACHINE_EPSILON * PetscMax(1.0, PetscAbsReal(time)))
+        {
+            if (time + step > model->profile_time[i])
+                TSSetTimeStep(ts, model->profile_time[i] - time);
+
+            break;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode TransientPostStep(TS ts)
+{
+    TransientModel *model;
+    PetscReal time;
+    PetscInt i;
+
+    TSGetApplicationContext(ts, &model);
+    TSGetTime(ts, &time);
+
+    // The history of the multistep method does not hold across a breakpoint, where the input or its slope changes abruptly
+    for (i = 0; i < model->num_points; i++)
+    {
+        if (PetscAbsReal(model->profile_time[i] - time) <= PETSC_SQRT_MACHINE_EPSILON * PetscMax(1.0, PetscAbsReal(time)))
+        {
+            TSRestartStep(ts);
+            TSSetTimeStep(ts, model->time_step);
+
+            break;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode TransientMonitor(TS ts, PetscInt step, PetscReal time, Vec x, void *ctx)
+{
+    TransientModel *model = (TransientModel *)ctx;
+    PlantKPIs kpis;
+    PetscReal state[NUM_VAR], kpi_array[NUM_KPI];
+    PetscInt i;
+
+    TransientState(model, time, x, state);
+
+    ComputeKPIs(state, &model->solver_ctx.entry_data.dessal_data, &kpis);
+    KPIsToArray(&kpis, kpi_array);
+
+    PetscFPrintf(PETSC_COMM_SELF, model->fptr, "%.10e,%.10e", (double)time, (double)*model->input);
+
+    for (i = 0; i < NUM_VAR; i++)
+        PetscFPrintf(PETSC_COMM_SELF, model->fptr, ",%.10e", (double)state[i]);
+
+    for (i = 0; i < NUM_KPI; i++)
+        PetscFPrintf(PETSC_COMM_SELF, model->fptr, ",%.10e", (double)kpi_array[i]);
+
+    PetscFPrintf(PETSC_COMM_SELF, model->fptr, "\n");
+
+    return 0;
+}
+
+PetscErrorCode TransientEvent(TS ts, PetscReal time, Vec x, PetscScalar value[], void *ctx)
+{
+    TransientModel *model = (TransientModel *)ctx;
+    PetscReal state[NUM_VAR], output;
+
+    TransientState(model, time, x, state);
+
+    PlantOutput(state, &model->solver_ctx.entry_data.dessal_data, model->event_output, &output);
+
+    value[0] = output - model->event_limit;
+
+    return 0;
+}
+
+PetscErrorCode TransientPostEvent(TS ts, PetscInt num_events, PetscInt event_list[], PetscReal time, Vec x, PetscBool forward, void *ctx)
+{
+    TransientModel *model = (TransientModel *)ctx;
+
+    if (model->num_events < MAX_EVENTS)
+        model->event_time[model->num_events] = time;
+
+    model->num_events++;
+
+    return 0;
+}
+
+/*
+Transient simulation
+
+The system is integrated from the steady state at the initial inputs by the adaptive BDF integrator of TS (variable order and step), the
+stage equations being solved by Newton with a finite-difference Jacobian, as in the steady solve. Steps end at the breakpoints of the
+input profile, where the integration restarts from the initial time step, and the crossings of the limit of the monitored output are located by the event handler of TS, optionally stopping the run.
+Every accepted step is appended to the results file. The integrator can be tuned with the -ts_* options (e.g. -ts_rtol, -ts_atol,
+-ts_bdf_order, -ts_adapt_dt_max).
+*/
+
+PetscErrorCode RunTransient(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    TransientModel model;
+    SolverCtx *solver_ctx = &model.solver_ctx;
+    SNESConvergedReason steady_reason;
+    TSConvergedReason reason;
+    TS ts;
+    SNES snes;
+    Vec x, atol, rtol;
+    PetscScalar *x_array, *atol_array, *rtol_array;
+    PetscReal state[NUM_VAR], final_time = 3600.0, time_step = 1.0e-2, solve_time;
+    PetscInt direction = 0, steps, rejections, iterations, i, k;
+    PetscLogDouble start, end;
+    char file[256] = "./results/transient.csv";
+
+    PetscOptionsGetReal(NULL, NULL, "-transient_final_time", &final_time, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-transient_time_step", &time_step, NULL);
+
+    PetscCall(TransientModelBuild(&model, entry_data, state, &steady_reason));
+
+    PetscCheck(steady_reason > 0, PETSC_COMM_WORLD, PETSC_ERR_NOT_CONVERGED,
+               "The steady state at the initial inputs did not converge (reason %d)", (int)steady_reason);
+
+    model.time_step = time_step;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Integrator                                                                                                                                    //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    VecDuplicate(solver_ctx->solution, &x);
+
+    DMDAVecGetArray(solver_ctx->da, x, &x_array);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        x_array[i] = state[k] / solver_ctx->scale[k];
+    }
+
+    DMDAVecRestoreArray(solver_ctx->da, x, &x_array);
+
+    // The local error of the algebraic unknowns is left uncontrolled, since they jump with the input and follow the differential ones
+    VecDuplicate(x, &atol);
+    VecDuplicate(x, &rtol);
+
+    DMDAVecGetArray(solver_ctx->da, atol, &atol_array);
+    DMDAVecGetArray(solver_ctx->da, rtol, &rtol_array);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        atol_array[i] = model.time_constant[k] > 0.0 ? 1.0e-6 : PETSC_INFINITY;
+        rtol_array[i] = model.time_constant[k] > 0.0 ? 1.0e-6 : PETSC_INFINITY;
+    }
+
+    DMDAVecRestoreArray(solver_ctx->da, atol, &atol_array);
+    DMDAVecRestoreArray(solver_ctx->da, rtol, &rtol_array);
+
+    TSCreate(PETSC_COMM_SELF, &ts);
+    TSSetApplicationContext(ts, &model);
+    TSSetType(ts, TSBDF);
+    TSSetIFunction(ts, NULL, TransientResidual, &model);
+    TSSetMaxTime(ts, final_time);
+    TSSetTimeStep(ts, time_step);
+    TSSetExactFinalTime(ts, TS_EXACTFINALTIME_MATCHSTEP);
+    TSSetTolerances(ts, 1.0e-6, atol, 1.0e-6, rtol);
+    TSSetMaxSNESFailures(ts, -1);
+    TSSetPreStep(ts, TransientPreStep);
+    TSSetPostStep(ts, TransientPostStep);
+    TSMonitorSet(ts, TransientMonitor, &model, NULL);
+
+    if (model.event_enabled)
+        TSSetEventHandler(ts, 1, &direction, &model.event_stop, TransientEvent, TransientPostEvent, &model);
+
+    TSSetFromOptions(ts);
+
+    TSGetSNES(ts, &snes);
+    SNESSetJacobian(snes, solver_ctx->jac, solver_ctx->jac, SNESComputeJacobianDefault, NULL);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Integration                                                                                                                                   //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &model.fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, model.fptr, "time,%s", model.input_name);
+
+    for (i = 0; i < NUM_VAR; i++)
+        PetscFPrintf(PETSC_COMM_SELF, model.fptr, ",%s", dessal_state_names[i]);
+
+    for (i = 0; i < NUM_KPI; i++)
+        PetscFPrintf(PETSC_COMM_SELF, model.fptr, ",%s", kpi_names[i]);
+
+    PetscFPrintf(PETSC_COMM_SELF, model.fptr, "\n");
+
+    PetscTime(&start);
+
+    TSSolve(ts, x);
+
+    PetscTime(&end);
+
+    PetscFClose(PETSC_COMM_SELF, model.fptr);
+
+    TSGetConvergedReason(ts, &reason);
+    TSGetSolveTime(ts, &solve_time);
+    TSGetStepNumber(ts, &steps);
+    TSGetStepRejections(ts, &rejections);
+    TSGetSNESIterations(ts, &iterations);
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Summary                                                                                                                                       //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscPrintf(PETSC_COMM_WORLD, "Transient simulation (%s scenario of %s): reason %d at t = %g s, results in %s\n",
+                scenario_names[model.scenario], model.input_name, (int)reason, (double)solve_time, file);
+    PetscPrintf(PETSC_COMM_WORLD, "  %d steps (%d rejected), %d Newton iterations, %lld balance evaluations\n", (int)steps, (int)rejections,
+                (int)iterations, (long long)model.num_evaluations);
+    PetscPrintf(PETSC_COMM_WORLD, "  %g s simulated in %g s of wall time (%g times faster than real time)\n", (double)solve_time,
+                (double)(end - start), (double)(solve_time / PetscMax(end - start, PETSC_SMALL)));
+    PetscPrintf(PETSC_COMM_WORLD, "  time constants: feed %g s, coolant %g s, wall %g s, distillate film %g s\n",
+                (double)model.time_constant[0], (double)model.time_constant[1], (double)model.time_constant[6],
+                (double)model.time_constant[4]);
+
+    for (i = 0; i < PetscMin(model.num_events, MAX_EVENTS); i++)
+        PetscPrintf(PETSC_COMM_WORLD, "  event: %s crossed %g at t = %g s\n",
+                    model.event_output < NUM_VAR ? dessal_state_names[model.event_output] : kpi_names[model.event_output - NUM_VAR],
+                    (double)model.event_limit, (double)model.event_time[i]);
+
+    TSDestroy(&ts);
+    VecDestroy(&x);
+    VecDestroy(&atol);
+    VecDestroy(&rtol);
+    TransientModelDestroy(&model);
+
+    return 0;
+}
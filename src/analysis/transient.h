@@ -0,0 +1,64 @@
+#ifndef TRANSIENT
+
+#define TRANSIENT
+
+#include <petscts.h>
+#include "../plant/plant.h"
+
+// Maximum number of breakpoints of the input profile of a transient scenario, and of recorded events
+#define MAX_PROFILE 64
+#define MAX_EVENTS 64
+
+// Scenarios driving a transient simulation
+typedef enum
+{
+    SCENARIO_STEP,     // Step of the driven input away from its nominal value
+    SCENARIO_STARTUP,  // Ramp of the driven input from its start value up to its nominal value
+    SCENARIO_SHUTDOWN, // Ramp of the driven input from its nominal value down to its start value
+    SCENARIO_PROFILE   // Piecewise-linear profile of the driven input given on the command line
+} TransientScenario;
+
+static const char *const scenario_names[] = {"step", "startup", "shutdown", "profile"};
+
+// Data structure containing the lumped-capacitance model of the desalination module and the scenario driving it
+typedef struct
+{
+    SolverCtx solver_ctx;
+
+    // Fluid held in the channels, heat capacity of the wall per unit area, and time constants of the unknowns (zero for the unknowns
+    // without capacitance, which remain algebraic)
+    PetscReal feed_holdup, cool_holdup, wall_capacity, time_constant[NUM_VAR];
+
+    // Scenario, driven input of the desalination module and its piecewise-linear profile in time
+    TransientScenario scenario;
+    char input_name[64];
+    PetscReal *input, profile_time[MAX_PROFILE], profile_value[MAX_PROFILE];
+    PetscInt num_points;
+
+    // Time step restarting the integration at each breakpoint of the profile
+    PetscReal time_step;
+
+    // Monitored output, its limit and the times at which it was crossed
+    PetscInt event_output, num_events;
+    PetscReal event_limit, event_time[MAX_EVENTS];
+    PetscBool event_enabled, event_stop;
+
+    // Results file and number of evaluations of the balance
+    FILE *fptr;
+    PetscInt64 num_evaluations;
+} TransientModel;
+
+// Defining a transient model constructor, fetching the scenario from the command line and solving the steady state at its initial inputs
+// (returned in the array of unknowns), at which the capacitances and time constants are evaluated
+PetscErrorCode TransientModelBuild(TransientModel *model, EntryData *entry_data, PetscReal state[], SNESConvergedReason *reason);
+
+// Function to set the driven input of a transient model to its value at a given time, updating the invariant terms of the balance
+PetscErrorCode TransientModelSetTime(TransientModel *model, PetscReal time);
+
+// Defining a transient model destructor
+PetscErrorCode TransientModelDestroy(TransientModel *model);
+
+// Function to run a transient simulation of the plant, driven by a scenario of one of its inputs
+PetscErrorCode RunTransient(EntryData *entry_data);
+
+#endif
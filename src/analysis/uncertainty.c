@@ -0,0 +1,456 @@
+#include "uncertainty.h"
+#include "sampling.h"
+
+/*
+Distributions of the uncertain parameters
+
+Each parameter is sampled by inverse transform of a point of the unit interval. When no distribution parameters are given in the command
+line, the bounds (or the standard deviation) are taken as a fraction of the nominal value, set by -<prefix>_relative_range. Every
+parameter lives within physical bounds (-<prefix>_<name>_bounds): porosities within [0, 1], the tortuosity above one and the other
+parameters on the side of zero of their nominal value. The normal distribution is truncated to them, by mapping the point of the unit
+interval to the range of the cumulative distribution function between the bounds, and the others must lie within them.
+*/
+
+PetscErrorCode InputDistributionBuild(InputDistribution *distribution, const char name[], const char prefix[], DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *parameter, nominal, relative_range = 0.1;
+    PetscInt type = DISTRIBUTION_UNIFORM, num_parameters = 3, num_bounds = 2;
+    PetscBool given, porosity, tortuosity;
+    char option[256];
+
+    PetscCall(DessalDataGetParameter(dessal_data, name, &parameter));
+    nominal = *parameter;
+
+    PetscStrncpy(distribution->name, name, sizeof(distribution->name));
+
+    PetscSNPrintf(option, sizeof(option), "-%s_relative_range", prefix);
+    PetscOptionsGetReal(NULL, NULL, option, &relative_range, NULL);
+
+    PetscSNPrintf(option, sizeof(option), "-%s_%s_distribution", prefix, name);
+    PetscOptionsGetEList(NULL, NULL, option, distribution_names, 3, &type, NULL);
+    distribution->type = (DistributionType)type;
+
+    // Default parameters around the nominal value
+    if (distribution->type == DISTRIBUTION_NORMAL)
+    {
+        distribution->parameters[0] = nominal;
+        distribution->parameters[1] = relative_range * PetscAbsReal(nominal);
+        distribution->parameters[2] = 0.0;
+    }
+    else
+    {
+        distribution->parameters[0] = nominal - relative_range * PetscAbsReal(nominal);
+        distribution->parameters[1] = nominal + relative_range * PetscAbsReal(nominal);
+        distribution->parameters[2] = nominal;
+    }
+
+    PetscSNPrintf(option, sizeof(option), "-%s_%s_parameters", prefix, name);
+    PetscOptionsGetRealArray(NULL, NULL, option, distribution->parameters, &num_parameters, &given);
+
+    if (given && distribution->type == DISTRIBUTION_TRIANGULAR && num_parameters < 3)
+        distribution->parameters[2] = 0.5 * (distribution->parameters[0] + distribution->parameters[1]);
+
+    PetscCheck(!given || num_parameters >= 2, PETSC_COMM_SELF, PETSC_ERR_ARG_WRONG,
+               "Option %s needs at least two values", option);
+    PetscCheck(distribution->type == DISTRIBUTION_NORMAL || distribution->parameters[0] <= distribution->parameters[1],
+               PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Lower bound above the upper one for the distribution of %s", name);
+    PetscCheck(distribution->type != DISTRIBUTION_TRIANGULAR ||
+                   (distribution->parameters[0] <= distribution->parameters[2] && distribution->parameters[2] <= distribution->parameters[1]),
+               PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Mode outside the bounds of the triangular distribution of %s", name);
+
+    // Physical bounds of the parameter
+    PetscStrendswith(name, "porosity", &porosity);
+    PetscStrcmp(name, "membrane_tortuosity", &tortuosity);
+
+    distribution->bounds[0] = nominal > 0.0 || porosity ? 0.0 : PETSC_NINFINITY;
+    distribution->bounds[1] = porosity ? 1.0 : nominal < 0.0 ? 0.0 : PETSC_INFINITY;
+
+    if (tortuosity)
+        distribution->bounds[0] = 1.0;
+
+    PetscSNPrintf(option, sizeof(option), "-%s_%s_bounds", prefix, name);
+    PetscOptionsGetRealArray(NULL, NULL, option, distribution->bounds, &num_bounds, &given);
+
+    PetscCheck(!given || num_bounds == 2, PETSC_COMM_SELF, PETSC_ERR_ARG_WRONG, "Option %s needs two values", option);
+    PetscCheck(distribution->bounds[0] < distribution->bounds[1], PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE,
+               "Lower physical bound above the upper one for %s", name);
+
+    if (distribution->type == DISTRIBUTION_NORMAL)
+        PetscCheck(distribution->parameters[1] == 0.0 ||
+                       NormalCDF((distribution->bounds[1] - distribution->parameters[0]) / distribution->parameters[1]) -
+                               NormalCDF((distribution->bounds[0] - distribution->parameters[0]) / distribution->parameters[1]) > PETSC_SMALL,
+                   PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "The normal distribution of %s has no probability within its physical bounds", name);
+    else
+        PetscCheck(distribution->parameters[0] >= distribution->bounds[0] && distribution->parameters[1] <= distribution->bounds[1],
+                   PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "The distribution of %s exceeds its physical bounds [%g, %g]", name,
+                   (double)distribution->bounds[0], (double)distribution->bounds[1]);
+
+    return 0;
+}
+
+PetscReal InputDistributionSample(InputDistribution *distribution, PetscReal uniform)
+{
+    PetscReal a = distribution->parameters[0], b = distribution->parameters[1], c = distribution->parameters[2], lower, upper;
+
+    switch (distribution->type)
+    {
+    case DISTRIBUTION_NORMAL:
+        if (b <= 0.0)
+            return a;
+        lower = NormalCDF((distribution->bounds[0] - a) / b);
+        upper = NormalCDF((distribution->bounds[1] - a) / b);
+        return PetscMin(PetscMax(a + b * InverseNormalCDF(lower + uniform * (upper - lower)), distribution->bounds[0]), distribution->bounds[1]);
+    case DISTRIBUTION_TRIANGULAR:
+        if (b <= a)
+            return a;
+        if (uniform < (c - a) / (b - a))
+            return a + PetscSqrtReal(uniform * (b - a) * (c - a));
+        return b - PetscSqrtReal((1.0 - uniform) * (b - a) * (b - c));
+    default:
+        return a + (b - a) * uniform;
+    }
+}
+
+/*
+Confidence intervals of randomized quasi-Monte Carlo
+
+The points of a quasi-random sequence are not independent, so the spread of the samples says nothing about the error of their mean. The
+error is instead estimated from independent randomizations of the sequence (replicates): their means are independent and identically
+distributed, and the confidence interval of the overall mean follows from their spread with Student's t.
+
+Reference: P. L'Ecuyer, Randomized quasi-Monte Carlo: an introduction for practitioners. In: Monte Carlo and Quasi-Monte Carlo Methods
+           2016, Springer (2018) 29-52. https://doi.org/10.1007/978-3-319-91436-7_2
+*/
+
+PetscErrorCode ReplicateInterval(CovarianceAccumulator replicates[], PetscInt num_replicates, PetscInt component, PetscReal confidence,
+                                 PetscReal *mean, PetscReal *half_width)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal sum = 0.0, deviation = 0.0;
+    PetscInt r;
+
+    for (r = 0; r < num_replicates; r++)
+        sum += replicates[r].mean[component];
+
+    *mean = sum / num_replicates;
+    *half_width = PETSC_INFINITY;
+
+    for (r = 0; r < num_replicates; r++)
+        if (replicates[r].count == 0)
+            return 0;
+
+    if (num_replicates < 2)
+        return 0;
+
+    for (r = 0; r < num_replicates; r++)
+        deviation += PetscSqr(replicates[r].mean[component] - *mean);
+
+    deviation = PetscSqrtReal(deviation / (num_replicates - 1));
+
+    *half_width = StudentQuantile(0.5 * (1.0 + confidence), num_replicates - 1) * deviation / PetscSqrtReal((PetscReal)num_replicates);
+
+    return 0;
+}
+
+/*
+Monte Carlo propagation of uncertainties with randomized quasi-random sampling and streaming statistics
+
+The samples are drawn in turn from independently randomized replicates of a Halton sequence (each with its own digit scrambling and a
+random shift modulo one, as the scrambling keeps the digit zero and so leaves base 2 untouched) and solved in batches, each MPI rank solving a
+contiguous chunk of the batch with a warm start from the nominal solution. The results of every batch are gathered on the first rank, which
+feeds the streaming accumulators (mean, co-moments, extrema and P-square quantiles, and the means of every replicate) in sample order, so
+memory does not grow with the number of samples. The run stops early once the half-widths of the confidence intervals of the means of all
+KPIs, estimated over the replicates and relative to the means, drop below the target.
+*/
+
+PetscErrorCode RunUncertainty(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    const char *default_names[] = {"pore_diameter", "membrane_porosity", "membrane_thickness", "polymer_conductivity",
+                                   "membrane_tortuosity"};
+    char *names[MAX_UNCERTAIN];
+    InputDistribution distribution[MAX_UNCERTAIN];
+    PetscInt num_inputs = MAX_UNCERTAIN, num_quantiles = MAX_QUANTILES, max_samples = 10000, min_samples = 256, batch_size = 32;
+    PetscInt num_replicates = 8, seed = 1, record_size, i, j, k, r;
+    PetscReal quantile_levels[MAX_QUANTILES] = {0.05, 0.5, 0.95};
+    PetscReal ci_target = 1.0e-3, confidence = 0.95;
+    PetscBool given, scramble = PETSC_TRUE;
+    char file[256] = "./results/uncertainty.csv";
+
+    PetscOptionsGetStringArray(NULL, NULL, "-uq_parameters", names, &num_inputs, &given);
+
+    if (!given)
+    {
+        num_inputs = sizeof(default_names) / sizeof(default_names[0]);
+
+        for (i = 0; i < num_inputs; i++)
+            PetscStrallocpy(default_names[i], &names[i]);
+    }
+
+    PetscOptionsGetRealArray(NULL, NULL, "-uq_quantiles", quantile_levels, &num_quantiles, &given);
+
+    if (!given)
+        num_quantiles = 3;
+
+    PetscOptionsGetInt(NULL, NULL, "-uq_samples", &max_samples, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-uq_min_samples", &min_samples, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-uq_batch_size", &batch_size, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-uq_replicates", &num_replicates, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-uq_seed", &seed, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-uq_scramble", &scramble, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-uq_ci_target", &ci_target, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-uq_confidence", &confidence, NULL);
+
+    PetscCheck(batch_size > 0 && max_samples > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Sample and batch sizes must be positive");
+    PetscCheck(confidence > 0.0 && confidence < 1.0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Confidence level must be within (0, 1)");
+    PetscCheck(num_replicates >= 2 && num_replicates <= MAX_REPLICATES, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+               "Number of replicates must be within [2, %d]", MAX_REPLICATES);
+
+    // Without scrambling the replicates would all be the same sequence, and the confidence intervals cannot be estimated
+    if (!scramble)
+    {
+        num_replicates = 1;
+        ci_target = 0.0;
+    }
+
+    for (i = 0; i < num_inputs; i++)
+        PetscCall(InputDistributionBuild(&distribution[i], names[i], "uq", &entry_data->dessal_data));
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Nominal solution, used as warm start for all samples                                                                                          //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    SolverCtx solver_ctx;
+    SNESConvergedReason reason;
+    PetscReal nominal_state[NUM_VAR], state[NUM_VAR];
+    PetscBool warm_start;
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    PlantSolveCase(&solver_ctx, entry_data, NULL, nominal_state, &reason);
+    warm_start = reason > 0 ? PETSC_TRUE : PETSC_FALSE;
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Sampling loop                                                                                                                                 //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscMPIInt size, rank;
+    HaltonSequence halton[MAX_REPLICATES];
+    CovarianceAccumulator accumulator, replicates[MAX_REPLICATES];
+    QuantileEstimator quantiles[NUM_KPI * MAX_QUANTILES];
+    EntryData sample_data;
+    PlantKPIs kpis;
+    PetscRandom random;
+    PetscReal *point, *record, *batch, *gathered = NULL, *parameter, *shift, mean, half_width, worst_width = PETSC_MAX_REAL;
+    PetscInt64 index, processed = 0, failed = 0;
+    PetscInt stop = 0;
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    // Record of a sample: validity flag, uncertain parameters and KPIs
+    record_size = 1 + num_inputs + NUM_KPI;
+
+    PetscMalloc1(num_inputs, &point);
+    PetscMalloc1(batch_size * record_size, &batch);
+
+    if (rank == 0)
+        PetscMalloc1(size * batch_size * record_size, &gathered);
+
+    // The samples cycle through the replicates, each with its own scrambling and shift of the sequence (the same on every rank)
+    PetscCalloc1(num_replicates * num_inputs, &shift);
+    PetscRandomCreate(PETSC_COMM_SELF, &random);
+    PetscRandomSetSeed(random, (unsigned long)seed);
+    PetscRandomSeed(random);
+
+    for (r = 0; r < num_replicates; r++)
+    {
+        HaltonBuild(&halton[r], num_inputs, scramble, (unsigned long)(seed + r));
+        CovarianceBuild(&replicates[r], num_inputs + NUM_KPI);
+
+        for (j = 0; j < num_inputs && scramble; j++)
+            PetscRandomGetValueReal(random, &shift[r * num_inputs + j]);
+    }
+
+    PetscRandomDestroy(&random);
+
+    CovarianceBuild(&accumulator, num_inputs + NUM_KPI);
+
+    for (k = 0; k < NUM_KPI; k++)
+        for (j = 0; j < num_quantiles; j++)
+            QuantileBuild(&quantiles[k * num_quantiles + j], quantile_levels[j]);
+
+    while (!stop)
+    {
+        for (i = 0; i < batch_size; i++)
+        {
+            record = &batch[i * record_size];
+            index = processed + (PetscInt64)rank * batch_size + i;
+            record[0] = 0.0;
+
+            if (index >= max_samples)
+                continue;
+
+            sample_data = *entry_data;
+
+            HaltonPoint(&halton[index % num_replicates], index / num_replicates + 1, point);
+
+            for (j = 0; j < num_inputs; j++)
+            {
+                point[j] += shift[(index % num_replicates) * num_inputs + j];
+                point[j] -= PetscFloorReal(point[j]);
+            }
+
+            for (j = 0; j < num_inputs; j++)
+            {
+                DessalDataGetParameter(&sample_data.dessal_data, distribution[j].name, &parameter);
+                *parameter = InputDistributionSample(&distribution[j], point[j]);
+                record[1 + j] = *parameter;
+            }
+
+            PlantSolveCase(&solver_ctx, &sample_data, warm_start ? nominal_state : NULL, state, &reason);
+
+            if (reason <= 0)
+                continue;
+
+            ComputeKPIs(state, &sample_data.dessal_data, &kpis);
+            KPIsToArray(&kpis, &record[1 + num_inputs]);
+            record[0] = 1.0;
+        }
+
+        MPI_Gather(batch, batch_size * record_size, MPIU_REAL, gathered, batch_size * record_size, MPIU_REAL, 0, PETSC_COMM_WORLD);
+
+        if (rank == 0)
+        {
+            // Feeding the accumulators in sample order
+            for (r = 0; r < size; r++)
+                for (i = 0; i < batch_size; i++)
+                {
+                    record = &gathered[(r * batch_size + i) * record_size];
+                    index = processed + (PetscInt64)r * batch_size + i;
+
+                    if (index >= max_samples)
+                        continue;
+
+                    if (record[0] == 0.0)
+                    {
+                        failed++;
+                        continue;
+                    }
+
+                    CovarianceUpdate(&accumulator, &record[1]);
+                    CovarianceUpdate(&replicates[index % num_replicates], &record[1]);
+
+                    for (k = 0; k < NUM_KPI; k++)
+                        for (j = 0; j < num_quantiles; j++)
+                            QuantileUpdate(&quantiles[k * num_quantiles + j], record[1 + num_inputs + k]);
+                }
+
+            // Relative half-width of the confidence intervals of the means of the KPIs, over the replicates
+            worst_width = 0.0;
+
+            for (k = 0; k < NUM_KPI; k++)
+            {
+                ReplicateInterval(replicates, num_replicates, num_inputs + k, confidence, &mean, &half_width);
+                worst_width = PetscMax(worst_width, half_width / PetscMax(PetscAbsReal(mean), PETSC_SMALL));
+            }
+
+            if (processed + size * batch_size >= max_samples)
+                stop = 1;
+            else if (ci_target > 0.0 && accumulator.count >= PetscMax(min_samples, 2) && worst_width <= ci_target)
+                stop = 1;
+        }
+
+        processed += (PetscInt64)size * batch_size;
+
+        MPI_Bcast(&stop, 1, MPIU_INT, 0, PETSC_COMM_WORLD);
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Exporting the statistics                                                                                                                      //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (rank == 0)
+    {
+        FILE *fptr;
+        PetscInt dim = num_inputs + NUM_KPI;
+
+        PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Uncertainty propagation:,,\n\n");
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Samples drawn =, %lld,\n", (long long)PetscMin(processed, (PetscInt64)max_samples));
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Samples converged =, %lld,\n", (long long)accumulator.count);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Samples failed =, %lld,\n", (long long)failed);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Scrambled replicates =, %d,\n", (int)num_replicates);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Confidence level =, %g,\n", (double)confidence);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Largest relative half-width of the confidence intervals of the means =, %g,\n\n", (double)worst_width);
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "Variable,distribution,mean,standard deviation,CI half-width,min,max");
+        for (j = 0; j < num_quantiles; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",q%g", (double)quantile_levels[j]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+        for (i = 0; i < dim; i++)
+        {
+            PetscReal deviation = PetscSqrtReal(CovarianceVariance(&accumulator, i));
+
+            ReplicateInterval(replicates, num_replicates, i, confidence, &mean, &half_width);
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%s,%.10e,%.10e,%.10e,%.10e,%.10e",
+                         i < num_inputs ? distribution[i].name : kpi_names[i - num_inputs],
+                         i < num_inputs ? distribution_names[distribution[i].type] : "output",
+                         (double)accumulator.mean[i], (double)deviation, (double)half_width,
+                         (double)accumulator.min[i], (double)accumulator.max[i]);
+
+            for (j = 0; j < num_quantiles; j++)
+                if (i < num_inputs)
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",");
+                else
+                    PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.10e", (double)QuantileValue(&quantiles[(i - num_inputs) * num_quantiles + j]));
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\nCorrelation matrix");
+        for (j = 0; j < dim; j++)
+            PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", j < num_inputs ? distribution[j].name : kpi_names[j - num_inputs]);
+        PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+        for (i = 0; i < dim; i++)
+        {
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s", i < num_inputs ? distribution[i].name : kpi_names[i - num_inputs]);
+
+            for (j = 0; j < dim; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6f", (double)CovarianceCorrelation(&accumulator, i, j));
+
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        PetscFClose(PETSC_COMM_SELF, fptr);
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "Uncertainty propagation: %lld samples converged, %lld failed, results in %s\n",
+                (long long)accumulator.count, (long long)failed, file);
+
+    for (r = 0; r < num_replicates; r++)
+    {
+        HaltonDestroy(&halton[r]);
+        CovarianceDestroy(&replicates[r]);
+    }
+
+    CovarianceDestroy(&accumulator);
+    PetscFree(point);
+    PetscFree(shift);
+    PetscFree(batch);
+    PetscFree(gathered);
+    SolverCtxDestroy(&solver_ctx);
+
+    for (i = 0; i < num_inputs; i++)
+        PetscFree(names[i]);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef UNCERTAINTY
+
+#define UNCERTAINTY
+
+#include "../plant/plant.h"
+#include "statistics.h"
+
+// Maximum number of uncertain parameters
+#define MAX_UNCERTAIN 32
+
+// Maximum number of reported quantiles
+#define MAX_QUANTILES 9
+
+// Maximum number of independently scrambled replicates of the quasi-random sequence
+#define MAX_REPLICATES 64
+
+// Probability distributions of the uncertain parameters
+typedef enum
+{
+    DISTRIBUTION_UNIFORM,   // Parameters: lower and upper bounds
+    DISTRIBUTION_NORMAL,    // Parameters: mean and standard deviation
+    DISTRIBUTION_TRIANGULAR // Parameters: lower bound, upper bound and mode
+} DistributionType;
+
+static const char *const distribution_names[] = {"uniform", "normal", "triangular"};
+
+// Data structure containing the distribution of an uncertain parameter of the desalination module, within the physical bounds of the
+// parameter (the normal distribution being truncated to them)
+typedef struct
+{
+    char name[64];
+    DistributionType type;
+    PetscReal parameters[3], bounds[2];
+} InputDistribution;
+
+// Function to fetch the distribution of an uncertain parameter from the command line, around its nominal value
+PetscErrorCode InputDistributionBuild(InputDistribution *distribution, const char name[], const char prefix[], DessalData *dessal_data);
+
+// Function to map a point of the unit interval to a value of the uncertain parameter (inverse transform sampling)
+PetscReal InputDistributionSample(InputDistribution *distribution, PetscReal uniform);
+
+// Function to compute the mean of a component of the random vector over independent replicates, and the half-width of its confidence
+// interval from the spread of the means of the replicates (Student t with one degree of freedom less than the number of replicates)
+PetscErrorCode ReplicateInterval(CovarianceAccumulator replicates[], PetscInt num_replicates, PetscInt component, PetscReal confidence,
+                                 PetscReal *mean, PetscReal *half_width);
+
+// Function to run the Monte Carlo propagation of the uncertainties of the membrane parameters to the KPIs of the plant
+PetscErrorCode RunUncertainty(EntryData *entry_data);
+
+#endif
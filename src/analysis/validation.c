@@ -0,0 +1,386 @@
+#include "validation.h"
+#include "sampling.h"
+
+/*
+Reference corpus
+
+The corpus is a fixed set of cases spread over the operating and design parameters of the desalination module, each one ranging within
+-validate_relative_range (a fraction) of its nominal value. The cases are the first points of the unscrambled Halton sequence, so that the
+corpus is the same from one run to the next and the errors of the fast paths can be compared across versions of the code.
+*/
+
+static const char *const corpus_parameters[] = {"entry_temperature_feed", "entry_temperature_cool", "feed_mass_flow_rate",
+                                                 "cool_mass_flow_rate",    "entry_salinity_feed",    "vacuum_pressure",
+                                                 "membrane_area",          "air_gap_thickness",      "film_thickness",
+                                                 "membrane_tortuosity",    "pore_diameter"};
+
+PetscErrorCode ValidationCorpusBuild(EntryData *entry_data, PetscInt num_cases, EntryData cases[])
+{
+    PetscFunctionBeginUser;
+
+    const PetscInt dim = sizeof(corpus_parameters) / sizeof(corpus_parameters[0]);
+    HaltonSequence halton;
+    PetscReal point[sizeof(corpus_parameters) / sizeof(corpus_parameters[0])], relative_range = 0.2, nominal, *parameter;
+    PetscInt i, j;
+
+    PetscOptionsGetReal(NULL, NULL, "-validate_relative_range", &relative_range, NULL);
+
+    HaltonBuild(&halton, dim, PETSC_FALSE, 0);
+
+    for (i = 0; i < num_cases; i++)
+    {
+        HaltonPoint(&halton, i + 1, point);
+
+        cases[i] = *entry_data;
+
+        for (j = 0; j < dim; j++)
+        {
+            PetscCall(DessalDataGetParameter(&entry_data->dessal_data, corpus_parameters[j], &parameter));
+            nominal = *parameter;
+
+            PetscCall(DessalDataGetParameter(&cases[i].dessal_data, corpus_parameters[j], &parameter));
+            *parameter = nominal + relative_range * PetscAbsReal(nominal) * (2.0 * point[j] - 1.0);
+        }
+    }
+
+    HaltonDestroy(&halton);
+
+    return 0;
+}
+
+/*
+Solution paths
+
+The baseline solves every case of the corpus from the default initial guess, with the full formulation and SNES, unscaled and unbounded
+whatever the options of the solver (-scaling, -bounded, -lockstep_lanes only apply to the fast paths). The paths without lanes do
+the same with their formulation, while the lockstep paths hand the whole corpus to the lockstep solver, from the same initial guesses: the
+plant system may have several roots, and a path warm-started otherwise could land on another one than the baseline. The time of a path
+covers the solves only; its iterations are the Newton iterations of all the cases, and its fallbacks the cases the lockstep solver handed
+back to SNES. The residual of a path is the largest norm of the scaled residuals of the double-precision balance at its converged states,
+evaluated after the solves whatever the precision of the path, so that a mixed-precision path is checked against the tolerances of the
+nonlinear solver. A converged state with a non-positive mass flux or feed outflow rate is a non-physical root, and counts as a failure.
+*/
+
+PetscErrorCode ValidationRunPath(const ValidationPath *path, EntryData *entry_data, EntryData cases[], PetscInt num_cases,
+                                 ValidationResult *result)
+{
+    PetscFunctionBeginUser;
+
+    SolverCtx solver_ctx;
+    LockstepSolver lockstep;
+    DessalData dessal_data;
+    PetscReal *guesses, update[NUM_VAR], norm;
+    PetscLogDouble start, end;
+    PetscInt lanes = path->lanes, iterations, i, k;
+    PetscBool physical;
+
+    PetscOptionsGetInt(NULL, NULL, "-lockstep_lanes", &lanes, NULL);
+
+    SolverCtxBuild(&solver_ctx, entry_data);
+
+    // The baseline is pinned to the unscaled and unbounded SNES solve, whatever the options of the solver
+    if (path == &validation_paths[0])
+    {
+        solver_ctx.bounded = PETSC_FALSE;
+        SNESSetType(solver_ctx.snes, SNESNEWTONLS);
+        SolverCtxSetScaling(&solver_ctx, PETSC_FALSE);
+    }
+
+    SolverCtxSetFormulation(&solver_ctx, path->formulation);
+    solver_ctx.jacobian = path->jacobian;
+    solver_ctx.precision = path->precision;
+
+    PetscMalloc1(num_cases * NUM_VAR, &result->states);
+    PetscMalloc1(num_cases, &result->reasons);
+
+    result->iterations = 0;
+    result->fallbacks = 0;
+
+    if (path->lanes > 0)
+    {
+        PetscCall(LockstepSolverBuild(&lockstep, &solver_ctx, PetscMax(lanes, 1)));
+
+        PetscMalloc1(num_cases * NUM_VAR, &guesses);
+
+        for (i = 0; i < num_cases; i++)
+        {
+            dessal_data = cases[i].dessal_data;
+            DessalDataResetState(&dessal_data);
+            DessalDataGetState(&dessal_data, &guesses[i * NUM_VAR]);
+        }
+
+        PetscTime(&start);
+        PetscCall(PlantSolveCases(&solver_ctx, &lockstep, cases, num_cases, guesses, NULL, result->states, result->reasons));
+        PetscTime(&end);
+
+        PetscFree(guesses);
+
+        result->iterations = lockstep.num_iterations;
+        result->fallbacks = lockstep.num_fallbacks;
+
+        LockstepSolverDestroy(&lockstep);
+    }
+    else
+    {
+        PetscTime(&start);
+
+        for (i = 0; i < num_cases; i++)
+        {
+            PlantSolveCase(&solver_ctx, &cases[i], NULL, &result->states[i * NUM_VAR], &result->reasons[i]);
+
+            SNESGetIterationNumber(solver_ctx.snes, &iterations);
+            result->iterations += iterations;
+        }
+
+        PetscTime(&end);
+    }
+
+    result->time = end - start;
+
+    // The residuals are scaled as in the default solve, and the non-physical roots count as failures
+    solver_ctx.scaling = PETSC_TRUE;
+
+    for (i = 0, result->failures = 0, result->max_residual = 0.0; i < num_cases; i++)
+    {
+        if (result->reasons[i] > 0)
+        {
+            PlantPhysical(&result->states[i * NUM_VAR], &physical);
+
+            if (!physical)
+                result->reasons[i] = SNES_DIVERGED_FUNCTION_DOMAIN;
+        }
+
+        if (result->reasons[i] <= 0)
+        {
+            result->failures++;
+            continue;
+        }
+
+        SolverCtxSetEntryData(&solver_ctx, &cases[i]);
+        DessalContextBalance(&solver_ctx.dessal_ctx, &result->states[i * NUM_VAR], update);
+
+        for (k = 0, norm = 0.0; k < NUM_VAR; k++)
+            norm += PetscSqr((result->states[i * NUM_VAR + k] - update[k]) / solver_ctx.scale[k]);
+
+        result->max_residual = PetscMax(result->max_residual, PetscSqrtReal(norm));
+    }
+
+    SolverCtxDestroy(&solver_ctx);
+
+    return 0;
+}
+
+/*
+Errors against the baseline
+
+The error of a field is its difference with the baseline relative to the magnitude of the baseline value, over the cases both paths solved.
+The cases the baseline fails (or solves to a non-physical root) are dropped from the comparison, as they have no reference solution; a
+case the baseline solved and the path did not counts as a mismatch, which fails the validation whatever the errors.
+*/
+
+PetscErrorCode ValidationFields(const PetscReal state[], DessalData *dessal_data, PetscReal fields[])
+{
+    PetscFunctionBeginUser;
+
+    PlantKPIs kpis;
+    PetscInt i;
+
+    for (i = 0; i < NUM_VAR; i++)
+        fields[i] = state[i];
+
+    ComputeKPIs(state, dessal_data, &kpis);
+    KPIsToArray(&kpis, &fields[NUM_VAR]);
+
+    return 0;
+}
+
+PetscErrorCode ValidationCompare(ValidationResult *result, ValidationResult *baseline, EntryData cases[], PetscInt num_cases)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal fields[NUM_FIELDS], baseline_fields[NUM_FIELDS], error;
+    PetscInt num_compared = 0, i, j;
+
+    result->mismatches = 0;
+
+    for (j = 0; j < NUM_FIELDS; j++)
+    {
+        result->max_error[j] = 0.0;
+        result->mean_error[j] = 0.0;
+    }
+
+    for (i = 0; i < num_cases; i++)
+    {
+        if (baseline->reasons[i] <= 0)
+            continue;
+
+        if (result->reasons[i] <= 0)
+        {
+            result->mismatches++;
+            continue;
+        }
+
+        ValidationFields(&result->states[i * NUM_VAR], &cases[i].dessal_data, fields);
+        ValidationFields(&baseline->states[i * NUM_VAR], &cases[i].dessal_data, baseline_fields);
+
+        for (j = 0; j < NUM_FIELDS; j++)
+        {
+            error = PetscAbsReal(fields[j] - baseline_fields[j]) / PetscMax(PetscAbsReal(baseline_fields[j]), PETSC_SMALL);
+            result->max_error[j] = PetscMax(result->max_error[j], error);
+            result->mean_error[j] += error;
+        }
+
+        num_compared++;
+    }
+
+    for (j = 0; j < NUM_FIELDS; j++)
+        result->mean_error[j] /= PetscMax(num_compared, 1);
+
+    return 0;
+}
+
+/*
+Validation of the fast paths
+
+Every selected path solves the reference corpus, and its errors are compared with the budgets given by -validate_max_error (worst case over
+the corpus) and -validate_mean_error (average over the corpus), field by field. The errors, times and iteration counts are written to the
+results file and summarized on screen; the run fails when any path exceeds a budget or fails a case the baseline solved, so that it can
+gate changes to the solvers.
+*/
+
+PetscErrorCode RunValidation(EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    const PetscInt num_paths = sizeof(validation_paths) / sizeof(validation_paths[0]);
+    ValidationResult results[sizeof(validation_paths) / sizeof(validation_paths[0])];
+    PetscBool selected[sizeof(validation_paths) / sizeof(validation_paths[0])], given, match, passed = PETSC_TRUE, path_passed;
+    PetscReal max_budget = 1e-6, mean_budget = 1e-8, max_error, mean_error;
+    PetscInt num_cases = 128, num_names = num_paths, worst_max, worst_mean, found, i, j, p;
+    char *names[sizeof(validation_paths) / sizeof(validation_paths[0])], file[256] = "./results/validation.csv";
+    EntryData *cases;
+    FILE *fptr;
+
+    PetscOptionsGetInt(NULL, NULL, "-validate_points", &num_cases, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-validate_max_error", &max_budget, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-validate_mean_error", &mean_budget, NULL);
+    PetscOptionsGetStringArray(NULL, NULL, "-validate_paths", names, &num_names, &given);
+
+    PetscCheck(num_cases > 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Number of validation points must be positive");
+
+    // Every fast path by default, the baseline always being solved
+    for (p = 0; p < num_paths; p++)
+        selected[p] = given && p > 0 ? PETSC_FALSE : PETSC_TRUE;
+
+    for (i = 0; given && i < num_names; i++)
+    {
+        for (p = 0, found = -1; p < num_paths; p++)
+        {
+            PetscStrcmp(names[i], validation_paths[p].name, &match);
+            if (match)
+                found = p;
+        }
+
+        PetscCheck(found >= 0, PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown validation path %s", names[i]);
+
+        selected[found] = PETSC_TRUE;
+        PetscFree(names[i]);
+    }
+
+    PetscMalloc1(num_cases, &cases);
+
+    PetscCall(ValidationCorpusBuild(entry_data, num_cases, cases));
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Solving the corpus along each path                                                                                                            //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    for (p = 0; p < num_paths; p++)
+    {
+        if (!selected[p])
+            continue;
+
+        PetscCall(ValidationRunPath(&validation_paths[p], entry_data, cases, num_cases, &results[p]));
+        PetscCall(ValidationCompare(&results[p], &results[0], cases, num_cases));
+
+        PetscCheck(results[0].failures < num_cases, PETSC_COMM_WORLD, PETSC_ERR_NOT_CONVERGED,
+                   "Validation failed: the baseline has no physical solution on the corpus");
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Reporting the errors against the budgets                                                                                                      //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    PetscCall(PetscFOpen(PETSC_COMM_SELF, file, "w", &fptr));
+
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "path,time,speedup,iterations,fallbacks,failures,mismatches,max_residual,statistic");
+    for (j = 0; j < NUM_VAR; j++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", dessal_state_names[j]);
+    for (j = 0; j < NUM_KPI; j++)
+        PetscFPrintf(PETSC_COMM_SELF, fptr, ",%s", kpi_names[j]);
+    PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+
+    PetscPrintf(PETSC_COMM_SELF, "Validation over %d cases (budgets: max relative error %g, mean relative error %g)\n", (int)num_cases,
+                (double)max_budget, (double)mean_budget);
+    if (results[0].failures > 0)
+        PetscPrintf(PETSC_COMM_SELF, "  cases without a physical baseline solution, dropped from the comparison: %d\n",
+                    (int)results[0].failures);
+    PetscPrintf(PETSC_COMM_SELF, "  %-18s %10s %8s %11s %9s %8s %10s %10s %10s %10s  %s\n", "path", "time [s]", "speedup", "iterations",
+                "fallbacks", "failures", "mismatches", "residual", "max error", "mean error", "status");
+
+    for (p = 0; p < num_paths; p++)
+    {
+        if (!selected[p])
+            continue;
+
+        for (j = 0, worst_max = 0, worst_mean = 0; j < NUM_FIELDS; j++)
+        {
+            if (results[p].max_error[j] > results[p].max_error[worst_max])
+                worst_max = j;
+            if (results[p].mean_error[j] > results[p].mean_error[worst_mean])
+                worst_mean = j;
+        }
+
+        max_error = results[p].max_error[worst_max];
+        mean_error = results[p].mean_error[worst_mean];
+        path_passed = results[p].mismatches == 0 && max_error <= max_budget && mean_error <= mean_budget ? PETSC_TRUE : PETSC_FALSE;
+        passed = passed && path_passed ? PETSC_TRUE : PETSC_FALSE;
+
+        PetscPrintf(PETSC_COMM_SELF, "  %-18s %10.4f %8.2f %11lld %9lld %8d %10d %10.3e %10.3e %10.3e  %s\n", validation_paths[p].name,
+                    (double)results[p].time, (double)(results[0].time / PetscMax(results[p].time, PETSC_SMALL)),
+                    (long long)results[p].iterations, (long long)results[p].fallbacks, (int)results[p].failures, (int)results[p].mismatches,
+                    (double)results[p].max_residual, (double)max_error, (double)mean_error, path_passed ? "pass" : "FAIL");
+
+        if (!path_passed && max_error > max_budget)
+            PetscPrintf(PETSC_COMM_SELF, "    worst max error on %s\n",
+                        worst_max < NUM_VAR ? dessal_state_names[worst_max] : kpi_names[worst_max - NUM_VAR]);
+        if (!path_passed && mean_error > mean_budget)
+            PetscPrintf(PETSC_COMM_SELF, "    worst mean error on %s\n",
+                        worst_mean < NUM_VAR ? dessal_state_names[worst_mean] : kpi_names[worst_mean - NUM_VAR]);
+
+        for (i = 0; i < 2; i++)
+        {
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "%s,%.6e,%.6e,%lld,%lld,%d,%d,%.6e,%s", validation_paths[p].name, (double)results[p].time,
+                         (double)(results[0].time / PetscMax(results[p].time, PETSC_SMALL)), (long long)results[p].iterations,
+                         (long long)results[p].fallbacks, (int)results[p].failures, (int)results[p].mismatches, (double)results[p].max_residual,
+                         i ? "mean_error" : "max_error");
+            for (j = 0; j < NUM_FIELDS; j++)
+                PetscFPrintf(PETSC_COMM_SELF, fptr, ",%.6e", (double)(i ? results[p].mean_error[j] : results[p].max_error[j]));
+            PetscFPrintf(PETSC_COMM_SELF, fptr, "\n");
+        }
+
+        PetscFree(results[p].states);
+        PetscFree(results[p].reasons);
+    }
+
+    PetscCall(PetscFClose(PETSC_COMM_SELF, fptr));
+
+    PetscPrintf(PETSC_COMM_SELF, "Results written to %s\n", file);
+
+    PetscFree(cases);
+
+    PetscCheck(passed, PETSC_COMM_WORLD, PETSC_ERR_NOT_CONVERGED, "Validation failed: a fast path exceeds the error budgets or fails cases the "
+               "baseline solved");
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef VALIDATION
+
+#define VALIDATION
+
+#include "../plant/plant.h"
+
+// Number of compared fields: the unknowns of the plant system and the KPIs
+#define NUM_FIELDS (NUM_VAR + NUM_KPI)
+
+// Data structure containing a solution path of the plant: the baseline one, or a fast path to be validated against it
+typedef struct
+{
+    const char *name;
+    PlantFormulation formulation;
+    PlantJacobian jacobian;
+    PetscInt lanes; // Lanes of the lockstep solver (0: one case at a time with SNES, from the default initial guess)
+    PlantPrecision precision;
+} ValidationPath;
+
+// Solution paths, the first one being the baseline
+static const ValidationPath validation_paths[] = {{"baseline", FORMULATION_FULL, JACOBIAN_DEFAULT, 0, PRECISION_DOUBLE},
+                                                  {"reduced", FORMULATION_REDUCED, JACOBIAN_DEFAULT, 0, PRECISION_DOUBLE},
+                                                  {"incremental", FORMULATION_FULL, JACOBIAN_INCREMENTAL, 0, PRECISION_DOUBLE},
+                                                  {"lockstep", FORMULATION_FULL, JACOBIAN_DEFAULT, 8, PRECISION_DOUBLE},
+                                                  {"lockstep_reduced", FORMULATION_REDUCED, JACOBIAN_DEFAULT, 8, PRECISION_DOUBLE},
+                                                  {"lockstep_mixed", FORMULATION_FULL, JACOBIAN_DEFAULT, 8, PRECISION_MIXED}};
+
+// Data structure containing the results of a solution path over the reference corpus, and its errors against the baseline
+typedef struct
+{
+    PetscReal *states;
+    SNESConvergedReason *reasons;
+    PetscLogDouble time;
+    PetscInt64 iterations, fallbacks;
+    PetscInt failures, mismatches;
+    PetscReal max_residual; // Largest scaled residual norm of the double-precision balance at the converged states
+    PetscReal max_error[NUM_FIELDS], mean_error[NUM_FIELDS];
+} ValidationResult;
+
+// Function to build the reference corpus, a fixed low-discrepancy set of operating and design points around the nominal entry data
+PetscErrorCode ValidationCorpusBuild(EntryData *entry_data, PetscInt num_cases, EntryData cases[]);
+
+// Function to solve the reference corpus along a solution path
+PetscErrorCode ValidationRunPath(const ValidationPath *path, EntryData *entry_data, EntryData cases[], PetscInt num_cases,
+                                 ValidationResult *result);
+
+// Function to compare the results of a solution path with the baseline ones, field by field
+PetscErrorCode ValidationCompare(ValidationResult *result, ValidationResult *baseline, EntryData cases[], PetscInt num_cases);
+
+// Function to run the validation of the fast paths against the baseline, failing when their errors exceed the budgets
+PetscErrorCode RunValidation(EntryData *entry_data);
+
+#endif
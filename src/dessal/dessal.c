@@ -1,190 +1,228 @@
-#include "../entrydata/entrydata.h"
-#include "physics.h"
+#include "dessal.h"
 
 /*
-Mass and energy balance in the desalination module
+Invariant terms of the balance of the desalination module
+
+The geometry, the inlet conditions and the membrane data are fixed within an operating point, so the terms built only from them (mass
+velocities in the channels, wall resistance, prefactors of the diffusivities, total pressure in the gap and the salinity-only parts of the
+properties of the coolant and of the distillate film) are computed once per case instead of at every evaluation of the residual.
 */
 
-PetscErrorCode DessalBalance(DessalData *dessal_data)
+PetscErrorCode DessalContextBuild(DessalContext *dessal_ctx, DessalData *dessal_data)
 {
     PetscFunctionBeginUser;
 
-    // Operational, properties, and geometrical data
-    PetscReal feed_mass_flow_rate = dessal_data->feed_mass_flow_rate,
-              cool_mass_flow_rate = dessal_data->cool_mass_flow_rate,
-              entry_temperature_feed = dessal_data->entry_temperature_feed,
-              entry_temperature_cool = dessal_data->entry_temperature_cool,
-              entry_salinity_feed = dessal_data->entry_salinity_feed,
-              entry_salinity_cool = dessal_data->entry_salinity_cool,
-              vacuum_pressure = dessal_data->vacuum_pressure,
-              membrane_area = dessal_data->membrane_area,
-              membrane_thickness = dessal_data->membrane_thickness,
-              membrane_porosity = dessal_data->membrane_porosity,
-              pore_diameter = dessal_data->pore_diameter,
-              feed_channel_height = dessal_data->feed_channel_height,
-              cool_channel_height = dessal_data->cool_channel_height,
-              channel_width = dessal_data->channel_width,
-              spacer_porosity = dessal_data->spacer_porosity,
-              gap_spacer_porosity = dessal_data->gap_spacer_porosity,
-              air_gap_thickness = dessal_data->air_gap_thickness,
-              wall_thickness = dessal_data->wall_thickness,
-              polymer_conductivity = dessal_data->polymer_conductivity,
-              spacer_conductivity = dessal_data->spacer_conductivity,
-              wall_conductivity = dessal_data->wall_conductivity;
-    PetscInt number_channels = dessal_data->number_channels;
-
-    // Iterative data
-    PetscReal out_temperature_feed = dessal_data->out_temperature_feed,
-              out_temperature_cool = dessal_data->out_temperature_cool,
-              feed_membrane_temperature = dessal_data->feed_membrane_temperature,
-              gap_membrane_temperature = dessal_data->gap_membrane_temperature,
-              film_boundary_temperature = dessal_data->film_boundary_temperature,
-              film_wall_temperature = dessal_data->film_wall_temperature,
-              cool_wall_temperature = dessal_data->cool_wall_temperature,
-              out_salinity_feed = dessal_data->out_salinity_feed,
-              mass_flux = dessal_data->mass_flux,
-              heat_flux = dessal_data->heat_flux,
-              vapor_heat_flux = dessal_data->vapor_heat_flux,
-              feed_outflow_rate = dessal_data->feed_outflow_rate;
-
-    // Feed
-    SaltWaterProperties feed_prop, feed_memb_prop;
-    PetscReal feed_resistance, feed_heat_transf_coef;
-    PetscReal avg_feed_temperature = 0.5 * (entry_temperature_feed + out_temperature_feed),
-              avg_feed_salinity = 0.5 * (entry_salinity_feed + out_salinity_feed);
-
-    SaltWaterPropBuild(&feed_prop, avg_feed_temperature, avg_feed_salinity);
-    SaltWaterPropBuild(&feed_memb_prop, feed_membrane_temperature, avg_feed_salinity);
-
-    feed_heat_transf_coef = ChannelHeatTransfCoef(&feed_prop,
-                                                  &feed_memb_prop,
-                                                  feed_mass_flow_rate,
-                                                  feed_channel_height,
-                                                  channel_width,
-                                                  number_channels,
-                                                  spacer_porosity);
-    feed_resistance = 1.0 / feed_heat_transf_coef;
-
-    // Heat conduction in the membrane
-    MoistAirProperties pore_air_prop;
-    PetscReal membrane_resistance, membrane_conductivity;
-
-    MoistAirPropBuild(&pore_air_prop, 0.5 * (feed_membrane_temperature + gap_membrane_temperature));
-
-    membrane_conductivity = MembraneConductivity(&pore_air_prop, polymer_conductivity, membrane_porosity);
-    membrane_resistance = membrane_thickness / membrane_conductivity;
-
-    // Heat conduction in the distillate film
-    SaltWaterProperties film_prop;
-    PetscReal film_resistance;
-    PetscReal effective_conductivity;
-    PetscReal film_thickness = 0.6e-3; // 1.44e-4; // WEIRD!!! Change in the future!
-
-    SaltWaterPropBuild(&film_prop, film_boundary_temperature, 0.0);
-
-    effective_conductivity = gap_spacer_porosity * film_prop.thermal_conductivity + (1.0 - gap_spacer_porosity) * spacer_conductivity;
-
-    film_resistance = film_thickness / effective_conductivity;
-
-    // Heat conduction in the air gap
-    MoistAirProperties gap_air_prop;
-    PetscReal gap_resistance;
-
-    MoistAirPropBuild(&gap_air_prop, 0.5 * (gap_membrane_temperature + film_boundary_temperature));
-
-    effective_conductivity = gap_spacer_porosity * gap_air_prop.thermal_conductivity + (1.0 - gap_spacer_porosity) * spacer_conductivity;
-
-    gap_resistance = PetscMax(0.0, air_gap_thickness - film_thickness) / effective_conductivity;
-
-    // Mass flux in the air gap
-    PetscReal latent_resistance;
-
-    mass_flux = MassFlux(membrane_porosity,
-                         membrane_tortuosity,
-                         membrane_thickness,
-                         pore_diameter,
-                         gap_spacer_porosity,
-                         air_gap_thickness,
-                         0.5 * (feed_membrane_temperature + gap_membrane_temperature),
-                         0.5 * (gap_membrane_temperature + film_boundary_temperature),
-                         feed_memb_prop.vapor_pressure,
-                         film_prop.vapor_pressure,
-                         vacuum_pressure);
-
-    vapor_heat_flux = mass_flux * feed_memb_prop.latent_heat_vaporization;
-
-    latent_resistance = (feed_membrane_temperature - film_boundary_temperature) / vapor_heat_flux;
-
-    // Heat conduction in the wall
-    PetscReal wall_resistance;
-
-    wall_resistance = wall_thickness / wall_conductivity;
-
-    // Coolant
-    SaltWaterProperties cool_prop, cool_wall_prop;
-    PetscReal cool_resistance, cool_heat_transf_coef;
-    PetscReal avg_cool_temperature = 0.5 * (entry_temperature_cool + out_temperature_cool);
-
-    SaltWaterPropBuild(&cool_prop, avg_cool_temperature, entry_salinity_cool);
-    SaltWaterPropBuild(&cool_wall_prop, cool_wall_temperature, entry_salinity_cool);
-
-    cool_heat_transf_coef = ChannelHeatTransfCoef(&cool_prop,
-                                                  &cool_wall_prop,
-                                                  cool_mass_flow_rate,
-                                                  cool_channel_height,
-                                                  channel_width,
-                                                  number_channels,
-                                                  spacer_porosity);
-    cool_resistance = 1.0 / cool_heat_transf_coef;
-
-    // Calculating the total heat flux
-    PetscReal equiv_resistance;
+    PetscReal film_thickness = dessal_data->film_thickness;
+
+    dessal_ctx->feed_mass_flow_rate = dessal_data->feed_mass_flow_rate;
+    dessal_ctx->cool_mass_flow_rate = dessal_data->cool_mass_flow_rate;
+    dessal_ctx->entry_temperature_feed = dessal_data->entry_temperature_feed;
+    dessal_ctx->entry_temperature_cool = dessal_data->entry_temperature_cool;
+    dessal_ctx->entry_salinity_feed = dessal_data->entry_salinity_feed;
+    dessal_ctx->membrane_area = dessal_data->membrane_area;
+
+    dessal_ctx->feed_mass_velocity = ChannelMassVelocity(dessal_data->feed_mass_flow_rate,
+                                                         dessal_data->feed_channel_height,
+                                                         dessal_data->channel_width,
+                                                         dessal_data->number_channels,
+                                                         dessal_data->spacer_porosity);
+    dessal_ctx->cool_mass_velocity = ChannelMassVelocity(dessal_data->cool_mass_flow_rate,
+                                                         dessal_data->cool_channel_height,
+                                                         dessal_data->channel_width,
+                                                         dessal_data->number_channels,
+                                                         dessal_data->spacer_porosity);
+    dessal_ctx->feed_channel_height = dessal_data->feed_channel_height;
+    dessal_ctx->cool_channel_height = dessal_data->cool_channel_height;
+
+    dessal_ctx->membrane_thickness = dessal_data->membrane_thickness;
+    dessal_ctx->polymer_conductivity = dessal_data->polymer_conductivity;
+    dessal_ctx->membrane_porosity = dessal_data->membrane_porosity;
+    dessal_ctx->gap_spacer_porosity = dessal_data->gap_spacer_porosity;
+    dessal_ctx->spacer_conductivity_term = (1.0 - dessal_data->gap_spacer_porosity) * dessal_data->spacer_conductivity;
+    dessal_ctx->film_thickness = film_thickness;
+    dessal_ctx->gap_thickness = PetscMax(0.0, dessal_data->air_gap_thickness - film_thickness);
+    dessal_ctx->wall_resistance = dessal_data->wall_thickness / dessal_data->wall_conductivity;
+
+    MassFluxCoefsBuild(&dessal_ctx->mass_flux_coefs,
+                       dessal_data->membrane_porosity,
+                       dessal_data->membrane_tortuosity,
+                       dessal_data->membrane_thickness,
+                       dessal_data->pore_diameter,
+                       dessal_data->air_gap_thickness,
+                       dessal_data->vacuum_pressure);
+
+    SaltWaterSalinityTermsBuild(&dessal_ctx->cool_terms, dessal_data->entry_salinity_cool);
+    SaltWaterSalinityTermsBuild(&dessal_ctx->film_terms, 0.0);
+    SaltWaterSalinityTermsBuildSingle(&dessal_ctx->cool_terms_single, (float)dessal_data->entry_salinity_cool);
+    SaltWaterSalinityTermsBuildSingle(&dessal_ctx->film_terms_single, 0.0f);
 
-    equiv_resistance = latent_resistance * (membrane_resistance + gap_resistance) / (latent_resistance + gap_resistance + membrane_resistance);
-    equiv_resistance += feed_resistance + film_resistance + wall_resistance + cool_resistance;
+    return 0;
+}
+
+// Balance in double precision, then in single precision
+#include "../properties/precision.h"
+#include "dessal_body.h"
+
+#define SINGLE_PRECISION
+#include "../properties/precision.h"
+#include "dessal_body.h"
+#undef SINGLE_PRECISION
+
+/*
+One-pass screening model of the desalination module
+
+A low-fidelity estimate for discarding design candidates before solving them. The nodes of the balance (properties, resistances and mass
+flux) are evaluated once at reference temperatures built from the inlets: the feed side a sixteenth of the inlet temperature difference
+above the mean inlet temperature, and the coolant side (film, wall and coolant) the same amount below it, at the inlet salinity (the
+channels exchange most of the inlet difference, so that the two sides of the gap end up close to the mean temperature). The resistance
+network is then applied in a single explicit pass: with the resistances frozen, the heat flux and the outlet temperatures satisfy the linear
+relations q = (T_feed,avg - T_cool,avg) / R_eq and T_out = T_in -/+ q * area / (flow rate * cp), closed in one step as
+q = (T_feed,in - T_cool,in) / (R_eq + area / (2 * m_feed * cp_feed) + area / (2 * m_cool * cp_cool)), and the vapor heat flux is the
+share of q through the latent branch of the membrane and the gap. Its errors come from the properties at the reference temperatures and
+from the latent branch, linearized at the reference state into a resistance although the vapor pressure difference driving it is strongly
+nonlinear in the temperatures; they are bounded by calibration against the full solver, not by construction.
+*/
 
-    heat_flux = (avg_feed_temperature - avg_cool_temperature) / equiv_resistance;
+PetscErrorCode DessalContextScreening(const DessalContext *dessal_ctx, PetscReal state[])
+{
+    PetscFunctionBeginUser;
 
-    // Calculating the temperature at the interface between the feed and the membrane
-    feed_membrane_temperature = avg_feed_temperature - heat_flux * feed_resistance;
+    PetscReal entry_temperature_feed = dessal_ctx->entry_temperature_feed,
+              entry_temperature_cool = dessal_ctx->entry_temperature_cool,
+              feed_mass_flow_rate = dessal_ctx->feed_mass_flow_rate,
+              membrane_area = dessal_ctx->membrane_area;
+    PetscReal mean_temperature = (feed_mass_flow_rate * entry_temperature_feed + dessal_ctx->cool_mass_flow_rate * entry_temperature_cool) /
+                                 (feed_mass_flow_rate + dessal_ctx->cool_mass_flow_rate),
+              spread = 0.0625 * (entry_temperature_feed - entry_temperature_cool);
+    PetscReal reference[NUM_DESSAL_STATE], update[NUM_DESSAL_STATE];
+    DessalCache cache;
+    PetscInt k;
+
+    // Reference state, with the average temperatures of the channels at the reference ones
+    for (k = 0; k < NUM_DESSAL_STATE; k++)
+        reference[k] = 0.0;
+
+    reference[0] = 2.0 * (mean_temperature + spread) - entry_temperature_feed;
+    reference[1] = 2.0 * (mean_temperature - spread) - entry_temperature_cool;
+    reference[2] = mean_temperature + spread;
+    reference[3] = mean_temperature + spread;
+    reference[4] = mean_temperature - spread;
+    reference[5] = mean_temperature - spread;
+    reference[6] = mean_temperature - spread;
+    reference[7] = dessal_ctx->entry_salinity_feed;
+
+    cache.valid = PETSC_FALSE;
+
+    DessalContextBalanceCached(dessal_ctx, &cache, reference, update);
+
+    // Resistance network frozen at the reference state
+    PetscReal feed_resistance = cache.feed_resistance,
+              membrane_resistance = cache.membrane_resistance,
+              film_resistance = cache.film_resistance,
+              gap_resistance = cache.gap_resistance,
+              wall_resistance = dessal_ctx->wall_resistance,
+              cool_resistance = cache.cool_resistance;
+    PetscReal latent_resistance, latent_share, equiv_resistance, feed_capacity, cool_capacity;
+
+    if (update[10] > 0.0)
+    {
+        latent_resistance = (reference[2] - reference[4]) / update[10];
+        latent_share = (membrane_resistance + gap_resistance) / (latent_resistance + gap_resistance + membrane_resistance);
+        equiv_resistance = latent_resistance * latent_share;
+    }
+    else
+    {
+        latent_share = 0.0;
+        equiv_resistance = membrane_resistance + gap_resistance;
+    }
 
-    // Calculating the temperature at the interface between the feed and the air gap
-    gap_membrane_temperature = feed_membrane_temperature - membrane_resistance * (heat_flux - vapor_heat_flux);
+    equiv_resistance += feed_resistance + film_resistance + wall_resistance + cool_resistance;
 
-    // Calculating the temperature at the interface between the wall and the coolant
-    cool_wall_temperature = avg_cool_temperature + heat_flux * cool_resistance;
+    feed_capacity = feed_mass_flow_rate * cache.feed_prop.specific_heat / membrane_area;
+    cool_capacity = dessal_ctx->cool_mass_flow_rate * cache.cool_prop.specific_heat / membrane_area;
 
-    // Calculating the temperature at the interface between the wall and the distillate film
-    film_wall_temperature = cool_wall_temperature + heat_flux * wall_resistance;
+    // Explicit pass
+    PetscReal heat_flux, vapor_heat_flux, mass_flux, avg_feed_temperature, avg_cool_temperature, feed_outflow_rate;
 
-    // Calculating the temperature at the interface between the gap and the distillate film
-    film_boundary_temperature = film_wall_temperature + heat_flux * film_resistance;
+    heat_flux = (entry_temperature_feed - entry_temperature_cool) / (equiv_resistance + 0.5 / feed_capacity + 0.5 / cool_capacity);
+    vapor_heat_flux = latent_share * heat_flux;
+    mass_flux = vapor_heat_flux / cache.feed_memb_prop.latent_heat_vaporization;
 
-    // Calculating the mass outflow rate in the feed side
+    avg_feed_temperature = entry_temperature_feed - 0.5 * heat_flux / feed_capacity;
+    avg_cool_temperature = entry_temperature_cool + 0.5 * heat_flux / cool_capacity;
     feed_outflow_rate = feed_mass_flow_rate - mass_flux * membrane_area;
 
-    // Calculating the salinity of the feed at the outlet
-    out_salinity_feed = entry_salinity_feed * feed_mass_flow_rate / feed_outflow_rate;
-
-    // Calculating the temperature of the feed at the outlet
-    out_temperature_feed = entry_temperature_feed - heat_flux * membrane_area / (feed_mass_flow_rate * feed_prop.specific_heat);
-
-    // Calculating the temperature of the coolant at the outlet
-    out_temperature_cool = entry_temperature_cool + heat_flux * membrane_area / (cool_mass_flow_rate * cool_prop.specific_heat);
-
-    // Updating the iterative data
-    dessal_data->out_temperature_feed = out_temperature_feed;
-    dessal_data->out_temperature_cool = out_temperature_cool;
-    dessal_data->feed_membrane_temperature = feed_membrane_temperature;
-    dessal_data->gap_membrane_temperature = gap_membrane_temperature;
-    dessal_data->film_boundary_temperature = film_boundary_temperature;
-    dessal_data->film_wall_temperature = film_wall_temperature;
-    dessal_data->cool_wall_temperature = cool_wall_temperature;
-    dessal_data->out_salinity_feed = out_salinity_feed;
-    dessal_data->mass_flux = mass_flux;
-    dessal_data->heat_flux = heat_flux;
-    dessal_data->vapor_heat_flux = vapor_heat_flux;
-    dessal_data->feed_outflow_rate = feed_outflow_rate;
+    state[0] = entry_temperature_feed - heat_flux / feed_capacity;
+    state[1] = entry_temperature_cool + heat_flux / cool_capacity;
+    state[2] = avg_feed_temperature - heat_flux * feed_resistance;
+    state[3] = state[2] - membrane_resistance * (heat_flux - vapor_heat_flux);
+    state[6] = avg_cool_temperature + heat_flux * cool_resistance;
+    state[5] = state[6] + heat_flux * wall_resistance;
+    state[4] = state[5] + heat_flux * film_resistance;
+    state[7] = dessal_ctx->entry_salinity_feed * feed_mass_flow_rate / feed_outflow_rate;
+    state[8] = mass_flux;
+    state[9] = heat_flux;
+    state[10] = vapor_heat_flux;
+    state[11] = feed_outflow_rate;
+
+    return 0;
+}
+
+PetscErrorCode DessalBalance(DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    DessalContext dessal_ctx;
+    PetscReal state[NUM_DESSAL_STATE], update[NUM_DESSAL_STATE];
+
+    DessalContextBuild(&dessal_ctx, dessal_data);
+    DessalDataGetState(dessal_data, state);
+    DessalContextBalance(&dessal_ctx, state, update);
+    DessalDataSetState(dessal_data, update);
+
+    return 0;
+}
+
+/*
+Mapping between the iterative data of the desalination module and the array of unknowns of the plant system
+*/
+
+PetscErrorCode DessalDataGetState(DessalData *dessal_data, PetscReal state[])
+{
+    PetscFunctionBeginUser;
+
+    state[0] = dessal_data->out_temperature_feed;
+    state[1] = dessal_data->out_temperature_cool;
+    state[2] = dessal_data->feed_membrane_temperature;
+    state[3] = dessal_data->gap_membrane_temperature;
+    state[4] = dessal_data->film_boundary_temperature;
+    state[5] = dessal_data->film_wall_temperature;
+    state[6] = dessal_data->cool_wall_temperature;
+    state[7] = dessal_data->out_salinity_feed;
+    state[8] = dessal_data->mass_flux;
+    state[9] = dessal_data->heat_flux;
+    state[10] = dessal_data->vapor_heat_flux;
+    state[11] = dessal_data->feed_outflow_rate;
+
+    return 0;
+}
+
+PetscErrorCode DessalDataSetState(DessalData *dessal_data, const PetscReal state[])
+{
+    PetscFunctionBeginUser;
+
+    dessal_data->out_temperature_feed = state[0];
+    dessal_data->out_temperature_cool = state[1];
+    dessal_data->feed_membrane_temperature = state[2];
+    dessal_data->gap_membrane_temperature = state[3];
+    dessal_data->film_boundary_temperature = state[4];
+    dessal_data->film_wall_temperature = state[5];
+    dessal_data->cool_wall_temperature = state[6];
+    dessal_data->out_salinity_feed = state[7];
+    dessal_data->mass_flux = state[8];
+    dessal_data->heat_flux = state[9];
+    dessal_data->vapor_heat_flux = state[10];
+    dessal_data->feed_outflow_rate = state[11];
 
     return 0;
 }
\ No newline at end of file
@@ -3,8 +3,116 @@
 #define DESSAL
 
 #include "../entrydata/entrydata.h"
+#include "physics.h"
+
+// Number of iterative data of the desalination module
+#define NUM_DESSAL_STATE 12
+
+// Names of the iterative data of the desalination module, in the order of the array of unknowns
+static const char *const dessal_state_names[] = {"out_temperature_feed", "out_temperature_cool", "feed_membrane_temperature",
+                                                 "gap_membrane_temperature", "film_boundary_temperature", "film_wall_temperature",
+                                                 "cool_wall_temperature", "out_salinity_feed", "mass_flux", "heat_flux", "vapor_heat_flux",
+                                                 "feed_outflow_rate"};
+
+// Data structure containing the terms of the balance of the desalination module that do not change within an operating point
+typedef struct
+{
+    // Operational data
+    PetscReal feed_mass_flow_rate, cool_mass_flow_rate, entry_temperature_feed, entry_temperature_cool, entry_salinity_feed, membrane_area;
+
+    // Channels
+    PetscReal feed_mass_velocity, cool_mass_velocity, feed_channel_height, cool_channel_height;
+
+    // Conduction across the membrane, the distillate film, the air gap and the wall
+    PetscReal membrane_thickness, polymer_conductivity, membrane_porosity, gap_spacer_porosity, spacer_conductivity_term,
+              film_thickness, gap_thickness, wall_resistance;
+
+    // Mass transfer
+    MassFluxCoefs mass_flux_coefs;
+
+    // Salinity-only terms of the properties of the coolant and of the distillate film
+    SaltWaterSalinityTerms cool_terms, film_terms;
+    SaltWaterSalinityTermsSingle cool_terms_single, film_terms_single;
+} DessalContext;
+
+// Nodes of the dependency graph of the balance of the desalination module, i.e. its cached subexpressions, in evaluation order
+typedef enum
+{
+    DESSAL_NODE_FEED_TERMS,      // Salinity-only terms of the properties of the feed
+    DESSAL_NODE_FEED_PROP,       // Properties of the feed at its average temperature
+    DESSAL_NODE_FEED_MEMB_PROP,  // Properties of the feed at the membrane
+    DESSAL_NODE_FEED_RESISTANCE, // Convective resistance of the feed channel
+    DESSAL_NODE_MEMBRANE,        // Conductive resistance of the membrane
+    DESSAL_NODE_FILM,            // Properties and conductive resistance of the distillate film
+    DESSAL_NODE_GAP,             // Conductive resistance of the air gap
+    DESSAL_NODE_MASS_FLUX,       // Mass flux across the membrane and the air gap
+    DESSAL_NODE_COOL_PROP,       // Properties of the coolant at its average temperature
+    DESSAL_NODE_COOL_WALL_PROP,  // Properties of the coolant at the wall
+    DESSAL_NODE_COOL_RESISTANCE, // Convective resistance of the coolant channel
+    NUM_DESSAL_NODES
+} DessalNode;
+
+// Unknowns read by each node (bit k for the unknown k), including through the nodes it is built from
+static const PetscInt dessal_node_unknowns[] = {1 << 7,
+                                                1 << 0 | 1 << 7,
+                                                1 << 2 | 1 << 7,
+                                                1 << 0 | 1 << 2 | 1 << 7,
+                                                1 << 2 | 1 << 3,
+                                                1 << 4,
+                                                1 << 3 | 1 << 4,
+                                                1 << 2 | 1 << 3 | 1 << 4 | 1 << 7,
+                                                1 << 1,
+                                                1 << 6,
+                                                1 << 1 | 1 << 6};
+
+// Data structure containing the nodes of the balance of the desalination module, cached along with the unknowns they were evaluated at
+typedef struct
+{
+    PetscBool valid;
+    PetscReal state[NUM_DESSAL_STATE];
+    SaltWaterSalinityTerms feed_terms;
+    SaltWaterProperties feed_prop, feed_memb_prop, film_prop, cool_prop, cool_wall_prop;
+    PetscReal feed_resistance, membrane_resistance, film_resistance, gap_resistance, mass_flux, cool_resistance;
+} DessalCache;
+
+// Data structure containing the nodes of the balance of the desalination module in single precision (the unknowns they were evaluated at
+// are kept in double precision)
+typedef struct
+{
+    PetscBool valid;
+    PetscReal state[NUM_DESSAL_STATE];
+    SaltWaterSalinityTermsSingle feed_terms;
+    SaltWaterPropertiesSingle feed_prop, feed_memb_prop, film_prop, cool_prop, cool_wall_prop;
+    float feed_resistance, membrane_resistance, film_resistance, gap_resistance, mass_flux, cool_resistance;
+} DessalCacheSingle;
+
+// Function to compute the invariant terms of the balance of the desalination module from its entry data
+PetscErrorCode DessalContextBuild(DessalContext *dessal_ctx, DessalData *dessal_data);
+
+// Function to execute the balance within the desalination module, mapping an array of unknowns to its update
+PetscErrorCode DessalContextBalance(const DessalContext *dessal_ctx, const PetscReal state[], PetscReal update[]);
+
+// Function to execute the balance within the desalination module, recomputing only the nodes of a cache (which is then updated) that read
+// an unknown changed since its last evaluation; an invalid cache (valid set to false) is fully recomputed
+PetscErrorCode DessalContextBalanceCached(const DessalContext *dessal_ctx, DessalCache *cache, const PetscReal state[], PetscReal update[]);
+
+// Functions to execute the balance within the desalination module in single precision, as their double-precision counterparts, the
+// unknowns and their update being rounded to and from single precision at the interface
+PetscErrorCode DessalContextBalanceSingle(const DessalContext *dessal_ctx, const PetscReal state[], PetscReal update[]);
+PetscErrorCode DessalContextBalanceCachedSingle(const DessalContext *dessal_ctx, DessalCacheSingle *cache, const PetscReal state[],
+                                                PetscReal update[]);
+
+// Function to approximate the solution of the balance within the desalination module in one explicit pass, with the properties and
+// resistances evaluated once at reference temperatures built from the inlets (low-fidelity screening model)
+PetscErrorCode DessalContextScreening(const DessalContext *dessal_ctx, PetscReal state[]);
 
 // Function to execute the balance within the desalination module
 PetscErrorCode DessalBalance(DessalData *dessal_data);
 
+// Function to copy the iterative data of the desalination module into an array of unknowns
+PetscErrorCode DessalDataGetState(DessalData *dessal_data, PetscReal state[]);
+
+// Function to copy an array of unknowns into the iterative data of the desalination module
+PetscErrorCode DessalDataSetState(DessalData *dessal_data, const PetscReal state[]);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+Mass and energy balance in the desalination module
+
+The balance is a dependency graph of cached subexpressions (properties, resistances and the mass flux), each node reading a declared subset
+of the unknowns. When the cache holds the nodes of a previous evaluation, only those reading an unknown that changed since are recomputed,
+so that a finite-difference Jacobian, which perturbs one unknown at a time, pays for the nodes of that unknown only. The final assembly of
+the fluxes and temperatures is cheap and always evaluated. The cache belongs to one context and must be invalidated when it is rebuilt.
+
+This body is compiled once per precision by dessal.c (see ../properties/precision.h). The unknowns and their update stay in double
+precision at the interface, and the terms of the context are rounded when read.
+*/
+
+PetscErrorCode REAL_NAME(DessalContextBalance)(const DessalContext *dessal_ctx, const PetscReal state[], PetscReal update[])
+{
+    PetscFunctionBeginUser;
+
+    REAL_NAME(DessalCache) cache;
+
+    cache.valid = PETSC_FALSE;
+
+    REAL_NAME(DessalContextBalanceCached)(dessal_ctx, &cache, state, update);
+
+    return 0;
+}
+
+PetscErrorCode REAL_NAME(DessalContextBalanceCached)(const DessalContext *dessal_ctx, REAL_NAME(DessalCache) *cache, const PetscReal state[],
+                                                     PetscReal update[])
+{
+    PetscFunctionBeginUser;
+
+    // Operational data
+    REAL feed_mass_flow_rate = (REAL)dessal_ctx->feed_mass_flow_rate,
+         cool_mass_flow_rate = (REAL)dessal_ctx->cool_mass_flow_rate,
+         entry_temperature_feed = (REAL)dessal_ctx->entry_temperature_feed,
+         entry_temperature_cool = (REAL)dessal_ctx->entry_temperature_cool,
+         entry_salinity_feed = (REAL)dessal_ctx->entry_salinity_feed,
+         membrane_area = (REAL)dessal_ctx->membrane_area,
+         gap_spacer_porosity = (REAL)dessal_ctx->gap_spacer_porosity;
+
+    // Iterative data (the remaining unknowns are explicit assignments of the balance)
+    REAL out_temperature_feed = (REAL)state[0],
+         out_temperature_cool = (REAL)state[1],
+         feed_membrane_temperature = (REAL)state[2],
+         gap_membrane_temperature = (REAL)state[3],
+         film_boundary_temperature = (REAL)state[4],
+         cool_wall_temperature = (REAL)state[6],
+         out_salinity_feed = (REAL)state[7];
+    REAL film_wall_temperature, mass_flux, heat_flux, vapor_heat_flux, feed_outflow_rate;
+
+    // Nodes reading an unknown that changed since the cached evaluation (all of them if the cache is invalid)
+    PetscBool stale[NUM_DESSAL_NODES];
+    PetscInt changed = 0, k;
+
+    for (k = 0; k < NUM_DESSAL_STATE; k++)
+        if (!cache->valid || state[k] != cache->state[k])
+            changed |= 1 << k;
+
+    for (k = 0; k < NUM_DESSAL_NODES; k++)
+        stale[k] = dessal_node_unknowns[k] & changed ? PETSC_TRUE : PETSC_FALSE;
+
+    // Feed
+    REAL avg_feed_temperature = REAL_C(0.5) * (entry_temperature_feed + out_temperature_feed),
+         avg_feed_salinity = REAL_C(0.5) * (entry_salinity_feed + out_salinity_feed);
+
+    if (stale[DESSAL_NODE_FEED_TERMS])
+        REAL_NAME(SaltWaterSalinityTermsBuild)(&cache->feed_terms, avg_feed_salinity);
+    if (stale[DESSAL_NODE_FEED_PROP])
+        REAL_NAME(SaltWaterPropBuildFromTerms)(&cache->feed_prop, avg_feed_temperature, &cache->feed_terms);
+    if (stale[DESSAL_NODE_FEED_MEMB_PROP])
+        REAL_NAME(SaltWaterPropBuildFromTerms)(&cache->feed_memb_prop, feed_membrane_temperature, &cache->feed_terms);
+
+    if (stale[DESSAL_NODE_FEED_RESISTANCE])
+        cache->feed_resistance = REAL_C(1.0) / REAL_NAME(ChannelHeatTransfCoef)(&cache->feed_prop,
+                                                                                &cache->feed_memb_prop,
+                                                                                (REAL)dessal_ctx->feed_mass_velocity,
+                                                                                (REAL)dessal_ctx->feed_channel_height);
+
+    // Heat conduction in the membrane
+    REAL_NAME(MoistAirProperties) pore_air_prop;
+    REAL membrane_conductivity;
+
+    if (stale[DESSAL_NODE_MEMBRANE])
+    {
+        REAL_NAME(MoistAirPropBuild)(&pore_air_prop, REAL_C(0.5) * (feed_membrane_temperature + gap_membrane_temperature));
+
+        membrane_conductivity = REAL_NAME(MembraneConductivity)(&pore_air_prop,
+                                                                (REAL)dessal_ctx->polymer_conductivity,
+                                                                (REAL)dessal_ctx->membrane_porosity);
+        cache->membrane_resistance = (REAL)dessal_ctx->membrane_thickness / membrane_conductivity;
+    }
+
+    // Heat conduction in the distillate film
+    REAL effective_conductivity;
+
+    if (stale[DESSAL_NODE_FILM])
+    {
+        REAL_NAME(SaltWaterPropBuildFromTerms)(&cache->film_prop, film_boundary_temperature, &dessal_ctx->REAL_FIELD(film_terms));
+
+        effective_conductivity = gap_spacer_porosity * cache->film_prop.thermal_conductivity + (REAL)dessal_ctx->spacer_conductivity_term;
+
+        cache->film_resistance = (REAL)dessal_ctx->film_thickness / effective_conductivity;
+    }
+
+    // Heat conduction in the air gap
+    REAL_NAME(MoistAirProperties) gap_air_prop;
+
+    if (stale[DESSAL_NODE_GAP])
+    {
+        REAL_NAME(MoistAirPropBuild)(&gap_air_prop, REAL_C(0.5) * (gap_membrane_temperature + film_boundary_temperature));
+
+        effective_conductivity = gap_spacer_porosity * gap_air_prop.thermal_conductivity + (REAL)dessal_ctx->spacer_conductivity_term;
+
+        cache->gap_resistance = (REAL)dessal_ctx->gap_thickness / effective_conductivity;
+    }
+
+    // Mass flux in the air gap
+    REAL latent_resistance;
+
+    if (stale[DESSAL_NODE_MASS_FLUX])
+        cache->mass_flux = REAL_NAME(MassFlux)(&dessal_ctx->mass_flux_coefs,
+                                               REAL_C(0.5) * (feed_membrane_temperature + gap_membrane_temperature),
+                                               REAL_C(0.5) * (gap_membrane_temperature + film_boundary_temperature),
+                                               cache->feed_memb_prop.vapor_pressure,
+                                               cache->film_prop.vapor_pressure);
+
+    mass_flux = cache->mass_flux;
+
+    vapor_heat_flux = mass_flux * cache->feed_memb_prop.latent_heat_vaporization;
+
+    latent_resistance = (feed_membrane_temperature - film_boundary_temperature) / vapor_heat_flux;
+
+    // Heat conduction in the wall
+    REAL wall_resistance = (REAL)dessal_ctx->wall_resistance;
+
+    // Coolant
+    REAL avg_cool_temperature = REAL_C(0.5) * (entry_temperature_cool + out_temperature_cool);
+
+    if (stale[DESSAL_NODE_COOL_PROP])
+        REAL_NAME(SaltWaterPropBuildFromTerms)(&cache->cool_prop, avg_cool_temperature, &dessal_ctx->REAL_FIELD(cool_terms));
+    if (stale[DESSAL_NODE_COOL_WALL_PROP])
+        REAL_NAME(SaltWaterPropBuildFromTerms)(&cache->cool_wall_prop, cool_wall_temperature, &dessal_ctx->REAL_FIELD(cool_terms));
+
+    if (stale[DESSAL_NODE_COOL_RESISTANCE])
+        cache->cool_resistance = REAL_C(1.0) / REAL_NAME(ChannelHeatTransfCoef)(&cache->cool_prop,
+                                                                                &cache->cool_wall_prop,
+                                                                                (REAL)dessal_ctx->cool_mass_velocity,
+                                                                                (REAL)dessal_ctx->cool_channel_height);
+
+    for (k = 0; k < NUM_DESSAL_STATE; k++)
+        cache->state[k] = state[k];
+
+    cache->valid = PETSC_TRUE;
+
+    REAL feed_resistance = cache->feed_resistance,
+         membrane_resistance = cache->membrane_resistance,
+         film_resistance = cache->film_resistance,
+         gap_resistance = cache->gap_resistance,
+         cool_resistance = cache->cool_resistance;
+
+    // Calculating the total heat flux
+    REAL equiv_resistance;
+
+    equiv_resistance = latent_resistance * (membrane_resistance + gap_resistance) / (latent_resistance + gap_resistance + membrane_resistance);
+    equiv_resistance += feed_resistance + film_resistance + wall_resistance + cool_resistance;
+
+    heat_flux = (avg_feed_temperature - avg_cool_temperature) / equiv_resistance;
+
+    // Calculating the temperature at the interface between the feed and the membrane
+    feed_membrane_temperature = avg_feed_temperature - heat_flux * feed_resistance;
+
+    // Calculating the temperature at the interface between the feed and the air gap
+    gap_membrane_temperature = feed_membrane_temperature - membrane_resistance * (heat_flux - vapor_heat_flux);
+
+    // Calculating the temperature at the interface between the wall and the coolant
+    cool_wall_temperature = avg_cool_temperature + heat_flux * cool_resistance;
+
+    // Calculating the temperature at the interface between the wall and the distillate film
+    film_wall_temperature = cool_wall_temperature + heat_flux * wall_resistance;
+
+    // Calculating the temperature at the interface between the gap and the distillate film
+    film_boundary_temperature = film_wall_temperature + heat_flux * film_resistance;
+
+    // Calculating the mass outflow rate in the feed side
+    feed_outflow_rate = feed_mass_flow_rate - mass_flux * membrane_area;
+
+    // Calculating the salinity of the feed at the outlet
+    out_salinity_feed = entry_salinity_feed * feed_mass_flow_rate / feed_outflow_rate;
+
+    // Calculating the temperature of the feed at the outlet
+    out_temperature_feed = entry_temperature_feed - heat_flux * membrane_area / (feed_mass_flow_rate * cache->feed_prop.specific_heat);
+
+    // Calculating the temperature of the coolant at the outlet
+    out_temperature_cool = entry_temperature_cool + heat_flux * membrane_area / (cool_mass_flow_rate * cache->cool_prop.specific_heat);
+
+    // Updating the iterative data
+    update[0] = out_temperature_feed;
+    update[1] = out_temperature_cool;
+    update[2] = feed_membrane_temperature;
+    update[3] = gap_membrane_temperature;
+    update[4] = film_boundary_temperature;
+    update[5] = film_wall_temperature;
+    update[6] = cool_wall_temperature;
+    update[7] = out_salinity_feed;
+    update[8] = mass_flux;
+    update[9] = heat_flux;
+    update[10] = vapor_heat_flux;
+    update[11] = feed_outflow_rate;
+
+    return 0;
+}
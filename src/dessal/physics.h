@@ -4,31 +4,52 @@
 
 #include "../properties/properties.h"
 
+// Data structure containing the coefficients of the mass flux across the membrane that only depend on the entry data
+typedef struct
+{
+    PetscReal molecular_coef, knudsen_coef, total_pressure, membrane_thickness, air_gap_thickness;
+} MassFluxCoefs;
+
+// Function to calculate the mass velocity in the water channels
+PetscReal ChannelMassVelocity(PetscReal mass_flow_rate,
+                              PetscReal channel_height,
+                              PetscReal channel_width,
+                              PetscInt number_channels,
+                              PetscReal spacer_porosity);
+
 // Function to calculate the heat transfer coefficients in the water channels
 PetscReal ChannelHeatTransfCoef(SaltWaterProperties *bulk_water_prop,
                                 SaltWaterProperties *wall_water_prop,
-                                PetscReal mass_flow_rate,
-                                PetscReal channel_height,
-                                PetscReal channel_width,
-                                PetscInt number_channels,
-                                PetscReal spacer_porosity);
+                                PetscReal mass_velocity,
+                                PetscReal channel_height);
 
 // Function to calculate the effective thermal conductivity of the membrane
 PetscReal MembraneConductivity(MoistAirProperties *pore_air_prop,
                                PetscReal polymer_conductivity,
                                PetscReal membrane_porosity);
 
+// Function to calculate the coefficients of the distillate mass flux across the membrane
+PetscErrorCode MassFluxCoefsBuild(MassFluxCoefs *coefs,
+                                  PetscReal membrane_porosity,
+                                  PetscReal membrane_tortuosity,
+                                  PetscReal membrane_thickness,
+                                  PetscReal pore_diameter,
+                                  PetscReal air_gap_thickness,
+                                  PetscReal vacuum_pressure);
+
 // Function to calculate the distillate mass flux across the membrane
-PetscReal MassFlux(PetscReal membrane_porosity,
-                   PetscReal membrane_tortuosity,
-                   PetscReal membrane_thickness,
-                   PetscReal pore_diameter,
-                   PetscReal gap_spacer_porosity,
-                   PetscReal air_gap_thickness,
+PetscReal MassFlux(const MassFluxCoefs *coefs,
                    PetscReal temperature_membrane,
                    PetscReal temperature_gap,
                    PetscReal feed_membrane_pressure,
-                   PetscReal film_boundary_pressure,
-                   PetscReal vacuum_pressure);
+                   PetscReal film_boundary_pressure);
+
+// Functions to calculate the heat transfer coefficients in the water channels, the effective thermal conductivity of the membrane and the
+// distillate mass flux in single precision, as their double-precision counterparts
+float ChannelHeatTransfCoefSingle(SaltWaterPropertiesSingle *bulk_water_prop, SaltWaterPropertiesSingle *wall_water_prop, float mass_velocity,
+                                  float channel_height);
+float MembraneConductivitySingle(MoistAirPropertiesSingle *pore_air_prop, float polymer_conductivity, float membrane_porosity);
+float MassFluxSingle(const MassFluxCoefs *coefs, float temperature_membrane, float temperature_gap, float feed_membrane_pressure,
+                     float film_boundary_pressure);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,95 @@
+/*
+Body of the transfer laws of the desalination module, compiled once per precision by physics.c (see precision.h)
+*/
+
+/*
+Maxwell's model for the thermal conductivity of the membrane and empirical correlation for the Nusselt number in spacer-filled channels
+
+Reference: I. Hitsov, K. De Sitter, C. Dotremont, P. Cauwenberg, I. Nopens, Full-scale validated Air Gap Membrane Distillation (AGMD) model
+           without calibration parameters. J. Membrane Sci. 533 (2017) 309-320. https://doi.org/10.1016/j.memsci.2017.04.002
+*/
+
+REAL REAL_NAME(MembraneConductivity)(REAL_NAME(MoistAirProperties) *pore_air_prop,
+                                     REAL polymer_conductivity,
+                                     REAL membrane_porosity)
+{
+    REAL air_conductivity = pore_air_prop->thermal_conductivity, beta;
+
+    beta = (polymer_conductivity - air_conductivity) / (polymer_conductivity + REAL_C(2.0) * air_conductivity);
+
+    return REAL_C(0.93) * air_conductivity * (REAL_C(1.0) + REAL_C(2.0) * beta * (REAL_C(1.0) - membrane_porosity)) /
+           (REAL_C(1.0) - beta * (REAL_C(1.0) - membrane_porosity));
+}
+
+REAL REAL_NAME(ChannelHeatTransfCoef)(REAL_NAME(SaltWaterProperties) *bulk_water_prop,
+                                      REAL_NAME(SaltWaterProperties) *wall_water_prop,
+                                      REAL mass_velocity,
+                                      REAL channel_height)
+{
+    // Properties
+    REAL dyn_viscosity = bulk_water_prop->dyn_viscosity,
+         thermal_conductivity = bulk_water_prop->thermal_conductivity,
+         prandtl = bulk_water_prop->prandtl,
+         wall_prandtl = wall_water_prop->prandtl;
+
+    REAL reynolds, nusselt;
+
+    reynolds = mass_velocity * channel_height / dyn_viscosity;
+
+    nusselt = REAL_C(0.22) * REAL_POW(reynolds, REAL_C(0.69)) * REAL_POW(prandtl, REAL_C(0.13));
+    nusselt *= REAL_POW(prandtl / wall_prandtl, REAL_C(0.25));
+
+    return thermal_conductivity * nusselt / channel_height;
+}
+
+/*
+Water mass flux across the membrane using approximate membrane and air gap permeabilities
+
+Reference: K.M. Lisboa, D.B. Moraes, C.P. Naveira-Cotta, R.M. Cotta, Analysis of the membrane effects on the energy efficiency of water
+           desalination in a direct contact membrane distillation (DCMD) system with heat recovery. Appl. Thermal Eng. 182 (2021) 116063
+           https://doi.org/10.1016/j.applthermaleng.2020.116063
+
+The coefficients, computed once per case, stay in double precision and are rounded when read.
+*/
+
+REAL REAL_NAME(MolecularDiffusion)(REAL molecular_coef, REAL temperature)
+{
+    return molecular_coef * REAL_POW(temperature, REAL_C(2.334));
+}
+
+REAL REAL_NAME(KnudsenDiffusion)(REAL knudsen_coef, REAL temperature)
+{
+    return knudsen_coef * REAL_SQRT(REAL_C(8.0) * (REAL)gas_constant * temperature / ((REAL)M_PI * (REAL)water_molar_mass));
+}
+
+REAL REAL_NAME(MassFlux)(const MassFluxCoefs *coefs,
+                         REAL temperature_membrane,
+                         REAL temperature_gap,
+                         REAL feed_membrane_pressure,
+                         REAL film_boundary_pressure)
+{
+    REAL total_pressure = (REAL)coefs->total_pressure, molar_mass = (REAL)water_molar_mass, constant = (REAL)gas_constant;
+    REAL molecular_diffusivity, knudsen_diffusivity, effective_diffusivity,
+         membrane_permeability, gap_permeability, permeability,
+         mass_flux;
+
+    temperature_membrane += REAL_C(273.15);
+    temperature_gap += REAL_C(273.15);
+
+    molecular_diffusivity = REAL_NAME(MolecularDiffusion)((REAL)coefs->molecular_coef, temperature_membrane);
+    knudsen_diffusivity = REAL_NAME(KnudsenDiffusion)((REAL)coefs->knudsen_coef, temperature_membrane);
+
+    effective_diffusivity = molecular_diffusivity * knudsen_diffusivity / (molecular_diffusivity + total_pressure * knudsen_diffusivity);
+
+    membrane_permeability = molar_mass * effective_diffusivity / (constant * temperature_membrane * (REAL)coefs->membrane_thickness);
+
+    molecular_diffusivity = REAL_NAME(MolecularDiffusion)(REAL_C(4.46e-6), temperature_gap);
+
+    gap_permeability = molar_mass * molecular_diffusivity / (constant * temperature_gap * total_pressure * (REAL)coefs->air_gap_thickness);
+
+    permeability = membrane_permeability * gap_permeability / (membrane_permeability + gap_permeability);
+
+    mass_flux = permeability * (feed_membrane_pressure - film_boundary_pressure);
+
+    return mass_flux;
+}
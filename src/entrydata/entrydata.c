@@ -44,7 +44,9 @@ PetscErrorCode EntryDataBuild(EntryData *entry_data)
               wall_thickness = 62.0e-6, // Default: 62 microns
               polymer_conductivity = 0.35, // Default: 0.35 W/mK
               spacer_conductivity = 0.27, // Default: 0.27 W/mK, source: https://doi.org/10.1016/j.compositesa.2003.11.005
-              wall_conductivity = 0.35; // Default: 0.35 W/mK
+              wall_conductivity = 0.35, // Default: 0.35 W/mK
+              membrane_tortuosity = 2.27, // Default: 2.27, source: https://doi.org/10.1016/j.memsci.2017.04.002
+              film_thickness = 0.6e-3; // Default: 0.6 mm, to be calibrated against measurements (-mode calibration)
     PetscInt number_channels = 6; // Default: 6
 
     PetscOptionsGetReal(NULL, NULL, "-membrane_area", &membrane_area, NULL);
@@ -61,6 +63,8 @@ PetscErrorCode EntryDataBuild(EntryData *entry_data)
     PetscOptionsGetReal(NULL, NULL, "-polymer_conductivity", &polymer_conductivity, NULL);
     PetscOptionsGetReal(NULL, NULL, "-spacer_conductivity", &spacer_conductivity, NULL);
     PetscOptionsGetReal(NULL, NULL, "-wall_conductivity", &wall_conductivity, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-membrane_tortuosity", &membrane_tortuosity, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-film_thickness", &film_thickness, NULL);
     PetscOptionsGetInt(NULL, NULL, "-number_channels", &number_channels, NULL);
 
     dessal_data.membrane_area = membrane_area;
@@ -78,36 +82,137 @@ PetscErrorCode EntryDataBuild(EntryData *entry_data)
     dessal_data.polymer_conductivity = polymer_conductivity;
     dessal_data.spacer_conductivity = spacer_conductivity;
     dessal_data.wall_conductivity = wall_conductivity;
+    dessal_data.membrane_tortuosity = membrane_tortuosity;
+    dessal_data.film_thickness = film_thickness;
 
     // Iterative data
-    PetscReal out_temperature_feed = entry_temperature_feed,
-              out_temperature_cool = entry_temperature_cool,
-              feed_membrane_temperature = entry_temperature_feed,
-              gap_membrane_temperature = entry_temperature_feed,
-              film_boundary_temperature = entry_temperature_cool,
-              film_wall_temperature = entry_temperature_cool,
-              cool_wall_temperature = entry_temperature_cool,
-              out_salinity_feed = entry_salinity_feed,
+    DessalDataResetState(&dessal_data);
+
+    // Recycle loop
+    RecycleData recycle_data;
+    PetscReal brine_recycle_fraction = 0.0, // Default: no brine recirculation
+              heater_power = 0.0; // Default: the heater holds the feed inlet temperature
+    PetscBool heat_recovery = PETSC_FALSE, // Default: the feed is made up of fresh seawater
+              fixed_heater_power = PETSC_FALSE;
+
+    PetscOptionsGetReal(NULL, NULL, "-brine_recycle_fraction", &brine_recycle_fraction, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-heat_recovery", &heat_recovery, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-heater_power", &heater_power, &fixed_heater_power);
+
+    PetscCheck(brine_recycle_fraction >= 0.0 && brine_recycle_fraction < 1.0, PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE,
+               "The fraction of recycled brine must lie in [0, 1)");
+
+    recycle_data.brine_recycle_fraction = brine_recycle_fraction;
+    recycle_data.heat_recovery = heat_recovery;
+    recycle_data.fixed_heater_power = fixed_heater_power;
+    recycle_data.heater_power = heater_power;
+    recycle_data.enabled = brine_recycle_fraction > 0.0 || heat_recovery || fixed_heater_power ? PETSC_TRUE : PETSC_FALSE;
+
+    // Aggregating all data
+    entry_data->dessal_data = dessal_data;
+    entry_data->recycle_data = recycle_data;
+
+    return 0;
+}
+/*
+Default initial guess of the iterative data, built from the conditions at the inlets of the module
+*/
+
+PetscErrorCode DessalDataResetState(DessalData *dessal_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal out_temperature_feed = dessal_data->entry_temperature_feed,
+              out_temperature_cool = dessal_data->entry_temperature_cool,
+              feed_membrane_temperature = dessal_data->entry_temperature_feed,
+              gap_membrane_temperature = dessal_data->entry_temperature_feed,
+              film_boundary_temperature = dessal_data->entry_temperature_cool,
+              film_wall_temperature = dessal_data->entry_temperature_cool,
+              cool_wall_temperature = dessal_data->entry_temperature_cool,
+              out_salinity_feed = dessal_data->entry_salinity_feed,
               mass_flux = 0.0,
               heat_flux = 0.0,
               vapor_heat_flux = 0.0,
-              feed_outflow_rate = feed_mass_flow_rate;
-
-    dessal_data.out_temperature_feed = out_temperature_feed;
-    dessal_data.out_temperature_cool = out_temperature_cool;
-    dessal_data.feed_membrane_temperature = feed_membrane_temperature;
-    dessal_data.gap_membrane_temperature = gap_membrane_temperature;
-    dessal_data.film_boundary_temperature = film_boundary_temperature;
-    dessal_data.film_wall_temperature = film_wall_temperature;
-    dessal_data.cool_wall_temperature = cool_wall_temperature;
-    dessal_data.out_salinity_feed = out_salinity_feed;
-    dessal_data.mass_flux = mass_flux;
-    dessal_data.heat_flux = heat_flux;
-    dessal_data.vapor_heat_flux = vapor_heat_flux;
-    dessal_data.feed_outflow_rate = feed_outflow_rate;
+              feed_outflow_rate = dessal_data->feed_mass_flow_rate;
 
-    // Aggregating all data
-    entry_data->dessal_data = dessal_data;
+    dessal_data->out_temperature_feed = out_temperature_feed;
+    dessal_data->out_temperature_cool = out_temperature_cool;
+    dessal_data->feed_membrane_temperature = feed_membrane_temperature;
+    dessal_data->gap_membrane_temperature = gap_membrane_temperature;
+    dessal_data->film_boundary_temperature = film_boundary_temperature;
+    dessal_data->film_wall_temperature = film_wall_temperature;
+    dessal_data->cool_wall_temperature = cool_wall_temperature;
+    dessal_data->out_salinity_feed = out_salinity_feed;
+    dessal_data->mass_flux = mass_flux;
+    dessal_data->heat_flux = heat_flux;
+    dessal_data->vapor_heat_flux = vapor_heat_flux;
+    dessal_data->feed_outflow_rate = feed_outflow_rate;
+
+    return 0;
+}
+
+/*
+Lookup of the real-valued operational and geometrical parameters of the desalination module by the name of their command-line option
+*/
+
+PetscErrorCode DessalDataFindParameter(DessalData *dessal_data, const char name[], PetscReal **parameter)
+{
+    PetscFunctionBeginUser;
+
+    struct
+    {
+        const char *name;
+        PetscReal *field;
+    } table[] = {{"feed_mass_flow_rate", &dessal_data->feed_mass_flow_rate},
+                 {"cool_mass_flow_rate", &dessal_data->cool_mass_flow_rate},
+                 {"entry_temperature_feed", &dessal_data->entry_temperature_feed},
+                 {"entry_temperature_cool", &dessal_data->entry_temperature_cool},
+                 {"entry_salinity_feed", &dessal_data->entry_salinity_feed},
+                 {"entry_salinity_cool", &dessal_data->entry_salinity_cool},
+                 {"vacuum_pressure", &dessal_data->vacuum_pressure},
+                 {"membrane_area", &dessal_data->membrane_area},
+                 {"membrane_thickness", &dessal_data->membrane_thickness},
+                 {"membrane_porosity", &dessal_data->membrane_porosity},
+                 {"pore_diameter", &dessal_data->pore_diameter},
+                 {"feed_channel_height", &dessal_data->feed_channel_height},
+                 {"cold_channel_height", &dessal_data->cool_channel_height},
+                 {"channel_width", &dessal_data->channel_width},
+                 {"spacer_porosity", &dessal_data->spacer_porosity},
+                 {"gap_spacer_porosity", &dessal_data->gap_spacer_porosity},
+                 {"air_gap_thickness", &dessal_data->air_gap_thickness},
+                 {"wall_thickness", &dessal_data->wall_thickness},
+                 {"polymer_conductivity", &dessal_data->polymer_conductivity},
+                 {"spacer_conductivity", &dessal_data->spacer_conductivity},
+                 {"wall_conductivity", &dessal_data->wall_conductivity},
+                 {"membrane_tortuosity", &dessal_data->membrane_tortuosity},
+                 {"film_thickness", &dessal_data->film_thickness}};
+    PetscInt i;
+    PetscBool match;
+
+    for (i = 0; i < (PetscInt)(sizeof(table) / sizeof(table[0])); i++)
+    {
+        PetscStrcmp(name, table[i].name, &match);
+
+        if (match)
+        {
+            *parameter = table[i].field;
+
+            return 0;
+        }
+    }
+
+    *parameter = NULL;
+
+    return 0;
+}
+
+PetscErrorCode DessalDataGetParameter(DessalData *dessal_data, const char name[], PetscReal **parameter)
+{
+    PetscFunctionBeginUser;
+
+    DessalDataFindParameter(dessal_data, name, parameter);
+
+    PetscCheck(*parameter, PETSC_COMM_SELF, PETSC_ERR_ARG_WRONG, "Unknown parameter of the desalination module: %s", name);
 
     return 0;
 }
\ No newline at end of file
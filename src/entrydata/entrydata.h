@@ -14,7 +14,6 @@ static const PetscReal water_molar_mass = 18.015e-3;
 static const PetscReal salt_molar_mass = 58.443e-3;
 static const PetscReal gas_constant = 8.3144698;
 static const PetscReal atm_pressure = 101.325e3;
-static const PetscReal membrane_tortuosity = 2.27; // https://doi.org/10.1016/j.memsci.2017.04.002
 
 // Data structure containing the data involved in the model for the desalination module
 typedef struct
@@ -26,7 +25,8 @@ typedef struct
     // Geometrical dimensions and fixed properties
     PetscReal membrane_area, membrane_thickness, membrane_porosity, pore_diameter, feed_channel_height,
               cool_channel_height, channel_width, spacer_porosity, gap_spacer_porosity, air_gap_thickness,
-              wall_thickness, polymer_conductivity, spacer_conductivity, wall_conductivity;
+              wall_thickness, polymer_conductivity, spacer_conductivity, wall_conductivity, membrane_tortuosity,
+              film_thickness;
     PetscInt number_channels;
 
     // Iterative data
@@ -35,14 +35,38 @@ typedef struct
               mass_flux, heat_flux, vapor_heat_flux, feed_outflow_rate;
 } DessalData;
 
+// Data structure containing the data involved in the model for the recycle loop around the desalination module
+typedef struct
+{
+    // Fraction of the brine leaving the module that is returned to the feed
+    PetscReal brine_recycle_fraction;
+
+    // Heat recovery (the coolant leaving the module makes up the feed, instead of fresh seawater at the coolant inlet conditions), and
+    // heater delivering a fixed power (instead of holding the feed inlet temperature)
+    PetscBool heat_recovery, fixed_heater_power;
+    PetscReal heater_power;
+
+    // Whether the feed inlet depends on the outlets of the module
+    PetscBool enabled;
+} RecycleData;
 
 // Aggregate of entry data for all components of the system
 typedef struct
 {
     DessalData dessal_data;
+    RecycleData recycle_data;
 } EntryData;
 
 // Entry data constructor
 PetscErrorCode EntryDataBuild(EntryData *entry_data);
 
+// Function to reset the iterative data of the desalination module to the default initial guess
+PetscErrorCode DessalDataResetState(DessalData *dessal_data);
+
+// Function to get a pointer to a real-valued operational or geometrical parameter of the desalination module from its option name
+PetscErrorCode DessalDataGetParameter(DessalData *dessal_data, const char name[], PetscReal **parameter);
+
+// Function to look up a parameter of the desalination module like DessalDataGetParameter, returning NULL for unknown names
+PetscErrorCode DessalDataFindParameter(DessalData *dessal_data, const char name[], PetscReal **parameter);
+
 #endif
\ No newline at end of file
@@ -1 +1,14 @@
-#include "./plant/plant.h"
\ No newline at end of file
+#include "./plant/plant.h"
+#include "./analysis/uncertainty.h"
+#include "./analysis/sweep.h"
+#include "./analysis/map.h"
+#include "./analysis/calibration.h"
+#include "./analysis/inverse.h"
+#include "./analysis/transient.h"
+#include "./analysis/validation.h"
+#include "./analysis/continuation.h"
+#include "./analysis/design.h"
+#include "./analysis/pareto.h"
+#include "./analysis/convergence.h"
+#include "./analysis/schedule.h"
+#include "./analysis/sobol.h"
\ No newline at end of file
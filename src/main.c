@@ -59,13 +59,273 @@ static char help[] = "Reduced model for vacuum-enhanced air gap membrane distill
 "-spacer_conductivity: type double, unit W/mK\n"
 "Description - Thermal conductivity of the material from which the spacer is made of.\n\n"
 "-wall_conductivity: type double, unit W/mK\n"
-"Description - Thermal conductivity of the condensing wall.\n\n";
+"Description - Thermal conductivity of the condensing wall.\n\n"
+"-membrane_tortuosity: type double, unit none\n"
+"Description - Tortuosity of the pores of the membrane.\n\n"
+"-film_thickness: type double, unit m\n"
+"Description - Thickness of the distillate film on the condensing wall.\n\n"
+"Recycle loop options:\n\n"
+"-brine_recycle_fraction: type double, unit none, default 0\n"
+"Description - Fraction of the brine leaving the module that is returned to the feed.\n\n"
+"-heat_recovery: type bool, default false\n"
+"Description - Make up the feed with the coolant leaving the module (preheated seawater) instead of fresh seawater at the coolant inlet.\n\n"
+"-heater_power: type double, unit W\n"
+"Description - Power delivered by the heater ahead of the feed inlet; if not given, the heater holds -entry_temperature_feed. With any of\n"
+"these options, the feed inlet salinity (and temperature, with -heater_power) is solved together with the module.\n\n"
+"Running modes:\n\n"
+"-mode: type string, options single, uncertainty, sweep, map, calibration, inverse, transient, validate, continuation, design, pareto,\n"
+"trace_summary, schedule or sobol, default single\n"
+"Description - single solves the plant for the entry data and writes ./results/report.csv. uncertainty propagates the uncertainties\n"
+"of the parameters of the desalination module to the KPIs by quasi-Monte Carlo sampling (may run with several MPI ranks), writing\n"
+"./results/uncertainty.csv. sweep solves a Cartesian grid of cases (may run with several MPI ranks), writing ./results/sweep.csv.\n"
+"map adaptively refines an operating map where the KPIs are poorly interpolated (may run with several MPI ranks), writing\n"
+"./results/map.csv. calibration fits parameters of the desalination module to measured points (may run with several MPI ranks),\n"
+"writing ./results/calibration.csv. inverse solves for inputs that meet production targets, writing ./results/inverse.csv. transient\n"
+"integrates the lumped-capacitance model of the module along time, writing ./results/transient.csv. validate compares the fast solution\n"
+"paths with the baseline solve on a reference corpus, writing ./results/validation.csv. continuation traces a response curve along one\n"
+"parameter, writing ./results/continuation.csv. design screens a grid of design candidates and solves the promising ones, writing\n"
+"./results/design.csv. pareto searches the Pareto front of design parameters with an evolutionary algorithm (may run with several MPI\n"
+"ranks), writing ./results/pareto.csv. trace_summary summarizes the convergence traces written with -trace, writing\n"
+"./results/trace_summary.csv. schedule chooses the setpoints of a day from a forecast, writing ./results/schedule.csv. sobol estimates\n"
+"the Sobol sensitivity indices of outputs of the plant (may run with several MPI ranks), writing ./results/sobol.csv.\n\n"
+"Numerical options:\n\n"
+"-scaling: type bool, default true\n"
+"Description - Solve for unknowns and residuals nondimensionalized by reference scales derived from the inlet conditions and geometry.\n\n"
+"-formulation: type string, options full or reduced, default full\n"
+"Description - Formulation of the plant system. The reduced one iterates only on the implicit unknowns (outlet and interface temperatures\n"
+"and outlet salinity) and reconstructs the explicit ones (fluxes, outflow rate and film/wall temperature) after convergence. A case that\n"
+"fails with it, or lands on a non-physical root (non-positive mass flux or feed outflow rate), is solved again with the full one.\n\n"
+"-reduced_max_it: type integer, default 100\n"
+"Description - Maximum number of iterations of the reduced formulation before falling back to the full one.\n\n"
+"-formulation_check: type bool, default false\n"
+"Description - Also solve the full formulation and print the relative differences to the selected one.\n\n"
+"-jacobian: type string, options default or incremental, default default\n"
+"Description - Finite-difference Jacobian of the plant system. The incremental one evaluates the balance once and, for each perturbed\n"
+"unknown, only recomputes the properties, resistances and mass flux that depend on it.\n\n"
+"-bounded: type bool, default false\n"
+"Description - Keep the unknowns within physical bounds following from the inlet conditions (temperatures between the inlet ones,\n"
+"nonnegative fluxes, outflow rate between the salt and the feed flow rates...) with the variational inequality solver. Applies to the\n"
+"SNES solves of forward problems without the recycle loop. Entry data are screened before solving in any case (positive vacuum pressure,\n"
+"inlets outside the range of the property correlations, unphysical geometry...) and infeasible ones are rejected with a reason.\n\n"
+"-homotopy: type bool, default false / -homotopy_max_steps: type integer, default 1000\n"
+"Description - Retry the cases that fail from the default initial guess by continuation from 1% of the membrane area (not with the\n"
+"recycle loop or in inverse problems).\n\n"
+"Uncertainty propagation options (-mode uncertainty):\n\n"
+"-uq_parameters: type comma-separated strings, default pore_diameter,membrane_porosity,membrane_thickness,polymer_conductivity,\n"
+"membrane_tortuosity\n"
+"Description - Uncertain parameters, named after their command-line options.\n\n"
+"-uq_<parameter>_distribution: type string, options uniform, normal or triangular, default uniform\n"
+"Description - Distribution of an uncertain parameter.\n\n"
+"-uq_<parameter>_parameters: type comma-separated doubles\n"
+"Description - Lower and upper bounds (uniform), mean and standard deviation (normal) or lower bound, upper bound and mode\n"
+"(triangular). Defaults to bounds (or standard deviation) of -uq_relative_range times the nominal value.\n\n"
+"-uq_relative_range: type double, default 0.1\n"
+"Description - Relative spread of the distributions not given explicitly.\n\n"
+"-uq_<parameter>_bounds: type comma-separated doubles, default [0, 1] for porosities, above 1 for the tortuosity and the side of zero of the\n"
+"nominal value otherwise\n"
+"Description - Physical bounds of an uncertain parameter, to which the normal distribution is truncated.\n\n"
+"-uq_samples: type integer, default 10000\n"
+"Description - Maximum number of samples.\n\n"
+"-uq_min_samples: type integer, default 256\n"
+"Description - Minimum number of converged samples before the run may stop early.\n\n"
+"-uq_batch_size: type integer, default 32\n"
+"Description - Number of samples solved by each MPI rank between two updates of the statistics.\n\n"
+"-uq_ci_target: type double, default 1.0e-3\n"
+"Description - Target half-width of the confidence intervals of the means of the KPIs, relative to the means (0 disables early stop).\n\n"
+"-uq_replicates: type integer, default 8\n"
+"Description - Independently scrambled and shifted replicates of the Halton sequence, the samples cycling through them; the confidence\n"
+"intervals follow from the spread of their means (randomized quasi-Monte Carlo), and are not available without scrambling.\n\n"
+"-uq_confidence: type double, default 0.95\n"
+"Description - Confidence level of the intervals.\n\n"
+"-uq_quantiles: type comma-separated doubles, default 0.05,0.5,0.95\n"
+"Description - Probability levels of the quantiles of the KPIs estimated in streaming.\n\n"
+"-uq_seed: type integer, default 1 / -uq_scramble: type bool, default true\n"
+"Description - Seed of the randomization of the replicates of the Halton sequence, and switch of their random digit scrambling.\n\n"
+"Parameter sweep options (-mode sweep):\n\n"
+"-sweep_parameters: type comma-separated strings, default entry_temperature_feed,feed_mass_flow_rate\n"
+"Description - Swept parameters, named after their command-line options.\n\n"
+"-sweep_min, -sweep_max: type comma-separated doubles, default 0.8 and 1.2 times the nominal values\n"
+"Description - Bounds of the swept parameters.\n\n"
+"-sweep_points: type comma-separated integers, default 11\n"
+"Description - Number of points of each swept parameter.\n\n"
+"-sweep_batch_size: type integer, default 16\n"
+"Description - Number of cases solved by each MPI rank between two writes of the results.\n\n"
+"-lockstep_lanes: type integer, default 0\n"
+"Description - Number of cases advanced together by the lockstep Newton solver (0 solves the cases one at a time with SNES).\n\n"
+"-precision: type string, options double or mixed, default double\n"
+"Description - Precision of the balance in the lanes of the lockstep solver. The mixed one evaluates it in single precision until the\n"
+"residual norm falls below -precision_switch, then refines in double precision down to the tolerances of the nonlinear solver.\n\n"
+"-precision_switch: type double, default 1e-5\n"
+"Description - Scaled residual norm at which the lanes of the mixed precision switch to the double-precision balance.\n\n"
+"-sweep_checkpoint_interval: type double, unit s, default 300\n"
+"Description - Minimum time between two checkpoints, written to ./results/sweep.checkpoint.\n\n"
+"-resume: type bool, default false\n"
+"Description - Resume an interrupted sweep from its last checkpoint, keeping the results written up to it.\n\n"
+"Operating map options (-mode map):\n\n"
+"-map_parameters, -map_min, -map_max: as the sweep options, default entry_temperature_feed,feed_mass_flow_rate\n"
+"Description - Mapped parameters and their bounds.\n\n"
+"-map_points: type comma-separated integers, default 5\n"
+"Description - Number of points of each parameter in the coarse grid the refinement starts from.\n\n"
+"-map_tolerance: type double, default 1.0e-2\n"
+"Description - Tolerance of the interpolation error of the KPIs at the center of a cell, relative to their ranges over the map.\n\n"
+"-map_max_level: type integer, default 4 / -map_max_points: type integer, default 20000\n"
+"Description - Maximum number of bisections of the coarse cells and maximum number of solved points.\n\n"
+"-map_validate: type integer, default 0\n"
+"Description - Number of quasi-random points at which the interpolated map is compared with direct solutions.\n\n"
+"Calibration options (-mode calibration):\n\n"
+"-calib_file: type string, required\n"
+"Description - CSV file of measured points, whose header names the operating conditions (as their options) and the measured unknowns or KPIs.\n\n"
+"-calib_parameters: type comma-separated strings, default film_thickness,membrane_tortuosity\n"
+"Description - Fitted parameters of the desalination module, named after their command-line options and starting from their values.\n\n"
+"-calib_sigma: type comma-separated doubles, default mean absolute values of the measured columns\n"
+"Description - Standard deviations weighting the residuals of the measured columns, in the order of the file.\n\n"
+"-calib_max_it: type integer, default 50\n"
+"Description - Maximum number of Levenberg-Marquardt iterations, i.e. accepted steps (rejected trials only increase the damping).\n\n"
+"-calib_confidence: type double, default 0.95\n"
+"Description - Confidence level of the intervals of the fitted parameters.\n\n"
+"Inverse solve options (-mode inverse, serial):\n\n"
+"-inverse_inputs: type comma-separated strings, default feed_mass_flow_rate\n"
+"Description - Freed inputs of the desalination module, named after their command-line options and starting from their values.\n\n"
+"-inverse_outputs: type comma-separated strings, default distillate_rate\n"
+"Description - Target outputs, named after the unknowns of the plant system or the KPIs, one per freed input.\n\n"
+"-inverse_targets: type comma-separated doubles, required\n"
+"Description - Target values of the outputs, in the units of the report (SI, KPIs per hour).\n\n"
+"-inverse_min, -inverse_max: type comma-separated doubles, default 0.5 and 1.5 times the nominal values\n"
+"Description - Bounds of the freed inputs.\n\n"
+"-inverse_check: type bool, default false\n"
+"Description - Solve the forward problem at the inputs found and compare its outputs.\n\n"
+"Transient options (-mode transient, serial):\n\n"
+"-transient_scenario: type string (step, startup, shutdown or profile), default step\n"
+"Description - Scenario of the driven input, starting from the steady state at its initial value.\n\n"
+"-transient_input: type string, default entry_temperature_feed\n"
+"Description - Driven input of the desalination module, named after its command-line option.\n\n"
+"-transient_step: type double, default 0.1 times the nominal value / -transient_step_time: type double, unit s, default 600\n"
+"Description - Size and time of the step of the step scenario.\n\n"
+"-transient_start_value: type double, default 0.5 times the nominal value / -transient_ramp_time: type double, unit s, default 600\n"
+"Description - Value of the input when the plant is off, and duration of the ramps of the startup and shutdown scenarios.\n\n"
+"-transient_profile_times, -transient_profile_values: type comma-separated doubles\n"
+"Description - Breakpoints (unit s) and values of the piecewise-linear input of the profile scenario.\n\n"
+"-transient_final_time: type double, unit s, default 3600 / -transient_time_step: type double, unit s, default 0.01\n"
+"Description - Simulated time and initial time step, adapted by the integrator (see the -ts_* options of PETSc).\n\n"
+"-transient_event_output: type string, default out_temperature_cool / -transient_event_limit: type double\n"
+"Description - Output (unknown or KPI) whose crossings of the limit are detected, only when a limit is given.\n\n"
+"-transient_event_stop: type bool, default false\n"
+"Description - Stop the simulation at the first crossing of the limit.\n\n"
+"-wall_density: type double, unit kg/m³, default 950 / -wall_specific_heat: type double, unit J/kgK, default 1900\n"
+"Description - Properties of the wall setting its heat capacity.\n\n"
+"Convergence trace options:\n\n"
+"-trace: type bool, default false\n"
+"Description - Append every iterate of the nonlinear solver (iterate, residuals, step length and condition number of the Jacobian) to a\n"
+"binary trace file, one per MPI rank.\n\n"
+"-trace_file: type string, default ./results/trace.bin\n"
+"Description - Trace file, also read by -mode trace_summary (serial), along with the files of the other ranks.\n\n"
+"-trace_summary_worst: type integer, default 5\n"
+"Description - Number of solves that failed or took the most iterations listed by -mode trace_summary.\n\n"
+"Validation options (-mode validate, serial):\n\n"
+"-validate_paths: type comma-separated strings (reduced, incremental, lockstep, lockstep_reduced or lockstep_mixed), default all\n"
+"Description - Fast paths compared with the baseline solve (full formulation, unscaled and unbounded SNES, from the default initial\n"
+"guess), over the cases the baseline solves to a physical root.\n\n"
+"-validate_points: type integer, default 128 / -validate_relative_range: type double, default 0.2\n"
+"Description - Number of cases of the fixed reference corpus, and range of its operating and design points around the nominal values.\n\n"
+"-validate_max_error, -validate_mean_error: type double, default 1e-6 and 1e-8\n"
+"Description - Budgets of the maximum and mean relative errors of each unknown and KPI; the run fails when a path exceeds them.\n\n"
+"Continuation options (-mode continuation, serial):\n\n"
+"-continuation_parameter: type string, default vacuum_pressure\n"
+"Description - Parameter of the desalination module along which the response curve is traced, named after its command-line option.\n\n"
+"-continuation_start, -continuation_end: type double, default the nominal value and 0.1 times the nominal value\n"
+"Description - Values of the parameter at the start and end of the curve.\n\n"
+"-continuation_max_steps: type integer, default 1000\n"
+"Description - Maximum number of points of the curve.\n\n"
+"-arclength_step, -arclength_min_step, -arclength_max_step: type double, default 0.05, 1e-6 and 0.2\n"
+"Description - Initial, minimum and maximum arclength steps, in the scaled unknowns and parameter.\n\n"
+"-arclength_max_it: type integer, default 10\n"
+"Description - Maximum number of iterations of the corrector.\n\n"
+"Design exploration options (-mode design, serial):\n\n"
+"-design_parameters, -design_min, -design_max, -design_points: as for a sweep, default entry_temperature_feed,membrane_thickness and\n"
+"11 points per parameter\n"
+"Description - Grid of design candidates.\n\n"
+"-design_objectives: type comma-separated strings, default distillate_rate,GOR\n"
+"Description - Objectives, named after the unknowns of the plant system, the KPIs or the parameters of the desalination module.\n\n"
+"-design_senses: type comma-separated strings (max or min), default max for each objective\n"
+"Description - Whether each objective is maximized or minimized.\n\n"
+"-design_calibration_points: type integer, default 16 / -design_safety: type double, default 2\n"
+"Description - Candidates solved to calibrate the errors of the one-pass screening model, and factor applied to the largest errors found.\n\n"
+"-design_check: type bool, default false\n"
+"Description - Also solve the discarded candidates and count the members of the Pareto front that the screening discarded.\n\n"
+"Pareto front search options (-mode pareto):\n\n"
+"-pareto_parameters, -pareto_min, -pareto_max: as for a sweep, default membrane_area,feed_mass_flow_rate,air_gap_thickness\n"
+"Description - Design parameters searched and their bounds.\n\n"
+"-pareto_objectives, -pareto_senses: as for a design exploration, default distillate_rate,SEC,membrane_area and max,min,min\n"
+"Description - Objectives of the search and whether each is maximized or minimized.\n\n"
+"-pareto_population: type integer, default 32 / -pareto_generations: type integer, default 20 / -pareto_seed: type integer, default 1\n"
+"Description - Size of the population (even), number of generations of the evolutionary algorithm (NSGA-II) and seed of its random stream.\n\n"
+"-pareto_crossover_eta, -pareto_mutation_eta: type double, default 15 and 20\n"
+"Description - Distribution indices of the simulated binary crossover and of the polynomial mutation.\n\n"
+"Setpoint scheduling options (-mode schedule, serial):\n\n"
+"-schedule_parameters, -schedule_min, -schedule_max, -schedule_points: as for a sweep, default\n"
+"feed_mass_flow_rate,cool_mass_flow_rate,vacuum_pressure and 5 points per setpoint\n"
+"Description - Grid of the setpoints chosen at every step of the day.\n\n"
+"-schedule_steps: type integer, default 24 / -schedule_step_time: type double, unit h, default 1\n"
+"Description - Number and duration of the steps of the schedule.\n\n"
+"-schedule_times: type comma-separated doubles, unit h\n"
+"Description - Breakpoints of the piecewise-linear profiles of the forecast.\n\n"
+"-schedule_feed_temperature, -schedule_cool_temperature: type comma-separated doubles, unit °C, default the nominal values\n"
+"Description - Forecast inlet temperatures of the feed and of the coolant, one per breakpoint.\n\n"
+"-schedule_heat: type comma-separated doubles, unit W, default unlimited\n"
+"Description - Forecast heat available for the plant, one per breakpoint.\n\n"
+"-schedule_heat_budget: type double, unit kWh, default unlimited / -schedule_budget_bins: type integer, default 480\n"
+"Description - Heat budget of the day, and number of bins it is discretized in by the dynamic programming.\n\n"
+"-schedule_resolution: type double, unit °C, default 0.1\n"
+"Description - Resolution of the forecast temperatures, the steps rounding to the same conditions sharing their solves.\n\n"
+"Sobol sensitivity analysis options (-mode sobol):\n\n"
+"-sobol_parameters: type comma-separated strings, default membrane_thickness,membrane_porosity,pore_diameter,membrane_tortuosity,\n"
+"polymer_conductivity,film_thickness,air_gap_thickness,gap_spacer_porosity,spacer_conductivity,feed_channel_height,cold_channel_height,\n"
+"spacer_porosity\n"
+"Description - Inputs of the analysis, named after their command-line options.\n\n"
+"-sobol_<parameter>_distribution, -sobol_<parameter>_parameters, -sobol_relative_range: as for the uncertainty propagation\n"
+"Description - Distributions of the inputs.\n\n"
+"-sobol_outputs: type comma-separated strings, default permeate_flux,GOR,SEC\n"
+"Description - Outputs of the analysis, named after the unknowns of the plant system or the KPIs.\n\n"
+"-sobol_samples: type integer, default 2048 / -sobol_min_samples: type integer, default 256\n"
+"Description - Maximum number of base samples, each solving the number of inputs plus two cases, and minimum number of converged ones\n"
+"before the run may stop early.\n\n"
+"-sobol_batch_size: type integer, default 4\n"
+"Description - Number of base samples solved by each MPI rank between two updates of the estimators.\n\n"
+"-sobol_bootstrap: type integer, default 200 / -sobol_confidence: type double, default 0.95\n"
+"Description - Number of (Poisson) bootstrap replicates and confidence level of the intervals of the indices.\n\n"
+"-sobol_ci_target: type double, default 0\n"
+"Description - Target width of the widest confidence interval of the indices (0 disables early stop).\n\n"
+"-sobol_seed: type integer, default 1 / -sobol_scramble: type bool, default true\n"
+"Description - Seed of the random digit scrambling of the Halton sequence and of the bootstrap weights, and switch of the scrambling.\n\n";
 
 #include "lib.h"
 
+// Running modes of the program
+typedef enum
+{
+    MODE_SINGLE,
+    MODE_UNCERTAINTY,
+    MODE_SWEEP,
+    MODE_MAP,
+    MODE_CALIBRATION,
+    MODE_INVERSE,
+    MODE_TRANSIENT,
+    MODE_VALIDATE,
+    MODE_CONTINUATION,
+    MODE_DESIGN,
+    MODE_PARETO,
+    MODE_TRACE_SUMMARY,
+    MODE_SCHEDULE,
+    MODE_SOBOL
+} RunMode;
+
+static const char *const mode_names[] = {"single", "uncertainty", "sweep", "map", "calibration", "inverse", "transient", "validate",
+                                         "continuation", "design", "pareto", "trace_summary", "schedule", "sobol"};
+
 int main(int argc, char **argv)
 {
     PetscMPIInt size;
+    PetscInt mode = MODE_SINGLE;
     EntryData entry_data;
 
     //-----------------------------------------------------------------------------------------------------------------------------------------------//
@@ -75,7 +335,10 @@ int main(int argc, char **argv)
     PetscFunctionBeginUser;
     PetscInitialize(&argc, &argv, (char *)0, help);
     PetscCallMPI(MPI_Comm_size(PETSC_COMM_WORLD, &size));
-    PetscCheck(size == 1, PETSC_COMM_WORLD, PETSC_ERR_WRONG_MPI_SIZE, "This program is intended for serial mode only!\n");
+    PetscCall(PetscOptionsGetEList(NULL, NULL, "-mode", mode_names, sizeof(mode_names) / sizeof(mode_names[0]), &mode, NULL));
+
+    // Studies made of many independent cases distribute them among the MPI ranks, the single case runs in serial mode
+    PetscCheck(size == 1 || (mode != MODE_SINGLE && mode != MODE_INVERSE && mode != MODE_TRANSIENT && mode != MODE_VALIDATE && mode != MODE_CONTINUATION && mode != MODE_DESIGN && mode != MODE_TRACE_SUMMARY && mode != MODE_SCHEDULE), PETSC_COMM_WORLD, PETSC_ERR_WRONG_MPI_SIZE, "This program is intended for serial mode only!\n");
 
     //-----------------------------------------------------------------------------------------------------------------------------------------------//
     // Fetching the entry data                                                                                                                       //
@@ -87,7 +350,50 @@ int main(int argc, char **argv)
     // Running the model of the plant                                                                                                                //
     //-----------------------------------------------------------------------------------------------------------------------------------------------//
 
-    PetscCall(RunPlant(&entry_data));
+    switch (mode)
+    {
+    case MODE_UNCERTAINTY:
+        PetscCall(RunUncertainty(&entry_data));
+        break;
+    case MODE_SWEEP:
+        PetscCall(RunSweep(&entry_data));
+        break;
+    case MODE_MAP:
+        PetscCall(RunMap(&entry_data));
+        break;
+    case MODE_CALIBRATION:
+        PetscCall(RunCalibration(&entry_data));
+        break;
+    case MODE_INVERSE:
+        PetscCall(RunInverse(&entry_data));
+        break;
+    case MODE_TRANSIENT:
+        PetscCall(RunTransient(&entry_data));
+        break;
+    case MODE_VALIDATE:
+        PetscCall(RunValidation(&entry_data));
+        break;
+    case MODE_CONTINUATION:
+        PetscCall(RunContinuation(&entry_data));
+        break;
+    case MODE_DESIGN:
+        PetscCall(RunDesign(&entry_data));
+        break;
+    case MODE_PARETO:
+        PetscCall(RunPareto(&entry_data));
+        break;
+    case MODE_TRACE_SUMMARY:
+        PetscCall(RunTraceSummary(&entry_data));
+        break;
+    case MODE_SCHEDULE:
+        PetscCall(RunSchedule(&entry_data));
+        break;
+    case MODE_SOBOL:
+        PetscCall(RunSobol(&entry_data));
+        break;
+    default:
+        PetscCall(RunPlant(&entry_data));
+    }
 
     //-----------------------------------------------------------------------------------------------------------------------------------------------//
     // Finalizing PETSc and the program                                                                                                              //
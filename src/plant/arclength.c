@@ -0,0 +1,461 @@
+#include "arclength.h"
+
+/*
+Pseudo-arclength continuation
+
+The solutions of the plant system G(x, p) = 0 along a parameter p form branches y(s) = (x(s), p(s)) parameterized by their arclength s,
+in the scaled unknowns and the parameter scaled by its value at the start. Each step predicts the next point along the unit tangent t of
+the branch, y + h t, and corrects it by Newton iterations on the bordered system
+
+    G(y) = 0,    t . (y - y_k) = h
+
+whose Jacobian [dG/dy; t] stays regular at the turning points of the branch, where dG/dx is singular and stepping in the parameter fails.
+The tangent at the new point solves [dG/dy; t_k] t = (0, 1), so that it keeps the orientation of the previous one, and a sign change of its
+parameter component marks a turning point. The step grows when the corrector converges within a few iterations and is halved when it
+fails or drifts further than one step away from the prediction (which would jump to another branch). A step crossing the end value of the
+parameter is corrected with the parameter fixed at it instead of the arclength condition.
+
+The reference scales of the unknowns are frozen at the start of the branch, so that the tangents of successive points are comparable.
+
+A branch starts from an initial guess of the solution at the start value of the parameter, corrected by Newton with the parameter fixed.
+
+Reference: E.L. Allgower, K. Georg, Introduction to Numerical Continuation Methods, SIAM, 2003.
+*/
+
+PetscErrorCode ArclengthSolverBuild(ArclengthSolver *arclength, SolverCtx *solver_ctx, const char name[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i;
+
+    PetscCheck(solver_ctx->inverse.num_free == 0, PETSC_COMM_SELF, PETSC_ERR_SUP, "The continuation does not support inverse problems");
+    PetscCheck(solver_ctx->num_loop == 0, PETSC_COMM_SELF, PETSC_ERR_SUP, "The continuation does not support the recycle loop");
+
+    arclength->num_var = solver_ctx->num_var;
+    arclength->formulation = solver_ctx->formulation;
+    arclength->entry_data = solver_ctx->entry_data;
+    arclength->dessal_ctx = solver_ctx->dessal_ctx;
+    for (i = 0; i < solver_ctx->num_var; i++)
+        arclength->var_index[i] = solver_ctx->var_index[i];
+
+    for (i = 0; i < NUM_VAR; i++)
+        arclength->scale[i] = solver_ctx->scale[i];
+
+    PetscCall(DessalDataGetParameter(&arclength->entry_data.dessal_data, name, &arclength->parameter));
+
+    arclength->parameter_scale = PetscAbsReal(*arclength->parameter) > PETSC_SMALL ? PetscAbsReal(*arclength->parameter) : 1.0;
+    arclength->context_value = *arclength->parameter;
+
+    arclength->step = 0.05;
+    arclength->min_step = 1.0e-6;
+    arclength->max_step = 0.2;
+    arclength->max_it = 10;
+
+    PetscOptionsGetReal(NULL, NULL, "-arclength_step", &arclength->step, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-arclength_min_step", &arclength->min_step, NULL);
+    PetscOptionsGetReal(NULL, NULL, "-arclength_max_step", &arclength->max_step, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-arclength_max_it", &arclength->max_it, NULL);
+
+    PetscCheck(0.0 < arclength->min_step && arclength->min_step <= arclength->step && arclength->step <= arclength->max_step, PETSC_COMM_SELF,
+               PETSC_ERR_ARG_OUTOFRANGE, "The arclength steps must satisfy 0 < min_step <= step <= max_step");
+
+    // Same absolute tolerance as the nonlinear solver
+    SNESGetTolerances(solver_ctx->snes, &arclength->atol, NULL, NULL, NULL, NULL);
+
+    arclength->num_steps = 0;
+    arclength->num_turning_points = 0;
+    arclength->num_evaluations = 0;
+    arclength->num_iterations = 0;
+
+    return 0;
+}
+
+// Function to update the invariant terms of the balance when the continued parameter changes
+PetscErrorCode ArclengthSetParameter(ArclengthSolver *arclength, PetscReal scaled_value)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal value = scaled_value * arclength->parameter_scale;
+
+    if (value == arclength->context_value)
+        return 0;
+
+    *arclength->parameter = value;
+    arclength->context_value = value;
+
+    DessalContextBuild(&arclength->dessal_ctx, &arclength->entry_data.dessal_data);
+
+    return 0;
+}
+
+PetscErrorCode ArclengthResidual(ArclengthSolver *arclength, const PetscReal y[], PetscReal f[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, i, k;
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR];
+
+    ArclengthSetParameter(arclength, y[n]);
+
+    for (i = 0; i < n; i++)
+    {
+        k = arclength->var_index[i];
+        state[k] = y[i] * arclength->scale[k];
+    }
+
+    DessalContextBalance(&arclength->dessal_ctx, state, update);
+
+    for (i = 0; i < n; i++)
+    {
+        k = arclength->var_index[i];
+        f[i] = (state[k] - update[k]) / arclength->scale[k];
+    }
+
+    arclength->num_evaluations++;
+
+    return 0;
+}
+
+// Function to build the finite-difference Jacobian of the residual with respect to the unknowns and the parameter (n x (n + 1), row-major)
+PetscErrorCode ArclengthJacobian(ArclengthSolver *arclength, const PetscReal y[], const PetscReal f[], PetscReal jac[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, i, j;
+    PetscReal y_shift[NUM_VAR + 1], f_shift[NUM_VAR], h;
+
+    for (j = 0; j <= n; j++)
+        y_shift[j] = y[j];
+
+    // Differencing steps of SNESComputeJacobianDefault
+    for (j = 0; j <= n; j++)
+    {
+        h = y[j];
+        if (PetscAbsReal(h) < 1.0e-6)
+            h = h >= 0.0 ? 1.0e-6 : -1.0e-6;
+        h *= PETSC_SQRT_MACHINE_EPSILON;
+
+        y_shift[j] = y[j] + h;
+        ArclengthResidual(arclength, y_shift, f_shift);
+        y_shift[j] = y[j];
+
+        for (i = 0; i < n; i++)
+            jac[i * (n + 1) + j] = (f_shift[i] - f[i]) / h;
+    }
+
+    return 0;
+}
+
+// Function to solve the bordered system [jac; row] z = b by LU factorization with partial pivoting (the matrix is overwritten)
+PetscErrorCode ArclengthBorderedSolve(PetscInt n, PetscReal a[], const PetscReal row[], PetscReal b[], PetscBool *singular)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt m = n + 1, i, j, k, p;
+    PetscReal pivot, factor, swap;
+
+    for (j = 0; j < m; j++)
+        a[n * m + j] = row[j];
+
+    *singular = PETSC_FALSE;
+
+    for (k = 0; k < m; k++)
+    {
+        for (p = k, i = k + 1; i < m; i++)
+            if (PetscAbsReal(a[i * m + k]) > PetscAbsReal(a[p * m + k]))
+                p = i;
+
+        if (p != k)
+        {
+            for (j = 0; j < m; j++)
+            {
+                swap = a[k * m + j];
+                a[k * m + j] = a[p * m + j];
+                a[p * m + j] = swap;
+            }
+
+            swap = b[k];
+            b[k] = b[p];
+            b[p] = swap;
+        }
+
+        pivot = a[k * m + k];
+
+        if (!(PetscAbsReal(pivot) > 0.0) || PetscIsInfOrNanReal(pivot))
+        {
+            *singular = PETSC_TRUE;
+
+            return 0;
+        }
+
+        for (i = k + 1; i < m; i++)
+        {
+            factor = a[i * m + k] / pivot;
+
+            for (j = k + 1; j < m; j++)
+                a[i * m + j] -= factor * a[k * m + j];
+
+            b[i] -= factor * b[k];
+        }
+    }
+
+    for (i = m - 1; i >= 0; i--)
+    {
+        for (j = i + 1; j < m; j++)
+            b[i] -= a[i * m + j] * b[j];
+
+        b[i] /= a[i * m + i];
+    }
+
+    return 0;
+}
+
+// Function to compute the unit tangent of the branch at a point, oriented along a previous tangent
+PetscErrorCode ArclengthTangent(ArclengthSolver *arclength, const PetscReal y[], const PetscReal previous[], PetscReal tangent[],
+                                PetscBool *singular)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, i;
+    PetscReal f[NUM_VAR], jac[(NUM_VAR + 1) * (NUM_VAR + 1)], norm = 0.0;
+
+    ArclengthResidual(arclength, y, f);
+    ArclengthJacobian(arclength, y, f, jac);
+
+    for (i = 0; i < n; i++)
+        tangent[i] = 0.0;
+    tangent[n] = 1.0;
+
+    ArclengthBorderedSolve(n, jac, previous, tangent, singular);
+
+    for (i = 0; i <= n; i++)
+        norm += tangent[i] * tangent[i];
+
+    norm = PetscSqrtReal(norm);
+
+    if (!(norm > 0.0) || PetscIsInfOrNanReal(norm))
+        *singular = PETSC_TRUE;
+
+    if (*singular)
+        return 0;
+
+    for (i = 0; i <= n; i++)
+        tangent[i] /= norm;
+
+    return 0;
+}
+
+// Function to correct a point by Newton iterations on the bordered system, closed by the arclength condition t . (z - y) = h (or, if fixed,
+// by keeping the parameter at its value in z)
+PetscErrorCode ArclengthCorrect(ArclengthSolver *arclength, PetscReal z[], PetscBool fixed, PetscReal h, PetscInt *iterations,
+                                PetscBool *converged)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, it, i;
+    PetscReal *y = arclength->y, *t = arclength->tangent, f[NUM_VAR + 1], jac[(NUM_VAR + 1) * (NUM_VAR + 1)], row[NUM_VAR + 1], norm;
+    PetscBool singular;
+
+    for (i = 0; i <= n; i++)
+        row[i] = fixed ? (i == n ? 1.0 : 0.0) : t[i];
+
+    *converged = PETSC_FALSE;
+
+    for (it = 0; it <= arclength->max_it; it++)
+    {
+        ArclengthResidual(arclength, z, f);
+
+        f[n] = 0.0;
+
+        if (!fixed)
+            for (i = 0, f[n] = -h; i <= n; i++)
+                f[n] += t[i] * (z[i] - y[i]);
+
+        for (i = 0, norm = 0.0; i <= n; i++)
+            norm += f[i] * f[i];
+
+        norm = PetscSqrtReal(norm);
+
+        if (norm < arclength->atol)
+            *converged = PETSC_TRUE;
+
+        if (*converged || PetscIsInfOrNanReal(norm) || it == arclength->max_it)
+            break;
+
+        ArclengthJacobian(arclength, z, f, jac);
+
+        for (i = 0; i <= n; i++)
+            f[i] = -f[i];
+
+        ArclengthBorderedSolve(n, jac, row, f, &singular);
+
+        if (singular)
+            break;
+
+        for (i = 0; i <= n; i++)
+            z[i] += f[i];
+
+        arclength->num_iterations++;
+    }
+
+    *iterations = it;
+
+    return 0;
+}
+
+PetscErrorCode ArclengthSolverStart(ArclengthSolver *arclength, const PetscReal state[], PetscReal value, PetscReal direction,
+                                    PetscBool *converged)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, iterations, i, k;
+    PetscReal previous[NUM_VAR + 1] = {0.0};
+    PetscBool singular;
+
+    for (i = 0; i < n; i++)
+    {
+        k = arclength->var_index[i];
+        arclength->y[i] = state[k] / arclength->scale[k];
+    }
+
+    arclength->y[n] = value / arclength->parameter_scale;
+
+    ArclengthCorrect(arclength, arclength->y, PETSC_TRUE, 0.0, &iterations, converged);
+
+    if (!*converged)
+        return 0;
+
+    previous[n] = direction >= 0.0 ? 1.0 : -1.0;
+
+    ArclengthTangent(arclength, arclength->y, previous, arclength->tangent, &singular);
+
+    *converged = singular ? PETSC_FALSE : PETSC_TRUE;
+
+    return 0;
+}
+
+PetscErrorCode ArclengthSolverStep(ArclengthSolver *arclength, PetscReal end, PetscBool *reached, PetscBool *turning, PetscBool *converged)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, iterations = 0, i;
+    PetscReal *y = arclength->y, *t = arclength->tangent, h = arclength->step, scaled_end = end / arclength->parameter_scale;
+    PetscReal z[NUM_VAR + 1], predicted[NUM_VAR + 1], tangent[NUM_VAR + 1], distance;
+    PetscBool final = PETSC_FALSE, singular;
+
+    *reached = PETSC_FALSE;
+    *turning = PETSC_FALSE;
+    *converged = PETSC_FALSE;
+
+    for (; h >= arclength->min_step; h *= 0.5)
+    {
+        // Tangent predictor, landing on the end value of the parameter if it is crossed
+        for (i = 0; i <= n; i++)
+            predicted[i] = y[i] + h * t[i];
+
+        final = (predicted[n] - scaled_end) * (y[n] - scaled_end) <= 0.0 ? PETSC_TRUE : PETSC_FALSE;
+
+        if (final)
+            predicted[n] = scaled_end;
+
+        for (i = 0; i <= n; i++)
+            z[i] = predicted[i];
+
+        ArclengthCorrect(arclength, z, final, h, &iterations, converged);
+
+        // The corrector may carry the parameter across the end value even when the predictor stops short of it
+        if (*converged && !final && (z[n] - scaled_end) * (y[n] - scaled_end) <= 0.0)
+        {
+            final = PETSC_TRUE;
+            predicted[n] = scaled_end;
+
+            for (i = 0; i <= n; i++)
+                z[i] = predicted[i];
+
+            ArclengthCorrect(arclength, z, final, h, &iterations, converged);
+        }
+
+        for (i = 0, distance = 0.0; i <= n; i++)
+            distance += (z[i] - predicted[i]) * (z[i] - predicted[i]);
+
+        if (!*converged || PetscSqrtReal(distance) > h)
+            continue;
+
+        ArclengthTangent(arclength, z, t, tangent, &singular);
+
+        if (!singular)
+            break;
+    }
+
+    if (h < arclength->min_step)
+    {
+        *converged = PETSC_FALSE;
+        arclength->step = arclength->min_step;
+
+        return 0;
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Accepting the step and adapting the next one                                                                                                  //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (t[n] * tangent[n] < 0.0)
+    {
+        *turning = PETSC_TRUE;
+        arclength->num_turning_points++;
+    }
+
+    for (i = 0; i <= n; i++)
+    {
+        y[i] = z[i];
+        t[i] = tangent[i];
+    }
+
+    if (iterations <= 3)
+        h = PetscMin(1.5 * h, arclength->max_step);
+    else if (iterations >= 6)
+        h = PetscMax(0.7 * h, arclength->min_step);
+
+    arclength->step = h;
+    arclength->num_steps++;
+
+    *reached = final;
+
+    return 0;
+}
+
+PetscErrorCode ArclengthSolverGetPoint(ArclengthSolver *arclength, PetscReal state[], PetscReal *value)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = arclength->num_var, i, k;
+    PetscReal update[NUM_VAR];
+    PetscBool implicit[NUM_VAR] = {PETSC_FALSE};
+
+    ArclengthSetParameter(arclength, arclength->y[n]);
+
+    for (k = 0; k < NUM_VAR; k++)
+        state[k] = 0.0;
+
+    for (i = 0; i < n; i++)
+    {
+        k = arclength->var_index[i];
+        state[k] = arclength->y[i] * arclength->scale[k];
+        implicit[k] = PETSC_TRUE;
+    }
+
+    if (value)
+        *value = arclength->y[n] * arclength->parameter_scale;
+
+    if (arclength->formulation == FORMULATION_FULL)
+        return 0;
+
+    // Reconstructing the explicit unknowns in one pass of the balance
+    DessalContextBalance(&arclength->dessal_ctx, state, update);
+
+    for (k = 0; k < NUM_VAR; k++)
+        if (!implicit[k])
+            state[k] = update[k];
+
+    return 0;
+}
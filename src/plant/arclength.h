@@ -0,0 +1,47 @@
+#ifndef ARCLENGTH
+
+#define ARCLENGTH
+
+#include "solver.h"
+
+// Data structure containing the pseudo-arclength continuation of the plant system along a parameter of the desalination module
+typedef struct
+{
+    PetscInt num_var, var_index[NUM_VAR];
+    PlantFormulation formulation;
+    PetscReal scale[NUM_VAR];
+
+    // Entry data along the branch and its invariant terms (built at context_value of the parameter), and continued parameter and its scale
+    EntryData entry_data;
+    DessalContext dessal_ctx;
+    PetscReal *parameter, parameter_scale, context_value;
+
+    // Current point of the branch (scaled unknowns followed by the scaled parameter) and unit tangent, num_var + 1 values each
+    PetscReal y[NUM_VAR + 1], tangent[NUM_VAR + 1];
+
+    // Arclength step and its bounds, tolerance and maximum number of iterations of the corrector
+    PetscReal step, min_step, max_step, atol;
+    PetscInt max_it;
+
+    // Number of accepted steps and turning points, and of evaluations of the balance and corrector iterations
+    PetscInt num_steps, num_turning_points;
+    PetscInt64 num_evaluations, num_iterations;
+} ArclengthSolver;
+
+// Defining a pseudo-arclength solver constructor, continuing the plant system of a solver context along a named parameter of the
+// desalination module, with the reference scales of the solver context
+PetscErrorCode ArclengthSolverBuild(ArclengthSolver *arclength, SolverCtx *solver_ctx, const char name[]);
+
+// Function to start a branch at a value of the parameter from an initial guess of the solution there, heading towards increasing
+// (direction > 0) or decreasing values of the parameter
+PetscErrorCode ArclengthSolverStart(ArclengthSolver *arclength, const PetscReal state[], PetscReal value, PetscReal direction,
+                                    PetscBool *converged);
+
+// Function to advance a branch by one adaptive predictor-corrector step, landing exactly on the end value of the parameter when the step
+// would cross it, and flagging the turning points (where the branch folds back in the parameter)
+PetscErrorCode ArclengthSolverStep(ArclengthSolver *arclength, PetscReal end, PetscBool *reached, PetscBool *turning, PetscBool *converged);
+
+// Function to get the current point of a branch, i.e. the solution of the plant system and the value of the parameter
+PetscErrorCode ArclengthSolverGetPoint(ArclengthSolver *arclength, PetscReal state[], PetscReal *value);
+
+#endif
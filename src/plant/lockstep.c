@@ -0,0 +1,554 @@
+#include "lockstep.h"
+#include "plant.h"
+#include <float.h>
+
+/*
+Lockstep solution of many cases
+
+For a system as small as the plant one, solving the cases one at a time with SNES is dominated by the per-case and per-iteration overhead
+of the solver objects (vectors, matrix assembly, Krylov solver and preconditioner setup) rather than by the balance itself. The lockstep
+solver advances a block of cases together with the same damped Newton method: every iteration evaluates the residuals of all lanes, builds
+their finite-difference Jacobians column by column (as SNESComputeJacobianDefault does), factorizes them by a batched dense LU with partial
+pivoting and backtracks along the Newton steps until the norm of the residuals decreases. The arrays are stored structure-of-arrays, with
+the lanes fastest, so that the factorization, the updates and the norms loop over contiguous lanes and vectorize across cases. A lane whose
+case converged or failed is refilled from the list of cases, so all lanes stay busy until the list runs out; idle lanes carry an identity
+Jacobian. The convergence tests and tolerances are those of the nonlinear solver of the solver context.
+
+The lanes only run warm-started cases: far from the solution, this plain backtracking is less robust than the line search of SNES and can
+even land on a non-physical root (negative mass flux), so the cold starts (a list without any warm state), the retries of failed cases and
+the lanes converged to a non-physical root go through PlantSolveCase.
+
+With -precision mixed, a lane evaluates the single-precision balance (residuals, Jacobian columns with a differencing parameter scaled to
+single precision, and line search) until its residual norm falls below -precision_switch, or its single-precision iterations stall on the
+rounding noise of the balance (a step shorter than the step tolerance, or a line search without enough decrease). The lane then evaluates
+the double-precision balance at its current iterate and refines it with double-precision Newton iterations, so the convergence tests, the
+converged reasons and the final residual norms are always those of the double-precision balance.
+*/
+
+PetscErrorCode LockstepSolverBuild(LockstepSolver *lockstep, SolverCtx *solver_ctx, PetscInt num_lanes)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt n = solver_ctx->num_var, i;
+
+    PetscCheck(num_lanes > 0, PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "The lockstep solver needs at least one lane");
+    PetscCheck(solver_ctx->inverse.num_free == 0, PETSC_COMM_SELF, PETSC_ERR_SUP, "The lockstep solver does not support inverse problems");
+    PetscCheck(solver_ctx->num_loop == 0, PETSC_COMM_SELF, PETSC_ERR_SUP, "The lockstep solver does not support the recycle loop");
+
+    lockstep->num_lanes = num_lanes;
+    lockstep->num_var = n;
+    lockstep->formulation = solver_ctx->formulation;
+    lockstep->precision = solver_ctx->precision;
+    lockstep->switch_norm = 1.0e-5;
+    lockstep->num_evaluations = 0;
+    lockstep->num_single_evaluations = 0;
+    lockstep->num_fallbacks = 0;
+    lockstep->num_iterations = 0;
+
+    for (i = 0; i < n; i++)
+        lockstep->var_index[i] = solver_ctx->var_index[i];
+
+    SNESGetTolerances(solver_ctx->snes, &lockstep->atol, &lockstep->rtol, &lockstep->stol, &lockstep->max_it, NULL);
+
+    // Lanes of the reduced formulation are cut short as with SNES, the fallback solving them with the full formulation
+    if (lockstep->formulation == FORMULATION_REDUCED)
+        lockstep->max_it = PetscMin(lockstep->max_it, solver_ctx->reduced_max_it);
+    PetscOptionsGetReal(NULL, NULL, "-precision_switch", &lockstep->switch_norm, NULL);
+
+    PetscMalloc1(num_lanes, &lockstep->lane_case);
+    PetscMalloc1(num_lanes, &lockstep->iterations);
+    PetscMalloc1(num_lanes, &lockstep->reason);
+    PetscMalloc1(num_lanes, &lockstep->dessal_ctx);
+    PetscMalloc1(NUM_VAR * num_lanes, &lockstep->scale);
+    PetscMalloc1(n * num_lanes, &lockstep->x);
+    PetscMalloc1(n * num_lanes, &lockstep->f);
+    PetscMalloc1(n * num_lanes, &lockstep->step);
+    PetscMalloc1(n * num_lanes, &lockstep->x_trial);
+    PetscMalloc1(n * num_lanes, &lockstep->f_trial);
+    PetscMalloc1(n * n * num_lanes, &lockstep->jac);
+    PetscMalloc1(num_lanes, &lockstep->factor);
+    PetscMalloc1(num_lanes, &lockstep->fnorm);
+    PetscMalloc1(num_lanes, &lockstep->fnorm0);
+    PetscMalloc1(num_lanes, &lockstep->snorm);
+    PetscMalloc1(num_lanes, &lockstep->lambda);
+    PetscMalloc1(num_lanes, &lockstep->searching);
+    PetscMalloc1(num_lanes, &lockstep->single);
+
+    return 0;
+}
+
+PetscErrorCode LockstepResidual(LockstepSolver *lockstep, PetscInt lane, const PetscReal x[], PetscReal f[], PetscReal *norm)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, i, k;
+    PetscReal *scale = &lockstep->scale[lane * NUM_VAR];
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR];
+
+    for (i = 0; i < lockstep->num_var; i++)
+    {
+        k = lockstep->var_index[i];
+        state[k] = x[i * L + lane] * scale[k];
+    }
+
+    if (lockstep->single[lane])
+    {
+        DessalContextBalanceSingle(&lockstep->dessal_ctx[lane], state, update);
+        lockstep->num_single_evaluations++;
+    }
+    else
+        DessalContextBalance(&lockstep->dessal_ctx[lane], state, update);
+
+    *norm = 0.0;
+
+    for (i = 0; i < lockstep->num_var; i++)
+    {
+        k = lockstep->var_index[i];
+        f[i * L + lane] = (state[k] - update[k]) / scale[k];
+        *norm += f[i * L + lane] * f[i * L + lane];
+    }
+
+    *norm = PetscSqrtReal(*norm);
+
+    lockstep->num_evaluations++;
+
+    return 0;
+}
+
+PetscErrorCode LockstepStart(LockstepSolver *lockstep, SolverCtx *solver_ctx, PetscInt lane, PetscInt index, EntryData *case_data,
+                             const PetscReal guess[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, i, k;
+
+    // Invariant terms and scales of the case, computed as for a single solve
+    SolverCtxSetEntryData(solver_ctx, case_data);
+
+    lockstep->dessal_ctx[lane] = solver_ctx->dessal_ctx;
+
+    for (k = 0; k < NUM_VAR; k++)
+        lockstep->scale[lane * NUM_VAR + k] = solver_ctx->scale[k];
+
+    for (i = 0; i < lockstep->num_var; i++)
+    {
+        k = lockstep->var_index[i];
+        lockstep->x[i * L + lane] = guess[k] / solver_ctx->scale[k];
+    }
+
+    lockstep->lane_case[lane] = index;
+    lockstep->iterations[lane] = 0;
+    lockstep->reason[lane] = SNES_CONVERGED_ITERATING;
+    lockstep->snorm[lane] = PETSC_INFINITY;
+    lockstep->single[lane] = lockstep->precision == PRECISION_MIXED ? PETSC_TRUE : PETSC_FALSE;
+
+    LockstepResidual(lockstep, lane, lockstep->x, lockstep->f, &lockstep->fnorm[lane]);
+
+    lockstep->fnorm0[lane] = lockstep->fnorm[lane];
+
+    return 0;
+}
+
+// Function to move a lane of the mixed precision to the double-precision balance, its residual being evaluated again at its iterate
+PetscErrorCode LockstepRefine(LockstepSolver *lockstep, PetscInt lane)
+{
+    PetscFunctionBeginUser;
+
+    lockstep->single[lane] = PETSC_FALSE;
+    lockstep->snorm[lane] = PETSC_INFINITY;
+
+    LockstepResidual(lockstep, lane, lockstep->x, lockstep->f, &lockstep->fnorm[lane]);
+
+    return 0;
+}
+
+// Convergence tests of SNESConvergedDefault, on the residual norm and on the length of the last step
+PetscErrorCode LockstepTest(LockstepSolver *lockstep, PetscInt lane)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, i;
+    PetscReal fnorm, xnorm = 0.0;
+
+    if (lockstep->reason[lane] != SNES_CONVERGED_ITERATING)
+        return 0;
+
+    for (i = 0; i < lockstep->num_var; i++)
+        xnorm += lockstep->x[i * L + lane] * lockstep->x[i * L + lane];
+
+    xnorm = PetscSqrtReal(xnorm);
+
+    // The tests only apply to the double-precision residual, a lane in single precision switching to it when close enough or stalled
+    if (lockstep->single[lane] && (lockstep->fnorm[lane] < lockstep->switch_norm ||
+                                   (lockstep->iterations[lane] > 0 && lockstep->snorm[lane] < lockstep->stol * xnorm)))
+        LockstepRefine(lockstep, lane);
+
+    fnorm = lockstep->fnorm[lane];
+
+    if (PetscIsInfOrNanReal(fnorm))
+        lockstep->reason[lane] = SNES_DIVERGED_FNORM_NAN;
+    else if (fnorm < lockstep->atol)
+        lockstep->reason[lane] = SNES_CONVERGED_FNORM_ABS;
+    else if (lockstep->iterations[lane] > 0 && fnorm <= lockstep->rtol * lockstep->fnorm0[lane])
+        lockstep->reason[lane] = SNES_CONVERGED_FNORM_RELATIVE;
+    else if (lockstep->iterations[lane] > 0 && lockstep->snorm[lane] < lockstep->stol * xnorm)
+        lockstep->reason[lane] = SNES_CONVERGED_SNORM_RELATIVE;
+    else if (lockstep->iterations[lane] >= lockstep->max_it)
+        lockstep->reason[lane] = SNES_DIVERGED_MAX_IT;
+
+    return 0;
+}
+
+PetscErrorCode LockstepFinish(LockstepSolver *lockstep, PetscInt lane, PetscReal state[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, i, k;
+    PetscReal *scale = &lockstep->scale[lane * NUM_VAR];
+    PetscReal update[NUM_VAR];
+    PetscBool implicit[NUM_VAR] = {PETSC_FALSE};
+
+    for (k = 0; k < NUM_VAR; k++)
+        state[k] = 0.0;
+
+    for (i = 0; i < lockstep->num_var; i++)
+    {
+        k = lockstep->var_index[i];
+        state[k] = lockstep->x[i * L + lane] * scale[k];
+        implicit[k] = PETSC_TRUE;
+    }
+
+    if (lockstep->formulation == FORMULATION_FULL)
+        return 0;
+
+    // Reconstructing the explicit unknowns in one pass of the balance
+    DessalContextBalance(&lockstep->dessal_ctx[lane], state, update);
+
+    for (k = 0; k < NUM_VAR; k++)
+        if (!implicit[k])
+            state[k] = update[k];
+
+    return 0;
+}
+
+/*
+Batched LU factorization with partial pivoting, solving J step = f for every lane in place (J is overwritten)
+
+The pivot search and the row exchanges are done lane by lane, and the elimination, which carries most of the arithmetic, over all lanes at
+once. A lane with a zero or non-finite pivot is flagged as a failed linear solve.
+*/
+
+PetscErrorCode LockstepLUSolve(LockstepSolver *lockstep)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, n = lockstep->num_var, i, j, k, p, lane;
+    PetscReal *a = lockstep->jac, *b = lockstep->step, *factor = lockstep->factor, pivot, swap;
+
+    for (k = 0; k < n; k++)
+    {
+        for (lane = 0; lane < L; lane++)
+        {
+            for (p = k, i = k + 1; i < n; i++)
+                if (PetscAbsReal(a[(i * n + k) * L + lane]) > PetscAbsReal(a[(p * n + k) * L + lane]))
+                    p = i;
+
+            if (p != k)
+            {
+                for (j = 0; j < n; j++)
+                {
+                    swap = a[(k * n + j) * L + lane];
+                    a[(k * n + j) * L + lane] = a[(p * n + j) * L + lane];
+                    a[(p * n + j) * L + lane] = swap;
+                }
+
+                swap = b[k * L + lane];
+                b[k * L + lane] = b[p * L + lane];
+                b[p * L + lane] = swap;
+            }
+
+            pivot = a[(k * n + k) * L + lane];
+
+            if (!(PetscAbsReal(pivot) > 0.0) || PetscIsInfOrNanReal(pivot))
+            {
+                if (lockstep->lane_case[lane] >= 0)
+                    lockstep->reason[lane] = SNES_DIVERGED_LINEAR_SOLVE;
+
+                a[(k * n + k) * L + lane] = 1.0;
+            }
+        }
+
+        for (i = k + 1; i < n; i++)
+        {
+            for (lane = 0; lane < L; lane++)
+                factor[lane] = a[(i * n + k) * L + lane] / a[(k * n + k) * L + lane];
+
+            for (j = k + 1; j < n; j++)
+                for (lane = 0; lane < L; lane++)
+                    a[(i * n + j) * L + lane] -= factor[lane] * a[(k * n + j) * L + lane];
+
+            for (lane = 0; lane < L; lane++)
+                b[i * L + lane] -= factor[lane] * b[k * L + lane];
+        }
+    }
+
+    for (i = n - 1; i >= 0; i--)
+    {
+        for (j = i + 1; j < n; j++)
+            for (lane = 0; lane < L; lane++)
+                b[i * L + lane] -= a[(i * n + j) * L + lane] * b[j * L + lane];
+
+        for (lane = 0; lane < L; lane++)
+            b[i * L + lane] /= a[(i * n + i) * L + lane];
+    }
+
+    return 0;
+}
+
+PetscErrorCode LockstepSolve(LockstepSolver *lockstep, SolverCtx *solver_ctx, EntryData cases[], PetscInt num_cases,
+                             const PetscReal warm_states[], const PetscBool warm[], PetscReal states[], SNESConvergedReason reasons[])
+{
+    PetscFunctionBeginUser;
+
+    PetscInt L = lockstep->num_lanes, n = lockstep->num_var, next = 0, latest = -1, given = -1, active = 0, index, lane, step, i, j;
+    PetscInt snes_iterations;
+    PlantScreenReason screen;
+    const PetscReal *guess;
+    PetscReal h, norm;
+    PetscBool searching, physical;
+
+    for (lane = 0; lane < L; lane++)
+        lockstep->lane_case[lane] = -1;
+
+    while (next < num_cases || active > 0)
+    {
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+        // Convergence tests, fallbacks and refills of the lanes                                                                                     //
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+
+        for (lane = 0; lane < L; lane++)
+        {
+            index = lockstep->lane_case[lane];
+
+            if (index >= 0)
+            {
+                LockstepTest(lockstep, lane);
+
+                if (lockstep->reason[lane] == SNES_CONVERGED_ITERATING)
+                    continue;
+
+                LockstepFinish(lockstep, lane, &states[index * NUM_VAR]);
+                reasons[index] = lockstep->reason[lane];
+
+                // Non-physical roots are handed back to SNES, which lands on the root of a single solve (falling back to the full
+                // formulation for the reduced one)
+                if (reasons[index] > 0)
+                {
+                    PlantPhysical(&states[index * NUM_VAR], &physical);
+
+                    if (!physical)
+                        reasons[index] = SNES_DIVERGED_FUNCTION_DOMAIN;
+                }
+
+                // Cases that failed from their warm state are solved again from the default initial guess with SNES
+                if (reasons[index] <= 0)
+                {
+                    PlantSolveCase(solver_ctx, &cases[index], NULL, &states[index * NUM_VAR], &reasons[index]);
+                    SNESGetIterationNumber(solver_ctx->snes, &snes_iterations);
+                    lockstep->num_fallbacks++;
+                    lockstep->num_iterations += snes_iterations;
+                }
+
+                if (reasons[index] > 0 && index > latest)
+                    latest = index;
+
+                lockstep->lane_case[lane] = -1;
+                active--;
+            }
+
+            while (next < num_cases && lockstep->lane_case[lane] < 0)
+            {
+                // Next case of the list, from its warm state, the last converged case or the warm state of a previous case (the lanes
+                // start before the first cases converge)
+                index = next++;
+
+                if (warm_states && (!warm || warm[index]))
+                    given = index;
+
+                // Cases rejected by the screening never take a lane, PlantSolveCase leaving them at the default initial guess
+                PlantScreen(&cases[index], &screen);
+
+                if (screen != SCREEN_FEASIBLE)
+                {
+                    PlantSolveCase(solver_ctx, &cases[index], NULL, &states[index * NUM_VAR], &reasons[index]);
+
+                    continue;
+                }
+
+                if (given == index)
+                    guess = &warm_states[index * NUM_VAR];
+                else if (latest >= 0)
+                    guess = &states[latest * NUM_VAR];
+                else if (given >= 0)
+                    guess = &warm_states[given * NUM_VAR];
+                else
+                {
+                    // Without any warm state, the case is solved from the default initial guess with SNES and seeds the following ones
+                    PlantSolveCase(solver_ctx, &cases[index], NULL, &states[index * NUM_VAR], &reasons[index]);
+                    SNESGetIterationNumber(solver_ctx->snes, &snes_iterations);
+                    lockstep->num_fallbacks++;
+                    lockstep->num_iterations += snes_iterations;
+
+                    if (reasons[index] > 0)
+                        latest = index;
+
+                    continue;
+                }
+
+                LockstepStart(lockstep, solver_ctx, lane, index, &cases[index], guess);
+                active++;
+            }
+        }
+
+        if (active == 0)
+            continue;
+
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+        // Finite-difference Jacobians (identity for idle lanes) and Newton steps                                                                    //
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+
+        for (i = 0; i < n * L; i++)
+            lockstep->x_trial[i] = lockstep->x[i];
+
+        for (j = 0; j < n; j++)
+        {
+            for (lane = 0; lane < L; lane++)
+            {
+                if (lockstep->lane_case[lane] < 0)
+                {
+                    for (i = 0; i < n; i++)
+                        lockstep->jac[(i * n + j) * L + lane] = i == j ? 1.0 : 0.0;
+
+                    continue;
+                }
+
+                // Differencing parameter of SNESComputeJacobianDefault, at the precision of the balance
+                h = lockstep->x[j * L + lane];
+                if (PetscAbsReal(h) < 1.0e-6)
+                    h = h >= 0.0 ? 1.0e-6 : -1.0e-6;
+                h *= lockstep->single[lane] ? PetscSqrtReal((PetscReal)FLT_EPSILON) : PETSC_SQRT_MACHINE_EPSILON;
+
+                lockstep->x_trial[j * L + lane] += h;
+
+                LockstepResidual(lockstep, lane, lockstep->x_trial, lockstep->f_trial, &norm);
+
+                for (i = 0; i < n; i++)
+                    lockstep->jac[(i * n + j) * L + lane] = (lockstep->f_trial[i * L + lane] - lockstep->f[i * L + lane]) / h;
+
+                lockstep->x_trial[j * L + lane] = lockstep->x[j * L + lane];
+            }
+        }
+
+        for (i = 0; i < n * L; i++)
+            lockstep->step[i] = lockstep->f[i];
+
+        for (lane = 0; lane < L; lane++)
+            if (lockstep->lane_case[lane] < 0)
+                for (i = 0; i < n; i++)
+                    lockstep->step[i * L + lane] = 0.0;
+
+        LockstepLUSolve(lockstep);
+
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+        // Backtracking line search, lanes leaving the search as soon as their residual norm decreases enough                                        //
+        //-------------------------------------------------------------------------------------------------------------------------------------------//
+
+        for (lane = 0; lane < L; lane++)
+        {
+            lockstep->searching[lane] = lockstep->lane_case[lane] >= 0 && lockstep->reason[lane] == SNES_CONVERGED_ITERATING ? PETSC_TRUE
+                                                                                                                               : PETSC_FALSE;
+            lockstep->lambda[lane] = 1.0;
+        }
+
+        for (step = 0, searching = PETSC_TRUE; step < 30 && searching; step++)
+        {
+            for (i = 0; i < n; i++)
+                for (lane = 0; lane < L; lane++)
+                    lockstep->x_trial[i * L + lane] = lockstep->x[i * L + lane] - lockstep->lambda[lane] * lockstep->step[i * L + lane];
+
+            searching = PETSC_FALSE;
+
+            for (lane = 0; lane < L; lane++)
+            {
+                if (!lockstep->searching[lane])
+                    continue;
+
+                LockstepResidual(lockstep, lane, lockstep->x_trial, lockstep->f_trial, &norm);
+
+                if (!PetscIsInfOrNanReal(norm) && norm <= (1.0 - 1.0e-4 * lockstep->lambda[lane]) * lockstep->fnorm[lane])
+                {
+                    lockstep->searching[lane] = PETSC_FALSE;
+                    lockstep->fnorm[lane] = norm;
+                    lockstep->snorm[lane] = 0.0;
+
+                    for (i = 0; i < n; i++)
+                    {
+                        lockstep->snorm[lane] += PetscSqr(lockstep->lambda[lane] * lockstep->step[i * L + lane]);
+                        lockstep->x[i * L + lane] = lockstep->x_trial[i * L + lane];
+                        lockstep->f[i * L + lane] = lockstep->f_trial[i * L + lane];
+                    }
+
+                    lockstep->snorm[lane] = PetscSqrtReal(lockstep->snorm[lane]);
+                }
+                else
+                {
+                    lockstep->lambda[lane] *= 0.5;
+                    searching = PETSC_TRUE;
+                }
+            }
+        }
+
+        for (lane = 0; lane < L; lane++)
+        {
+            if (lockstep->lane_case[lane] < 0)
+                continue;
+
+            // A line search failing in single precision reached the rounding noise of the balance, and carries on in double precision
+            if (lockstep->searching[lane] && lockstep->single[lane])
+                LockstepRefine(lockstep, lane);
+            else if (lockstep->searching[lane])
+                lockstep->reason[lane] = SNES_DIVERGED_LINE_SEARCH;
+
+            lockstep->iterations[lane]++;
+            lockstep->num_iterations++;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode LockstepSolverDestroy(LockstepSolver *lockstep)
+{
+    PetscFunctionBeginUser;
+
+    PetscFree(lockstep->lane_case);
+    PetscFree(lockstep->iterations);
+    PetscFree(lockstep->reason);
+    PetscFree(lockstep->dessal_ctx);
+    PetscFree(lockstep->scale);
+    PetscFree(lockstep->x);
+    PetscFree(lockstep->f);
+    PetscFree(lockstep->step);
+    PetscFree(lockstep->x_trial);
+    PetscFree(lockstep->f_trial);
+    PetscFree(lockstep->jac);
+    PetscFree(lockstep->factor);
+    PetscFree(lockstep->fnorm);
+    PetscFree(lockstep->fnorm0);
+    PetscFree(lockstep->snorm);
+    PetscFree(lockstep->lambda);
+    PetscFree(lockstep->searching);
+    PetscFree(lockstep->single);
+
+    return 0;
+}
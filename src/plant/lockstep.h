@@ -0,0 +1,45 @@
+#ifndef LOCKSTEP
+
+#define LOCKSTEP
+
+#include "solver.h"
+
+// Data structure containing the lanes of the lockstep solver, each lane holding one case; the arrays are stored structure-of-arrays
+// (lane index fastest), so that the per-lane arithmetic of the Newton iterations runs over contiguous lanes
+typedef struct
+{
+    PetscInt num_lanes, num_var, var_index[NUM_VAR], max_it;
+    PetscReal atol, rtol, stol;
+    PlantFormulation formulation;
+    PlantPrecision precision;
+    PetscReal switch_norm; // Residual norm below which a lane of the mixed precision leaves the single-precision balance
+
+    // Case held by each lane (-1 when idle), its Newton iteration count and its converged reason
+    PetscInt *lane_case, *iterations;
+    SNESConvergedReason *reason;
+
+    // Invariant terms of the balance and reference scales of the case of each lane
+    DessalContext *dessal_ctx;
+    PetscReal *scale;
+
+    // Scaled unknowns, residuals, Newton steps, trial points and Jacobians (num_var x num_var per lane), and the norms of each lane
+    PetscReal *x, *f, *step, *x_trial, *f_trial, *jac, *factor, *fnorm, *fnorm0, *snorm, *lambda;
+    PetscBool *searching, *single; // Lanes in their line search, and lanes evaluating the single-precision balance
+
+    // Number of evaluations of the balance in the lanes (and of those in single precision), of cases solved by SNES instead, and of
+    // Newton iterations (in the lanes and by SNES), since the solver was built
+    PetscInt64 num_evaluations, num_single_evaluations, num_fallbacks, num_iterations;
+} LockstepSolver;
+
+// Defining a lockstep solver constructor, the formulation, precision and tolerances being taken from a solver context
+PetscErrorCode LockstepSolverBuild(LockstepSolver *lockstep, SolverCtx *solver_ctx, PetscInt num_lanes);
+
+// Function to solve a list of cases, advancing up to num_lanes of them together; cases without a warm state start from the last converged
+// case of the list, and cold starts and retries of failed cases are left to PlantSolveCase
+PetscErrorCode LockstepSolve(LockstepSolver *lockstep, SolverCtx *solver_ctx, EntryData cases[], PetscInt num_cases,
+                             const PetscReal warm_states[], const PetscBool warm[], PetscReal states[], SNESConvergedReason reasons[]);
+
+// Defining a lockstep solver destructor
+PetscErrorCode LockstepSolverDestroy(LockstepSolver *lockstep);
+
+#endif
@@ -1,31 +1,62 @@
-#include "../entrydata/entrydata.h"
+#include "output.h"
 #include "../properties/properties.h"
+#include "../recycle/recycle.h"
 
-PetscErrorCode ExportToFile(Vec *vector, EntryData *entry_data, char file[])
+/*
+Key performance indicators of the plant: distillate production, gain-output ratio, specific thermal energy consumption and thermal
+efficiency, assuming the heat input is the one needed to bring the coolant from its outlet temperature to the feed inlet temperature
+*/
+
+PetscErrorCode ComputeKPIs(const PetscReal state[], DessalData *dessal_data, PlantKPIs *kpis)
+{
+    PetscFunctionBeginUser;
+
+    SaltWaterProperties prop;
+    PetscReal heat_input;
+
+    SaltWaterPropBuild(&prop,
+                       0.5 * (dessal_data->entry_temperature_feed + state[1]),
+                       dessal_data->entry_salinity_cool);
+
+    heat_input = dessal_data->cool_mass_flow_rate * prop.specific_heat * (dessal_data->entry_temperature_feed - state[1]);
+
+    kpis->permeate_flux = 3600.0 * state[8];
+    kpis->distillate_rate = 3600.0 * state[8] * dessal_data->membrane_area;
+    kpis->GOR = state[10] * dessal_data->membrane_area / heat_input;
+    kpis->SEC = heat_input / (3600.0 * state[8] * dessal_data->membrane_area);
+    kpis->thermal_efficiency = 100.0 * state[10] / state[9];
+
+    return 0;
+}
+
+PetscErrorCode KPIsToArray(PlantKPIs *kpis, PetscReal array[])
+{
+    PetscFunctionBeginUser;
+
+    array[0] = kpis->permeate_flux;
+    array[1] = kpis->distillate_rate;
+    array[2] = kpis->GOR;
+    array[3] = kpis->SEC;
+    array[4] = kpis->thermal_efficiency;
+
+    return 0;
+}
+
+PetscErrorCode ExportToFile(const PetscReal state[], EntryData *entry_data, char file[])
 {
     PetscFunctionBeginUser;
 
     PetscViewer viewer;
-    const PetscScalar *array;
+    const PetscReal *array = state;
     FILE *fptr;
 
     PetscViewerASCIIOpen(PETSC_COMM_WORLD, file, &viewer);
     PetscViewerFileSetMode(viewer, FILE_MODE_WRITE);
     PetscViewerASCIIGetPointer(viewer, &fptr);
 
-    VecGetArrayRead(*vector, &array);
-
-    DessalData dessal_data = entry_data->dessal_data;
-    SaltWaterProperties prop;
-    PetscReal GOR, SEC;
-
-    SaltWaterPropBuild(&prop,
-                       0.5 * (dessal_data.entry_temperature_feed + array[1]),
-                       dessal_data.entry_salinity_cool);
+    PlantKPIs kpis;
 
-    GOR = dessal_data.cool_mass_flow_rate * prop.specific_heat * (dessal_data.entry_temperature_feed - array[1]);
-    SEC = GOR / (3600.0 * array[8] * dessal_data.membrane_area);
-    GOR = array[10] * dessal_data.membrane_area / GOR;
+    ComputeKPIs(state, &entry_data->dessal_data, &kpis);
 
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Desalination module:,,\n\n");
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Feed temperature at the outlet of the module =, %.10f, °C\n", array[0]);
@@ -39,12 +70,30 @@ PetscErrorCode ExportToFile(Vec *vector, EntryData *entry_data, char file[])
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Mass flux =, %.10f, kg/m²h\n", 3600.0 * array[8]);
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Heat flux =, %.10f, W/m²\n", array[9]);
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Vapor heat flux =, %.10f, W/m²\n", array[10]);
-    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Gain-output ratio (GOR) =, %.10f,\n", GOR);
-    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Specific thermal energy consumption (SECth) =, %.10f, kWh/m³\n", SEC);
-    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Thermal efficiency =, %.10f,%%\n", 100.0 * array[10] / array[9]);
+    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Gain-output ratio (GOR) =, %.10f,\n", kpis.GOR);
+    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Specific thermal energy consumption (SECth) =, %.10f, kWh/m³\n", kpis.SEC);
+    PetscFPrintf(PETSC_COMM_WORLD, fptr, "Thermal efficiency =, %.10f,%%\n", kpis.thermal_efficiency);
     PetscFPrintf(PETSC_COMM_WORLD, fptr, "Feed mass flowrate at the outlet of the module =, %.10f, kg/s\n", array[11]);
 
-    VecRestoreArrayRead(*vector, &array);
+    if (entry_data->recycle_data.enabled)
+    {
+        RecycleStreams streams;
+
+        RecycleBalance(&entry_data->recycle_data, &entry_data->dessal_data, state, &streams);
+
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "\nRecycle loop:,,\n\n");
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Feed temperature at the inlet of the module =, %.10f, °C\n",
+                     entry_data->dessal_data.entry_temperature_feed);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Feed salinity at the inlet of the module =, %.10f, wt%%\n",
+                     100.0 * entry_data->dessal_data.entry_salinity_feed);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Makeup mass flowrate =, %.10f, kg/s\n", streams.makeup_flow_rate);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Recycled brine mass flowrate =, %.10f, kg/s\n", streams.recycle_flow_rate);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Discharged brine mass flowrate =, %.10f, kg/s\n", streams.brine_discharge_rate);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Discharged coolant mass flowrate =, %.10f, kg/s\n", streams.cool_discharge_rate);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Feed temperature ahead of the heater =, %.10f, °C\n", streams.mix_temperature);
+        PetscFPrintf(PETSC_COMM_WORLD, fptr, "Heater power =, %.10f, W\n", streams.heater_power);
+    }
+
     PetscViewerDestroy(&viewer);
 
     return 0;
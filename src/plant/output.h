@@ -4,7 +4,25 @@
 
 #include "../entrydata/entrydata.h"
 
+// Number of key performance indicators of the plant
+#define NUM_KPI 5
+
+// Names of the key performance indicators, in the order of KPIsToArray
+static const char *const kpi_names[] = {"permeate_flux", "distillate_rate", "GOR", "SEC", "thermal_efficiency"};
+
+// Data structure containing the key performance indicators of the plant
+typedef struct
+{
+    PetscReal permeate_flux, distillate_rate, GOR, SEC, thermal_efficiency;
+} PlantKPIs;
+
+// Function to compute the key performance indicators from the solution of the plant system
+PetscErrorCode ComputeKPIs(const PetscReal state[], DessalData *dessal_data, PlantKPIs *kpis);
+
+// Function to copy the key performance indicators into an array
+PetscErrorCode KPIsToArray(PlantKPIs *kpis, PetscReal array[]);
+
 // Function to export the results to a file
-PetscErrorCode ExportToFile(Vec *vector, EntryData *entry_data, char file[]);
+PetscErrorCode ExportToFile(const PetscReal state[], EntryData *entry_data, char file[]);
 
-#endif
\ No newline at end of file
+#endif
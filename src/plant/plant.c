@@ -1,28 +1,86 @@
-#include "solver.h"
-#include "output.h"
+#include "plant.h"
 #include "../dessal/dessal.h"
+#include "../properties/properties.h"
 
-PetscErrorCode InitialGuess(Vec x, SolverCtx *solver_ctx)
+PetscErrorCode PlantOutputFind(const char name[], PetscInt *index)
+{
+    PetscFunctionBeginUser;
+
+    PetscBool match;
+    PetscInt k;
+
+    *index = -1;
+
+    // Unknowns take precedence over KPIs of the same name
+    for (k = 0; k < NUM_VAR; k++)
+    {
+        PetscStrcmp(name, dessal_state_names[k], &match);
+
+        if (match)
+        {
+            *index = k;
+
+            return 0;
+        }
+    }
+
+    for (k = 0; k < NUM_KPI; k++)
+    {
+        PetscStrcmp(name, kpi_names[k], &match);
+
+        if (match)
+        {
+            *index = NUM_VAR + k;
+
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+PetscErrorCode PlantOutput(const PetscReal state[], DessalData *dessal_data, PetscInt index, PetscReal *value)
+{
+    PetscFunctionBeginUser;
+
+    PlantKPIs kpis;
+    PetscReal kpi_array[NUM_KPI];
+
+    if (index < NUM_VAR)
+    {
+        *value = state[index];
+
+        return 0;
+    }
+
+    ComputeKPIs(state, dessal_data, &kpis);
+    KPIsToArray(&kpis, kpi_array);
+
+    *value = kpi_array[index - NUM_VAR];
+
+    return 0;
+}
+
+PetscErrorCode InitialGuess(Vec x, SolverCtx *solver_ctx, const PetscReal state[])
 {
-    EntryData entry_data = solver_ctx->entry_data;
-    DessalData dessal_data = entry_data.dessal_data;
     DM da = solver_ctx->da;
     PetscScalar *x_array;
+    PetscInt i, k;
 
     DMDAVecGetArray(da, x, &x_array);
 
-    x_array[0] = dessal_data.out_temperature_feed;
-    x_array[1] = dessal_data.out_temperature_cool;
-    x_array[2] = dessal_data.feed_membrane_temperature;
-    x_array[3] = dessal_data.gap_membrane_temperature;
-    x_array[4] = dessal_data.film_boundary_temperature;
-    x_array[5] = dessal_data.film_wall_temperature;
-    x_array[6] = dessal_data.cool_wall_temperature;
-    x_array[7] = dessal_data.out_salinity_feed;
-    x_array[8] = dessal_data.mass_flux;
-    x_array[9] = dessal_data.heat_flux;
-    x_array[10] = dessal_data.vapor_heat_flux;
-    x_array[11] = dessal_data.feed_outflow_rate;
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        x_array[i] = state[k] / solver_ctx->scale[k];
+    }
+
+    // Freed inputs of an inverse problem and inlets closed by the recycle loop, starting from their current values
+    for (i = 0; i < solver_ctx->inverse.num_free; i++)
+        x_array[solver_ctx->num_var + i] = *solver_ctx->free_input[i] / solver_ctx->input_scale[i];
+
+    for (i = 0; i < solver_ctx->num_loop; i++)
+        x_array[solver_ctx->num_var + solver_ctx->inverse.num_free + i] = *solver_ctx->loop_input[i] / solver_ctx->loop_scale[i];
 
     DMDAVecRestoreArray(da, x, &x_array);
 
@@ -32,10 +90,12 @@ PetscErrorCode InitialGuess(Vec x, SolverCtx *solver_ctx)
 PetscErrorCode PlantBalances(SNES snes, Vec x, Vec f, void *ctx)
 {
     SolverCtx *solver_ctx = (SolverCtx *)ctx;
-    EntryData entry_data = solver_ctx->entry_data;
-    DessalData dessal_data = entry_data.dessal_data;
     DM da = solver_ctx->da;
     PetscScalar *x_array, *f_array;
+    PetscReal *scale = solver_ctx->scale;
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR], output, closure[2];
+    PetscInt num_free = solver_ctx->inverse.num_free, num_loop = solver_ctx->num_loop, i, k;
+    RecycleStreams streams;
     Vec x_local;
 
     DMGetLocalVector(da, &x_local);
@@ -47,35 +107,72 @@ PetscErrorCode PlantBalances(SNES snes, Vec x, Vec f, void *ctx)
     // Desalination module                                                                                                                           //
     //-----------------------------------------------------------------------------------------------------------------------------------------------//
 
-    // Setting iterative data
-    dessal_data.out_temperature_feed = x_array[0];
-    dessal_data.out_temperature_cool = x_array[1];
-    dessal_data.feed_membrane_temperature = x_array[2];
-    dessal_data.gap_membrane_temperature = x_array[3];
-    dessal_data.film_boundary_temperature = x_array[4];
-    dessal_data.film_wall_temperature = x_array[5];
-    dessal_data.cool_wall_temperature = x_array[6];
-    dessal_data.out_salinity_feed = x_array[7];
-    dessal_data.mass_flux = x_array[8];
-    dessal_data.heat_flux = x_array[9];
-    dessal_data.vapor_heat_flux = x_array[10];
-    dessal_data.feed_outflow_rate = x_array[11];
+    // Setting iterative data (mapping the scaled unknowns back to physical units; in the reduced formulation, the explicit unknowns are
+    // not read by the balance)
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * scale[k];
+    }
+
+    // Setting the freed inputs of an inverse problem and the inlets closed by the recycle loop, which changes the invariant terms of the
+    // balance
+    if (num_free > 0 || num_loop > 0)
+    {
+        for (i = 0; i < num_free; i++)
+            *solver_ctx->free_input[i] = x_array[solver_ctx->num_var + i] * solver_ctx->input_scale[i];
+
+        for (i = 0; i < num_loop; i++)
+            *solver_ctx->loop_input[i] = x_array[solver_ctx->num_var + num_free + i] * solver_ctx->loop_scale[i];
+
+        DessalContextBuild(&solver_ctx->dessal_ctx, &solver_ctx->entry_data.dessal_data);
+    }
 
     // Updating iterative data
-    DessalBalance(&dessal_data);
-
-    f_array[0] = x_array[0] - dessal_data.out_temperature_feed;
-    f_array[1] = x_array[1] - dessal_data.out_temperature_cool;
-    f_array[2] = x_array[2] - dessal_data.feed_membrane_temperature;
-    f_array[3] = x_array[3] - dessal_data.gap_membrane_temperature;
-    f_array[4] = x_array[4] - dessal_data.film_boundary_temperature;
-    f_array[5] = x_array[5] - dessal_data.film_wall_temperature;
-    f_array[6] = x_array[6] - dessal_data.cool_wall_temperature;
-    f_array[7] = x_array[7] - dessal_data.out_salinity_feed;
-    f_array[8] = x_array[8] - dessal_data.mass_flux;
-    f_array[9] = x_array[9] - dessal_data.heat_flux;
-    f_array[10] = x_array[10] - dessal_data.vapor_heat_flux;
-    f_array[11] = x_array[11] - dessal_data.feed_outflow_rate;
+    DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        f_array[i] = (state[k] - update[k]) / scale[k];
+    }
+
+    // Outputs and outlets are evaluated on the iterated unknowns, completed with the explicit ones from the balance in the reduced
+    // formulation
+    if ((num_free > 0 || num_loop > 0) && solver_ctx->formulation == FORMULATION_REDUCED)
+    {
+        state[5] = update[5];
+        state[8] = update[8];
+        state[9] = update[9];
+        state[10] = update[10];
+        state[11] = update[11];
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Targets of an inverse problem                                                                                                                 //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    for (i = 0; i < num_free; i++)
+    {
+        PlantOutput(state, &solver_ctx->entry_data.dessal_data, solver_ctx->inverse.output[i], &output);
+        f_array[solver_ctx->num_var + i] = solver_ctx->inverse.orientation[i] * (output - solver_ctx->inverse.target[i]) /
+                                           solver_ctx->output_scale[i];
+    }
+
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+    // Closure of the recycle loop                                                                                                                   //
+    //-----------------------------------------------------------------------------------------------------------------------------------------------//
+
+    if (num_loop > 0)
+    {
+        RecycleBalance(&solver_ctx->entry_data.recycle_data, &solver_ctx->entry_data.dessal_data, state, &streams);
+
+        closure[0] = streams.mix_salinity;
+        closure[1] = streams.heater_temperature;
+
+        for (i = 0; i < num_loop; i++)
+            f_array[solver_ctx->num_var + num_free + i] = (*solver_ctx->loop_input[i] - closure[i]) / solver_ctx->loop_scale[i];
+    }
 
     DMDAVecRestoreArray(da, x_local, &x_array);
     DMDAVecRestoreArray(da, f, &f_array);
@@ -84,32 +181,660 @@ PetscErrorCode PlantBalances(SNES snes, Vec x, Vec f, void *ctx)
     return 0;
 }
 
+/*
+Incremental finite-difference Jacobian
+
+The columns are differenced as in SNESComputeJacobianDefault, with the same differencing parameter, but the balance is evaluated once in
+full at the current unknowns and each perturbed evaluation starts from a copy of its cached nodes: perturbing one unknown only recomputes
+the properties and resistances that read it (e.g. the properties of the coolant for its outlet temperature), which gives the same Jacobian
+at a fraction of the cost. The freed inputs of an inverse problem and the inlets closed by the recycle loop change the invariant terms of
+the balance, so these systems fall back to SNESComputeJacobianDefault.
+*/
+
+PetscErrorCode PlantJacobianIncremental(SNES snes, Vec x, Mat jac, Mat pre, void *ctx)
+{
+    SolverCtx *solver_ctx = (SolverCtx *)ctx;
+    DM da = solver_ctx->da;
+    PetscScalar *x_array;
+    PetscReal *scale = solver_ctx->scale;
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR], f[NUM_VAR], column[NUM_VAR], h;
+    PetscInt n = solver_ctx->num_var, rows[NUM_VAR], i, j, k, l;
+    DessalCache base, cache;
+
+    if (solver_ctx->inverse.num_free > 0 || solver_ctx->num_loop > 0)
+        return SNESComputeJacobianDefault(snes, x, jac, pre, NULL);
+
+    DMDAVecGetArray(da, x, &x_array);
+
+    for (i = 0; i < n; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * scale[k];
+        rows[i] = i;
+    }
+
+    base.valid = PETSC_FALSE;
+    DessalContextBalanceCached(&solver_ctx->dessal_ctx, &base, state, update);
+
+    for (i = 0; i < n; i++)
+    {
+        k = solver_ctx->var_index[i];
+        f[i] = (state[k] - update[k]) / scale[k];
+    }
+
+    MatSetOption(pre, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_FALSE);
+
+    for (j = 0; j < n; j++)
+    {
+        // Differencing parameter of SNESComputeJacobianDefault
+        h = x_array[j];
+        if (PetscAbsReal(h) < 1.0e-6)
+            h = h >= 0.0 ? 1.0e-6 : -1.0e-6;
+        h *= PETSC_SQRT_MACHINE_EPSILON;
+
+        k = solver_ctx->var_index[j];
+        state[k] = (x_array[j] + h) * scale[k];
+
+        cache = base;
+        DessalContextBalanceCached(&solver_ctx->dessal_ctx, &cache, state, update);
+
+        for (i = 0; i < n; i++)
+        {
+            l = solver_ctx->var_index[i];
+            column[i] = ((state[l] - update[l]) / scale[l] - f[i]) / h;
+        }
+
+        state[k] = x_array[j] * scale[k];
+
+        MatSetValues(pre, n, rows, 1, &j, column, INSERT_VALUES);
+    }
+
+    DMDAVecRestoreArray(da, x, &x_array);
+
+    MatAssemblyBegin(pre, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(pre, MAT_FINAL_ASSEMBLY);
+
+    if (jac != pre)
+    {
+        MatAssemblyBegin(jac, MAT_FINAL_ASSEMBLY);
+        MatAssemblyEnd(jac, MAT_FINAL_ASSEMBLY);
+    }
+
+    return 0;
+}
+
+PetscErrorCode ReconstructState(Vec x, SolverCtx *solver_ctx, PetscReal state[])
+{
+    DM da = solver_ctx->da;
+    PetscScalar *x_array;
+    PetscReal update[NUM_VAR];
+    PetscInt i, k;
+
+    DMDAVecGetArray(da, x, &x_array);
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * solver_ctx->scale[k];
+    }
+
+    // Freed inputs of an inverse problem and inlets closed by the recycle loop, left in the entry data of the solver context
+    if (solver_ctx->inverse.num_free > 0 || solver_ctx->num_loop > 0)
+    {
+        for (i = 0; i < solver_ctx->inverse.num_free; i++)
+            *solver_ctx->free_input[i] = x_array[solver_ctx->num_var + i] * solver_ctx->input_scale[i];
+
+        for (i = 0; i < solver_ctx->num_loop; i++)
+            *solver_ctx->loop_input[i] = x_array[solver_ctx->num_var + solver_ctx->inverse.num_free + i] * solver_ctx->loop_scale[i];
+
+        DessalContextBuild(&solver_ctx->dessal_ctx, &solver_ctx->entry_data.dessal_data);
+    }
+
+    DMDAVecRestoreArray(da, x, &x_array);
+
+    if (solver_ctx->formulation == FORMULATION_FULL)
+        return 0;
+
+    // Reconstructing the explicit unknowns in one pass of the balance
+    DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+
+    state[5] = update[5];
+    state[8] = update[8];
+    state[9] = update[9];
+    state[10] = update[10];
+    state[11] = update[11];
+
+    return 0;
+}
+
+PetscErrorCode PlantPhysical(const PetscReal state[], PetscBool *physical)
+{
+    PetscFunctionBeginUser;
+
+    *physical = (PetscBool)(state[8] > 0.0 && state[11] > 0.0);
+
+    return 0;
+}
+
+/*
+Active physical bounds
+
+The variational inequality solver converges on the residuals of the unknowns free of their bounds, so with -bounded a case clamped at a
+physical bound (e.g. a vanishing mass flux) is reported as converged although it is not a root of the plant system. The residual of the
+unbounded system is evaluated at the solution: when it exceeds the tolerance of the solver (the absolute one, the relative one applied to
+the initial residual, or the free residual it converged on), a bound holds the solution and the case is not converged.
+*/
+
+PetscErrorCode PlantBoundActive(SolverCtx *solver_ctx, PetscReal initial_norm, PetscBool *active)
+{
+    PetscFunctionBeginUser;
+
+    Vec residual;
+    PetscReal norm, free_norm, atol, rtol;
+
+    VecDuplicate(solver_ctx->solution, &residual);
+    SNESComputeFunction(solver_ctx->snes, solver_ctx->solution, residual);
+    VecNorm(residual, NORM_2, &norm);
+    VecDestroy(&residual);
+
+    SNESGetFunctionNorm(solver_ctx->snes, &free_norm);
+    SNESGetTolerances(solver_ctx->snes, &atol, &rtol, NULL, NULL, NULL);
+
+    *active = (PetscBool)(!(norm <= PetscMax(PetscMax(atol, rtol * initial_norm), free_norm)));
+
+    return 0;
+}
+
+/*
+Fallback of the reduced formulation
+
+The explicit unknowns of the reduced formulation (the mass and heat fluxes, the feed outflow rate and the film wall temperature) are not
+iterated upon, so nothing keeps the implicit ones away from a root whose mass flux or feed outflow rate is negative, and the reduced system
+may stall where the full one converges. The reduced solve is cut at -reduced_max_it iterations, and a case that fails with the reduced
+formulation, or converges to a non-physical root, is solved again with the full formulation from the same initial guess (the freed inputs
+and the inlets closed by the recycle loop included). The solver context is left in the full formulation, which holds the solution, and
+switches back to the reduced one at its next solve, so a fallback rebuilds the distributed array once.
+*/
+
+PetscErrorCode PlantSolve(SolverCtx *solver_ctx, PetscReal state[], SNESConvergedReason *reason)
+{
+    PetscFunctionBeginUser;
+
+    Vec solution = solver_ctx->solution;
+    SNESLineSearch linesearch;
+    RecycleStreams streams;
+    PetscBool feasible, active, physical;
+    Vec residual;
+    PetscReal initial_norm = 0.0, guess[NUM_VAR], free_guess[MAX_INVERSE], loop_guess[2], atol, rtol, stol;
+    PetscInt max_it, max_funcs, i;
+
+    // The reduced formulation set back after a fallback of the previous solve
+    if (solver_ctx->fallback)
+    {
+        solver_ctx->fallback = PETSC_FALSE;
+        PetscCall(SolverCtxSetFormulation(solver_ctx, FORMULATION_REDUCED));
+        solution = solver_ctx->solution;
+    }
+
+    // Initial guess, including the freed inputs and the closed inlets, for the fallback of the reduced formulation
+    PetscArraycpy(guess, state, NUM_VAR);
+
+    for (i = 0; i < solver_ctx->inverse.num_free; i++)
+        free_guess[i] = *solver_ctx->free_input[i];
+    for (i = 0; i < solver_ctx->num_loop; i++)
+        loop_guess[i] = *solver_ctx->loop_input[i];
+
+    InitialGuess(solution, solver_ctx, state);
+
+    SNESSetFunction(solver_ctx->snes, NULL, PlantBalances, solver_ctx);
+    if (solver_ctx->jacobian == JACOBIAN_INCREMENTAL)
+        SNESSetJacobian(solver_ctx->snes, solver_ctx->jac, solver_ctx->jac, PlantJacobianIncremental, solver_ctx);
+    else
+        SNESSetJacobian(solver_ctx->snes, solver_ctx->jac, solver_ctx->jac, SNESComputeJacobianDefault, NULL);
+
+    // The line search of the solver type set last reports its steps to the trace recorder
+    if (solver_ctx->trace)
+    {
+        SNESGetLineSearch(solver_ctx->snes, &linesearch);
+        SNESLineSearchSetPostCheck(linesearch, PlantTraceLineSearch, solver_ctx);
+        PlantTraceBegin(solver_ctx->trace, &solver_ctx->dessal_ctx,
+                        solver_ctx->num_var + solver_ctx->inverse.num_free + solver_ctx->num_loop, solver_ctx->formulation);
+    }
+
+    // The initial residual sets the relative tolerance against which the physical bounds are checked
+    if (solver_ctx->bounded)
+    {
+        VecDuplicate(solution, &residual);
+        SNESComputeFunction(solver_ctx->snes, solution, residual);
+        VecNorm(residual, NORM_2, &initial_norm);
+        VecDestroy(&residual);
+    }
+
+    // A reduced solve that stalls is cut short, the full formulation taking over
+    SNESGetTolerances(solver_ctx->snes, &atol, &rtol, &stol, &max_it, &max_funcs);
+
+    if (solver_ctx->formulation == FORMULATION_REDUCED)
+        SNESSetTolerances(solver_ctx->snes, atol, rtol, stol, PetscMin(max_it, solver_ctx->reduced_max_it), max_funcs);
+
+    SNESSolve(solver_ctx->snes, NULL, solution);
+    SNESGetConvergedReason(solver_ctx->snes, reason);
+
+    SNESSetTolerances(solver_ctx->snes, atol, rtol, stol, max_it, max_funcs);
+
+    if (solver_ctx->trace)
+        PlantTraceEnd(solver_ctx->trace, solver_ctx->snes);
+
+    // Solutions clamped at a physical bound are not roots of the plant system
+    if (*reason > 0 && solver_ctx->bounded)
+    {
+        PlantBoundActive(solver_ctx, initial_norm, &active);
+
+        if (active)
+            *reason = SNES_DIVERGED_FUNCTION_DOMAIN;
+    }
+
+    ReconstructState(solution, solver_ctx, state);
+
+    if (solver_ctx->formulation == FORMULATION_REDUCED)
+    {
+        PlantPhysical(state, &physical);
+
+        if (*reason <= 0 || !physical)
+        {
+            PetscArraycpy(state, guess, NUM_VAR);
+
+            for (i = 0; i < solver_ctx->inverse.num_free; i++)
+                *solver_ctx->free_input[i] = free_guess[i];
+            for (i = 0; i < solver_ctx->num_loop; i++)
+                *solver_ctx->loop_input[i] = loop_guess[i];
+
+            DessalContextBuild(&solver_ctx->dessal_ctx, &solver_ctx->entry_data.dessal_data);
+
+            PetscCall(SolverCtxSetFormulation(solver_ctx, FORMULATION_FULL));
+            PetscCall(PlantSolve(solver_ctx, state, reason));
+
+            solver_ctx->fallback = PETSC_TRUE;
+
+            return 0;
+        }
+    }
+
+    // Solutions of the recycle loop outside its physical range are rejected
+    if (*reason > 0 && solver_ctx->num_loop > 0)
+    {
+        RecycleBalance(&solver_ctx->entry_data.recycle_data, &solver_ctx->entry_data.dessal_data, state, &streams);
+        RecycleFeasible(&streams, state, &feasible);
+
+        if (!feasible)
+            *reason = SNES_DIVERGED_FUNCTION_DOMAIN;
+    }
+
+    return 0;
+}
+
+/*
+Sensitivities of the solution to parameters of the desalination module
+
+The solution x(p) satisfies G(x, p) = x - B(x, p) = 0, B being the balance of the desalination module, so by the implicit function theorem
+dx/dp = (dG/dx)^-1 dB/dp. The Jacobian is the one of the plant system at the converged (scaled) solution, and dB/dp is approximated by
+finite differences of the balance at the fixed solution: each parameter costs one evaluation of the balance and one linear solve, instead
+of a new nonlinear solve. In the reduced formulation, the sensitivities of the explicit unknowns follow from differentiating their
+assignments in the balance along the sensitivities of the implicit ones.
+*/
+
+PetscErrorCode PlantSensitivity(SolverCtx *solver_ctx, const PetscReal state[], const char *const names[], PetscInt num_params,
+                                PetscReal sensitivity[])
+{
+    PetscFunctionBeginUser;
+
+    DM da = solver_ctx->da;
+    Vec x = solver_ctx->solution, rhs, dx;
+    KSP ksp;
+    EntryData perturbed;
+    DessalContext dessal_ctx;
+    PetscScalar *array;
+    PetscReal *scale = solver_ctx->scale, *parameter, *column, step;
+    PetscReal update[NUM_VAR], perturbed_update[NUM_VAR], shifted[NUM_VAR];
+    PetscBool implicit[NUM_VAR];
+    PetscInt i, k, p;
+
+    PetscCheck(solver_ctx->num_loop == 0, PETSC_COMM_SELF, PETSC_ERR_SUP, "The sensitivities do not support the recycle loop");
+
+    InitialGuess(x, solver_ctx, state);
+
+    SNESComputeJacobian(solver_ctx->snes, x, solver_ctx->jac, solver_ctx->jac);
+    SNESGetKSP(solver_ctx->snes, &ksp);
+    KSPSetOperators(ksp, solver_ctx->jac, solver_ctx->jac);
+
+    VecDuplicate(x, &rhs);
+    VecDuplicate(x, &dx);
+
+    for (k = 0; k < NUM_VAR; k++)
+        implicit[k] = PETSC_FALSE;
+    for (i = 0; i < solver_ctx->num_var; i++)
+        implicit[solver_ctx->var_index[i]] = PETSC_TRUE;
+
+    DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+
+    for (p = 0; p < num_params; p++)
+    {
+        column = &sensitivity[p * NUM_VAR];
+
+        perturbed = solver_ctx->entry_data;
+        PetscCall(DessalDataGetParameter(&perturbed.dessal_data, names[p], &parameter));
+
+        step = PETSC_SQRT_MACHINE_EPSILON * PetscMax(PetscAbsReal(*parameter), PETSC_SMALL);
+        *parameter += step;
+
+        DessalContextBuild(&dessal_ctx, &perturbed.dessal_data);
+        DessalContextBalance(&dessal_ctx, state, perturbed_update);
+
+        // Right-hand side in the scaled unknowns, S^-1 dB/dp
+        DMDAVecGetArray(da, rhs, &array);
+        for (i = 0; i < solver_ctx->num_var; i++)
+        {
+            k = solver_ctx->var_index[i];
+            array[i] = (perturbed_update[k] - update[k]) / (step * scale[k]);
+        }
+        DMDAVecRestoreArray(da, rhs, &array);
+
+        KSPSolve(ksp, rhs, dx);
+
+        DMDAVecGetArray(da, dx, &array);
+        for (i = 0; i < solver_ctx->num_var; i++)
+        {
+            k = solver_ctx->var_index[i];
+            column[k] = array[i] * scale[k];
+        }
+        DMDAVecRestoreArray(da, dx, &array);
+
+        if (solver_ctx->formulation == FORMULATION_FULL)
+            continue;
+
+        for (k = 0; k < NUM_VAR; k++)
+            shifted[k] = implicit[k] ? state[k] + step * column[k] : state[k];
+
+        DessalContextBalance(&dessal_ctx, shifted, perturbed_update);
+
+        for (k = 0; k < NUM_VAR; k++)
+            if (!implicit[k])
+                column[k] = (perturbed_update[k] - update[k]) / step;
+    }
+
+    VecDestroy(&rhs);
+    VecDestroy(&dx);
+
+    return 0;
+}
+
+/*
+Homotopy on the membrane area
+
+Far from the solution (e.g. a guessed mass flux that would evaporate the whole feed, a pole of the outlet salinity), Newton may fail from
+the default initial guess. For a vanishing membrane area nothing is exchanged between the channels and this guess, built from the inlet
+conditions, is the solution itself. The homotopy starts from it at 1% of the actual area, where Newton converges, and ramps the area up to
+its actual value by pseudo-arclength continuation, which follows the branch connected to the no-exchange solution around its turning
+points; the end point is polished by a Newton solve, which sets the converged reason. The ramp fails when it does not reach the actual area
+within -homotopy_max_steps steps. The continuation supports neither inverse problems nor the recycle loop, whose failed cases are left as
+they are.
+*/
+
+PetscErrorCode PlantHomotopy(SolverCtx *solver_ctx, PetscReal state[], SNESConvergedReason *reason)
+{
+    PetscFunctionBeginUser;
+
+    ArclengthSolver arclength;
+    DessalData start_data = solver_ctx->entry_data.dessal_data;
+    PetscReal start = 0.01 * start_data.membrane_area, end = start_data.membrane_area;
+    PetscInt max_steps = 1000;
+    PetscBool reached = PETSC_FALSE, turning, converged;
+
+    if (solver_ctx->inverse.num_free > 0 || solver_ctx->num_loop > 0)
+        return 0;
+
+    PetscOptionsGetInt(NULL, NULL, "-homotopy_max_steps", &max_steps, NULL);
+
+    // Default initial guess, which does not depend on the membrane area
+    start_data.membrane_area = start;
+    DessalDataResetState(&start_data);
+    DessalDataGetState(&start_data, state);
+
+    PetscCall(ArclengthSolverBuild(&arclength, solver_ctx, "membrane_area"));
+
+    ArclengthSolverStart(&arclength, state, start, end - start, &converged);
+
+    while (converged && !reached && arclength.num_steps < max_steps)
+        ArclengthSolverStep(&arclength, end, &reached, &turning, &converged);
+
+    if (!reached)
+    {
+        *reason = SNES_DIVERGED_MAX_IT;
+
+        return 0;
+    }
+
+    ArclengthSolverGetPoint(&arclength, state, NULL);
+
+    PlantSolve(solver_ctx, state, reason);
+
+    return 0;
+}
+
+/*
+Screening of the entry data
+
+A few cheap checks reject inputs for which the plant cannot be solved, or only outside the range of validity of the model, before any
+solver is built (instead of letting Newton run up to its maximum number of iterations):
+- the vacuum pressure must not be positive, and must leave a positive absolute pressure in the air gap;
+- the flow rates must be positive and, with heat recovery, the coolant outflow must be able to make up the feed;
+- the inlet temperatures and salinities must lie within the range of the seawater property correlations (0-120 degC, 0-120 g/kg);
+- the heat released by the feed down to the coolant inlet temperature, cp * (T_feed - T_cool) per unit mass, must not be able to evaporate
+  so much water (recovery) that the brine leaves above the maximum salinity of the correlations, recovery < 1 - S_feed / S_max;
+- the geometry must be physical (positive dimensions and conductivities, porosities within (0, 1), a tortuosity of at least one).
+The first failed check gives the reason for rejecting the entry data.
+*/
+
+PetscErrorCode PlantScreen(const EntryData *entry_data, PlantScreenReason *reason)
+{
+    PetscFunctionBeginUser;
+
+    const DessalData *d = &entry_data->dessal_data;
+    const RecycleData *r = &entry_data->recycle_data;
+    const PetscReal temperature_max = 120.0, salinity_max = 0.12;
+    SaltWaterProperties feed_prop;
+    PetscReal recovery;
+
+    *reason = SCREEN_FEASIBLE;
+
+    if (!(d->vacuum_pressure <= 0.0) || !(atm_pressure + d->vacuum_pressure > 0.0))
+        *reason = SCREEN_VACUUM_PRESSURE;
+    else if (!(d->feed_mass_flow_rate > 0.0) || !(d->cool_mass_flow_rate > 0.0) ||
+             (r->heat_recovery && d->feed_mass_flow_rate * (1.0 - r->brine_recycle_fraction) > d->cool_mass_flow_rate))
+        *reason = SCREEN_FLOW_RATE;
+    else if (!(d->entry_temperature_feed >= 0.0 && d->entry_temperature_feed <= temperature_max) ||
+             !(d->entry_temperature_cool >= 0.0 && d->entry_temperature_cool <= temperature_max))
+        *reason = SCREEN_TEMPERATURE;
+    else if (!(d->entry_salinity_feed >= 0.0 && d->entry_salinity_feed <= salinity_max) ||
+             !(d->entry_salinity_cool >= 0.0 && d->entry_salinity_cool <= salinity_max) ||
+             !(r->brine_recycle_fraction >= 0.0 && r->brine_recycle_fraction < 1.0))
+        *reason = SCREEN_SALINITY;
+    else if (!(d->membrane_area > 0.0) || !(d->membrane_thickness > 0.0) || !(d->pore_diameter > 0.0) || !(d->feed_channel_height > 0.0) ||
+             !(d->cool_channel_height > 0.0) || !(d->channel_width > 0.0) || !(d->air_gap_thickness > 0.0) || !(d->wall_thickness > 0.0) ||
+             !(d->film_thickness > 0.0) || !(d->polymer_conductivity > 0.0) || !(d->spacer_conductivity > 0.0) ||
+             !(d->wall_conductivity > 0.0) || !(d->membrane_porosity > 0.0 && d->membrane_porosity < 1.0) ||
+             !(d->spacer_porosity > 0.0 && d->spacer_porosity < 1.0) || !(d->gap_spacer_porosity > 0.0 && d->gap_spacer_porosity < 1.0) ||
+             !(d->membrane_tortuosity >= 1.0) || d->number_channels < 1)
+        *reason = SCREEN_GEOMETRY;
+
+    if (*reason != SCREEN_FEASIBLE)
+        return 0;
+
+    SaltWaterPropBuild(&feed_prop, d->entry_temperature_feed, d->entry_salinity_feed);
+
+    recovery = feed_prop.specific_heat * (d->entry_temperature_feed - d->entry_temperature_cool) / feed_prop.latent_heat_vaporization;
+
+    if (!(recovery < 1.0 - d->entry_salinity_feed / salinity_max))
+        *reason = SCREEN_RECOVERY;
+
+    return 0;
+}
+
+/*
+Solution of one case of a study: the entry data of the solver context is replaced, the system is solved from the warm-start state (when
+given) and, should it fail, once more from the default initial guess built from the inlet conditions, and then with -homotopy by the
+homotopy on the membrane area
+*/
+
+PetscErrorCode PlantSolveCase(SolverCtx *solver_ctx, EntryData *entry_data, const PetscReal warm_state[], PetscReal state[],
+                              SNESConvergedReason *reason)
+{
+    PetscFunctionBeginUser;
+
+    DessalData dessal_data = entry_data->dessal_data;
+    PlantScreenReason screen;
+    PetscInt i;
+
+    PlantScreen(entry_data, &screen);
+
+    // Cases rejected by the screening are left at the default initial guess
+    if (screen != SCREEN_FEASIBLE)
+    {
+        DessalDataResetState(&dessal_data);
+        DessalDataGetState(&dessal_data, state);
+        *reason = SNES_DIVERGED_FUNCTION_DOMAIN;
+
+        return 0;
+    }
+
+    SolverCtxSetEntryData(solver_ctx, entry_data);
+
+    if (warm_state)
+    {
+        for (i = 0; i < NUM_VAR; i++)
+            state[i] = warm_state[i];
+
+        PlantSolve(solver_ctx, state, reason);
+
+        if (*reason > 0)
+            return 0;
+    }
+
+    DessalDataResetState(&dessal_data);
+    DessalDataGetState(&dessal_data, state);
+
+    PlantSolve(solver_ctx, state, reason);
+
+    if (*reason > 0 || !solver_ctx->homotopy)
+        return 0;
+
+    PetscCall(PlantHomotopy(solver_ctx, state, reason));
+
+    return 0;
+}
+
+PetscErrorCode PlantSolveCases(SolverCtx *solver_ctx, LockstepSolver *lockstep, EntryData cases[], PetscInt num_cases,
+                               const PetscReal warm_states[], const PetscBool warm[], PetscReal states[], SNESConvergedReason reasons[])
+{
+    PetscFunctionBeginUser;
+
+    const PetscReal *guess;
+    PetscInt latest = -1, i;
+
+    if (lockstep)
+    {
+        PetscCall(LockstepSolve(lockstep, solver_ctx, cases, num_cases, warm_states, warm, states, reasons));
+
+        return 0;
+    }
+
+    for (i = 0; i < num_cases; i++)
+    {
+        if (warm_states && (!warm || warm[i]))
+            guess = &warm_states[i * NUM_VAR];
+        else
+            guess = latest >= 0 ? &states[latest * NUM_VAR] : NULL;
+
+        PlantSolveCase(solver_ctx, &cases[i], guess, &states[i * NUM_VAR], &reasons[i]);
+
+        if (reasons[i] > 0)
+            latest = i;
+    }
+
+    return 0;
+}
+
+PetscErrorCode CheckFormulation(SolverCtx *solver_ctx, const PetscReal state[])
+{
+    PetscFunctionBeginUser;
+
+    SolverCtx full_ctx;
+    EntryData entry_data = solver_ctx->entry_data;
+    SNESConvergedReason reason;
+    PetscReal full_state[NUM_VAR], error, max_error = 0.0;
+    PetscInt i;
+
+    SolverCtxBuild(&full_ctx, &entry_data);
+    SolverCtxSetFormulation(&full_ctx, FORMULATION_FULL);
+
+    DessalDataGetState(&entry_data.dessal_data, full_state);
+    PlantSolve(&full_ctx, full_state, &reason);
+
+    PetscPrintf(PETSC_COMM_WORLD, "Formulation check (%s against full, full solve reason %d):\n",
+                formulation_names[solver_ctx->formulation], (int)reason);
+
+    for (i = 0; i < NUM_VAR; i++)
+    {
+        error = PetscAbsReal(state[i] - full_state[i]) / PetscMax(PetscAbsReal(full_state[i]), PETSC_SMALL);
+        max_error = PetscMax(max_error, error);
+        PetscPrintf(PETSC_COMM_WORLD, "  %-26s relative difference = %g\n", dessal_state_names[i], (double)error);
+    }
+
+    PetscPrintf(PETSC_COMM_WORLD, "  maximum relative difference = %g\n", (double)max_error);
+
+    SolverCtxDestroy(&full_ctx);
+
+    return 0;
+}
+
 PetscErrorCode RunPlant(EntryData *entry_data)
 {
     PetscFunctionBeginUser;
 
     SolverCtx solver_ctx;
-    Vec solution;
-    Mat jac;
+    SNESConvergedReason reason;
+    PlantScreenReason screen;
+    PetscReal state[NUM_VAR];
+    PetscBool check = PETSC_FALSE;
     char file[256] = "./results/report.csv";
 
+    PetscOptionsGetBool(NULL, NULL, "-formulation_check", &check, NULL);
+
+    PlantScreen(entry_data, &screen);
+    PetscCheck(screen == SCREEN_FEASIBLE, PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Infeasible entry data rejected by the screening (%s)",
+               screen_reason_names[screen]);
+
     SolverCtxBuild(&solver_ctx, entry_data);
 
-    DMCreateGlobalVector(solver_ctx.da, &solution);
-    DMCreateMatrix(solver_ctx.da, &jac);
+    DessalDataGetState(&entry_data->dessal_data, state);
 
-    InitialGuess(solution, &solver_ctx);
+    PlantSolve(&solver_ctx, state, &reason);
 
-    SNESSetFunction(solver_ctx.snes, NULL, PlantBalances, &solver_ctx);
-    SNESSetJacobian(solver_ctx.snes, jac, jac, SNESComputeJacobianDefault, NULL);
+    if (reason <= 0 && solver_ctx.homotopy)
+        PetscCall(PlantHomotopy(&solver_ctx, state, &reason));
 
-    SNESSolve(solver_ctx.snes, NULL, solution);
+    // Only solutions are exported, the inlets closed by the recycle loop being left in the entry data of the solver context
+    if (reason > 0)
+    {
+        ExportToFile(state, &solver_ctx.entry_data, file);
 
-    ExportToFile(&solution, entry_data, file);
+        if (check)
+            CheckFormulation(&solver_ctx, state);
+    }
+    else
+        PetscPrintf(PETSC_COMM_WORLD, "The plant did not converge (reason %d)%s, nothing written to %s\n", (int)reason,
+                    reason == SNES_DIVERGED_FUNCTION_DOMAIN ? ", or converged outside the physical range" : "", file);
 
-    VecDestroy(&solution);
-    MatDestroy(&jac);
     SolverCtxDestroy(&solver_ctx);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -2,9 +2,67 @@
 
 #define PLANT
 
-#include "../entrydata/entrydata.h"
+#include "solver.h"
+#include "lockstep.h"
+#include "arclength.h"
+#include "output.h"
+
+// Reasons for rejecting entry data before solving the plant
+typedef enum
+{
+    SCREEN_FEASIBLE,        // Entry data passing all the checks
+    SCREEN_VACUUM_PRESSURE, // Positive vacuum pressure, or no absolute pressure left in the gap
+    SCREEN_FLOW_RATE,       // Non-positive flow rate, or a coolant outflow too small to make up the feed with heat recovery
+    SCREEN_TEMPERATURE,     // Inlet temperature outside the range of the property correlations
+    SCREEN_SALINITY,        // Inlet salinity outside the range of the property correlations, or brine recycle fraction outside [0, 1)
+    SCREEN_RECOVERY,        // Heat in the feed able to concentrate the brine beyond the range of the property correlations
+    SCREEN_GEOMETRY         // Non-positive dimension or conductivity, porosity outside (0, 1), tortuosity below one or no channel
+} PlantScreenReason;
+
+static const char *const screen_reason_names[] = {"feasible", "vacuum_pressure", "flow_rate", "temperature", "salinity", "recovery",
+                                                  "geometry"};
 
 // Function to run the code for the plant
 PetscErrorCode RunPlant(EntryData *entry_data);
 
+// Function to look up an output of the plant by name, i.e. an unknown (index below NUM_VAR) or a KPI (index NUM_VAR plus the index of the
+// KPI), returning -1 for unknown names
+PetscErrorCode PlantOutputFind(const char name[], PetscInt *index);
+
+// Function to compute an output of the plant from the solution of the plant system
+PetscErrorCode PlantOutput(const PetscReal state[], DessalData *dessal_data, PetscInt index, PetscReal *value);
+
+// Function to screen entry data for infeasible inputs with a few cheap checks, before any solver is built
+PetscErrorCode PlantScreen(const EntryData *entry_data, PlantScreenReason *reason);
+
+// Function to check that a solution of the plant system is physical, i.e. with a positive mass flux and a positive feed outflow rate
+PetscErrorCode PlantPhysical(const PetscReal state[], PetscBool *physical);
+
+// Function to check whether a solution of the variational inequality solver is held by the physical bounds (-bounded), i.e. whether the
+// residual of the unbounded plant system exceeds the tolerance of the solver, given the residual norm of the initial guess
+PetscErrorCode PlantBoundActive(SolverCtx *solver_ctx, PetscReal initial_norm, PetscBool *active);
+
+// Function to solve the plant system held by a solver context, starting from (and returning the solution in) the array of unknowns; a
+// case that fails with the reduced formulation, or lands on a non-physical root, is solved again with the full one
+PetscErrorCode PlantSolve(SolverCtx *solver_ctx, PetscReal state[], SNESConvergedReason *reason);
+
+// Function to solve one case of a study, warm-started from a given state (if not NULL) with a fallback to the default initial guess (and
+// then to the homotopy of PlantHomotopy, with -homotopy); cases rejected by PlantScreen are not solved (SNES_DIVERGED_FUNCTION_DOMAIN)
+PetscErrorCode PlantSolveCase(SolverCtx *solver_ctx, EntryData *entry_data, const PetscReal warm_state[], PetscReal state[],
+                              SNESConvergedReason *reason);
+
+// Function to solve the plant system held by a solver context by continuation from a small fraction of the membrane area up to its
+// actual value, returning the solution in the array of unknowns, for cases that Newton fails to solve from the default guess
+PetscErrorCode PlantHomotopy(SolverCtx *solver_ctx, PetscReal state[], SNESConvergedReason *reason);
+
+// Function to solve a list of cases of a study, with the lockstep solver if given (one case at a time with SNES otherwise); cases without a
+// warm state start from the last converged case of the list
+PetscErrorCode PlantSolveCases(SolverCtx *solver_ctx, LockstepSolver *lockstep, EntryData cases[], PetscInt num_cases,
+                               const PetscReal warm_states[], const PetscBool warm[], PetscReal states[], SNESConvergedReason reasons[]);
+
+// Function to compute the sensitivities of the solution of the last solved case to named parameters of the desalination module, stored
+// parameter by parameter (NUM_VAR values each)
+PetscErrorCode PlantSensitivity(SolverCtx *solver_ctx, const PetscReal state[], const char *const names[], PetscInt num_params,
+                                PetscReal sensitivity[]);
+
 #endif
\ No newline at end of file
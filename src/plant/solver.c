@@ -1,6 +1,5 @@
 #include "solver.h"
-
-#define NUM_VAR 12
+#include "../properties/properties.h"
 
 PetscErrorCode SolverCtxBuild(SolverCtx *solver_ctx, EntryData *entry_data)
 {
@@ -8,10 +7,22 @@ PetscErrorCode SolverCtxBuild(SolverCtx *solver_ctx, EntryData *entry_data)
     SNES snes;
     SNESLineSearch snesls;
     KSP ksp;
-    DM da;
+    PetscBool scaling = PETSC_TRUE, homotopy = PETSC_FALSE, bounded = PETSC_FALSE, trace = PETSC_FALSE;
+    PetscInt formulation = FORMULATION_FULL, jacobian = JACOBIAN_DEFAULT, precision = PRECISION_DOUBLE, reduced_max_it = 100;
+    char trace_file[PETSC_MAX_PATH_LEN] = "./results/trace.bin";
 
-    SNESCreate(PETSC_COMM_WORLD, &snes);
-    SNESSetType(snes, SNESNEWTONLS);
+    PetscOptionsGetBool(NULL, NULL, "-scaling", &scaling, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-homotopy", &homotopy, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-bounded", &bounded, NULL);
+    PetscOptionsGetEList(NULL, NULL, "-formulation", formulation_names, 2, &formulation, NULL);
+    PetscOptionsGetInt(NULL, NULL, "-reduced_max_it", &reduced_max_it, NULL);
+    PetscOptionsGetEList(NULL, NULL, "-jacobian", jacobian_names, 2, &jacobian, NULL);
+    PetscOptionsGetEList(NULL, NULL, "-precision", precision_names, 2, &precision, NULL);
+    PetscOptionsGetBool(NULL, NULL, "-trace", &trace, NULL);
+    PetscOptionsGetString(NULL, NULL, "-trace_file", trace_file, sizeof(trace_file), NULL);
+
+    SNESCreate(PETSC_COMM_SELF, &snes);
+    SNESSetType(snes, bounded ? SNESVINEWTONRSLS : SNESNEWTONLS);
     SNESGetLineSearch(snes, &snesls);
     SNESLineSearchSetType(snesls, SNESLINESEARCHL2);
     SNESLineSearchSetTolerances(snesls, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT, 1000);
@@ -21,13 +32,353 @@ PetscErrorCode SolverCtxBuild(SolverCtx *solver_ctx, EntryData *entry_data)
     KSPGMRESSetOrthogonalization(ksp, KSPGMRESModifiedGramSchmidtOrthogonalization);
     SNESSetFromOptions(snes);
 
-    DMDACreate1d(PETSC_COMM_WORLD, DM_BOUNDARY_NONE, NUM_VAR, 1, 1, NULL, &da);
+    solver_ctx->snes = snes;
+    solver_ctx->da = NULL;
+    solver_ctx->solution = NULL;
+    solver_ctx->jac = NULL;
+    solver_ctx->entry_data = *entry_data;
+    solver_ctx->inverse.num_free = 0;
+    solver_ctx->num_loop = 0;
+    solver_ctx->homotopy = homotopy;
+    solver_ctx->bounded = bounded;
+    solver_ctx->reduced_max_it = reduced_max_it;
+    solver_ctx->fallback = PETSC_FALSE;
+    solver_ctx->jacobian = (PlantJacobian)jacobian;
+    solver_ctx->precision = (PlantPrecision)precision;
+    solver_ctx->trace = NULL;
+
+    if (trace)
+    {
+        PetscMalloc1(1, &solver_ctx->trace);
+        PetscCall(PlantTraceOpen(solver_ctx->trace, trace_file));
+        SNESMonitorSet(snes, PlantTraceMonitor, solver_ctx, NULL);
+    }
+
+    DessalContextBuild(&solver_ctx->dessal_ctx, &solver_ctx->entry_data.dessal_data);
+
+    SolverCtxSetRecycle(solver_ctx);
+    SolverCtxSetScaling(solver_ctx, scaling);
+    PetscCall(SolverCtxSetFormulation(solver_ctx, (PlantFormulation)formulation));
+
+    return 0;
+}
+
+/*
+Formulations of the plant system
+
+Within the balance of the desalination module, the temperature at the interface between the distillate film and the wall, the mass and
+heat fluxes and the feed outflow rate are explicit assignments that never feed back into the balance. The reduced formulation iterates only
+on the remaining (implicit) unknowns, namely the outlet temperatures, the interface temperatures at the membrane, the gap and the coolant
+side of the wall, and the outlet salinity of the feed. The explicit unknowns are reconstructed in one pass after convergence; the reduced
+solve is limited to -reduced_max_it iterations, PlantSolve falling back to the full formulation when it fails or lands on a non-physical
+root.
+*/
+
+PetscErrorCode SolverCtxSetFormulation(SolverCtx *solver_ctx, PlantFormulation formulation)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt reduced_index[] = {0, 1, 2, 3, 4, 6, 7};
+    PetscInt num_free = solver_ctx->inverse.num_free, num_loop = solver_ctx->num_loop, i;
+    DM da;
+
+    solver_ctx->formulation = formulation;
+
+    if (formulation == FORMULATION_REDUCED)
+    {
+        solver_ctx->num_var = sizeof(reduced_index) / sizeof(PetscInt);
+
+        for (i = 0; i < solver_ctx->num_var; i++)
+            solver_ctx->var_index[i] = reduced_index[i];
+    }
+    else
+    {
+        solver_ctx->num_var = NUM_VAR;
+
+        for (i = 0; i < NUM_VAR; i++)
+            solver_ctx->var_index[i] = i;
+    }
+
+    // The nonlinear solver holds work vectors (and bounds) of the size of the previous system
+    if (solver_ctx->da)
+        SNESReset(solver_ctx->snes);
+
+    VecDestroy(&solver_ctx->solution);
+    MatDestroy(&solver_ctx->jac);
+    DMDestroy(&solver_ctx->da);
+
+    DMDACreate1d(PETSC_COMM_SELF, DM_BOUNDARY_NONE, solver_ctx->num_var + num_free + num_loop, 1, 1, NULL, &da);
     DMSetUp(da);
 
-    solver_ctx->snes = snes;
     solver_ctx->da = da;
+
+    DMCreateGlobalVector(da, &solver_ctx->solution);
+    DMCreateMatrix(da, &solver_ctx->jac);
+
+    PetscCall(SolverCtxSetBounds(solver_ctx));
+
+    return 0;
+}
+
+PetscErrorCode SolverCtxSetEntryData(SolverCtx *solver_ctx, EntryData *entry_data)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt num_loop = solver_ctx->num_loop;
+
     solver_ctx->entry_data = *entry_data;
 
+    DessalContextBuild(&solver_ctx->dessal_ctx, &solver_ctx->entry_data.dessal_data);
+
+    SolverCtxSetRecycle(solver_ctx);
+    SolverCtxSetScaling(solver_ctx, solver_ctx->scaling);
+
+    // The bounds follow the scales, and the physical bounds the inlet conditions
+    if (solver_ctx->num_loop != num_loop)
+        PetscCall(SolverCtxSetFormulation(solver_ctx, solver_ctx->formulation));
+    else if (solver_ctx->bounded)
+        PetscCall(SolverCtxSetBounds(solver_ctx));
+
+    return 0;
+}
+
+/*
+Closure of the recycle loop
+
+With brine recirculation, heat recovery or a heater of fixed power, the feed inlet of the module depends on its own outlets. Instead of
+iterating the whole model on the inlets (successive substitution), the inlets that depend on the outlets become unknowns of the plant
+system, with the closure equations (inlet - balance of the recycle loop) / scale = 0, and the loop is solved together with the module by
+one Newton solve. The feed salinity is closed whenever the loop is enabled, and the feed temperature when the heater delivers a fixed power
+(otherwise the heater holds it). The closed inlets are left in the entry data of the solver context, and are scaled like the outlets.
+*/
+
+PetscErrorCode SolverCtxSetRecycle(SolverCtx *solver_ctx)
+{
+    PetscFunctionBeginUser;
+
+    RecycleData *recycle_data = &solver_ctx->entry_data.recycle_data;
+    DessalData *dessal_data = &solver_ctx->entry_data.dessal_data;
+
+    solver_ctx->num_loop = 0;
+
+    if (!recycle_data->enabled)
+        return 0;
+
+    solver_ctx->loop_input[solver_ctx->num_loop++] = &dessal_data->entry_salinity_feed;
+
+    if (recycle_data->fixed_heater_power)
+        solver_ctx->loop_input[solver_ctx->num_loop++] = &dessal_data->entry_temperature_feed;
+
+    return 0;
+}
+
+/*
+Bounds of the plant system
+
+The freed inputs of an inverse problem are kept within their bounds. With -bounded, the unknowns of the plant system are also kept within
+physical bounds that follow from the inlet conditions, so that Newton iterates cannot wander into unphysical states (e.g. a vanishing feed
+outflow rate blowing the outlet salinity up, or a negative mass flux):
+- every temperature lies between the inlet temperatures, the feed being the hot side of the module;
+- the outlet salinity lies between the inlet salinity and one, as the module only removes water from the feed;
+- the mass flux is nonnegative and cannot evaporate the water of the feed, i.e. mass_flux * area <= (1 - salinity) * flow rate;
+- the heat flux has the sign of the inlet temperature difference, and the vapor heat flux is nonnegative;
+- the feed outflow rate lies between the salt and the whole of the feed flow rate.
+Both kinds of bounds are enforced by the variational inequality solver. The physical bounds hold for given inlets only, so they are not
+combined with inverse problems or the recycle loop, where some inlets are unknowns.
+*/
+
+PetscErrorCode SolverCtxSetBounds(SolverCtx *solver_ctx)
+{
+    PetscFunctionBeginUser;
+
+    DessalData *dessal_data = &solver_ctx->entry_data.dessal_data;
+    PetscInt num_var = solver_ctx->num_var, num_free = solver_ctx->inverse.num_free, i, k;
+    PetscReal lower_state[NUM_VAR], upper_state[NUM_VAR], temperature_min, temperature_max, flow, salt;
+    Vec lower, upper;
+    PetscScalar *lower_array, *upper_array;
+
+    if (!solver_ctx->bounded && num_free == 0)
+        return 0;
+
+    VecDuplicate(solver_ctx->solution, &lower);
+    VecDuplicate(solver_ctx->solution, &upper);
+    VecSet(lower, PETSC_NINFINITY);
+    VecSet(upper, PETSC_INFINITY);
+
+    DMDAVecGetArray(solver_ctx->da, lower, &lower_array);
+    DMDAVecGetArray(solver_ctx->da, upper, &upper_array);
+
+    if (solver_ctx->bounded)
+    {
+        PetscCheck(num_free == 0 && solver_ctx->num_loop == 0, PETSC_COMM_SELF, PETSC_ERR_ARG_INCOMP,
+                   "The physical bounds (-bounded) follow from given inlets and do not apply to inverse problems or the recycle loop");
+
+        temperature_min = PetscMin(dessal_data->entry_temperature_feed, dessal_data->entry_temperature_cool);
+        temperature_max = PetscMax(dessal_data->entry_temperature_feed, dessal_data->entry_temperature_cool);
+        flow = dessal_data->feed_mass_flow_rate;
+        salt = dessal_data->entry_salinity_feed * flow;
+
+        for (k = 0; k < 7; k++)
+        {
+            lower_state[k] = temperature_min;
+            upper_state[k] = temperature_max;
+        }
+
+        lower_state[7] = dessal_data->entry_salinity_feed;
+        upper_state[7] = 1.0;
+        lower_state[8] = 0.0;
+        upper_state[8] = (flow - salt) / dessal_data->membrane_area;
+        lower_state[9] = dessal_data->entry_temperature_feed >= dessal_data->entry_temperature_cool ? 0.0 : PETSC_NINFINITY;
+        upper_state[9] = dessal_data->entry_temperature_feed >= dessal_data->entry_temperature_cool ? PETSC_INFINITY : 0.0;
+        lower_state[10] = 0.0;
+        upper_state[10] = PETSC_INFINITY;
+        lower_state[11] = salt;
+        upper_state[11] = flow;
+
+        for (i = 0; i < num_var; i++)
+        {
+            k = solver_ctx->var_index[i];
+
+            lower_array[i] = lower_state[k] / solver_ctx->scale[k];
+            upper_array[i] = upper_state[k] / solver_ctx->scale[k];
+        }
+    }
+
+    for (i = 0; i < num_free; i++)
+    {
+        lower_array[num_var + i] = solver_ctx->inverse.min[i] / solver_ctx->input_scale[i];
+        upper_array[num_var + i] = solver_ctx->inverse.max[i] / solver_ctx->input_scale[i];
+    }
+
+    DMDAVecRestoreArray(solver_ctx->da, lower, &lower_array);
+    DMDAVecRestoreArray(solver_ctx->da, upper, &upper_array);
+
+    SNESVISetVariableBounds(solver_ctx->snes, lower, upper);
+
+    VecDestroy(&lower);
+    VecDestroy(&upper);
+
+    return 0;
+}
+
+/*
+Reference scales of the unknowns, derived from the inlet conditions and the geometry of the module
+
+Temperatures are scaled by the hottest inlet temperature, the salinity by the feed inlet salinity and the outflow rate by the feed inlet
+flow rate. The heat fluxes are scaled by the sensible heat released by the feed if it were cooled down to the coolant inlet temperature,
+spread over the membrane area, and the mass flux by the amount of water this heat is able to evaporate. The plant system is solved for
+x / scale, with residuals divided by the same scales, so that all unknowns and residuals are of order one.
+*/
+
+PetscErrorCode SolverCtxSetScaling(SolverCtx *solver_ctx, PetscBool scaling)
+{
+    PetscFunctionBeginUser;
+
+    DessalData dessal_data = solver_ctx->entry_data.dessal_data;
+    SaltWaterProperties feed_prop;
+    PetscReal temperature_scale, salinity_scale, flow_scale, heat_flux_scale, mass_flux_scale;
+    PetscInt i;
+
+    solver_ctx->scaling = scaling;
+
+    if (!scaling)
+    {
+        for (i = 0; i < NUM_VAR; i++)
+            solver_ctx->scale[i] = 1.0;
+
+        solver_ctx->loop_scale[0] = 1.0;
+        solver_ctx->loop_scale[1] = 1.0;
+
+        return 0;
+    }
+
+    SaltWaterPropBuild(&feed_prop, dessal_data.entry_temperature_feed, dessal_data.entry_salinity_feed);
+
+    temperature_scale = PetscMax(PetscAbsReal(dessal_data.entry_temperature_feed), PetscAbsReal(dessal_data.entry_temperature_cool));
+    salinity_scale = PetscAbsReal(dessal_data.entry_salinity_feed);
+    flow_scale = PetscAbsReal(dessal_data.feed_mass_flow_rate);
+    heat_flux_scale = flow_scale * feed_prop.specific_heat;
+    heat_flux_scale *= PetscAbsReal(dessal_data.entry_temperature_feed - dessal_data.entry_temperature_cool) / dessal_data.membrane_area;
+    mass_flux_scale = heat_flux_scale / feed_prop.latent_heat_vaporization;
+
+    solver_ctx->scale[0] = temperature_scale;
+    solver_ctx->scale[1] = temperature_scale;
+    solver_ctx->scale[2] = temperature_scale;
+    solver_ctx->scale[3] = temperature_scale;
+    solver_ctx->scale[4] = temperature_scale;
+    solver_ctx->scale[5] = temperature_scale;
+    solver_ctx->scale[6] = temperature_scale;
+    solver_ctx->scale[7] = salinity_scale;
+    solver_ctx->scale[8] = mass_flux_scale;
+    solver_ctx->scale[9] = heat_flux_scale;
+    solver_ctx->scale[10] = heat_flux_scale;
+    solver_ctx->scale[11] = flow_scale;
+
+    // Falling back to unit scales for degenerate entry data (e.g. fresh water feed or no driving temperature difference)
+    for (i = 0; i < NUM_VAR; i++)
+        if (!(solver_ctx->scale[i] > PETSC_SMALL) || PetscIsInfOrNanReal(solver_ctx->scale[i]))
+            solver_ctx->scale[i] = 1.0;
+
+    // Inlets closed by the recycle loop, scaled like the outlet salinity and temperatures
+    solver_ctx->loop_scale[0] = solver_ctx->scale[7];
+    solver_ctx->loop_scale[1] = solver_ctx->scale[0];
+
+    return 0;
+}
+
+/*
+Inverse problems
+
+Instead of solving the plant for given inputs and reading its outputs, some outputs (e.g. the distillate rate or the outlet salinity) are
+fixed at target values and as many inputs (e.g. the feed flow rate or the vacuum pressure) become unknowns, appended to the plant system
+together with the equations (output - target) / |target| = 0. The augmented system is square and solved by one Newton solve, with the
+variational inequality solver so that the freed inputs stay within their bounds; a target that cannot be reached within them leaves its
+input at the bound. The freed inputs are scaled by their values when the inverse problem is set, which are also the initial guesses.
+*/
+
+PetscErrorCode SolverCtxSetInverse(SolverCtx *solver_ctx, const InverseProblem *inverse)
+{
+    PetscFunctionBeginUser;
+
+    PetscInt i, j;
+
+    if (!inverse)
+    {
+        solver_ctx->inverse.num_free = 0;
+
+        SNESSetType(solver_ctx->snes, solver_ctx->bounded ? SNESVINEWTONRSLS : SNESNEWTONLS);
+        SNESSetFromOptions(solver_ctx->snes);
+
+        PetscCall(SolverCtxSetFormulation(solver_ctx, solver_ctx->formulation));
+
+        return 0;
+    }
+
+    PetscCheck(inverse->num_free > 0 && inverse->num_free <= MAX_INVERSE, PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE,
+               "An inverse problem frees between 1 and %d inputs", MAX_INVERSE);
+
+    solver_ctx->inverse = *inverse;
+
+    for (i = 0; i < inverse->num_free; i++)
+    {
+        PetscCall(DessalDataGetParameter(&solver_ctx->entry_data.dessal_data, inverse->input[i], &solver_ctx->free_input[i]));
+
+        for (j = 0; j < solver_ctx->num_loop; j++)
+            PetscCheck(solver_ctx->free_input[i] != solver_ctx->loop_input[j], PETSC_COMM_SELF, PETSC_ERR_ARG_WRONG,
+                       "The input %s is closed by the recycle loop and cannot be freed", inverse->input[i]);
+
+        PetscCheck(inverse->min[i] <= inverse->max[i], PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Empty bounds of the freed input %s",
+                   inverse->input[i]);
+
+        solver_ctx->input_scale[i] = PetscAbsReal(*solver_ctx->free_input[i]) > PETSC_SMALL ? PetscAbsReal(*solver_ctx->free_input[i]) : 1.0;
+        solver_ctx->output_scale[i] = PetscAbsReal(inverse->target[i]) > PETSC_SMALL ? PetscAbsReal(inverse->target[i]) : 1.0;
+    }
+
+    SNESSetType(solver_ctx->snes, SNESVINEWTONRSLS);
+    SNESSetFromOptions(solver_ctx->snes);
+
+    PetscCall(SolverCtxSetFormulation(solver_ctx, solver_ctx->formulation));
+
     return 0;
 }
 
@@ -35,6 +386,15 @@ PetscErrorCode SolverCtxDestroy(SolverCtx *solver_ctx)
 {
     PetscFunctionBeginUser;
     SNESDestroy(&solver_ctx->snes);
+
+    if (solver_ctx->trace)
+    {
+        PlantTraceClose(solver_ctx->trace);
+        PetscFree(solver_ctx->trace);
+    }
+
+    VecDestroy(&solver_ctx->solution);
+    MatDestroy(&solver_ctx->jac);
     DMDestroy(&solver_ctx->da);
 
     return 0;
@@ -2,20 +2,107 @@
 
 #define SOLVER
 
-#include "../entrydata/entrydata.h"
+#include "../dessal/dessal.h"
+#include "../recycle/recycle.h"
+#include "trace.h"
+
+// Number of unknowns of the plant system
+#define NUM_VAR 12
+
+// Formulations of the plant system
+typedef enum
+{
+    FORMULATION_FULL,   // Newton iterates on all the unknowns
+    FORMULATION_REDUCED // Newton iterates only on the implicit core, the remaining unknowns are reconstructed after convergence
+} PlantFormulation;
+
+static const char *const formulation_names[] = {"full", "reduced"};
+
+// Finite-difference Jacobians of the plant system
+typedef enum
+{
+    JACOBIAN_DEFAULT,    // SNESComputeJacobianDefault, one full evaluation of the residual per column
+    JACOBIAN_INCREMENTAL // PlantJacobianIncremental, each column recomputing only the nodes of the balance that read the perturbed unknown
+} PlantJacobian;
+
+static const char *const jacobian_names[] = {"default", "incremental"};
+
+// Precisions of the evaluations of the balance in the Newton iterations of the lockstep solver
+typedef enum
+{
+    PRECISION_DOUBLE, // Every evaluation in double precision
+    PRECISION_MIXED   // Evaluations in single precision down to -precision_switch, then in double precision to the tolerances
+} PlantPrecision;
+
+static const char *const precision_names[] = {"double", "mixed"};
+
+// Maximum number of inputs freed in an inverse problem
+#define MAX_INVERSE 8
+
+// Data structure containing an inverse problem: outputs of the plant fixed at target values, and as many inputs of the desalination module
+// freed within bounds
+typedef struct
+{
+    PetscInt num_free;
+    char input[MAX_INVERSE][64];
+    PetscInt output[MAX_INVERSE]; // Index of an unknown, or NUM_VAR plus the index of a KPI
+    PetscReal target[MAX_INVERSE], min[MAX_INVERSE], max[MAX_INVERSE];
+    PetscReal orientation[MAX_INVERSE]; // +1 or -1, so that each target residual increases with its paired input
+} InverseProblem;
 
 // Defining the solver context data structure
 typedef struct
 {
     SNES snes;
     DM da;
+    Vec solution;
+    Mat jac;
     EntryData entry_data;
+    DessalContext dessal_ctx;
+    PlantFormulation formulation;
+    PlantJacobian jacobian;
+    PlantPrecision precision;
+    PetscInt num_var, var_index[NUM_VAR], reduced_max_it;
+    PetscBool fallback; // Full formulation standing in for the reduced one after a fallback, until the next solve
+    PetscBool scaling, homotopy, bounded;
+    PetscReal scale[NUM_VAR];
+    InverseProblem inverse;
+    PetscReal *free_input[MAX_INVERSE], input_scale[MAX_INVERSE], output_scale[MAX_INVERSE];
+
+    // Inlets of the desalination module closed by the recycle loop (feed salinity, and feed temperature with a fixed heater power)
+    PetscInt num_loop;
+    PetscReal *loop_input[2], loop_scale[2];
+
+    // Convergence trace recorder (NULL unless -trace)
+    PlantTrace *trace;
 } SolverCtx;
 
 // Defining a solver context constructor
 PetscErrorCode SolverCtxBuild(SolverCtx *solver_ctx, EntryData *entry_data);
 
+// Function to set the formulation of the plant system, (re)creating the distributed array, vectors and matrices accordingly
+PetscErrorCode SolverCtxSetFormulation(SolverCtx *solver_ctx, PlantFormulation formulation);
+
+// Function to replace the entry data of a solver context, e.g. between the cases of a study, updating the invariant terms of the balance
+// and the reference scales
+PetscErrorCode SolverCtxSetEntryData(SolverCtx *solver_ctx, EntryData *entry_data);
+
+// Function to set the reference scales used to nondimensionalize the unknowns and residuals
+PetscErrorCode SolverCtxSetScaling(SolverCtx *solver_ctx, PetscBool scaling);
+
+// Function to set the closure of the recycle loop from the entry data of a solver context, appending the inlets of the desalination module
+// that depend on its outlets to the unknowns of the plant system and the closure equations to its residuals
+PetscErrorCode SolverCtxSetRecycle(SolverCtx *solver_ctx);
+
+// Function to set the bounds of the unknowns of the plant system, i.e. the bounds of the freed inputs of an inverse problem and (with
+// -bounded) the physical bounds of the unknowns of the desalination module following from its inlet conditions
+PetscErrorCode SolverCtxSetBounds(SolverCtx *solver_ctx);
+
+// Function to set an inverse problem (or the forward problem if NULL), appending the freed inputs to the unknowns of the plant system and
+// the target equations to its residuals, the freed inputs being bounded
+PetscErrorCode SolverCtxSetInverse(SolverCtx *solver_ctx, const InverseProblem *inverse);
+
 // Defining a solver context destructor
 PetscErrorCode SolverCtxDestroy(SolverCtx *solver_ctx);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,343 @@
+#include "solver.h"
+
+/*
+Convergence traces
+
+With -trace, every solve of the plant system by PlantSolve is recorded in a binary trace file (-trace_file), appended to across runs: a
+record at the beginning of the solve with the inlet conditions, one record per iterate with the full iterate in physical units, the scaled
+residual of each unknown, the step length and Newton direction norm of the line search that reached it and the condition number of the
+Jacobian of that step, and a record at the end with the converged reason and the cost of the solve. The iterates are recorded by an SNES
+monitor and the steps by a line search post-check, so the nonlinear solver itself is unchanged. The records of a solve are flushed at its
+end, so that the records of the solves of several solver contexts of a process never interleave. With several MPI ranks, each rank writes
+its own file, the file name being followed by the rank beyond the first one. The lockstep solver and the transient integrator, which do
+not go through PlantSolve, are not traced.
+*/
+
+PetscErrorCode PlantTraceOpen(PlantTrace *trace, const char file[])
+{
+    PetscFunctionBeginUser;
+
+    PetscMPIInt rank;
+    char name[PETSC_MAX_PATH_LEN];
+    int header[2] = {TRACE_MAGIC, TRACE_VERSION};
+
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+    if (rank == 0)
+        PetscStrncpy(name, file, sizeof(name));
+    else
+        PetscSNPrintf(name, sizeof(name), "%s.%d", file, (int)rank);
+
+    trace->fptr = fopen(name, "ab");
+    PetscCheck(trace->fptr, PETSC_COMM_SELF, PETSC_ERR_FILE_OPEN, "Unable to open trace file %s", name);
+
+    // A new file starts with the magic number and the version of the records
+    if (ftell(trace->fptr) == 0)
+        fwrite(header, sizeof(int), 2, trace->fptr);
+
+    trace->step = 0.0;
+    trace->update_norm = 0.0;
+
+    return 0;
+}
+
+PetscErrorCode PlantTraceBegin(PlantTrace *trace, const DessalContext *dessal_ctx, PetscInt num_unknowns, PetscInt formulation)
+{
+    PetscFunctionBeginUser;
+
+    int kind = TRACE_BEGIN;
+    TraceBegin begin;
+
+    begin.num_unknowns = (int)num_unknowns;
+    begin.formulation = (int)formulation;
+    begin.inlet[0] = (float)dessal_ctx->feed_mass_flow_rate;
+    begin.inlet[1] = (float)dessal_ctx->cool_mass_flow_rate;
+    begin.inlet[2] = (float)dessal_ctx->entry_temperature_feed;
+    begin.inlet[3] = (float)dessal_ctx->entry_temperature_cool;
+    begin.inlet[4] = (float)dessal_ctx->entry_salinity_feed;
+    begin.inlet[5] = (float)dessal_ctx->membrane_area;
+
+    fwrite(&kind, sizeof(int), 1, trace->fptr);
+    fwrite(&begin, sizeof(TraceBegin), 1, trace->fptr);
+
+    trace->step = 0.0;
+    trace->update_norm = 0.0;
+
+    PetscTime(&trace->start);
+
+    return 0;
+}
+
+PetscErrorCode PlantTraceEnd(PlantTrace *trace, SNES snes)
+{
+    PetscFunctionBeginUser;
+
+    int kind = TRACE_END;
+    TraceEnd end;
+    SNESConvergedReason reason;
+    PetscLogDouble now;
+    PetscInt iterations, evaluations;
+    PetscReal norm;
+
+    PetscTime(&now);
+
+    SNESGetConvergedReason(snes, &reason);
+    SNESGetIterationNumber(snes, &iterations);
+    SNESGetNumberFunctionEvals(snes, &evaluations);
+    SNESGetFunctionNorm(snes, &norm);
+
+    end.reason = (int)reason;
+    end.iterations = (int)iterations;
+    end.function_evaluations = (int)evaluations;
+    end.norm = (float)norm;
+    end.time = (float)(now - trace->start);
+
+    fwrite(&kind, sizeof(int), 1, trace->fptr);
+    fwrite(&end, sizeof(TraceEnd), 1, trace->fptr);
+    fflush(trace->fptr);
+
+    return 0;
+}
+
+PetscErrorCode PlantTraceMonitor(SNES snes, PetscInt iteration, PetscReal norm, void *ctx)
+{
+    PetscFunctionBeginUser;
+
+    SolverCtx *solver_ctx = (SolverCtx *)ctx;
+    PlantTrace *trace = solver_ctx->trace;
+    int kind = TRACE_ITERATION;
+    TraceIteration record;
+    Vec x, f;
+    Mat jac;
+    const PetscScalar *x_array, *f_array;
+    PetscReal state[NUM_VAR] = {0.0}, update[NUM_VAR], *matrix, condition = 0.0;
+    PetscInt num_unknowns, *rows, i, k;
+
+    SNESGetSolution(snes, &x);
+    SNESGetFunction(snes, &f, NULL, NULL);
+    VecGetSize(x, &num_unknowns);
+
+    VecGetArrayRead(x, &x_array);
+    VecGetArrayRead(f, &f_array);
+
+    record.iteration = (int)iteration;
+    record.norm = (float)norm;
+    record.step = (float)(iteration > 0 ? trace->step : 0.0);
+    record.update_norm = (float)(iteration > 0 ? trace->update_norm : 0.0);
+    record.extra_residual = 0.0f;
+
+    for (k = 0; k < NUM_VAR; k++)
+        record.residual[k] = 0.0f;
+
+    for (i = 0; i < solver_ctx->num_var; i++)
+    {
+        k = solver_ctx->var_index[i];
+        state[k] = x_array[i] * solver_ctx->scale[k];
+        record.residual[k] = (float)f_array[i];
+    }
+
+    for (i = solver_ctx->num_var; i < num_unknowns; i++)
+        record.extra_residual = PetscMax(record.extra_residual, (float)PetscAbsReal(f_array[i]));
+
+    VecRestoreArrayRead(x, &x_array);
+    VecRestoreArrayRead(f, &f_array);
+
+    // The explicit unknowns of the reduced formulation, from one pass of the balance
+    if (solver_ctx->formulation == FORMULATION_REDUCED)
+    {
+        DessalContextBalance(&solver_ctx->dessal_ctx, state, update);
+
+        state[5] = update[5];
+        state[8] = update[8];
+        state[9] = update[9];
+        state[10] = update[10];
+        state[11] = update[11];
+    }
+
+    for (k = 0; k < NUM_VAR; k++)
+        record.state[k] = (float)state[k];
+
+    // The Jacobian holds the one of the step that reached the iterate, none for the initial guess
+    if (iteration > 0)
+    {
+        SNESGetJacobian(snes, &jac, NULL, NULL, NULL);
+
+        PetscMalloc1(num_unknowns, &rows);
+        PetscMalloc1(num_unknowns * num_unknowns, &matrix);
+
+        for (i = 0; i < num_unknowns; i++)
+            rows[i] = i;
+
+        MatGetValues(jac, num_unknowns, rows, num_unknowns, rows, matrix);
+        TraceCondition(num_unknowns, matrix, &condition);
+
+        PetscFree(rows);
+        PetscFree(matrix);
+    }
+
+    record.condition = (float)condition;
+
+    fwrite(&kind, sizeof(int), 1, trace->fptr);
+    fwrite(&record, sizeof(TraceIteration), 1, trace->fptr);
+
+    return 0;
+}
+
+PetscErrorCode PlantTraceLineSearch(SNESLineSearch linesearch, Vec x, Vec y, Vec w, PetscBool *changed_y, PetscBool *changed_w, void *ctx)
+{
+    PetscFunctionBeginUser;
+
+    SolverCtx *solver_ctx = (SolverCtx *)ctx;
+
+    SNESLineSearchGetLambda(linesearch, &solver_ctx->trace->step);
+    VecNorm(y, NORM_2, &solver_ctx->trace->update_norm);
+
+    *changed_y = PETSC_FALSE;
+    *changed_w = PETSC_FALSE;
+
+    return 0;
+}
+
+/*
+Condition number of the Jacobian
+
+The plant system has a few tens of unknowns at most, so the Jacobian is inverted explicitly by Gauss-Jordan elimination with partial
+pivoting and its 1-norm condition number ||J||_1 ||J^-1||_1 is computed exactly, at the cost of a fraction of one finite-difference
+Jacobian. A singular Jacobian has an infinite condition number.
+*/
+
+PetscErrorCode TraceCondition(PetscInt n, const PetscReal matrix[], PetscReal *condition)
+{
+    PetscFunctionBeginUser;
+
+    PetscReal *a, *inverse, norm = 0.0, inverse_norm = 0.0, column, pivot, factor, swap;
+    PetscInt i, j, k, p;
+
+    PetscMalloc1(n * n, &a);
+    PetscMalloc1(n * n, &inverse);
+
+    for (i = 0; i < n * n; i++)
+        a[i] = matrix[i];
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j < n; j++)
+            inverse[i * n + j] = i == j ? 1.0 : 0.0;
+
+    *condition = PETSC_INFINITY;
+
+    for (k = 0; k < n; k++)
+    {
+        for (i = k + 1, p = k; i < n; i++)
+            if (PetscAbsReal(a[i * n + k]) > PetscAbsReal(a[p * n + k]))
+                p = i;
+
+        if (a[p * n + k] == 0.0)
+        {
+            PetscFree(a);
+            PetscFree(inverse);
+
+            return 0;
+        }
+
+        for (j = 0; j < n && p != k; j++)
+        {
+            swap = a[k * n + j];
+            a[k * n + j] = a[p * n + j];
+            a[p * n + j] = swap;
+
+            swap = inverse[k * n + j];
+            inverse[k * n + j] = inverse[p * n + j];
+            inverse[p * n + j] = swap;
+        }
+
+        pivot = a[k * n + k];
+
+        for (j = 0; j < n; j++)
+        {
+            a[k * n + j] /= pivot;
+            inverse[k * n + j] /= pivot;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            if (i == k || a[i * n + k] == 0.0)
+                continue;
+
+            factor = a[i * n + k];
+
+            for (j = 0; j < n; j++)
+            {
+                a[i * n + j] -= factor * a[k * n + j];
+                inverse[i * n + j] -= factor * inverse[k * n + j];
+            }
+        }
+    }
+
+    // Largest absolute column sums of the matrix and of its inverse
+    for (j = 0; j < n; j++)
+    {
+        for (i = 0, column = 0.0; i < n; i++)
+            column += PetscAbsReal(matrix[i * n + j]);
+        norm = PetscMax(norm, column);
+
+        for (i = 0, column = 0.0; i < n; i++)
+            column += PetscAbsReal(inverse[i * n + j]);
+        inverse_norm = PetscMax(inverse_norm, column);
+    }
+
+    *condition = norm * inverse_norm;
+
+    PetscFree(a);
+    PetscFree(inverse);
+
+    return 0;
+}
+
+PetscErrorCode TraceRead(FILE *fptr, TraceRecordKind *kind, TraceBegin *begin, TraceIteration *iteration, TraceEnd *end, PetscBool *found)
+{
+    PetscFunctionBeginUser;
+
+    int value;
+    size_t count = 0;
+
+    *found = fread(&value, sizeof(int), 1, fptr) == 1 ? PETSC_TRUE : PETSC_FALSE;
+
+    if (!*found)
+        return 0;
+
+    PetscCheck(value >= TRACE_BEGIN && value <= TRACE_END, PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Corrupted trace record of kind %d",
+               value);
+
+    *kind = (TraceRecordKind)value;
+
+    switch (*kind)
+    {
+    case TRACE_BEGIN:
+        count = fread(begin, sizeof(TraceBegin), 1, fptr);
+        break;
+    case TRACE_ITERATION:
+        count = fread(iteration, sizeof(TraceIteration), 1, fptr);
+        break;
+    case TRACE_END:
+        count = fread(end, sizeof(TraceEnd), 1, fptr);
+        break;
+    }
+
+    // A record cut short ends the file of a run interrupted during a solve
+    if (count != 1)
+        *found = PETSC_FALSE;
+
+    return 0;
+}
+
+PetscErrorCode PlantTraceClose(PlantTrace *trace)
+{
+    PetscFunctionBeginUser;
+
+    if (trace->fptr)
+        fclose(trace->fptr);
+
+    trace->fptr = NULL;
+
+    return 0;
+}
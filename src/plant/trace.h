@@ -0,0 +1,86 @@
+#ifndef TRACE
+
+#define TRACE
+
+#include "../dessal/dessal.h"
+
+// Magic number opening a trace file ("VAGT") and version of its records
+#define TRACE_MAGIC 0x54474156
+#define TRACE_VERSION 1
+
+// Number of inlet conditions recorded at the beginning of a solve
+#define NUM_TRACE_INLETS 6
+
+// Names of the inlet conditions recorded at the beginning of a solve, in the order of the records
+static const char *const trace_inlet_names[] = {"feed_mass_flow_rate", "cool_mass_flow_rate", "entry_temperature_feed",
+                                                "entry_temperature_cool", "entry_salinity_feed", "membrane_area"};
+
+// Kinds of the records of a trace file, each record being its kind followed by its body
+typedef enum
+{
+    TRACE_BEGIN,     // Beginning of a solve (TraceBegin)
+    TRACE_ITERATION, // Iterate of the nonlinear solver (TraceIteration)
+    TRACE_END        // End of a solve (TraceEnd)
+} TraceRecordKind;
+
+// Body of the record of the beginning of a solve
+typedef struct
+{
+    int num_unknowns, formulation; // Size of the plant system and its formulation
+    float inlet[NUM_TRACE_INLETS];
+} TraceBegin;
+
+// Body of the record of an iterate, in single precision, which is enough to diagnose the convergence and halves the size of the file
+typedef struct
+{
+    int iteration;
+    float norm;           // Norm of the residual
+    float step;           // Step length of the line search that reached the iterate (0 for the initial guess)
+    float update_norm;    // Norm of the Newton direction of that step, in the scaled unknowns
+    float condition;      // 1-norm condition number of the Jacobian of that step (0 for the initial guess)
+    float state[NUM_DESSAL_STATE];    // Iterate, in physical units (the explicit unknowns of the reduced formulation reconstructed)
+    float residual[NUM_DESSAL_STATE]; // Scaled residual of each unknown (0 for the explicit unknowns of the reduced formulation)
+    float extra_residual; // Largest scaled residual of the target equations of an inverse problem and the closures of the recycle loop
+} TraceIteration;
+
+// Body of the record of the end of a solve
+typedef struct
+{
+    int reason, iterations, function_evaluations;
+    float norm, time;
+} TraceEnd;
+
+// Data structure containing the convergence trace recorder of a solver context
+typedef struct
+{
+    FILE *fptr;
+    PetscReal step, update_norm; // Latest line search
+    PetscLogDouble start;
+} PlantTrace;
+
+// Function to open the trace file of a recorder for appending, one file per MPI rank (the file name followed by the rank beyond the first)
+PetscErrorCode PlantTraceOpen(PlantTrace *trace, const char file[]);
+
+// Function to record the beginning of a solve of the plant system held by a solver context
+PetscErrorCode PlantTraceBegin(PlantTrace *trace, const DessalContext *dessal_ctx, PetscInt num_unknowns, PetscInt formulation);
+
+// Function to record the end of a solve, flushing the records of the solve to the trace file
+PetscErrorCode PlantTraceEnd(PlantTrace *trace, SNES snes);
+
+// SNES monitor recording each iterate of the plant system held by a solver context (given as the context of the monitor)
+PetscErrorCode PlantTraceMonitor(SNES snes, PetscInt iteration, PetscReal norm, void *ctx);
+
+// Line search post-check recording the step length and the norm of the Newton direction of each step (the solver context being its context)
+PetscErrorCode PlantTraceLineSearch(SNESLineSearch linesearch, Vec x, Vec y, Vec w, PetscBool *changed_y, PetscBool *changed_w, void *ctx);
+
+// Function to estimate the 1-norm condition number of a small dense matrix (row-major) by explicit inversion
+PetscErrorCode TraceCondition(PetscInt n, const PetscReal matrix[], PetscReal *condition);
+
+// Function to read the next record of a trace file, returning its kind and body (found set to false at the end of the file, or at a record
+// cut short by an interrupted run)
+PetscErrorCode TraceRead(FILE *fptr, TraceRecordKind *kind, TraceBegin *begin, TraceIteration *iteration, TraceEnd *end, PetscBool *found);
+
+// Function to close the trace file of a recorder
+PetscErrorCode PlantTraceClose(PlantTrace *trace);
+
+#endif
@@ -0,0 +1,41 @@
+/*
+Precision of the bodies compiled twice
+
+The correlations of the properties, the transfer laws and the balance of the desalination module are written once, in terms of the macros
+below, and included twice by their source files: in double precision (PetscReal, no suffix), then with SINGLE_PRECISION defined in single
+precision (float arithmetic and literals, names suffixed with Single and fields with _single). This file has no include guard, so that each
+inclusion selects the precision of the body that follows it.
+*/
+
+#undef REAL
+#undef REAL_C
+#undef REAL_NAME
+#undef REAL_FIELD
+#undef REAL_POW
+#undef REAL_EXP
+#undef REAL_LOG10
+#undef REAL_SQRT
+
+#ifdef SINGLE_PRECISION
+
+#define REAL float
+#define REAL_C(x) x##f
+#define REAL_NAME(name) name##Single
+#define REAL_FIELD(name) name##_single
+#define REAL_POW powf
+#define REAL_EXP expf
+#define REAL_LOG10 log10f
+#define REAL_SQRT sqrtf
+
+#else
+
+#define REAL PetscReal
+#define REAL_C(x) x
+#define REAL_NAME(name) name
+#define REAL_FIELD(name) name
+#define REAL_POW PetscPowReal
+#define REAL_EXP PetscExpReal
+#define REAL_LOG10 PetscLog10Real
+#define REAL_SQRT PetscSqrtReal
+
+#endif
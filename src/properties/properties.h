@@ -17,10 +17,46 @@ typedef struct
               vapor_pressure, latent_heat_vaporization;
 } SaltWaterProperties;
 
+// Data structure containing the salinity-only terms of the correlations for the thermophysical properties of salt water
+typedef struct
+{
+    PetscReal density[4], specific_heat[4], dyn_viscosity[2], thermal_conductivity, activity_coefficient, latent_heat_vaporization;
+} SaltWaterSalinityTerms;
+
+// Function that computes the salinity-only terms of the thermophysical properties of salt water
+PetscErrorCode SaltWaterSalinityTermsBuild(SaltWaterSalinityTerms *terms, PetscReal salinity);
+
 // Function that updates the thermophysical properties of salt water
 PetscErrorCode SaltWaterPropBuild(SaltWaterProperties *salt_water_prop, PetscReal temperature, PetscReal salinity);
 
+// Function that updates the thermophysical properties of salt water from precomputed salinity-only terms
+PetscErrorCode SaltWaterPropBuildFromTerms(SaltWaterProperties *salt_water_prop, PetscReal temperature, const SaltWaterSalinityTerms *terms);
+
 // Function that updates the thermophysical properties of moist air
 PetscErrorCode MoistAirPropBuild(MoistAirProperties *moist_air_prop, PetscReal temperature);
 
+// Data structures of the thermophysical properties and of the salinity-only terms in single precision, for the balance of the
+// desalination module in single precision (the correlations are compiled in both precisions from the same body)
+typedef struct
+{
+    float density, specific_heat, dyn_viscosity, thermal_conductivity, prandtl;
+} MoistAirPropertiesSingle;
+
+typedef struct
+{
+    float density, specific_heat, dyn_viscosity, thermal_conductivity, prandtl, vapor_pressure, latent_heat_vaporization;
+} SaltWaterPropertiesSingle;
+
+typedef struct
+{
+    float density[4], specific_heat[4], dyn_viscosity[2], thermal_conductivity, activity_coefficient, latent_heat_vaporization;
+} SaltWaterSalinityTermsSingle;
+
+// Functions that compute the thermophysical properties in single precision, as their double-precision counterparts
+PetscErrorCode SaltWaterSalinityTermsBuildSingle(SaltWaterSalinityTermsSingle *terms, float salinity);
+PetscErrorCode SaltWaterPropBuildSingle(SaltWaterPropertiesSingle *salt_water_prop, float temperature, float salinity);
+PetscErrorCode SaltWaterPropBuildFromTermsSingle(SaltWaterPropertiesSingle *salt_water_prop, float temperature,
+                                                 const SaltWaterSalinityTermsSingle *terms);
+PetscErrorCode MoistAirPropBuildSingle(MoistAirPropertiesSingle *moist_air_prop, float temperature);
+
 #endif
\ No newline at end of file
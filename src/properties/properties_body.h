@@ -0,0 +1,367 @@
+/*
+Body of the correlations of the thermophysical properties, compiled once per precision by properties.c (see precision.h)
+*/
+
+/*
+Salt water thermophysical propeties
+
+Reference: K.G. Nayar, M.H. Sharqawy, L.D. Banchik, J.H. Lienhard IV, Thermophysical properties of seawater: A review and new correlations that
+           include pressure dependence. Desalination 390 (2016) 1-24. https://doi.org/10.1016/j.desal.2016.02.024
+
+The salinity-only parts of the correlations are split from the temperature-dependent ones, so that they are computed once for streams of
+fixed salinity
+*/
+
+PetscErrorCode REAL_NAME(SaltWaterDensityTerms)(REAL_NAME(SaltWaterSalinityTerms) *terms, REAL salinity)
+{
+    REAL b[5] = {8.020e2,
+                 -2.001,
+                 1.677e-2,
+                 -3.060e-5,
+                 -1.613e-5};
+
+    // Coefficients of the salinity part as a polynomial of the temperature
+    terms->density[0] = b[0] * salinity;
+    terms->density[1] = b[1] * salinity;
+    terms->density[2] = b[2] * salinity + b[4] * salinity * salinity;
+    terms->density[3] = b[3] * salinity;
+
+    return 0;
+}
+
+REAL REAL_NAME(SaltWaterDensity)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL a[5] = {9.999e2,
+                 2.034e-2,
+                 -6.162e-3,
+                 2.261e-5,
+                 -4.657e-8};
+    REAL temperature_part, salinity_part;
+
+    temperature_part = a[0] + a[1] * temperature;
+    temperature_part += a[2] * temperature * temperature;
+    temperature_part += a[3] * temperature * temperature * temperature;
+    temperature_part += a[4] * temperature * temperature * temperature * temperature;
+
+    salinity_part = terms->density[0];
+    salinity_part += terms->density[1] * temperature;
+    salinity_part += terms->density[2] * temperature * temperature;
+    salinity_part += terms->density[3] * temperature * temperature * temperature;
+
+    return temperature_part + salinity_part;
+}
+
+PetscErrorCode REAL_NAME(SaltWaterSpecificHeatTerms)(REAL_NAME(SaltWaterSalinityTerms) *terms, REAL salinity)
+{
+    REAL a[3] = {5328.0,
+                 -9.76e1,
+                 4.04e-1};
+    REAL b[3] = {-6.913,
+                 7.351e-1,
+                 -3.15e-3};
+    REAL c[3] = {9.6e-3,
+                 -1.927e-3,
+                 8.23e-6};
+    REAL d[3] = {2.5e-6,
+                 1.666e-6,
+                 -7.125e-9};
+    REAL alt_salinity, alt_salinity2;
+
+    alt_salinity = REAL_C(1000.0) * salinity;
+    alt_salinity2 = alt_salinity * alt_salinity;
+
+    terms->specific_heat[0] = a[0] + a[1] * alt_salinity + a[2] * alt_salinity2;
+    terms->specific_heat[1] = b[0] + b[1] * alt_salinity + b[2] * alt_salinity2;
+    terms->specific_heat[2] = c[0] + c[1] * alt_salinity + c[2] * alt_salinity2;
+    terms->specific_heat[3] = d[0] + d[1] * alt_salinity + d[2] * alt_salinity2;
+
+    return 0;
+}
+
+REAL REAL_NAME(SaltWaterSpecificHeat)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL A = terms->specific_heat[0],
+         B = terms->specific_heat[1],
+         C = terms->specific_heat[2],
+         D = terms->specific_heat[3];
+    REAL abs_temperature, specific_heat;
+
+    abs_temperature = temperature + REAL_C(273.15);
+
+    specific_heat = A + B * abs_temperature + C * abs_temperature * abs_temperature;
+    specific_heat += D * abs_temperature * abs_temperature * abs_temperature;
+
+    return specific_heat;
+}
+
+// Exceptionally taken from https://doi.org/10.5004/dwt.2010.1079
+PetscErrorCode REAL_NAME(SaltWaterDynViscosityTerms)(REAL_NAME(SaltWaterSalinityTerms) *terms, REAL salinity)
+{
+    REAL a[3] = {0.0428,
+                 0.00123,
+                 0.000131};
+    REAL b[3] = {-0.03724,
+                 0.01859,
+                 -0.00271};
+    REAL alt_salinity, ionic_strength, ionic_strength2, ionic_strength3;
+
+    alt_salinity = salinity / REAL_C(1.00472);
+    ionic_strength = REAL_C(19.915) * alt_salinity / (REAL_C(1.0) - REAL_C(1.00487) * alt_salinity);
+    ionic_strength2 = ionic_strength * ionic_strength;
+    ionic_strength3 = ionic_strength * ionic_strength2;
+
+    terms->dyn_viscosity[0] = a[0] * ionic_strength + a[1] * ionic_strength2 + a[2] * ionic_strength3;
+    terms->dyn_viscosity[1] = b[0] * ionic_strength + b[1] * ionic_strength2 + b[2] * ionic_strength3;
+
+    return 0;
+}
+
+REAL REAL_NAME(SaltWaterDynViscosity)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL c[3] = {4.2844e-5,
+                 0.157,
+                 -91.296};
+    REAL pure_viscosity, viscosity, alt_temperature;
+
+    alt_temperature = temperature + REAL_C(64.993);
+
+    pure_viscosity = c[1] * alt_temperature * alt_temperature + c[2];
+    pure_viscosity = c[0] + REAL_C(1.0) / pure_viscosity;
+
+    viscosity = terms->dyn_viscosity[1];
+    viscosity *= REAL_LOG10(REAL_C(1000.0) * pure_viscosity);
+    viscosity += terms->dyn_viscosity[0];
+    viscosity = pure_viscosity * REAL_POW(REAL_C(10.0), viscosity);
+
+    return viscosity;
+}
+
+PetscErrorCode REAL_NAME(SaltWaterThermalConductivityTerms)(REAL_NAME(SaltWaterSalinityTerms) *terms, REAL salinity)
+{
+    REAL alt_salinity;
+
+    alt_salinity = REAL_C(1000.0) * salinity;
+
+    terms->thermal_conductivity = REAL_C(1.0) + REAL_C(0.00022) * alt_salinity;
+
+    return 0;
+}
+
+REAL REAL_NAME(SaltWaterThermalConductivity)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL b[4] = {0.797015,
+                 -0.251242,
+                 0.096437,
+                 -0.032696};
+    REAL dimless_temperature, thermal_conductivity;
+
+    dimless_temperature = (temperature + REAL_C(273.15)) / REAL_C(300.0);
+
+    thermal_conductivity = b[0] * REAL_POW(dimless_temperature, -REAL_C(0.194));
+    thermal_conductivity += b[1] * REAL_POW(dimless_temperature, -REAL_C(4.717));
+    thermal_conductivity += b[2] * REAL_POW(dimless_temperature, -REAL_C(6.385));
+    thermal_conductivity += b[3] * REAL_POW(dimless_temperature, -REAL_C(2.134));
+    thermal_conductivity /= terms->thermal_conductivity;
+
+    return thermal_conductivity;
+}
+
+// The vapor pressure framework was conducted using https://doi.org/10.1016/j.ijheatmasstransfer.2013.07.051
+REAL REAL_NAME(PureVaporPressure)(REAL temperature)
+{
+    REAL vapor_pressure;
+
+    vapor_pressure = REAL_C(23.1964) - REAL_C(3816.44) / (temperature + REAL_C(227.02));
+    vapor_pressure = REAL_EXP(vapor_pressure);
+
+    return vapor_pressure;
+}
+
+REAL REAL_NAME(ActivityCoefficient)(REAL salinity)
+{
+    REAL activity_coefficient, molar_fraction;
+
+    molar_fraction = (REAL)water_molar_mass * salinity / ((REAL_C(1.0) - salinity) * (REAL)salt_molar_mass + salinity * (REAL)water_molar_mass);
+
+    activity_coefficient = REAL_C(1.0) - REAL_C(0.5) * molar_fraction - REAL_C(10.0) * molar_fraction * molar_fraction;
+    activity_coefficient *= (REAL_C(1.0) - molar_fraction);
+
+    return activity_coefficient;
+}
+
+REAL REAL_NAME(VaporPressure)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL pure_vapor_pressure;
+
+    pure_vapor_pressure = REAL_NAME(PureVaporPressure)(temperature);
+
+    return pure_vapor_pressure * terms->activity_coefficient;
+}
+
+// Exceptionally taken from https://doi.org/10.5004/dwt.2010.1079
+REAL REAL_NAME(SaltWaterLatentHeat)(REAL temperature, const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    REAL a[5] = {2.501e6,
+                 -2.369e3,
+                 2.678e-1,
+                 -8.103e-3,
+                 -2.079e-5};
+    REAL pure_latent_heat, latent_heat_vaporization;
+
+    pure_latent_heat = a[0] + a[1] * temperature;
+    pure_latent_heat += a[2] * temperature * temperature;
+    pure_latent_heat += a[3] * temperature * temperature * temperature;
+    pure_latent_heat += a[4] * temperature * temperature * temperature * temperature;
+
+    latent_heat_vaporization = pure_latent_heat * terms->latent_heat_vaporization;
+
+    return latent_heat_vaporization;
+}
+
+PetscErrorCode REAL_NAME(SaltWaterSalinityTermsBuild)(REAL_NAME(SaltWaterSalinityTerms) *terms, REAL salinity)
+{
+    PetscFunctionBeginUser;
+
+    REAL_NAME(SaltWaterDensityTerms)(terms, salinity);
+    REAL_NAME(SaltWaterSpecificHeatTerms)(terms, salinity);
+    REAL_NAME(SaltWaterDynViscosityTerms)(terms, salinity);
+    REAL_NAME(SaltWaterThermalConductivityTerms)(terms, salinity);
+
+    terms->activity_coefficient = REAL_NAME(ActivityCoefficient)(salinity);
+    terms->latent_heat_vaporization = REAL_C(1.0) - salinity;
+
+    return 0;
+}
+
+PetscErrorCode REAL_NAME(SaltWaterPropBuild)(REAL_NAME(SaltWaterProperties) *salt_water_prop, REAL temperature, REAL salinity)
+{
+    PetscFunctionBeginUser;
+
+    REAL_NAME(SaltWaterSalinityTerms) terms;
+
+    REAL_NAME(SaltWaterSalinityTermsBuild)(&terms, salinity);
+    REAL_NAME(SaltWaterPropBuildFromTerms)(salt_water_prop, temperature, &terms);
+
+    return 0;
+}
+
+PetscErrorCode REAL_NAME(SaltWaterPropBuildFromTerms)(REAL_NAME(SaltWaterProperties) *salt_water_prop, REAL temperature,
+                                                      const REAL_NAME(SaltWaterSalinityTerms) *terms)
+{
+    PetscFunctionBeginUser;
+
+    REAL density, specific_heat, dyn_viscosity, thermal_conductivity, vapor_pressure, latent_heat_vaporization;
+
+    density = REAL_NAME(SaltWaterDensity)(temperature, terms);
+    specific_heat = REAL_NAME(SaltWaterSpecificHeat)(temperature, terms);
+    dyn_viscosity = REAL_NAME(SaltWaterDynViscosity)(temperature, terms);
+    thermal_conductivity = REAL_NAME(SaltWaterThermalConductivity)(temperature, terms);
+    vapor_pressure = REAL_NAME(VaporPressure)(temperature, terms);
+    latent_heat_vaporization = REAL_NAME(SaltWaterLatentHeat)(temperature, terms);
+
+    salt_water_prop->density = density;
+    salt_water_prop->specific_heat = specific_heat;
+    salt_water_prop->dyn_viscosity = dyn_viscosity;
+    salt_water_prop->thermal_conductivity = thermal_conductivity;
+    salt_water_prop->prandtl = dyn_viscosity * specific_heat / thermal_conductivity;
+    salt_water_prop->vapor_pressure = vapor_pressure;
+    salt_water_prop->latent_heat_vaporization = latent_heat_vaporization;
+
+    return 0;
+}
+
+/*
+Moist air properties
+
+Reference: P.T. Tsilingiris, Review and critical comparative evaluation of moist air thermophysical properties at the temperature range between
+           0 and 100 °C for Engineering Calculations. Renew. and Sust. Energy Reviews 83 (2018) 50-63. https://doi.org/10.1016/j.rser.2017.10.072
+
+Assumption: Air saturated with water vapor (RH = 100%)
+*/
+
+REAL REAL_NAME(MoistAirDensity)(REAL temperature)
+{
+    REAL sd[4] = {1.293393662,
+                  -5.538444326e-3,
+                  3.860201577e-5,
+                  -5.2536065e-7};
+    REAL density;
+
+    density = sd[0] + sd[1] * temperature;
+    density += sd[2] * temperature * temperature;
+    density += sd[3] * temperature * temperature * temperature;
+
+    return density;
+}
+
+REAL REAL_NAME(MoistAirSpecificHeat)(REAL temperature)
+{
+    REAL sc[6] = {1.00457142,
+                  2.05063275e-3,
+                  -1.6315370e-4,
+                  6.2123003e-6,
+                  -8.8304788e-8,
+                  5.07130703e-10};
+    REAL specific_heat;
+
+    specific_heat = sc[0] + sc[1] * temperature;
+    specific_heat += sc[2] * temperature * temperature;
+    specific_heat += sc[3] * temperature * temperature * temperature;
+    specific_heat += sc[4] * temperature * temperature * temperature * temperature;
+    specific_heat += sc[5] * temperature * temperature * temperature * temperature * temperature;
+    specific_heat *= REAL_C(1000.0);
+
+    return specific_heat;
+}
+
+REAL REAL_NAME(MoistAirDynViscosity)(REAL temperature)
+{
+    REAL sv[5] = {1.715747771e-5,
+                  4.722402075e-8,
+                  -3.663027156e-10,
+                  1.873236686e-12,
+                  -8.050218737e-14};
+    REAL dyn_viscosity;
+
+    dyn_viscosity = sv[0] + sv[1] * temperature;
+    dyn_viscosity += sv[2] * temperature * temperature;
+    dyn_viscosity += sv[3] * temperature * temperature * temperature;
+    dyn_viscosity += sv[4] * temperature * temperature * temperature * temperature;
+
+    return dyn_viscosity;
+}
+
+REAL REAL_NAME(MoistAirThermalConductivity)(REAL temperature)
+{
+    REAL sk[5] = {24.0073953e-3,
+                  7.278410162e-5,
+                  -1.788037411e-7,
+                  -1.351703529e-9,
+                  -3.322412767e-11};
+    REAL thermal_conductivity;
+
+    thermal_conductivity = sk[0] + sk[1] * temperature;
+    thermal_conductivity += sk[2] * temperature * temperature;
+    thermal_conductivity += sk[3] * temperature * temperature * temperature;
+    thermal_conductivity += sk[4] * temperature * temperature * temperature * temperature;
+
+    return thermal_conductivity;
+}
+
+PetscErrorCode REAL_NAME(MoistAirPropBuild)(REAL_NAME(MoistAirProperties) *moist_air_prop, REAL temperature)
+{
+    REAL density, specific_heat, dyn_viscosity, thermal_conductivity;
+
+    density = REAL_NAME(MoistAirDensity)(temperature);
+    specific_heat = REAL_NAME(MoistAirSpecificHeat)(temperature);
+    dyn_viscosity = REAL_NAME(MoistAirDynViscosity)(temperature);
+    thermal_conductivity = REAL_NAME(MoistAirThermalConductivity)(temperature);
+
+    moist_air_prop->density = density;
+    moist_air_prop->specific_heat = specific_heat;
+    moist_air_prop->dyn_viscosity = dyn_viscosity;
+    moist_air_prop->thermal_conductivity = thermal_conductivity;
+    moist_air_prop->prandtl = dyn_viscosity * specific_heat / thermal_conductivity;
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "recycle.h"
+
+/*
+Balance of the recycle loop
+
+A fraction of the brine leaving the module is returned to the feed and mixed with the makeup, which is either fresh seawater at the coolant
+inlet conditions or, with heat recovery, the coolant preheated in the module; the makeup flow rate complements the recycled brine up to
+the feed flow rate, and the remaining brine and coolant are discharged. The mixture is brought to the feed inlet by the heater, which
+either holds the feed inlet temperature (its power being an output) or delivers a fixed power (the feed inlet temperature being an output).
+The streams are mixed adiabatically with a common specific heat, the one of the mixed feed.
+*/
+
+PetscErrorCode RecycleBalance(const RecycleData *recycle_data, const DessalData *dessal_data, const PetscReal state[],
+                              RecycleStreams *streams)
+{
+    PetscFunctionBeginUser;
+
+    SaltWaterProperties mix_prop;
+    PetscReal feed_mass_flow_rate = dessal_data->feed_mass_flow_rate,
+              makeup_temperature = recycle_data->heat_recovery ? state[1] : dessal_data->entry_temperature_cool,
+              makeup_salinity = dessal_data->entry_salinity_cool;
+
+    // Mass balances of the mixer and the splitters
+    streams->recycle_flow_rate = recycle_data->brine_recycle_fraction * state[11];
+    streams->makeup_flow_rate = feed_mass_flow_rate - streams->recycle_flow_rate;
+    streams->brine_discharge_rate = state[11] - streams->recycle_flow_rate;
+    streams->cool_discharge_rate = dessal_data->cool_mass_flow_rate - (recycle_data->heat_recovery ? streams->makeup_flow_rate : 0.0);
+
+    // Salt and energy balances of the mixer
+    streams->mix_temperature = (streams->makeup_flow_rate * makeup_temperature + streams->recycle_flow_rate * state[0]) /
+                               feed_mass_flow_rate;
+    streams->mix_salinity = (streams->makeup_flow_rate * makeup_salinity + streams->recycle_flow_rate * state[7]) / feed_mass_flow_rate;
+
+    // Energy balance of the heater
+    SaltWaterPropBuild(&mix_prop, streams->mix_temperature, streams->mix_salinity);
+
+    if (recycle_data->fixed_heater_power)
+    {
+        streams->heater_power = recycle_data->heater_power;
+        streams->heater_temperature = streams->mix_temperature + streams->heater_power / (feed_mass_flow_rate * mix_prop.specific_heat);
+    }
+    else
+    {
+        streams->heater_temperature = dessal_data->entry_temperature_feed;
+        streams->heater_power = feed_mass_flow_rate * mix_prop.specific_heat * (streams->heater_temperature - streams->mix_temperature);
+    }
+
+    return 0;
+}
+
+/*
+Feasibility of the recycle loop
+
+The closure of the loop is a nonlinear system in its own right, and with a fixed heater power it may converge (or wander) to states no
+plant can reach: a heater outlet above boiling, a makeup or a discharge flowing backwards. Such states are outside the range of the
+property correlations and are rejected instead of being reported as solutions.
+*/
+
+PetscErrorCode RecycleFeasible(const RecycleStreams *streams, const PetscReal state[], PetscBool *feasible)
+{
+    PetscFunctionBeginUser;
+
+    const PetscReal temperature_min = 0.0, temperature_max = 120.0;
+    PetscReal temperatures[4] = {streams->mix_temperature, streams->heater_temperature, state[0], state[1]};
+    PetscInt i;
+
+    *feasible = streams->makeup_flow_rate >= 0.0 && streams->recycle_flow_rate >= 0.0 && streams->brine_discharge_rate >= 0.0 &&
+                        streams->cool_discharge_rate >= 0.0
+                    ? PETSC_TRUE
+                    : PETSC_FALSE;
+
+    for (i = 0; i < 4; i++)
+        if (!(temperatures[i] >= temperature_min && temperatures[i] <= temperature_max))
+            *feasible = PETSC_FALSE;
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef RECYCLE
+
+#define RECYCLE
+
+#include "../entrydata/entrydata.h"
+#include "../properties/properties.h"
+
+// Data structure containing the streams of the recycle loop around the desalination module
+typedef struct
+{
+    // Mass flow rates of the makeup (fresh seawater or preheated coolant), of the recycled brine and of the discharged brine and coolant
+    PetscReal makeup_flow_rate, recycle_flow_rate, brine_discharge_rate, cool_discharge_rate;
+
+    // Feed mixed from the makeup and the recycled brine, ahead of the heater
+    PetscReal mix_temperature, mix_salinity;
+
+    // Temperature of the feed leaving the heater and power delivered by the heater
+    PetscReal heater_temperature, heater_power;
+} RecycleStreams;
+
+// Function to execute the balance of the recycle loop, computing its streams from the inlet conditions and the outlets of the desalination
+// module (the solution of the plant system)
+PetscErrorCode RecycleBalance(const RecycleData *recycle_data, const DessalData *dessal_data, const PetscReal state[],
+                              RecycleStreams *streams);
+
+// Function to check that the streams of the recycle loop are physical: nonnegative flow rates and loop temperatures (mixed feed, heater
+// outlet and outlets of the module) within the range of the seawater property correlations
+PetscErrorCode RecycleFeasible(const RecycleStreams *streams, const PetscReal state[], PetscBool *feasible);
+
+#endif